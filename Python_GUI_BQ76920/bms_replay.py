@@ -0,0 +1,1127 @@
+#Offline replay of recorded BQ76920 sessions
+#
+#Feeds recorded raw register values through the firmware's own conversion
+#math (rtos_ga202.X/src/app/bms_math.c, compiled here as a host shared
+#library) so the Coulomb Counter and temperature logic can be tuned without
+#hardware. Outputs SoC error and temperature curves as CSV (and a PNG if
+#matplotlib is installed).
+#
+#Input formats:
+#  1. CSV with a header row. Required columns: tick (ms), cc_raw.
+#     Optional columns: ts1_raw, ref_soc (reference SoC in %, e.g. from a
+#     cycler), any of vc1_raw..vc15_raw, bat_raw, fets_off (1 while CHG and
+#     DSG are both off, feeds the CC offset calibration). Raw values may be
+#     decimal or 0x-prefixed hex.
+#  2. A captured UART log (GUI output or any terminal capture). The
+#     "Current: ... (raw: 0x...., tick: N)" lines supply cc_raw/tick, the
+#     "Temp: ... (raw: 0x....)" lines supply ts1_raw and "CC offset: ..."
+#     lines the firmware's CC offset. Values printed by the firmware are
+#     checked against the replayed ones.
+#
+#With --ocv the replay also initialises SoC from the cell voltages and
+#re-anchors it after rest periods, like the firmware does (needs the vcN_raw
+#columns; --afe and --cells pick which VC inputs hold cells, as
+#cell_topology.c does). --ekf runs the fixed-point Kalman filter (soc_ekf.c) instead, the
+#firmware's "soc ekf" engine. The CC offset calibration, dead-band and
+#capacity learning (capacity_learn.c) are always applied, as in the
+#firmware. --synthetic HOURS generates a cycling session with a wandering
+#Coulomb Counter offset and optionally an ageing pack (--true-capacity,
+#--fade) instead of reading a file, and compares the engines with and
+#without those corrections. --check-adc compares the firmware's batched
+#cell and pack conversion (bms_cells_raw_to_mV(), bms_pack_raw_to_mV())
+#with their definitions over every raw code. --sampling HOURS runs the
+#firmware's measurement rate tiers (sample_rate.c) over a simulated pack
+#and compares them with fixed periods: measurements and I2C time per hour,
+#charge counted against the true charge, and how long a current step or a
+#cell nearing OV/UV goes unseen. --metering HOURS runs the Coulomb Counter
+#metering modes (cc_meter.c: continuous, periodic and on-demand one-shots,
+#with readings lost to bus errors) over a simulated standby pack and
+#compares the charge they count with the true charge, for the trapezoid
+#weighting the firmware uses and for holding each reading over its interval.
+#
+#Usage:
+#  python bms_replay.py session.csv -o curves.csv
+#  python bms_replay.py uart_capture.txt --plot curves.png
+#  python bms_replay.py --synthetic 48 --cc-offset-lsb 0.5
+#  python bms_replay.py --synthetic 500 --profile full --true-capacity 2900 --fade 5
+#  python bms_replay.py --check-adc
+#  python bms_replay.py --sampling 24
+#  python bms_replay.py --metering 24
+
+
+import argparse
+import bisect
+import csv
+import ctypes
+import math
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE_APP_DIR = os.path.join(HERE, "..", "rtos_ga202.X", "src", "app")
+MATH_SOURCES = ["bms_math.c", "soc_ekf.c", "capacity_learn.c", "cell_stats.c", "cell_topology.c",
+                "sample_rate.c", "cc_meter.c"]
+BUILD_DIR = os.path.join(HERE, "build")
+
+#Same defaults as taskBQ76920.c
+DEFAULT_CAPACITY_MAH = 3200.0
+DEFAULT_CC_GAIN_UV = 369.0
+DEFAULT_SHUNT_OHM = 0.01
+DEFAULT_ADC_GAIN_UV = 365
+DEFAULT_ADC_OFFSET_MV = 0
+CELL_ERROR_RAW_MIN = 10         #BMS_CELL_ERROR_RAW_MIN
+CELL_ERROR_MV_MAX = 5000        #BMS_CELL_ERROR_MV_MAX
+ADC_CHECK_BATCH = 16            #bms_cells_raw_to_mV() returns a 16-bit mask
+DEFAULT_CC_DEADBAND_MA = 20
+CELL_STATS_WINDOW = 16
+CELL_STATS_BYTES = 2048                #room for cell_stats_t of 15 cells, only used through its API
+
+CHEMISTRIES = {"nmc": 0, "lfp": 1}     #bms_chem_t
+AFES = {"bq76920": 0, "bq76930": 1, "bq76940": 2}    #bms_afe_t
+VC_INPUTS = 15                         #cells lists hold VC1..VC15, None if not recorded
+
+#soc_model in taskBQ76920.c, noise terms in Q8.24
+EKF_R0_MOHM = 50
+EKF_R1_MOHM = 30
+EKF_TAU_S = 60
+EKF_Q_SOC = 1e-6
+EKF_Q_V1 = 0.01
+EKF_R_MEAS = 4.0
+EKF_SIGMA_PERCENT = 5.0
+
+#sampling_config in taskBQ76920.c
+SAMPLE_PERIODS_MS = (8000, 2000, 250)  #idle, normal, fast
+SAMPLE_IDLE_MA = 50
+SAMPLE_FAST_MA = 3000
+SAMPLE_FAST_MV_PER_S = 5
+SAMPLE_LIMIT_MARGIN_MV = 100
+SAMPLE_HYSTERESIS_PERCENT = 20
+SAMPLE_CALM_MS = 15000
+SAMPLE_TIER_NAMES = ("idle", "normal", "fast")
+SAMPLE_TIER_NORMAL = 1
+SAMPLING_STEP_MS = 250                 #CC conversion, the resolution of the --sampling pack
+SAMPLING_UV_MV = 3000                  #--sampling trip points
+SAMPLING_OV_MV = 4200
+SAMPLING_STEP_A = 0.5                  #a current change this large is an event to react to
+MEASURE_I2C_MS = 4                     #CC, FET and cell frame reads at 100 kHz
+METERING_PERIODS_S = (8, 60, 600, 3600)  #--metering periodic one-shot cadences
+METERING_DEMAND_S = (60, 900)          #--metering on-demand gaps, uniform
+METERING_LOST = 0.02                   #share of readings a bus error loses
+METERING_SEEDS = 20                    #--metering sessions per profile
+
+CURRENT_LINE = re.compile(r"Current:\s*(-?[\d.]+) A \| SoC:\s*(-?[\d.]+) % \(raw: 0x([0-9A-Fa-f]{4}), tick: (\d+)\)")
+TEMP_LINE = re.compile(r"Temp:\s*(-?[\d.]+|nan|-?inf) C \(raw: 0x([0-9A-Fa-f]{4})\)")
+CC_OFFSET_LINE = re.compile(r"CC offset:\s*(-?[\d.]+) LSB")
+
+
+class BmsTemp(ctypes.Structure):
+    _fields_ = [("v_ts1", ctypes.c_float),
+                ("r_therm", ctypes.c_float),
+                ("temp_c", ctypes.c_float)]
+
+
+class BmsAdcScale(ctypes.Structure):
+    _fields_ = [("gain_uV", ctypes.c_uint16),
+                ("offset_mV", ctypes.c_int8),
+                ("gain_recip", ctypes.c_uint16)]
+
+
+class BmsRest(ctypes.Structure):
+    _fields_ = [("avg_A", ctypes.c_float),
+                ("rest_sec", ctypes.c_float),
+                ("anchored", ctypes.c_bool)]
+
+
+class BmsCcCal(ctypes.Structure):
+    _fields_ = [("offset_lsb", ctypes.c_float),
+                ("sum", ctypes.c_int32),
+                ("count", ctypes.c_uint8),
+                ("valid", ctypes.c_bool)]
+
+
+class CellStat(ctypes.Structure):
+    _fields_ = [("min_mV", ctypes.c_uint16),
+                ("max_mV", ctypes.c_uint16),
+                ("mean_mV", ctypes.c_float),
+                ("sd_mV", ctypes.c_float)]
+
+
+class CapLearn(ctypes.Structure):
+    _fields_ = [("nominal_mAh", ctypes.c_float),
+                ("learned_mAh", ctypes.c_float),
+                ("cycle_mAh", ctypes.c_float),
+                ("cycles", ctypes.c_uint16),
+                ("learn_count", ctypes.c_uint16),
+                ("anchor_soc", ctypes.c_float),
+                ("since_anchor_mAh", ctypes.c_float),
+                ("throughput_mAh", ctypes.c_float),
+                ("full_mV", ctypes.c_uint16),
+                ("at_full", ctypes.c_bool)]
+
+
+class SocEkfModel(ctypes.Structure):
+    _fields_ = [("chem", ctypes.c_int),
+                ("capacity_mAh", ctypes.c_uint16),
+                ("r0_mohm", ctypes.c_uint16),
+                ("r1_mohm", ctypes.c_uint16),
+                ("tau_s", ctypes.c_uint16),
+                ("q_soc", ctypes.c_int32),
+                ("q_v1", ctypes.c_int32),
+                ("r_meas", ctypes.c_int32)]
+
+
+class SocEkf(ctypes.Structure):
+    _fields_ = [("soc", ctypes.c_int32),
+                ("v1", ctypes.c_int32),
+                ("p00", ctypes.c_int32),
+                ("p01", ctypes.c_int32),
+                ("p11", ctypes.c_int32),
+                ("soc_per_mAms", ctypes.c_int32),
+                ("inv_tau", ctypes.c_int32),
+                ("model", ctypes.POINTER(SocEkfModel))]
+
+
+class SampleRateConfig(ctypes.Structure):
+    _fields_ = [("period_ms", ctypes.c_uint16 * 3),
+                ("idle_mA", ctypes.c_uint16),
+                ("fast_mA", ctypes.c_uint16),
+                ("fast_mV_per_s", ctypes.c_uint16),
+                ("limit_margin_mV", ctypes.c_uint16),
+                ("hysteresis_percent", ctypes.c_uint8),
+                ("calm_ms", ctypes.c_uint16)]
+
+
+class SampleRate(ctypes.Structure):
+    _fields_ = [("tier", ctypes.c_uint8),
+                ("reasons", ctypes.c_uint8),
+                ("have_ref", ctypes.c_bool),
+                ("calm_ms", ctypes.c_uint16),
+                ("ref_min_mV", ctypes.c_uint16),
+                ("ref_max_mV", ctypes.c_uint16),
+                ("ref_age_ms", ctypes.c_uint32),
+                ("mV_per_s", ctypes.c_uint16),
+                ("limit_mV", ctypes.c_uint16)]
+
+
+class CcMeter(ctypes.Structure):
+    _fields_ = [("have_last", ctypes.c_bool),
+                ("last_A", ctypes.c_float),
+                ("last_ms", ctypes.c_uint32),
+                ("readings", ctypes.c_uint32),
+                ("gap_max_ms", ctypes.c_uint32)]
+
+
+def build_math_library():
+    #Compile the firmware math sources into a shared library (only when stale)
+    lib_name = "bms_math.dll" if os.name == "nt" else "libbms_math.so"
+    lib_path = os.path.join(BUILD_DIR, lib_name)
+    sources = [os.path.join(FIRMWARE_APP_DIR, s) for s in MATH_SOURCES]
+    headers = [s[:-2] + ".h" for s in sources]
+
+    #this file too: it holds the list of sources
+    newest = max(os.path.getmtime(p) for p in sources + headers + [__file__] if os.path.exists(p))
+    if os.path.exists(lib_path) and os.path.getmtime(lib_path) >= newest:
+        return lib_path
+
+    cc = os.environ.get("CC") or shutil.which("cc") or shutil.which("gcc")
+    if not cc:
+        sys.exit("No C compiler found (set CC) - needed to build the firmware math library")
+
+    os.makedirs(BUILD_DIR, exist_ok=True)
+    #-ffp-contract=off keeps a*b+c from being fused, XC16 never does that
+    #Built for the largest AFE so per-cell tables cover any --afe
+    cmd = [cc, "-O2", "-shared", "-fPIC", "-ffp-contract=off", "-fno-fast-math",
+           "-DBMS_AFE=BMS_AFE_BQ76940", "-I", FIRMWARE_APP_DIR, "-o", lib_path] + sources + ["-lm"]
+    subprocess.check_call(cmd)
+    return lib_path
+
+
+def load_math_library():
+    lib = ctypes.CDLL(build_math_library())
+
+    lib.bms_cell_raw_to_mV.argtypes = [ctypes.c_uint16, ctypes.c_uint16, ctypes.c_int8]
+    lib.bms_cell_raw_to_mV.restype = ctypes.c_uint32
+    lib.bms_pack_raw_to_mV.argtypes = [ctypes.c_uint16]
+    lib.bms_pack_raw_to_mV.restype = ctypes.c_uint32
+    lib.bms_adc_scale_init.argtypes = [ctypes.POINTER(BmsAdcScale), ctypes.c_uint16, ctypes.c_int8]
+    lib.bms_adc_scale_init.restype = None
+    lib.bms_cells_raw_to_mV.argtypes = [ctypes.POINTER(BmsAdcScale), ctypes.POINTER(ctypes.c_uint16),
+                                        ctypes.POINTER(ctypes.c_uint16), ctypes.c_uint8]
+    lib.bms_cells_raw_to_mV.restype = ctypes.c_uint16
+    lib.bms_ts_raw_to_temp.argtypes = [ctypes.c_uint16, ctypes.POINTER(BmsTemp)]
+    lib.bms_ts_raw_to_temp.restype = None
+    lib.bms_elapsed_sec.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.bms_elapsed_sec.restype = ctypes.c_float
+    lib.bms_cc_raw_to_current_A.argtypes = [ctypes.c_int16, ctypes.c_float, ctypes.c_float]
+    lib.bms_cc_raw_to_current_A.restype = ctypes.c_float
+    lib.bms_soc_integrate.argtypes = [ctypes.c_float] * 4
+    lib.bms_soc_integrate.restype = ctypes.c_float
+    lib.bms_soc_percent.argtypes = [ctypes.c_float, ctypes.c_float]
+    lib.bms_soc_percent.restype = ctypes.c_float
+    lib.bms_cell_reading_is_error.argtypes = [ctypes.c_uint16, ctypes.c_uint32]
+    lib.bms_cell_reading_is_error.restype = ctypes.c_bool
+    lib.bms_ocv_soc_percent.argtypes = [ctypes.c_int, ctypes.c_uint16, ctypes.POINTER(ctypes.c_bool)]
+    lib.bms_ocv_soc_percent.restype = ctypes.c_float
+    lib.bms_rest_detect.argtypes = [ctypes.POINTER(BmsRest), ctypes.c_float, ctypes.c_float]
+    lib.bms_rest_detect.restype = ctypes.c_bool
+    lib.bms_cc_cal_sample.argtypes = [ctypes.POINTER(BmsCcCal), ctypes.c_int16]
+    lib.bms_cc_cal_sample.restype = ctypes.c_bool
+    lib.bms_cc_cal_restart.argtypes = [ctypes.POINTER(BmsCcCal)]
+    lib.bms_cc_cal_restart.restype = None
+    lib.bms_cc_cal_current_A.argtypes = [ctypes.POINTER(BmsCcCal), ctypes.c_int16] + [ctypes.c_float] * 3
+    lib.bms_cc_cal_current_A.restype = ctypes.c_float
+    lib.cap_learn_init.argtypes = [ctypes.POINTER(CapLearn), ctypes.c_float, ctypes.c_int]
+    lib.cap_learn_init.restype = None
+    lib.cap_learn_integrate.argtypes = [ctypes.POINTER(CapLearn), ctypes.c_float, ctypes.c_float]
+    lib.cap_learn_integrate.restype = ctypes.c_bool
+    lib.cap_learn_anchor.argtypes = [ctypes.POINTER(CapLearn), ctypes.c_float]
+    lib.cap_learn_anchor.restype = ctypes.c_bool
+    lib.cap_learn_detect_full.argtypes = [ctypes.POINTER(CapLearn), ctypes.c_uint16, ctypes.c_float]
+    lib.cap_learn_detect_full.restype = ctypes.c_bool
+    lib.soc_ekf_set_capacity.argtypes = [ctypes.POINTER(SocEkf), ctypes.c_uint16]
+    lib.soc_ekf_set_capacity.restype = None
+    lib.soc_ekf_init.argtypes = [ctypes.POINTER(SocEkf), ctypes.POINTER(SocEkfModel),
+                                 ctypes.c_int32, ctypes.c_int32]
+    lib.soc_ekf_init.restype = None
+    lib.soc_ekf_update.argtypes = [ctypes.POINTER(SocEkf), ctypes.c_int32, ctypes.c_uint16, ctypes.c_uint16]
+    lib.soc_ekf_update.restype = None
+    lib.soc_ekf_soc.argtypes = [ctypes.POINTER(SocEkf)]
+    lib.soc_ekf_soc.restype = ctypes.c_int32
+    lib.cell_topology_find.argtypes = [ctypes.c_int, ctypes.c_uint8]
+    lib.cell_topology_find.restype = ctypes.c_void_p
+    lib.cell_topology_inputs.argtypes = [ctypes.c_int]
+    lib.cell_topology_inputs.restype = ctypes.c_uint8
+    lib.cell_topology_input.argtypes = [ctypes.c_void_p, ctypes.c_uint8]
+    lib.cell_topology_input.restype = ctypes.c_uint8
+    lib.cell_stats_init.argtypes = [ctypes.c_void_p, ctypes.c_uint8, ctypes.c_uint8, ctypes.c_uint8]
+    lib.cell_stats_init.restype = None
+    lib.cell_stats_add.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint16)]
+    lib.cell_stats_add.restype = ctypes.c_bool
+    lib.cell_stats_get.argtypes = [ctypes.c_void_p, ctypes.c_uint8, ctypes.POINTER(CellStat)]
+    lib.cell_stats_get.restype = ctypes.c_bool
+    lib.cell_stats_imbalance_mV.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8)]
+    lib.cell_stats_imbalance_mV.restype = ctypes.c_float
+    lib.sample_rate_init.argtypes = [ctypes.POINTER(SampleRate), ctypes.c_uint8]
+    lib.sample_rate_init.restype = None
+    lib.sample_rate_update.argtypes = [ctypes.POINTER(SampleRate), ctypes.POINTER(SampleRateConfig),
+                                       ctypes.c_float] + [ctypes.c_uint16] * 4 + [ctypes.c_uint32]
+    lib.sample_rate_update.restype = ctypes.c_uint8
+    lib.cc_meter_init.argtypes = [ctypes.POINTER(CcMeter)]
+    lib.cc_meter_init.restype = None
+    lib.cc_meter_add.argtypes = [ctypes.POINTER(CcMeter), ctypes.c_float, ctypes.c_uint32,
+                                 ctypes.POINTER(ctypes.c_uint32)]
+    lib.cc_meter_add.restype = ctypes.c_float
+    return lib
+
+
+def f32(value):
+    return ctypes.c_float(value).value
+
+
+def format_fw_float(value, decimals):
+    #Same text as uart1_send_float() in uart_fmt.c: scale in float32, round
+    #half away from zero, then print as fixed point
+    if value != value:
+        return "nan"
+    scaled = f32(f32(value) * float(10 ** decimals))
+    scaled = f32(scaled + (-0.5 if scaled < 0 else 0.5))
+    if scaled >= 2147483648.0:
+        return "inf"
+    if scaled < -2147483648.0:
+        return "-inf"
+    fixed = int(scaled)
+    sign = "-" if fixed < 0 else ""
+    fixed = abs(fixed)
+    if decimals == 0:
+        return sign + str(fixed)
+    return sign + str(fixed // 10 ** decimals) + "." + str(fixed % 10 ** decimals).zfill(decimals)
+
+
+def parse_int(text):
+    return int(text, 0) if text not in (None, "") else None
+
+
+def to_int16(value):
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def load_csv(path):
+    samples = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            sample = {
+                "tick": int(row["tick"]),
+                "cc_raw": parse_int(row["cc_raw"]),
+                "ts1_raw": parse_int(row.get("ts1_raw")),
+                "ref_soc": float(row["ref_soc"]) if row.get("ref_soc") else None,
+                "cells": [parse_int(row.get(f"vc{n}_raw")) for n in range(1, VC_INPUTS + 1)],
+                "bat_raw": parse_int(row.get("bat_raw")),
+                "fets_off": row.get("fets_off", "").strip() == "1",
+            }
+            samples.append(sample)
+    return samples
+
+
+def load_uart_log(path):
+    samples = []
+    pending_ts1 = None
+    pending_offset = None
+    with open(path, errors="ignore") as f:
+        for line in f:
+            m = TEMP_LINE.search(line)
+            if m:
+                pending_ts1 = int(m.group(2), 16)
+                continue
+            m = CC_OFFSET_LINE.search(line)
+            if m:
+                pending_offset = float(m.group(1))
+                continue
+            m = CURRENT_LINE.search(line)
+            if m:
+                samples.append({
+                    "tick": int(m.group(4)),
+                    "cc_raw": int(m.group(3), 16),
+                    "ts1_raw": pending_ts1,
+                    "ref_soc": None,
+                    "cells": [None] * VC_INPUTS,
+                    "bat_raw": None,
+                    "fets_off": False,
+                    "cc_offset": pending_offset,
+                    "printed": (m.group(1), m.group(2)),
+                })
+                pending_ts1 = None
+                pending_offset = None
+    return samples
+
+
+def topology_cells(lib, args):
+    #VC input indices of the populated cells, from the firmware's table
+    topology = lib.cell_topology_find(AFES[args.afe], args.cells)
+    if not topology:
+        sys.exit(f"{args.afe.upper()} can't be wired for {args.cells} cells")
+    return tuple(lib.cell_topology_input(topology, n) for n in range(args.cells))
+
+
+def average_cell_mV(lib, cells, args):
+    #Same as average_cell_mV() in taskBQ76920.c
+    total = count = 0
+    for i in args.vc_cells:
+        raw = cells[i]
+        if raw is None:
+            continue
+        mV = lib.bms_cell_raw_to_mV(raw, args.adc_gain, args.adc_offset)
+        if not lib.bms_cell_reading_is_error(raw, mV):
+            total += mV
+            count += 1
+    return total // count if count else 0
+
+
+def ocv_reading(lib, cells, args):
+    #(OCV SoC, reliable) from the mean cell voltage, None if no cell reads
+    cell_mV = average_cell_mV(lib, cells, args)
+    if cell_mV == 0:
+        return None
+    reliable = ctypes.c_bool()
+    ocv_soc = lib.bms_ocv_soc_percent(CHEMISTRIES[args.chemistry], cell_mV, ctypes.byref(reliable))
+    return ocv_soc, reliable.value
+
+
+def ekf_model(args):
+    q24 = lambda x: int(x * 16777216.0)
+    return SocEkfModel(CHEMISTRIES[args.chemistry], int(args.capacity), EKF_R0_MOHM, EKF_R1_MOHM,
+                       EKF_TAU_S, q24(EKF_Q_SOC), q24(EKF_Q_V1), q24(EKF_R_MEAS))
+
+
+def round_half_away(value):
+    #(int32_t)(x + 0.5f) style rounding used in update_soc_ekf()
+    return int(f32(value + (0.5 if value >= 0 else -0.5)))
+
+
+def replay(lib, samples, args, engine="cc", cc_cal=True, learn=True):
+    #engine: "cc" (integrator only), "ocv" (plus OCV and full-charge
+    #anchoring) or "ekf". cc_cal=False skips the CC offset calibration and
+    #dead-band, learn=False keeps the nominal capacity.
+    f = ctypes.c_float
+    use_ocv = engine in ("ocv", "ekf")
+    capacity = f(args.capacity).value
+    remaining = f(capacity * args.initial_soc / 100.0).value
+    ref_remaining = remaining   #float64 integration of the same current
+    cl = CapLearn()
+    lib.cap_learn_init(ctypes.byref(cl), capacity, CHEMISTRIES[args.chemistry])
+    stats = ctypes.create_string_buffer(CELL_STATS_BYTES)
+    lib.cell_stats_init(stats, len(args.vc_cells), CELL_STATS_WINDOW, 1)
+    inputs = lib.cell_topology_inputs(AFES[args.afe])
+    stats_fed = False
+    weakest = ctypes.c_uint8()
+    meter = CcMeter()
+    lib.cc_meter_init(ctypes.byref(meter))
+    meter_ms = ctypes.c_uint32()
+    temp = BmsTemp()
+    rest = BmsRest()
+    cal = BmsCcCal()
+    deadband_A = f(args.cc_deadband / 1000.0).value
+    model = ekf_model(args)
+    ekf = SocEkf()
+    booted = False
+    last_temp_c = None
+    mismatches = 0
+    rows = []
+
+    def anchor(anchor_soc):
+        #learn_from_anchor() in taskBQ76920.c
+        if learn and lib.cap_learn_anchor(ctypes.byref(cl), anchor_soc):
+            lib.soc_ekf_set_capacity(ctypes.byref(ekf), int(cl.learned_mAh))
+
+    for s in samples:
+        if use_ocv and not booted and any(c is not None for c in s["cells"]):
+            booted = True
+            reading = ocv_reading(lib, s["cells"], args)
+            if reading is not None:
+                if reading[1]:
+                    anchor(reading[0])
+                remaining = f32(f32(reading[0] * cl.learned_mAh) / 100.0)
+            if engine == "ekf":
+                soc = lib.bms_soc_percent(remaining, cl.learned_mAh)
+                lib.soc_ekf_init(ctypes.byref(ekf), ctypes.byref(model), int(f32(soc * 65536.0)),
+                                 int(EKF_SIGMA_PERCENT * 65536.0))
+                lib.soc_ekf_set_capacity(ctypes.byref(ekf), int(cl.learned_mAh))
+
+        cc_value = to_int16(s["cc_raw"])
+        if not cc_cal:
+            current_A = lib.bms_cc_raw_to_current_A(cc_value, args.cc_gain, args.shunt)
+        else:
+            #update_soc_from_cc(): a logged offset wins over our own estimate
+            if s.get("cc_offset") is not None:
+                cal.offset_lsb = s["cc_offset"]
+                cal.valid = True
+            elif s.get("fets_off"):
+                lib.bms_cc_cal_sample(ctypes.byref(cal), cc_value)
+            else:
+                lib.bms_cc_cal_restart(ctypes.byref(cal))
+            current_A = lib.bms_cc_cal_current_A(ctypes.byref(cal), cc_value, args.cc_gain, args.shunt,
+                                                 deadband_A)
+        #charge since the previous reading, cc_meter_add() as in the firmware
+        mean_A = lib.cc_meter_add(ctypes.byref(meter), current_A, s["tick"] & 0xFFFFFFFF, ctypes.byref(meter_ms))
+        dt_sec = f32(meter_ms.value / 1000.0)
+        cell_mV = average_cell_mV(lib, s["cells"], args)
+        if learn:
+            lib.cap_learn_integrate(ctypes.byref(cl), mean_A, dt_sec)
+        if engine == "ekf" and booted:
+            #update_soc_ekf(): gaps over 60 s in 60 s steps, the cells with the last
+            mean_mA = round_half_away(f32(mean_A * 1000.0))
+            dt_ms = f32(dt_sec * 1000.0)
+            while dt_ms > 60000.0:
+                lib.soc_ekf_update(ctypes.byref(ekf), mean_mA, 60000, 0)
+                dt_ms = f32(dt_ms - 60000.0)
+            lib.soc_ekf_update(ctypes.byref(ekf), mean_mA, round_half_away(dt_ms), cell_mV)
+            soc = f32(lib.soc_ekf_soc(ctypes.byref(ekf)) / 65536.0)
+            remaining = f32(f32(soc * cl.learned_mAh) / 100.0)
+        else:
+            remaining = lib.bms_soc_integrate(remaining, cl.learned_mAh, mean_A, dt_sec)
+            soc = lib.bms_soc_percent(remaining, cl.learned_mAh)
+
+        if use_ocv and lib.bms_rest_detect(ctypes.byref(rest), mean_A, dt_sec):
+            reading = ocv_reading(lib, s["cells"], args)
+            if reading is not None and reading[1]:
+                anchor(reading[0])
+                if engine == "ocv":
+                    remaining = f32(f32(reading[0] * cl.learned_mAh) / 100.0)
+                    soc = lib.bms_soc_percent(remaining, cl.learned_mAh)
+
+        if use_ocv and lib.cap_learn_detect_full(ctypes.byref(cl), cell_mV, current_A):
+            anchor(100.0)
+            if engine == "ocv":
+                remaining = cl.learned_mAh
+                soc = 100.0
+
+        ref_remaining -= mean_A * meter_ms.value / 3600.0
+        ref_remaining = min(max(ref_remaining, 0.0), capacity)
+        ref_soc = s["ref_soc"] if s["ref_soc"] is not None else ref_remaining / capacity * 100.0
+
+        if s["ts1_raw"] is not None:
+            lib.bms_ts_raw_to_temp(s["ts1_raw"], ctypes.byref(temp))
+            last_temp_c = temp.temp_c
+
+        cells_mV = [lib.bms_cell_raw_to_mV(raw, args.adc_gain, args.adc_offset) if raw is not None else None
+                    for raw in s["cells"][:inputs]]
+        pack_mV = lib.bms_pack_raw_to_mV(s["bat_raw"]) if s["bat_raw"] is not None else None
+
+        #feed_cell_stats() in taskBQ76920.c: only snapshots with every cell readable
+        snapshot = [cells_mV[i] for i in args.vc_cells]
+        if all(mV is not None and not lib.bms_cell_reading_is_error(s["cells"][i], mV)
+               for i, mV in zip(args.vc_cells, snapshot)):
+            lib.cell_stats_add(stats, (ctypes.c_uint16 * len(snapshot))(*snapshot))
+            stats_fed = True
+        imbalance_mV = lib.cell_stats_imbalance_mV(stats, ctypes.byref(weakest)) if stats_fed else None
+
+        if "printed" in s and s["printed"] != (format_fw_float(current_A, 2), format_fw_float(soc, 2)):
+            mismatches += 1
+
+        rows.append({
+            "t_s": (s["tick"] - samples[0]["tick"]) / 1000.0,
+            "current_A": current_A,
+            "soc_fw": soc,
+            "soc_ref": ref_soc,
+            "soc_err": soc - ref_soc,
+            "temp_c": last_temp_c,
+            "cells_mV": cells_mV,
+            "pack_mV": pack_mV,
+            "capacity_mAh": cl.learned_mAh,
+            "cycles": cl.cycles,
+            "imbalance_mV": imbalance_mV,
+            "weakest_cell": args.vc_cells[weakest.value] + 1,
+        })
+
+    return rows, mismatches
+
+
+def ocv_mV_for_soc(lib, chemistry, soc):
+    #Inverse of bms_ocv_soc_percent() by bisection (the table is monotonic)
+    lo, hi = 1000, 5000
+    while lo < hi:
+        mid = (lo + hi) // 2
+        if lib.bms_ocv_soc_percent(CHEMISTRIES[chemistry], mid, None) < soc:
+            lo = mid + 1
+        else:
+            hi = mid
+    return lo
+
+
+def synthetic_session(lib, args):
+    #Cycling sampled every 2 s like the firmware loop, with the FETs off
+    #during the rests. "partial": rest / C/2 discharge / rest / C/2 charge
+    #for fixed times. "full": rest, C/2 discharge to 10 %, rest, CC-CV charge
+    #to the top of the OCV curve ending at C/40, rest. The CC reading carries
+    #an offset that wanders (random walk) plus reading noise, cell voltages
+    #follow the OCV table minus an IR drop and a one-RC polarisation (the
+    #model soc_ekf.c assumes), plus 1 mV of ADC noise. The true capacity
+    #starts at --true-capacity and fades by --fade % per 100 equivalent
+    #cycles of discharge.
+    rng = random.Random(args.seed)
+    lsb_A = args.cc_gain * 1e-6 / args.shunt
+    rate_A = args.capacity / 1000.0 / 2.0
+    v_max = ocv_mV_for_soc(lib, args.chemistry, 100.0)
+    initial_capacity = args.true_capacity or args.capacity
+    discharged_mAh = 0.0
+    soc = args.true_initial_soc
+    v1_mV = 0.0
+    offset_lsb = args.cc_offset_lsb
+    walk_lsb = args.cc_offset_walk * math.sqrt(2.0 / 3600.0)
+    decay = math.exp(-2.0 / EKF_TAU_S)
+    tick = 2000
+    end = args.synthetic * 3600 * 1000
+    samples = []
+
+    def step(current_A):
+        nonlocal soc, v1_mV, offset_lsb, tick, discharged_mAh
+        capacity = initial_capacity * (1.0 - args.fade / 100.0 * discharged_mAh / args.capacity / 100.0)
+        soc -= current_A * 2.0 * 1000.0 / 3600.0 / capacity * 100.0
+        soc = min(max(soc, 0.0), 100.0)
+        discharged_mAh += max(current_A, 0.0) * 2.0 * 1000.0 / 3600.0
+        offset_lsb += rng.gauss(0.0, walk_lsb)
+        cc_raw = int(round(current_A / lsb_A + offset_lsb + rng.gauss(0.0, 0.5)))
+        v1_mV = v1_mV * decay + (1.0 - decay) * current_A * EKF_R1_MOHM
+        cell_mV = (ocv_mV_for_soc(lib, args.chemistry, soc) - current_A * EKF_R0_MOHM - v1_mV
+                   + rng.gauss(0.0, 1.0))
+        cell_raw = int(round((cell_mV - args.adc_offset) * 1000.0 / args.adc_gain))
+        samples.append({
+            "tick": tick,
+            "cc_raw": cc_raw & 0xFFFF,
+            "ts1_raw": None,
+            "ref_soc": soc,
+            "true_capacity": capacity,
+            "cells": [cell_raw if i in args.vc_cells else None for i in range(VC_INPUTS)],
+            "bat_raw": None,
+            "fets_off": current_A == 0.0,
+        })
+        tick += 2000
+
+    def rest(hours):
+        for _ in range(int(hours * 3600 / 2)):
+            step(0.0)
+
+    while tick < end:
+        if args.profile == "partial":
+            for current_A, hours in ((0.0, 1.0), (rate_A, 1.5), (0.0, 1.0), (-rate_A, 1.5)):
+                for _ in range(int(hours * 3600 / 2)):
+                    step(current_A)
+            continue
+
+        rest(1.0)
+        while soc > 10.0:
+            step(rate_A)
+        rest(1.0)
+        #CC until the terminal voltage reaches the top of the OCV curve,
+        #then CV: the current that holds it there, until it tapers to C/40
+        current_A = -rate_A
+        while current_A < -rate_A / 20.0:
+            step(current_A)
+            ocv = ocv_mV_for_soc(lib, args.chemistry, soc)
+            current_A = max((ocv - v1_mV * decay - v_max) / EKF_R0_MOHM, -rate_A)
+        rest(0.5)
+    return samples
+
+
+def sampling_session(lib, args):
+    #The pack at CC conversion resolution: (current_A, lowest cell mV,
+    #highest cell mV) per 250 ms. Repeats: 30 min on the shelf with a 1 A
+    #load for 20 s every 10 min, 15 min of 5 A pulses (1.5 s every 8 to
+    #12 s) over 0.3 A, a C/2 discharge until the lowest cell is 50 mV above UV,
+    #30 min rest, a C/2 charge until the highest is 40 mV below OV, 30 min
+    #rest. Three cells with -2/0/+2 % capacity on the OCV, IR and RC model
+    #of synthetic_session().
+    rng = random.Random(args.seed)
+    ocv = [ocv_mV_for_soc(lib, args.chemistry, n / 10.0) for n in range(1001)]
+    rate_A = args.capacity / 1000.0 / 2.0
+    dt = SAMPLING_STEP_MS / 1000.0
+    decay = math.exp(-dt / EKF_TAU_S)
+    capacities = [args.capacity * k for k in (0.98, 1.0, 1.02)]
+    socs = [args.true_initial_soc] * len(capacities)
+    v1_mV = 0.0
+    end = int(args.sampling * 3600 * 1000 / SAMPLING_STEP_MS)
+    steps = []
+
+    def step(current_A):
+        nonlocal v1_mV
+        v1_mV = v1_mV * decay + (1.0 - decay) * current_A * EKF_R1_MOHM
+        cells = []
+        for n, capacity in enumerate(capacities):
+            socs[n] = min(max(socs[n] - current_A * dt * 1000.0 / 3600.0 / capacity * 100.0, 0.0), 100.0)
+            i = min(int(socs[n] * 10.0), 999)
+            frac = socs[n] * 10.0 - i
+            cells.append(ocv[i] + (ocv[i + 1] - ocv[i]) * frac - current_A * EKF_R0_MOHM - v1_mV)
+        steps.append((current_A, min(cells), max(cells)))
+        return min(cells), max(cells)
+
+    def hold(current_A, seconds):
+        for _ in range(int(seconds * 1000 / SAMPLING_STEP_MS)):
+            step(current_A)
+
+    while len(steps) < end:
+        for _ in range(3):
+            hold(0.0, 580)
+            hold(1.0, 20)
+        for _ in range(90):
+            hold(5.0, 1.5)
+            hold(0.3, rng.uniform(6.5, 10.5))
+        low, high = step(rate_A)
+        while low > SAMPLING_UV_MV + 50:
+            low, high = step(rate_A)
+        hold(0.0, 1800)
+        while high < SAMPLING_OV_MV - 40:
+            low, high = step(-rate_A)
+        hold(0.0, 1800)
+    del steps[end:]
+    return steps
+
+
+def run_sampler(lib, steps, args, period_ms=None):
+    #Measures steps every period_ms, or at the period of the tier
+    #sample_rate_update() picks when period_ms is None. Each measurement
+    #reads the last CC conversion (0.5 LSB noise) and the cells (1 mV noise)
+    #and integrates the current over the interval since the previous one,
+    #as update_soc_from_cc() does. Returns the step indexes measured, the
+    #counted charge (mAh) after each and the tier used after each.
+    rng = random.Random(args.seed)
+    lsb_A = args.cc_gain * 1e-6 / args.shunt
+    config = SampleRateConfig(SAMPLE_PERIODS_MS, SAMPLE_IDLE_MA, SAMPLE_FAST_MA, SAMPLE_FAST_MV_PER_S,
+                              SAMPLE_LIMIT_MARGIN_MV, SAMPLE_HYSTERESIS_PERCENT, SAMPLE_CALM_MS)
+    state = SampleRate()
+    lib.sample_rate_init(ctypes.byref(state), SAMPLE_TIER_NORMAL)
+    period = period_ms or SAMPLE_PERIODS_MS[SAMPLE_TIER_NORMAL]
+    taken, charge, tiers = [], [], []
+    counted = 0.0
+    last_ms = 0
+    k = period // SAMPLING_STEP_MS - 1
+    while k < len(steps):
+        current_A, low, high = steps[k]
+        now_ms = (k + 1) * SAMPLING_STEP_MS
+        raw = to_int16(int(round(current_A / lsb_A + rng.gauss(0.0, 0.5))) & 0xFFFF)
+        read_A = lib.bms_cc_raw_to_current_A(raw, args.cc_gain, args.shunt)
+        counted += read_A * (now_ms - last_ms) / 3600.0
+        if period_ms is None:
+            tier = lib.sample_rate_update(ctypes.byref(state), ctypes.byref(config), read_A,
+                                          int(round(low + rng.gauss(0.0, 1.0))),
+                                          int(round(high + rng.gauss(0.0, 1.0))),
+                                          SAMPLING_UV_MV, SAMPLING_OV_MV, now_ms - last_ms)
+            period = SAMPLE_PERIODS_MS[tier]
+            tiers.append(tier)
+        last_ms = now_ms
+        taken.append(k)
+        charge.append(counted)
+        k += period // SAMPLING_STEP_MS
+    return taken, charge, tiers
+
+
+def sampling_events(steps, margin_mV):
+    #Step indexes where the current changes by SAMPLING_STEP_A or more, and
+    #where a cell comes within margin_mV of UV or OV
+    current_events, limit_events = [], []
+    near = False
+    for k in range(1, len(steps)):
+        if abs(steps[k][0] - steps[k - 1][0]) >= SAMPLING_STEP_A:
+            current_events.append(k)
+        now_near = steps[k][1] <= SAMPLING_UV_MV + margin_mV or steps[k][2] >= SAMPLING_OV_MV - margin_mV
+        if now_near and not near:
+            limit_events.append(k)
+        near = now_near
+    return current_events, limit_events
+
+
+def reaction(taken, events):
+    #Mean and worst delay (ms) from each event to the end of the first CC
+    #conversion measured after it, and the events no measurement saw before
+    #the next one
+    delays, missed = [], 0
+    for n, e in enumerate(events):
+        i = bisect.bisect_left(taken, e)
+        if i == len(taken) or (n + 1 < len(events) and taken[i] >= events[n + 1]):
+            missed += 1
+            continue
+        delays.append((taken[i] - e + 1) * SAMPLING_STEP_MS)
+    if not delays:
+        return 0.0, 0, missed
+    return sum(delays) / len(delays), max(delays), missed
+
+
+def compare_sampling(lib, args):
+    steps = sampling_session(lib, args)
+    hours = len(steps) * SAMPLING_STEP_MS / 3600000.0
+    true_charge = []
+    total = 0.0
+    for current_A, _, _ in steps:
+        total += current_A * SAMPLING_STEP_MS / 3600.0
+        true_charge.append(total)
+    current_events, limit_events = sampling_events(steps, SAMPLE_LIMIT_MARGIN_MV)
+    print(f"Sampling: {hours:g} h, {len(current_events)} current steps of {SAMPLING_STEP_A:g} A or more, "
+          f"{len(limit_events)} approaches within {SAMPLE_LIMIT_MARGIN_MV} mV of UV {SAMPLING_UV_MV} / "
+          f"OV {SAMPLING_OV_MV} mV")
+    print(f"{'':16}{'meas/h':>8}{'I2C ms/h':>10}{'charge err mAh':>16}{'max':>7}"
+          f"{'step delay ms':>15}{'max':>6}{'missed':>8}{'limit delay ms':>16}{'max':>6}")
+    for name, period_ms in (("fixed 250 ms", 250), ("fixed 2 s", 2000), ("fixed 8 s", 8000), ("adaptive", None)):
+        taken, charge, tiers = run_sampler(lib, steps, args, period_ms)
+        errors = [charge[n] - true_charge[k] for n, k in enumerate(taken)]
+        step_mean, step_max, missed = reaction(taken, current_events)
+        limit_mean, limit_max, _ = reaction(taken, limit_events)
+        per_hour = len(taken) / hours
+        print(f"{name:16}{per_hour:8.0f}{per_hour * MEASURE_I2C_MS:10.0f}{errors[-1]:16.2f}"
+              f"{max(abs(e) for e in errors):7.2f}{step_mean:15.0f}{step_max:6d}{missed:8d}"
+              f"{limit_mean:16.0f}{limit_max:6d}")
+        if tiers:
+            spent = [0] * len(SAMPLE_PERIODS_MS)
+            for n, tier in enumerate(tiers[:-1]):
+                spent[tier] += taken[n + 1] - taken[n]
+            print("  time per tier: " + ", ".join(
+                f"{SAMPLE_TIER_NAMES[t]} {100.0 * spent[t] / max(sum(spent), 1):.1f} %" for t in range(len(spent))))
+
+
+def metering_session(args, seed, bursts):
+    #True current per 250 ms conversion of a pack in standby: a few mA of
+    #housekeeping and, once every 12 h, a charge at C/2 for 40 min tapering
+    #linearly to C/32 over another 40 min. With bursts, also a 150 mA load
+    #for 30 to 120 s about every 10 min and a 2 A burst of 3 to 8 s about
+    #every 30 min.
+    rng = random.Random(seed)
+    rate_A = args.capacity / 1000.0 / 2.0
+    per_s = 1000 // SAMPLING_STEP_MS
+    end = int(args.metering * 3600 * per_s)
+    current = [0.005] * end
+
+    def load(start, seconds, amps):
+        for k in range(start, min(start + int(seconds * per_s), end)):
+            current[k] += amps
+
+    t = rng.uniform(0, 600)
+    while bursts and t * per_s < end:
+        load(int(t * per_s), rng.uniform(30, 120), 0.15)
+        t += rng.expovariate(1 / 600.0)
+    t = rng.uniform(0, 1800)
+    while bursts and t * per_s < end:
+        load(int(t * per_s), rng.uniform(3, 8), 2.0)
+        t += rng.expovariate(1 / 1800.0)
+    for start_h in range(6, int(args.metering) + 1, 12):
+        k0 = int((start_h * 3600 + rng.uniform(0, 3600)) * per_s)
+        load(k0, 2400, -rate_A)
+        taper = 2400 * per_s
+        for k in range(k0 + taper, min(k0 + 2 * taper, end)):
+            current[k] -= rate_A + (rate_A / 16.0 - rate_A) * (k - k0 - taper) / taper
+    return current
+
+
+def run_meter(lib, current, args, seed, reads):
+    #Reads the conversion ending at each step index in reads (0.5 LSB
+    #noise) and counts charge two ways: through cc_meter_add() and by
+    #holding each reading over the interval before it, as the firmware did.
+    #Returns the mAh each way after every reading.
+    rng = random.Random(seed)
+    lsb_A = args.cc_gain * 1e-6 / args.shunt
+    meter = CcMeter()
+    lib.cc_meter_init(ctypes.byref(meter))
+    dt_ms = ctypes.c_uint32()
+    trapezoid = held = 0.0
+    last_ms = None
+    counted = []
+    for k in reads:
+        now_ms = (k + 1) * SAMPLING_STEP_MS
+        raw = to_int16(int(round(current[k] / lsb_A + rng.gauss(0.0, 0.5))) & 0xFFFF)
+        read_A = lib.bms_cc_raw_to_current_A(raw, args.cc_gain, args.shunt)
+        mean_A = lib.cc_meter_add(ctypes.byref(meter), read_A, now_ms & 0xFFFFFFFF, ctypes.byref(dt_ms))
+        trapezoid += mean_A * dt_ms.value / 3600.0
+        if last_ms is not None:
+            held += read_A * (now_ms - last_ms) / 3600.0
+        last_ms = now_ms
+        counted.append((trapezoid, held))
+    return counted
+
+
+def metering_reads(steps, seed):
+    #Step indexes each mode reads at: continuous CC read every 2 s and 8 s,
+    #periodic one-shots with METERING_LOST of them lost (phase random) and
+    #on-demand one-shots at random gaps.
+    rng = random.Random(seed)
+    per_s = 1000 // SAMPLING_STEP_MS
+
+    def every(period_s, lost=0.0):
+        first = rng.randrange(period_s * per_s)
+        return [k for k in range(first, steps, period_s * per_s) if rng.random() >= lost]
+
+    demand, k = [], rng.randrange(METERING_DEMAND_S[0] * per_s)
+    while k < steps:
+        demand.append(k)
+        k += int(rng.uniform(*METERING_DEMAND_S) * per_s)
+    modes = [("continuous 2 s", True, every(2)), ("continuous 8 s", True, every(8))]
+    modes += [(f"periodic {p} s", False, every(p, METERING_LOST)) for p in METERING_PERIODS_S]
+    modes.append((f"oneshot {METERING_DEMAND_S[0]}-{METERING_DEMAND_S[1]} s", False, demand))
+    return modes
+
+
+def compare_metering(lib, args):
+    #Charge each metering mode counts between its first and last reading
+    #against the true charge, over METERING_SEEDS sessions: bias (mean
+    #error) and RMS error, trapezoid and held.
+    per_s = 1000 // SAMPLING_STEP_MS
+    for bursts in (False, True):
+        stats = {}
+        for seed in range(args.seed, args.seed + METERING_SEEDS):
+            current = metering_session(args, seed, bursts)
+            steps = len(current)
+            true_mAh = [0.0]
+            for amps in current:
+                true_mAh.append(true_mAh[-1] + amps * SAMPLING_STEP_MS / 3600.0)
+            for name, continuous, reads in metering_reads(steps, seed + 1):
+                counted = run_meter(lib, current, args, seed + 2, reads)
+                truth = true_mAh[reads[-1] + 1] - true_mAh[reads[0] + 1]
+                entry = stats.setdefault(name, {"conv": 0.0, "gap": 0, "err": []})
+                entry["conv"] += (3600 * per_s if continuous else len(reads) * 3600.0 / (steps / per_s)) / METERING_SEEDS
+                entry["gap"] = max(entry["gap"], max(b - a for a, b in zip(reads, reads[1:])) // per_s)
+                entry["err"].append((counted[-1][0] - truth, counted[-1][1] - truth))
+        print(f"Metering: {args.metering:g} h standby, {'with loads and bursts' if bursts else 'charge ramps only'}, "
+              f"{METERING_SEEDS} sessions, {100 * METERING_LOST:g} % of periodic readings lost")
+        print(f"{'':22}{'conv/h':>8}{'longest gap s':>15}"
+              f"{'trapezoid bias mAh':>20}{'rms':>8}{'held bias mAh':>15}{'rms':>8}")
+        for name, entry in stats.items():
+            cols = []
+            for way in (0, 1):
+                errors = [e[way] for e in entry["err"]]
+                cols.append((sum(errors) / len(errors), math.sqrt(sum(e * e for e in errors) / len(errors))))
+            print(f"{name:22}{entry['conv']:8.0f}{entry['gap']:15d}{cols[0][0]:20.2f}{cols[0][1]:8.2f}"
+                  f"{cols[1][0]:15.2f}{cols[1][1]:8.2f}")
+
+
+def write_csv(path, rows):
+    with open(path, "w", newline="") as f:
+        w = csv.writer(f)
+        w.writerow(["t_s", "current_A", "soc_fw", "soc_ref", "soc_err", "temp_c"]
+                   + [f"c{n + 1}_mV" for n in range(len(rows[0]["cells_mV"]))]
+                   + ["pack_mV", "imbalance_mV"])
+        for r in rows:
+            w.writerow([r["t_s"], r["current_A"], r["soc_fw"], r["soc_ref"], r["soc_err"],
+                        "" if r["temp_c"] is None else r["temp_c"]]
+                       + ["" if v is None else v for v in r["cells_mV"]]
+                       + ["" if r["pack_mV"] is None else r["pack_mV"]]
+                       + ["" if r["imbalance_mV"] is None else round(r["imbalance_mV"], 1)])
+
+
+def write_plot(path, rows):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print("matplotlib not installed, skipping plot")
+        return
+    t = [r["t_s"] / 3600.0 for r in rows]
+    fig, (ax1, ax2) = plt.subplots(2, 1, sharex=True, figsize=(10, 6))
+    ax1.plot(t, [r["soc_err"] for r in rows])
+    ax1.set_ylabel("SoC error (%)")
+    ax2.plot(t, [r["temp_c"] if r["temp_c"] is not None else float("nan") for r in rows])
+    ax2.set_ylabel("Temperature (C)")
+    ax2.set_xlabel("Time (h)")
+    fig.tight_layout()
+    fig.savefig(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Replay a recorded BMS session through the firmware math")
+    parser.add_argument("session", nargs="?", help="CSV recording or captured UART log")
+    parser.add_argument("-o", "--output", help="write curves to this CSV file")
+    parser.add_argument("--plot", help="write a PNG of SoC error and temperature")
+    parser.add_argument("--capacity", type=float, default=DEFAULT_CAPACITY_MAH, help="pack capacity (mAh)")
+    parser.add_argument("--initial-soc", type=float, default=100.0, help="SoC at the first sample (%%)")
+    parser.add_argument("--cc-gain", type=float, default=DEFAULT_CC_GAIN_UV, help="CC gain (uV/LSB)")
+    parser.add_argument("--shunt", type=float, default=DEFAULT_SHUNT_OHM, help="sense resistor (Ohm)")
+    parser.add_argument("--adc-gain", type=int, default=DEFAULT_ADC_GAIN_UV, help="ADCGAIN (uV/LSB)")
+    parser.add_argument("--adc-offset", type=int, default=DEFAULT_ADC_OFFSET_MV, help="ADCOFFSET (mV)")
+    parser.add_argument("--cc-deadband", type=float, default=DEFAULT_CC_DEADBAND_MA,
+                        help="CC dead-band after offset removal (mA), 0 to disable")
+    parser.add_argument("--ocv", action="store_true", help="OCV SoC at start and re-anchoring at rest")
+    parser.add_argument("--ekf", action="store_true", help="Kalman filter SoC engine (soc_ekf.c)")
+    parser.add_argument("--afe", choices=sorted(AFES), default="bq76920", help="BQ769x0 variant")
+    parser.add_argument("--cells", type=int, help="cells in series, as 'cells <n>' (default the fewest)")
+    parser.add_argument("--chemistry", choices=sorted(CHEMISTRIES), default="nmc", help="OCV table")
+    parser.add_argument("--synthetic", type=float, metavar="HOURS",
+                        help="simulate HOURS of cycling instead of reading a session")
+    parser.add_argument("--cc-offset-lsb", type=float, default=0.5, help="synthetic CC offset (LSB)")
+    parser.add_argument("--cc-offset-walk", type=float, default=0.1,
+                        help="synthetic CC offset random walk (LSB per sqrt(hour))")
+    parser.add_argument("--true-capacity", type=float,
+                        help="synthetic true capacity at start (mAh), default --capacity")
+    parser.add_argument("--fade", type=float, default=0.0,
+                        help="synthetic capacity loss (%% per 100 equivalent cycles)")
+    parser.add_argument("--profile", choices=("partial", "full"), default="partial",
+                        help="synthetic cycles: fixed-time C/2 or full CC-CV cycles")
+    parser.add_argument("--true-initial-soc", type=float, default=90.0, help="synthetic true SoC at start (%%)")
+    parser.add_argument("--seed", type=int, default=1, help="synthetic noise seed")
+    parser.add_argument("--check-adc", action="store_true",
+                        help="check the batched cell/pack conversion against its definition")
+    parser.add_argument("--sampling", type=float, metavar="HOURS",
+                        help="compare the adaptive measurement rate with fixed periods over HOURS")
+    parser.add_argument("--metering", type=float, metavar="HOURS",
+                        help="compare the Coulomb Counter metering modes on a standby pack over HOURS")
+    args = parser.parse_args()
+    if args.cells is None:
+        args.cells = {"bq76920": 3, "bq76930": 6, "bq76940": 9}[args.afe]
+
+    lib = load_math_library()
+    if args.check_adc:
+        sys.exit(0 if check_adc(lib, args) else 1)
+    if args.sampling:
+        compare_sampling(lib, args)
+        return
+    if args.metering:
+        compare_metering(lib, args)
+        return
+    args.vc_cells = topology_cells(lib, args)
+    if args.synthetic:
+        compare_synthetic(lib, args)
+        return
+    if not args.session:
+        parser.error("a session file is required unless --synthetic is given")
+
+    samples = load_csv(args.session) if args.session.lower().endswith(".csv") else load_uart_log(args.session)
+    if not samples:
+        sys.exit("No samples found in " + args.session)
+
+    start = time.perf_counter()
+    rows, mismatches = replay(lib, samples, args, selected_engine(args))
+    wall = time.perf_counter() - start
+
+    session_sec = (samples[-1]["tick"] - samples[0]["tick"]) / 1000.0
+    max_err = max(abs(r["soc_err"]) for r in rows)
+    print(f"Samples:          {len(rows)}")
+    print(f"Session length:   {session_sec:.1f} s")
+    print(f"Replay time:      {wall:.3f} s ({session_sec / wall if wall > 0 else float('inf'):.0f}x real time)")
+    print(f"Final SoC:        {rows[-1]['soc_fw']:.3f} % (reference {rows[-1]['soc_ref']:.3f} %)")
+    print(f"Max |SoC error|:  {max_err:.4f} %")
+    if any("printed" in s for s in samples):
+        print(f"Printed values not reproduced: {mismatches}")
+    if rows[-1]["imbalance_mV"] is not None:
+        worst = max(rows, key=lambda r: r["imbalance_mV"] or 0.0)
+        print(f"Cell imbalance:   {rows[-1]['imbalance_mV']:.1f} mV at the end (weakest C{rows[-1]['weakest_cell']}), "
+              f"{worst['imbalance_mV']:.1f} mV worst (C{worst['weakest_cell']} at {worst['t_s']:.0f} s)")
+
+    if args.output:
+        write_csv(args.output, rows)
+    if args.plot:
+        write_plot(args.plot, rows)
+
+
+def check_adc_batch(lib, gain, offset, codes):
+    #Mismatches of bms_cells_raw_to_mV() against (raw * gain) / 1000 + offset
+    #in uint32_t, the same as bms_cell_raw_to_mV(), error mask included
+    scale = BmsAdcScale()
+    lib.bms_adc_scale_init(ctypes.byref(scale), gain, offset)
+    raw = (ctypes.c_uint16 * ADC_CHECK_BATCH)()
+    mV = (ctypes.c_uint16 * ADC_CHECK_BATCH)()
+    failures = 0
+    for base in range(0, codes, ADC_CHECK_BATCH):
+        count = min(ADC_CHECK_BATCH, codes - base)
+        raw[:count] = range(base, base + count)
+        errors = lib.bms_cells_raw_to_mV(ctypes.byref(scale), raw, mV, count)
+        for n in range(count):
+            code = base + n
+            ref = ((code * gain) // 1000 + offset) & 0xFFFFFFFF
+            is_error = code < CELL_ERROR_RAW_MIN or ref > CELL_ERROR_MV_MAX
+            if mV[n] != ref & 0xFFFF or bool(errors >> n & 1) != is_error:
+                failures += 1
+    return failures
+
+
+def check_adc(lib, args):
+    #Every 16-bit code over the ADCGAIN range (365..396 uV) at --adc-offset,
+    #every 14-bit code (the VCx ADC range) over all ADCOFFSET values at
+    #--adc-gain, every BAT code against the old (uint32_t)(raw * 1.9f)
+    cases = failures = 0
+    for gain in range(365, 397):
+        failures += check_adc_batch(lib, gain, args.adc_offset, 0x10000)
+        cases += 0x10000
+    for offset in range(-128, 128):
+        failures += check_adc_batch(lib, args.adc_gain, offset, 0x4000)
+        cases += 0x4000
+    print(f"Cell conversion:  {cases} cases, {failures} mismatches")
+
+    pack_failures = sum(lib.bms_pack_raw_to_mV(raw) != int(f32(raw * f32(1.9))) for raw in range(0x10000))
+    print(f"Pack conversion:  65536 cases, {pack_failures} mismatches")
+    return failures == 0 and pack_failures == 0
+
+
+def selected_engine(args):
+    return "ekf" if args.ekf else "ocv" if args.ocv else "cc"
+
+
+def compare_synthetic(lib, args):
+    samples = synthetic_session(lib, args)
+    true_capacity = samples[-1]["true_capacity"]
+    print(f"Synthetic session: {args.synthetic:g} h ({args.profile} cycles), {len(samples)} samples, "
+          f"CC offset {args.cc_offset_lsb:g} LSB (walk {args.cc_offset_walk:g} LSB/sqrt(h)), "
+          f"start {args.initial_soc:g} % (true {args.true_initial_soc:g} %)")
+    print(f"Capacity: nominal {args.capacity:g} mAh, true {args.true_capacity or args.capacity:g} "
+          f"-> {true_capacity:.0f} mAh")
+    print(f"{'':32}{'final err %':>12}{'max |err| %':>13}{'mean |err| %':>14}{'capacity':>10}{'cycles':>8}")
+    configs = (("CC only", "cc", False, False),
+               ("CC only + offset cal", "cc", True, False),
+               ("CC + OCV anchor", "ocv", False, False),
+               ("CC + OCV anchor + offset cal", "ocv", True, False),
+               ("CC + OCV anchor + cal + learn", "ocv", True, True),
+               ("EKF", "ekf", False, False),
+               ("EKF + offset cal", "ekf", True, False),
+               ("EKF + offset cal + learn", "ekf", True, True))
+    for name, engine, cc_cal, learn in configs:
+        rows, _ = replay(lib, samples, args, engine, cc_cal, learn)
+        errors = [abs(r["soc_err"]) for r in rows]
+        print(f"{name:32}{rows[-1]['soc_err']:12.3f}{max(errors):13.3f}{sum(errors) / len(errors):14.3f}"
+              f"{rows[-1]['capacity_mAh']:10.0f}{rows[-1]['cycles']:8d}")
+        if engine == selected_engine(args) and cc_cal and learn == (engine != "cc"):
+            if args.output:
+                write_csv(args.output, rows)
+            if args.plot:
+                write_plot(args.plot, rows)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,179 @@
+#Firmware event trace to Chrome tracing timeline
+#
+#Fetches the binary dump of the firmware's "trace" command (trace.c) over
+#the serial port, or reads a saved one, and writes it as Chrome tracing JSON
+#for chrome://tracing or https://ui.perfetto.dev. Tracks:
+#  CPU          which task was running (from the FreeRTOS task switches)
+#  Steps        the running BQ76920 task's step (its watchdog activity code)
+#  I2C          each transaction, start condition to stop
+#  Commands     each UART command, named from the firmware command table
+#  UART         instants where the TX interrupt emptied the queue
+#Clock profile switches are global instants. Times start at the oldest
+#record that survived in the 64-event ring.
+#
+#Usage:
+#  python trace_view.py --port COM5 -o trace.json
+#  python trace_view.py --port /dev/ttyUSB0 --baud 115200 --save dump.bin -o trace.json
+#  python trace_view.py dump.bin -o trace.json
+
+
+import argparse
+import json
+import struct
+import sys
+
+DEFAULT_BAUD = 9600
+RECORD = struct.Struct("<IBB")      #trace_record_t: cycles, type, arg
+
+#trace_type_t in trace.h
+TRACE_TASK = 1
+TRACE_I2C_START = 2
+TRACE_I2C_DONE = 3
+TRACE_UART_DRAIN = 4
+TRACE_COMMAND = 5
+TRACE_COMMAND_END = 6
+TRACE_STEP = 7
+TRACE_CLOCK = 8
+
+TASKS = ["IDLE", "Tmr Svc", "protect", "measure", "telem", "console"]      #trace_task_t
+#ACTIVITY_* high byte in taskBQ76920.c
+STEPS = {1: "boot", 2: "UART wait", 3: "SYS_STAT poll", 4: "Coulomb Counter", 5: "command", 6: "scrub",
+         7: "fault", 8: "CC calibration", 9: "telemetry", 10: "request",
+         11: "power state", 12: "flash write"}
+#Order of commands[] in taskBQ76920.c
+COMMANDS = ["g", "read", "write", "baud", "clock", "i2c", "soc", "cc", "cap", "cells",
+            "stats", "rate", "power", "meter", "crash", "trace", "cpu", "tasks", "help"]
+
+TRACKS = {"CPU": 1, "Steps": 2, "I2C": 3, "Commands": 4, "UART": 5}
+
+
+def parse_dump(data):
+    """Returns (fcy_hz, [(cycles, type, arg), ...]) from the bytes following "trace"."""
+    start = data.find(b"TRACE ")
+    if start < 0:
+        raise ValueError("no TRACE header in the input")
+    end = data.find(b"\r\n", start)
+    if end < 0:
+        raise ValueError("truncated TRACE header")
+    fields = data[start:end].split()
+    count, fcy_hz = int(fields[1]), int(fields[2])
+    body = data[end + 2:end + 2 + count * RECORD.size]
+    if len(body) < count * RECORD.size:
+        raise ValueError("dump holds %d of %d records" % (len(body) // RECORD.size, count))
+    return fcy_hz, [RECORD.unpack_from(body, i * RECORD.size) for i in range(count)]
+
+
+def fetch_dump(port, baud, timeout_s=10.0):
+    import serial       #only needed for a live capture
+
+    with serial.Serial(port, baud, timeout=0.5) as ser:
+        ser.reset_input_buffer()
+        ser.write(b"trace\r\n")
+        data = b""
+        header_end = -1
+        count = None
+        for _ in range(int(timeout_s / 0.5)):
+            data += ser.read(4096)
+            if count is None:
+                start = data.find(b"TRACE ")
+                header_end = data.find(b"\r\n", start) if start >= 0 else -1
+                if header_end >= 0:
+                    count = int(data[start:header_end].split()[1])
+            if count is not None and len(data) >= header_end + 2 + count * RECORD.size:
+                return data
+        raise TimeoutError("no complete trace dump from %s" % port)
+
+
+def timestamps_us(fcy_hz, records):
+    """Microseconds since the oldest record. The counter is 32-bit and counts
+    Fcy cycles, and TRACE_CLOCK records carry the Fcy in MHz before them, so
+    the rate is known walking back from the newest record."""
+    times = [0.0] * len(records)
+    rate = fcy_hz / 1e6                  #cycles per us
+    deltas = [0.0] * len(records)
+    for i in range(len(records) - 1, 0, -1):
+        if records[i][1] == TRACE_CLOCK:
+            rate = records[i][2]
+        deltas[i] = ((records[i][0] - records[i - 1][0]) & 0xFFFFFFFF) / rate
+    for i in range(1, len(records)):
+        times[i] = times[i - 1] + deltas[i]
+    return times
+
+
+def to_chrome(fcy_hz, records):
+    times = timestamps_us(fcy_hz, records)
+    events = [{"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "BQ76920 firmware"}}]
+    for name, tid in TRACKS.items():
+        events.append({"ph": "M", "pid": 1, "tid": tid, "name": "thread_name", "args": {"name": name}})
+        events.append({"ph": "M", "pid": 1, "tid": tid, "name": "thread_sort_index", "args": {"sort_index": tid}})
+
+    open_slices = {}        #track -> (name, start)
+
+    def close(track, t):
+        if track in open_slices:
+            name, start = open_slices.pop(track)
+            events.append({"ph": "X", "pid": 1, "tid": TRACKS[track], "name": name,
+                           "ts": start, "dur": max(t - start, 0.0)})
+
+    for (cycles, kind, arg), t in zip(records, times):
+        if kind == TRACE_TASK:
+            close("CPU", t)
+            open_slices["CPU"] = (TASKS[arg] if arg < len(TASKS) else "task %d" % arg, t)
+        elif kind == TRACE_STEP:
+            close("Steps", t)
+            open_slices["Steps"] = (STEPS.get(arg, "step %d" % arg), t)
+        elif kind == TRACE_I2C_START:
+            close("I2C", t)
+            open_slices["I2C"] = ("transaction", t)
+        elif kind == TRACE_I2C_DONE:
+            if "I2C" in open_slices and arg:
+                open_slices["I2C"] = ("collision", open_slices["I2C"][1])
+            close("I2C", t)
+        elif kind == TRACE_COMMAND:
+            open_slices["Commands"] = ("command", t)
+        elif kind == TRACE_COMMAND_END:
+            if "Commands" in open_slices:
+                name = COMMANDS[arg] if arg < len(COMMANDS) else "unknown"
+                open_slices["Commands"] = (name, open_slices["Commands"][1])
+            close("Commands", t)
+        elif kind == TRACE_UART_DRAIN:
+            events.append({"ph": "i", "s": "t", "pid": 1, "tid": TRACKS["UART"], "name": "TX drained", "ts": t})
+        elif kind == TRACE_CLOCK:
+            events.append({"ph": "i", "s": "g", "pid": 1, "tid": TRACKS["CPU"], "name": "clock switch",
+                           "ts": t, "args": {"previous_fcy_mhz": arg}})
+    end = times[-1] if times else 0.0
+    for track in list(open_slices):
+        close(track, end)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert the firmware's event trace to Chrome tracing JSON")
+    parser.add_argument("dump", nargs="?", help="saved dump (raw bytes of the 'trace' reply)")
+    parser.add_argument("--port", help="fetch a dump from the board on this serial port")
+    parser.add_argument("--baud", type=int, default=DEFAULT_BAUD, help="UART baud rate")
+    parser.add_argument("--save", help="also save the fetched raw dump here")
+    parser.add_argument("-o", "--output", default="trace.json", help="Chrome tracing JSON file")
+    args = parser.parse_args()
+
+    if args.port:
+        data = fetch_dump(args.port, args.baud)
+        if args.save:
+            with open(args.save, "wb") as f:
+                f.write(data)
+    elif args.dump:
+        with open(args.dump, "rb") as f:
+            data = f.read()
+    else:
+        parser.error("give a dump file or --port")
+
+    fcy_hz, records = parse_dump(data)
+    with open(args.output, "w") as f:
+        json.dump(to_chrome(fcy_hz, records), f, indent=1)
+    span_ms = timestamps_us(fcy_hz, records)[-1] / 1000.0 if records else 0.0
+    print("%d events over %.1f ms written to %s" % (len(records), span_ms, args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -46,6 +46,8 @@
 #include "xc.h"
 #include "clock.h"
 
+uint32_t CLOCK_SystemFrequencyHz = _XTAL_FREQ;
+
 void CLOCK_Initialize(void)
 {
     // PLLEN disabled; RCDIV FRC/2; DOZE 1:8; DOZEN disabled; ROI disabled; 
@@ -75,4 +77,5 @@ void CLOCK_Initialize(void)
     // CF no clock failure; NOSC FRCDIV; SOSCEN disabled; POSCEN disabled; CLKLOCK unlocked; OSWEN Switch is Complete; IOLOCK not-active; 
     __builtin_write_OSCCONH((uint8_t) (0x07));
     __builtin_write_OSCCONL((uint8_t) (0x00));
+    CLOCK_SystemFrequencyHz = _XTAL_FREQ;
 }
@@ -55,7 +55,16 @@
 #define _XTAL_FREQ  4000000UL
 #endif
 
-#define CLOCK_SystemFrequencyGet()        (4000000UL)
+#include <stdint.h>
+
+/**
+ * Oscillator frequency (Fosc) currently in use. Starts at the FRCDIV
+ * default below and is updated by clock_profile_set() after a clock switch,
+ * so every divisor derived through CLOCK_PeripheralFrequencyGet() follows it.
+ */
+extern uint32_t CLOCK_SystemFrequencyHz;
+
+#define CLOCK_SystemFrequencyGet()        (CLOCK_SystemFrequencyHz)
 
 #define CLOCK_PeripheralFrequencyGet()    (CLOCK_SystemFrequencyGet() / 2)
 
@@ -44,7 +44,10 @@
     TERMS.
 */
 
+#include "clock.h"
 #include "i2c1.h"
+#include "tmr2.h"
+#include "trace.h"
 
 /**
  Section: Data Types
@@ -175,6 +178,8 @@ typedef enum
 
 static void I2C1_FunctionComplete(void);
 static void I2C1_Stop(I2C1_MESSAGE_STATUS completion_code);
+static void I2C1_BusConfigure(uint16_t brg);
+static void I2C1_TimingRecord(uint32_t cycles);
 
 /**
  Section: Local Variables
@@ -188,6 +193,12 @@ static uint8_t                       i2c1_trb_count;
 static I2C1_TRANSACTION_REQUEST_BLOCK *p_i2c1_trb_current;
 static I2C_TR_QUEUE_ENTRY            *p_i2c1_current = NULL;
 
+static uint32_t                      i2c1_bus_speed = I2C1_DEFAULT_BUS_SPEED_HZ;
+static uint16_t                      i2c1_cycles_per_us;
+static uint32_t                      i2c1_start_count;  // TMR2 count at the start condition
+static bool                          i2c1_timing_active = false;
+static I2C1_TIMING                   i2c1_timing;
+
 
 /**
   Section: Driver Interface
@@ -202,12 +213,16 @@ void I2C1_Initialize(void)
     i2c1_object.trStatus.s.full = false;
 
     i2c1_object.i2cErrors = 0;
+
+    i2c1_bus_speed = I2C1_DEFAULT_BUS_SPEED_HZ;
+    i2c1_cycles_per_us = CLOCK_PeripheralFrequencyGet() / 1000000UL;
+    i2c1_timing_active = false;
     
     // initialize the hardware
-    // Baud Rate Generator Value: I2CBRG 8;   
-    I2C1BRG = 0x08;
-    // ACKEN disabled; STRICT disabled; STREN disabled; GCEN disabled; SMEN disabled; DISSLW enabled; I2CSIDL disabled; ACKDT Sends ACK; SCLREL Holds; RSEN disabled; A10M 7 Bit; PEN disabled; RCEN disabled; SEN disabled; I2CEN enabled; 
-    I2C1CONL = 0x8000;
+    // Baud Rate Generator Value: I2CBRG 8 at Fcy = 2 MHz, derived from the active clock
+    I2C1BRG = I2C1_BRGCompute(CLOCK_PeripheralFrequencyGet(), i2c1_bus_speed);
+    // ACKEN disabled; STRICT disabled; STREN disabled; GCEN disabled; SMEN disabled; DISSLW set (slew control off, standard mode); I2CSIDL disabled; ACKDT Sends ACK; SCLREL Holds; RSEN disabled; A10M 7 Bit; PEN disabled; RCEN disabled; SEN disabled; I2CEN enabled; 
+    I2C1CONL = 0x8200;
     // BCL disabled; D_nA disabled; R_nW disabled; P disabled; S disabled; I2COV disabled; IWCOL disabled; 
     I2C1STAT = 0x00;
 
@@ -217,8 +232,99 @@ void I2C1_Initialize(void)
     // enable the master interrupt
     IEC1bits.MI2C1IE = 1;
 
+    I2C1_TimingReset();
+}
+
+
+uint16_t I2C1_BRGCompute(uint32_t fcy, uint32_t fscl)
+{
+    uint32_t half_period;
+
+    // BRG 2 is Fcy / 8; above it 2 * fscl can wrap to a zero divisor
+    if ((fscl == 0) || (fscl > (fcy / 8)))
+    {
+        return 0;
+    }
+
+    half_period = (fcy + (2 * fscl) - 1) / (2 * fscl);  // round up -> SCL <= fscl
+    if ((half_period < 4) || (half_period > 0x10001UL))
+    {
+        return 0;
+    }
+    return (uint16_t)(half_period - 2);
+}
+
+void I2C1_BRGUpdate(void)
+{
+    uint16_t brg = I2C1_BRGCompute(CLOCK_PeripheralFrequencyGet(), i2c1_bus_speed);
+
+    if (brg != 0)
+    {
+        I2C1_BusConfigure(brg);
+    }
 }
 
+bool I2C1_BusSpeedSet(uint32_t fscl)
+{
+    uint16_t brg = I2C1_BRGCompute(CLOCK_PeripheralFrequencyGet(), fscl);
+
+    if (brg == 0)
+    {
+        return false;
+    }
+
+    i2c1_bus_speed = fscl;
+    I2C1_BusConfigure(brg);
+    return true;
+}
+
+uint32_t I2C1_BusSpeedGet(void)
+{
+    return i2c1_bus_speed;
+}
+
+static void I2C1_BusConfigure(uint16_t brg)
+{
+    I2C1CONLbits.I2CEN = 0;
+    I2C1BRG = brg;
+    // slew-rate control is specified for 400 kHz, standard mode runs without it
+    I2C1CONLbits.DISSLW = (i2c1_bus_speed <= 100000UL) ? 1 : 0;
+    I2C1CONLbits.I2CEN = 1;
+
+    i2c1_cycles_per_us = CLOCK_PeripheralFrequencyGet() / 1000000UL;
+}
+
+void I2C1_TimingGet(I2C1_TIMING *timing)
+{
+    IEC1bits.MI2C1IE = 0;   // the ISR updates the statistics
+    *timing = i2c1_timing;
+    IEC1bits.MI2C1IE = 1;
+}
+
+void I2C1_TimingReset(void)
+{
+    IEC1bits.MI2C1IE = 0;
+    i2c1_timing.count = 0;
+    i2c1_timing.last_us = 0;
+    i2c1_timing.min_us = 0xFFFF;
+    i2c1_timing.max_us = 0;
+    i2c1_timing.total_us = 0;
+    IEC1bits.MI2C1IE = 1;
+}
+
+static void I2C1_TimingRecord(uint32_t cycles)
+{
+    uint32_t us = cycles / i2c1_cycles_per_us;
+    uint16_t us16 = (us > 0xFFFF) ? 0xFFFF : (uint16_t)us;
+
+    i2c1_timing_active = false;
+
+    i2c1_timing.count++;
+    i2c1_timing.last_us = us16;
+    i2c1_timing.total_us += us16;
+    if (us16 < i2c1_timing.min_us) i2c1_timing.min_us = us16;
+    if (us16 > i2c1_timing.max_us) i2c1_timing.max_us = us16;
+}
 
 uint8_t I2C1_ErrorCountGet(void)
 {
@@ -246,6 +352,8 @@ void __attribute__ ( ( interrupt, no_auto_psv ) ) _MI2C1Interrupt ( void )
         I2C1_WRITE_COLLISION_STATUS_BIT = 0;
         i2c1_state = S_MASTER_IDLE;
         *(p_i2c1_current->pTrFlag) = I2C1_MESSAGE_FAIL;
+        i2c1_timing_active = false;
+        trace_event(TRACE_I2C_DONE, 1);
 
         // reset the buffer pointer
         p_i2c1_current = NULL;
@@ -258,6 +366,14 @@ void __attribute__ ( ( interrupt, no_auto_psv ) ) _MI2C1Interrupt ( void )
     {
         case S_MASTER_IDLE:    /* In reset state, waiting for data to send */
 
+            if(i2c1_timing_active)
+            {
+                // this interrupt is the stop condition of the last
+                // transaction completing
+                I2C1_TimingRecord(TMR2_Counter32BitGet() - i2c1_start_count);
+                trace_event(TRACE_I2C_DONE, 0);
+            }
+
             if(i2c1_object.trStatus.s.empty != true)
             {
                 // grab the item pointed by the head
@@ -286,6 +402,9 @@ void __attribute__ ( ( interrupt, no_auto_psv ) ) _MI2C1Interrupt ( void )
                 }
 
                 // send the start condition
+                i2c1_start_count = TMR2_Counter32BitGet();
+                i2c1_timing_active = true;
+                trace_event(TRACE_I2C_START, 0);
                 I2C1_START_CONDITION_ENABLE_BIT = 1;
 
                 // start the i2c request
@@ -234,6 +234,63 @@ typedef struct
 void I2C1_Initialize(void);
 
 
+#define I2C1_DEFAULT_BUS_SPEED_HZ   100000UL    // SCL frequency at power-up
+#define I2C1_FAST_MODE_HZ           400000UL    // BQ76920 maximum, needs Fcy >= 3.2 MHz
+
+/**
+ * @brief Computes I2C1BRG for an SCL frequency: BRG = Fcy / (2 * Fscl) - 2,
+ *        rounded so the bus never runs faster than requested.
+ *
+ * @param fcy  Instruction/peripheral clock in Hz.
+ * @param fscl Requested SCL frequency in Hz.
+ * @return BRG value, or 0 if the speed can't be reached at this clock
+ *         (values 0 and 1 are not supported by the module).
+ */
+uint16_t I2C1_BRGCompute(uint32_t fcy, uint32_t fscl);
+
+/**
+ * @brief Reloads I2C1BRG for the current peripheral clock and bus speed.
+ *        Only call this while the bus is idle (e.g. right after a clock
+ *        switch).
+ */
+void I2C1_BRGUpdate(void);
+
+/**
+ * @brief Changes the SCL frequency. Slew-rate control is enabled for
+ *        fast mode (above 100 kHz) and disabled for standard mode. Only
+ *        call this while the bus is idle.
+ *
+ * @return false (and leaves the bus untouched) if the speed can't be
+ *         generated from the current peripheral clock.
+ */
+bool I2C1_BusSpeedSet(uint32_t fscl);
+
+uint32_t I2C1_BusSpeedGet(void);
+
+/**
+ * @brief Start-to-stop duration of completed transactions, in microseconds.
+ *        One transaction is one queue entry (start, TRBs, stop).
+ */
+typedef struct
+{
+    uint32_t count;
+    uint16_t last_us;
+    uint16_t min_us;
+    uint16_t max_us;
+    uint32_t total_us;      // total_us / count = average
+} I2C1_TIMING;
+
+/**
+ * @brief Copies the transaction timing statistics.
+ */
+void I2C1_TimingGet(I2C1_TIMING *timing);
+
+/**
+ * @brief Clears the transaction timing statistics.
+ */
+void I2C1_TimingReset(void);
+
+
 /**
     @Summary
         Handles one i2c master write transaction with the
@@ -55,6 +55,7 @@
 #include "traps.h"
 #include "uart1.h"
 #include "i2c1.h"
+#include "tmr2.h"
 
 #warning "This file will be removed in future MCC releases. Use system.h instead."
 
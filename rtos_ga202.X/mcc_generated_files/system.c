@@ -50,7 +50,7 @@
 #pragma config DSBOREN = ON    //Deep Sleep BOR Enable bit->DSBOR Enabled
 #pragma config DSWDTEN = ON    //Deep Sleep Watchdog Timer Enable->DSWDT Enabled
 #pragma config DSSWEN = ON    //DSEN Bit Enable->Deep Sleep is controlled by the register bit DSEN
-#pragma config PLLDIV = DISABLED    //USB 96 MHz PLL Prescaler Select bits->PLL Disabled
+#pragma config PLLDIV = PLL4X    //USB 96 MHz PLL Prescaler Select bits->4x PLL selected (used by the 32 MHz clock profile)
 #pragma config I2C1SEL = DISABLE    //Alternate I2C1 enable bit->I2C1 uses SCL1 and SDA1 pins
 #pragma config IOL1WAY = ON    //PPS IOLOCK Set Only Once Enable bit->Once set, the IOLOCK bit cannot be cleared
 
@@ -58,7 +58,7 @@
 #pragma config WPFP = WPFP127    //Write Protection Flash Page Segment Boundary->Page 127 (0x1FC00)
 #pragma config SOSCSEL = OFF    //SOSC Selection bits->Digital (SCLKI) mode
 #pragma config WDTWIN = PS25_0    //Window Mode Watchdog Timer Window Width Select->Watch Dog Timer Window Width is 25 percent
-#pragma config PLLSS = PLL_PRI    //PLL Secondary Selection Configuration bit->PLL is fed by the Primary oscillator
+#pragma config PLLSS = PLL_FRC    //PLL Secondary Selection Configuration bit->PLL is fed by the on-chip Fast RC (FRC) oscillator
 #pragma config BOREN = ON    //Brown-out Reset Enable->Brown-out Reset Enable
 #pragma config WPDIS = WPDIS    //Segment Write Protection Disable->Disabled
 #pragma config WPCFG = WPCFGDIS    //Write Protect Configuration Page Select->Disabled
@@ -68,17 +68,17 @@
 #pragma config POSCMD = NONE    //Primary Oscillator Select->Primary Oscillator Disabled
 #pragma config WDTCLK = LPRC    //WDT Clock Source Select bits->WDT uses LPRC
 #pragma config OSCIOFCN = ON    //OSCO Pin Configuration->OSCO/CLKO/RA3 functions as port I/O (RA3)
-#pragma config FCKSM = CSDCMD    //Clock Switching and Fail-Safe Clock Monitor Configuration bits->Clock switching and Fail-Safe Clock Monitor are disabled
+#pragma config FCKSM = CSECMD    //Clock Switching and Fail-Safe Clock Monitor Configuration bits->Clock switching is enabled, Fail-Safe Clock Monitor is disabled
 #pragma config FNOSC = FRCDIV    //Initial Oscillator Select->Fast RC Oscillator with Postscaler (FRCDIV)
 #pragma config ALTCMPI = CxINC_RB    //Alternate Comparator Input bit->C1INC is on RB13, C2INC is on RB9 and C3INC is on RA0
 #pragma config WDTCMX = WDTCLK    //WDT Clock Source Select bits->WDT clock source is determined by the WDTCLK Configuration bits
 #pragma config IESO = OFF    //Internal External Switchover->Disabled
 
 // CONFIG1
-#pragma config WDTPS = PS32768    //Watchdog Timer Postscaler Select->1:32768
+#pragma config WDTPS = PS1024    //Watchdog Timer Postscaler Select->1:1024
 #pragma config FWPSA = PR128    //WDT Prescaler Ratio Select->1:128
 #pragma config WINDIS = OFF    //Windowed WDT Disable->Standard Watchdog Timer
-#pragma config FWDTEN = OFF    //Watchdog Timer Enable->WDT disabled in hardware; SWDTEN bit disabled
+#pragma config FWDTEN = SWON    //Watchdog Timer Enable->WDT controlled with the SWDTEN bit
 #pragma config ICS = PGx1    //Emulator Pin Placement Select bits->Emulator functions are shared with PGEC1/PGED1
 #pragma config LPCFG = OFF    //Low power regulator control->Disabled - regardless of RETEN
 #pragma config GWRP = OFF    //General Segment Write Protect->Write to program memory allowed
@@ -92,6 +92,7 @@
 #include "interrupt_manager.h"
 #include "traps.h"
 #include "i2c1.h"
+#include "tmr2.h"
 
 void SYSTEM_Initialize(void)
 {
@@ -100,6 +101,7 @@ void SYSTEM_Initialize(void)
     INTERRUPT_Initialize();
     I2C1_Initialize();
     UART1_Initialize();
+    TMR2_Initialize();
 }
 
 /**
@@ -0,0 +1,89 @@
+/**
+  TMR2 Generated Driver Source File
+
+  @Company
+    Microchip Technology Inc.
+
+  @File Name
+    tmr2.c
+
+  @Summary
+    This is the generated source file for the TMR2 driver using PIC24 / dsPIC33 / PIC32MM MCUs
+
+  @Description
+    This source file provides APIs for driver for TMR2.
+    Generation Information :
+        Product Revision  :  PIC24 / dsPIC33  MCUs - 1.171.3
+        Device            :  PIC24FJ128GA202
+    The generated drivers are tested against the following:
+        Compiler          :  XC16 v2.10
+        MPLAB             :  MPLAB X v6.05
+*/
+
+/*
+    (c) 2020 Microchip Technology Inc. and its subsidiaries. You may use this
+    software and any derivatives exclusively with Microchip products.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION
+    WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+    MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE
+    TERMS.
+*/
+
+/**
+  Section: Included Files
+*/
+
+#include <xc.h>
+#include "tmr2.h"
+
+/**
+  Section: Driver Interface
+*/
+
+void TMR2_Initialize (void)
+{
+    //TMR3 0; 
+    TMR3 = 0x00;
+    //TMR2 0; 
+    TMR2 = 0x00;
+    //Period = 2^32 Tcy (2147 s at Fcy = 2 MHz, 268 s at 16 MHz); PR3 65535; PR2 65535; 
+    PR3 = 0xFFFF;
+    PR2 = 0xFFFF;
+    //TCKPS 1:1; T32 32 Bit; TON enabled; TSIDL disabled; TCS FOSC/2; TGATE disabled; 
+    T2CON = 0x8008;
+
+    IFS0bits.T3IF = 0;
+    IEC0bits.T3IE = 0;  // free-running, no interrupt
+}
+
+uint32_t TMR2_Counter32BitGet( void )
+{
+    uint32_t countVal;
+    uint16_t countValUpper;
+    uint16_t countValLower;
+
+    countValLower = TMR2;
+    countValUpper = TMR3HLD;
+
+    //get the current counter value and return it
+    countVal = ((uint32_t)countValUpper << 16) | countValLower;
+
+    return countVal;
+}
+
+/**
+ End of File
+*/
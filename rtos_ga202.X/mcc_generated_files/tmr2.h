@@ -0,0 +1,104 @@
+/**
+  TMR2 Generated Driver Header File
+
+  @Company
+    Microchip Technology Inc.
+
+  @File Name
+    tmr2.h
+
+  @Summary
+    This is the generated header file for the TMR2 driver using PIC24 / dsPIC33 / PIC32MM MCUs
+
+  @Description
+    This header file provides APIs for driver for TMR2.
+    Generation Information :
+        Product Revision  :  PIC24 / dsPIC33  MCUs - 1.171.3
+        Device            :  PIC24FJ128GA202
+    The generated drivers are tested against the following:
+        Compiler          :  XC16 v2.10
+        MPLAB             :  MPLAB X v6.05
+*/
+
+/*
+    (c) 2020 Microchip Technology Inc. and its subsidiaries. You may use this
+    software and any derivatives exclusively with Microchip products.
+
+    THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS". NO WARRANTIES, WHETHER
+    EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED
+    WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A
+    PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION
+    WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION.
+
+    IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE,
+    INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND
+    WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS
+    BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE. TO THE
+    FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS IN
+    ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF ANY,
+    THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+
+    MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE
+    TERMS.
+*/
+
+#ifndef _TMR2_H
+#define _TMR2_H
+
+/**
+  Section: Included Files
+*/
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus  // Provide C++ Compatibility
+
+    extern "C" {
+
+#endif
+
+/**
+  Section: Interface Routines
+*/
+
+/**
+  @Summary
+    Initializes hardware and data for the given instance of the TMR module
+
+  @Description
+    Timer2/Timer3 are paired as one free-running 32-bit counter clocked
+    from Fcy with a 1:1 prescale and no interrupt. At Fcy = 16 MHz it wraps
+    every ~268 s, so differences of two readings are valid for anything
+    shorter than that.
+
+  @Param
+    None.
+
+  @Returns
+    None
+*/
+void TMR2_Initialize (void);
+
+/**
+  @Summary
+    Returns the current 32-bit count (instruction cycles)
+
+  @Description
+    Reading TMR2 latches TMR3 into TMR3HLD, so the two halves are coherent.
+    Safe to call from interrupts.
+*/
+uint32_t TMR2_Counter32BitGet( void );
+
+#ifdef __cplusplus  // Provide C++ Compatibility
+
+    }
+
+#endif
+
+#endif //_TMR2_H
+    
+/**
+ End of File
+*/
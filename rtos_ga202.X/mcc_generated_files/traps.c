@@ -48,9 +48,24 @@
 #include <xc.h>
 #include "traps.h"
 
-#define ERROR_HANDLER __attribute__((interrupt,no_auto_psv))
+/* Before the compiler saves anything, copy the two words the trap pushed
+ * (PC<15:0>, then SRL:IPL3:PC<22:16>) and W15. W0 is parked in RAM rather
+ * than on the stack, which may be the reason for the trap.
+ */
+#define ERROR_HANDLER __attribute__((interrupt(preprologue( \
+    "mov w0, _TRAPS_saved_w0\n" \
+    "mov [w15-4], w0\n" \
+    "mov w0, _TRAPS_stacked_pc\n" \
+    "mov [w15-2], w0\n" \
+    "mov w0, _TRAPS_stacked_pc+2\n" \
+    "mov w15, _TRAPS_stacked_sp\n" \
+    "mov _TRAPS_saved_w0, w0")), no_auto_psv))
 #define FAILSAFE_STACK_GUARDSIZE 8
 
+volatile uint16_t TRAPS_stacked_pc[2];
+volatile uint16_t TRAPS_stacked_sp;
+volatile uint16_t TRAPS_saved_w0;
+
 /**
  * a private place to store the error code if we run into a severe error
  */
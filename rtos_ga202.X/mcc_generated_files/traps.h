@@ -83,4 +83,12 @@ typedef enum
 */
 void TRAPS_halt_on_error(uint16_t code);
 
+/**
+ * What the last trap pushed: [0] = PC<15:0>, [1] = SRL<7:0>:IPL3:PC<22:16>,
+ * and W15 on entry (4 bytes above the interrupted stack pointer). Valid in
+ * TRAPS_halt_on_error().
+ */
+extern volatile uint16_t TRAPS_stacked_pc[2];
+extern volatile uint16_t TRAPS_stacked_sp;
+
 #endif
\ No newline at end of file
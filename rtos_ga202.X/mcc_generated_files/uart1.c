@@ -46,7 +46,55 @@
   Section: Included Files
 */
 #include <xc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "clock.h"
 #include "uart1.h"
+#include "trace.h"
+
+static uint32_t uart1_baud = UART1_DEFAULT_BAUD;
+static uint32_t uart1_tx_count = 0;
+static volatile uint16_t uart1_rx_lost = 0;
+
+/**
+  Section: Data Type Definitions
+*/
+
+/** UART Driver Queue
+
+  @Summary
+    Defines the Transmit queue (ring) shared by UART1_Write and the TX ISR.
+
+  @Description
+    UART1_Write only moves uart1_txHead. uart1_txTail is moved by the
+    interrupt and also by UART1_TxPump in task context, which masks U1TXIE
+    before touching it. That masking is the locking rule: anything else
+    that moves uart1_txTail outside the ISR must do the same.
+*/
+static uint8_t uart1_txByteQ[UART1_CONFIG_TX_BYTEQ_LENGTH];
+static volatile uint16_t uart1_txHead = 0;
+static volatile uint16_t uart1_txTail = 0;
+
+#define UART1_TXQ_NEXT(i)   (((i) + 1) & (UART1_CONFIG_TX_BYTEQ_LENGTH - 1))
+
+/** UART Driver Receive Queue
+
+  @Summary
+    Defines the Receive queue (ring) filled by the RX ISR and emptied by
+    UART1_Read.
+
+  @Description
+    The interrupt only moves uart1_rxHead and the task side only moves
+    uart1_rxTail, so no locking is needed. A byte that finds the queue full
+    is read out of the FIFO anyway and counted in uart1_rx_lost.
+*/
+static uint8_t uart1_rxByteQ[UART1_CONFIG_RX_BYTEQ_LENGTH];
+static volatile uint16_t uart1_rxHead = 0;
+static volatile uint16_t uart1_rxTail = 0;
+
+#define UART1_RXQ_NEXT(i)   (((i) + 1) & (UART1_CONFIG_RX_BYTEQ_LENGTH - 1))
+
+static void UART1_TxPump(void);
 
 /**
   Section: UART1 APIs
@@ -63,8 +111,8 @@ void UART1_Initialize(void)
     U1MODE = (0x8008 & ~(1<<15));  // disabling UARTEN bit
     // UTXISEL0 TX_ONE_CHAR; UTXINV disabled; URXEN disabled; OERR NO_ERROR_cleared; URXISEL RX_ONE_CHAR; UTXBRK COMPLETED; UTXEN disabled; ADDEN disabled; 
     U1STA = 0x00;
-    // BaudRate = 9600; Frequency = 2000000 Hz; U1BRG 51; 
-    U1BRG = 0x33;
+    // BaudRate = 9600; Frequency = 2000000 Hz; U1BRG 51; derived from the active clock
+    U1BRG = UART1_BRGCompute(CLOCK_PeripheralFrequencyGet(), UART1_DEFAULT_BAUD, NULL);
     // ADMADDR 0; ADMMASK 0; 
     U1ADMD = 0x00;
     // T0PD 1 ETU; PTRCL T0; TXRPT Retransmits the error byte once; CONV Direct; SCEN disabled; 
@@ -78,49 +126,142 @@ void UART1_Initialize(void)
     // WTCH 0; 
     U1WTCH = 0x00;
     
+    uart1_txHead = 0;
+    uart1_txTail = 0;
+    IFS0bits.U1TXIF = 0;
+    IEC0bits.U1TXIE = 0;    // enabled by UART1_Write while the queue holds data
+
+    uart1_rxHead = 0;
+    uart1_rxTail = 0;
+    uart1_rx_lost = 0;
+
     U1MODEbits.UARTEN = 1;   // enabling UART ON bit
     U1STAbits.UTXEN = 1;
 
+    IFS0bits.U1RXIF = 0;
+    IEC0bits.U1RXIE = 1;    // every received byte goes through the queue
+
+    uart1_baud = UART1_DEFAULT_BAUD;
 }
 
 uint8_t UART1_Read(void)
 {
-    while(!(U1STAbits.URXDA == 1))
+    uint8_t data;
+
+    while(uart1_rxTail == uart1_rxHead)
     {
         
     }
 
-    if ((U1STAbits.OERR == 1))
+    data = uart1_rxByteQ[uart1_rxTail];
+    uart1_rxTail = UART1_RXQ_NEXT(uart1_rxTail);
+    return data;
+}
+
+void UART1_Write(uint8_t txData)
+{
+    uint16_t next = UART1_TXQ_NEXT(uart1_txHead);
+
+    while(next == uart1_txTail)
     {
-        U1STAbits.OERR = 0;
+        // queue full: drain it from here, the TX interrupt may be masked
+        // (before the scheduler starts or inside a critical section)
+        UART1_TxPump();
     }
-    
-    return U1RXREG;
+
+    uart1_txByteQ[uart1_txHead] = txData;
+    uart1_txHead = next;
+    uart1_tx_count++;
+
+    UART1_TxPump();     // top up the hardware FIFO, the ISR does the rest
 }
 
-void UART1_Write(uint8_t txData)
+// Moves queued bytes into the 4-deep hardware FIFO. The TX interrupt is
+// held off meanwhile and left enabled only while bytes remain.
+static void UART1_TxPump(void)
 {
-    while(U1STAbits.UTXBF == 1)
+    IEC0bits.U1TXIE = 0;
+
+    while((uart1_txTail != uart1_txHead) && (U1STAbits.UTXBF == 0))
     {
-        
+        U1TXREG = uart1_txByteQ[uart1_txTail];
+        uart1_txTail = UART1_TXQ_NEXT(uart1_txTail);
     }
 
-    U1TXREG = txData;    // Write the data byte to the USART.
+    if(uart1_txTail != uart1_txHead)
+    {
+        IEC0bits.U1TXIE = 1;
+    }
+}
+
+void __attribute__ ( ( interrupt, no_auto_psv ) ) _U1TXInterrupt ( void )
+{
+    IFS0bits.U1TXIF = 0;
+
+    while((uart1_txTail != uart1_txHead) && (U1STAbits.UTXBF == 0))
+    {
+        U1TXREG = uart1_txByteQ[uart1_txTail];
+        uart1_txTail = UART1_TXQ_NEXT(uart1_txTail);
+    }
+
+    if(uart1_txTail == uart1_txHead)
+    {
+        IEC0bits.U1TXIE = 0;
+        trace_event(TRACE_UART_DRAIN, 0);
+    }
+}
+
+// Empties the hardware FIFO into the receive queue. An overrun stops the
+// receiver until OERR is cleared, which also flushes the FIFO, so it is
+// cleared only after the bytes already in it have been read.
+void __attribute__ ( ( interrupt, no_auto_psv ) ) _U1RXInterrupt ( void )
+{
+    IFS0bits.U1RXIF = 0;
+
+    while(U1STAbits.URXDA == 1)
+    {
+        uint8_t data = U1RXREG;
+        uint16_t next = UART1_RXQ_NEXT(uart1_rxHead);
+
+        if(next == uart1_rxTail)
+        {
+            uart1_rx_lost++;
+        }
+        else
+        {
+            uart1_rxByteQ[uart1_rxHead] = data;
+            uart1_rxHead = next;
+        }
+    }
+
+    if(U1STAbits.OERR == 1)
+    {
+        U1STAbits.OERR = 0;
+        uart1_rx_lost++;    // at least the byte that found the FIFO full
+    }
 }
 
 bool UART1_IsRxReady(void)
 {
-    return U1STAbits.URXDA;
+    return (uart1_rxTail != uart1_rxHead);
 }
 
 bool UART1_IsTxReady(void)
 {
-    return ((!U1STAbits.UTXBF) && U1STAbits.UTXEN );
+    return ((UART1_TXQ_NEXT(uart1_txHead) != uart1_txTail) && U1STAbits.UTXEN );
 }
 
 bool UART1_IsTxDone(void)
 {
-    return U1STAbits.TRMT;
+    return ((uart1_txTail == uart1_txHead) && U1STAbits.TRMT);
+}
+
+void UART1_TxFlush(void)
+{
+    while(!UART1_IsTxDone())
+    {
+        UART1_TxPump();
+    }
 }
 
 
@@ -128,9 +269,70 @@ void uart1_send_string(const char *str)
 {
     while (*str)
     {
-        while (!UART1_IsTxReady());  // Wait until UART is ready
-        UART1_Write(*str++);
+        UART1_Write(*str++);    // queued, blocks only while the queue is full
+    }
+}
+
+
+uint16_t UART1_BRGCompute(uint32_t fcy, uint32_t baud, int16_t *error_permille)
+{
+    int16_t error = INT16_MAX;
+    uint16_t brg = 0;
+
+    // Fcy / 4 is BRG 0; above it 4 * baud can wrap to a zero divisor
+    if ((baud != 0) && (baud <= (fcy / 4)))
+    {
+        // round to nearest: (fcy / (4 * baud)) - 1
+        uint32_t div = (fcy + (2 * baud)) / (4 * baud);
+        if ((div >= 1) && (div <= 0x10000UL))
+        {
+            uint32_t actual = fcy / (4 * div);
+            brg = (uint16_t)(div - 1);
+            error = (int16_t)(((int32_t)actual - (int32_t)baud) * 1000 / (int32_t)baud);
+        }
+    }
+
+    if (error_permille != NULL)
+    {
+        *error_permille = error;
+    }
+    return brg;
+}
+
+bool UART1_BaudRateSet(uint32_t baud)
+{
+    int16_t error;
+    uint16_t brg = UART1_BRGCompute(CLOCK_PeripheralFrequencyGet(), baud, &error);
+
+    if ((error > UART1_BAUD_MAX_ERROR_PERMILLE) || (error < -UART1_BAUD_MAX_ERROR_PERMILLE))
+    {
+        return false;
     }
+
+    UART1_TxFlush();    // let the last stop bit out at the old rate
+
+    U1MODEbits.UARTEN = 0;
+    U1BRG = brg;
+    U1MODEbits.UARTEN = 1;
+    U1STAbits.UTXEN = 1;
+
+    uart1_baud = baud;
+    return true;
+}
+
+uint32_t UART1_BaudRateGet(void)
+{
+    return uart1_baud;
+}
+
+uint32_t UART1_TxByteCountGet(void)
+{
+    return uart1_tx_count;
+}
+
+uint16_t UART1_RxLostCountGet(void)
+{
+    return uart1_rx_lost;
 }
 
 /*******************************************************************************
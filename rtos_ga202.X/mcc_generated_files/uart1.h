@@ -58,6 +58,13 @@
 
 #endif
 
+/**
+  Section: Macro Declarations
+*/
+
+#define UART1_CONFIG_TX_BYTEQ_LENGTH    256     // transmit queue size, power of 2
+#define UART1_CONFIG_RX_BYTEQ_LENGTH    128     // receive queue size, power of 2, holds a command line
+
 /**
   Section: UART1 APIs
 */
@@ -91,7 +98,8 @@ void UART1_Initialize(void);
     Read a byte of data from the UART1.
 
   @Description
-    This routine reads a byte of data from the UART1.
+    This routine takes a byte from the receive queue, which the RX
+    interrupt fills from the 4-deep hardware FIFO.
 
   @Preconditions
     UART1_Initialize() function should have been called
@@ -113,12 +121,13 @@ uint8_t UART1_Read(void);
     Writes a byte of data to the UART1.
 
   @Description
-    This routine writes a byte of data to the UART1.
+    This routine queues a byte of data for the UART1. The byte is sent by
+    the TX interrupt. If the queue is full the call drains it by polling,
+    so it also works while interrupts are masked.
 
   @Preconditions
     UART1_Initialize() function should have been called
-    before calling this function. The transfer status should be checked to see
-    if transmitter is not busy before calling this function.
+    before calling this function.
 
   @Param
     txData  - Data byte to write to the UART1
@@ -131,7 +140,7 @@ void UART1_Write(uint8_t txData);
 
 /**
   @Description
-    Indicates of there is data available to read.
+    Indicates if there is data in the receive queue.
 
   @Returns
     true if byte can be read.
@@ -159,6 +168,13 @@ bool UART1_IsTxReady(void);
 */
 bool UART1_IsTxDone(void);
 
+/**
+  @Description
+    Blocks until the queue is empty and the last stop bit has been sent.
+    Does not rely on the TX interrupt.
+*/
+void UART1_TxFlush(void);
+
 
 
 
@@ -170,6 +186,70 @@ bool UART1_IsTxDone(void);
 void uart1_send_string(const char *str);
 
 
+/*
+ * Baud rate selection (BRGH = 1): U1BRG = Fcy / (4 * baud) - 1
+ *
+ *   Fcy (clock setting)      9600          19200         38400         57600         115200
+ *   2 MHz  (FRC/2, default)  51  +0.16%    25  +0.16%    12  +0.16%    8   -3.55%    3   +8.51%
+ *   4 MHz  (FRC/1)           103 +0.16%    51  +0.16%    25  +0.16%    16  +2.12%    8   -3.55%
+ *   16 MHz (FRC + 4x PLL)    416 -0.08%    207 +0.16%    103 +0.16%    68  +0.64%    34  -0.79%
+ *
+ * Rates with more than UART1_BAUD_MAX_ERROR_PERMILLE of error are rejected.
+ * Received bytes are moved to the receive queue by the RX interrupt, so the
+ * reader may sleep as long as the queue lasts; the FIFO itself only has to
+ * outlast the interrupt latency (4 bytes: 350 us at 115200).
+ * At 8N1 each byte costs 10 bit times, so throughput is baud / 10 B/s:
+ *
+ *   baud      B/s      'g' status dumps/s (~370 B)   CC lines/s (~62 B)
+ *   9600      960      2.6                           15
+ *   19200     1920     5.2                           31
+ *   38400     3840     10.4                          62
+ *   57600     5760     15.6                          93
+ *   115200    11520    31.1                          186
+ */
+#define UART1_DEFAULT_BAUD              9600UL
+#define UART1_BAUD_MAX_ERROR_PERMILLE   20      // 2.0 %
+
+/**
+ * @brief Computes the U1BRG value (BRGH = 1) for a baud rate.
+ *
+ * @param fcy            Peripheral clock in Hz.
+ * @param baud           Requested baud rate.
+ * @param error_permille Receives the signed baud error in 0.1 % steps (may be NULL).
+ * @return BRG value, or 0 with error_permille set to INT16_MAX if the rate is
+ *         out of range for this clock.
+ */
+uint16_t UART1_BRGCompute(uint32_t fcy, uint32_t baud, int16_t *error_permille);
+
+/**
+ * @brief Reprograms U1BRG for a new baud rate at the current peripheral clock.
+ *
+ * Waits for the transmitter to drain first so no byte is sent at a mixed rate.
+ *
+ * @param baud Requested baud rate.
+ * @return false (and leaves the UART untouched) if the rate can't be
+ *         generated within UART1_BAUD_MAX_ERROR_PERMILLE.
+ */
+bool UART1_BaudRateSet(uint32_t baud);
+
+/**
+ * @brief Returns the baud rate currently programmed by UART1_BaudRateSet().
+ */
+uint32_t UART1_BaudRateGet(void);
+
+/**
+ * @brief Free-running count of bytes written since reset (wraps at 2^32).
+ *        Used to measure telemetry load.
+ */
+uint32_t UART1_TxByteCountGet(void);
+
+/**
+ * @brief Count of received bytes lost since reset, because the receive
+ *        queue was full or the hardware FIFO overran (wraps at 2^16).
+ */
+uint16_t UART1_RxLostCountGet(void);
+
+
 
 /*******************************************************************************
 
@@ -0,0 +1,166 @@
+/*
+ * afe_shadow.c
+ * BQ76920 configuration register shadow and reset detection.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "afe_shadow.h"
+
+#define INDEX(reg)  ((uint8_t)((reg) - AFE_CONFIG_FIRST_REG))
+
+//Bits that read back what was written; the rest are reserved, write-only
+//or driven by the chip
+static const uint8_t stable_bits[AFE_CONFIG_REGS] =
+{
+    0x1F, 0x1F, 0x1F,       //CELLBAL1..3: CB1..CB5
+    0x18,                   //SYS_CTRL1: ADC_EN, TEMP_SEL (not LOAD_PRESENT, SHUT_A/B)
+    0xC0,                   //SYS_CTRL2: DELAY_DIS, CC_EN (not CC_ONESHOT, DSG_ON, CHG_ON)
+    0x9F,                   //PROTECT1: RSNS, SCD_D, SCD_T
+    0x7F,                   //PROTECT2: OCD_D, OCD_T
+    0xF0,                   //PROTECT3: UV_D, OV_D
+    0xFF, 0xFF,             //OV_TRIP, UV_TRIP
+    0x3F,                   //CC_CFG
+};
+
+//Registers the chip changes by itself: always read from the device and
+//always written, even with the value the shadow already has
+#define LIVE_REGS   ((1u << INDEX(0x04)) | (1u << INDEX(AFE_SYS_CTRL2_REG)))
+
+
+void afe_shadow_init(afe_shadow_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->state = AFE_STATE_INIT;
+}
+
+
+bool afe_shadow_holds(uint8_t reg)
+{
+    return reg >= AFE_CONFIG_FIRST_REG && INDEX(reg) < AFE_CONFIG_REGS;
+}
+
+
+bool afe_shadow_stage(afe_shadow_t *s, uint8_t reg, uint8_t value)
+{
+    uint8_t n = INDEX(reg);
+    uint16_t bit;
+
+    if (!afe_shadow_holds(reg)) return false;
+    bit = 1u << n;
+
+    //Already there: nothing to write
+    if ((s->valid & bit) && !(s->dirty & bit) && !(LIVE_REGS & bit) && s->config[n] == value)
+    {
+        return true;
+    }
+
+    s->config[n] = value;
+    s->valid |= bit;
+    s->dirty |= bit;
+    return true;
+}
+
+
+const uint8_t *afe_shadow_next_burst(const afe_shadow_t *s, uint8_t *reg, uint8_t *count)
+{
+    uint8_t first = 0;
+    uint8_t n;
+
+    while (first < AFE_CONFIG_REGS && !(s->dirty & (1u << first))) first++;
+    if (first == AFE_CONFIG_REGS) return NULL;
+
+    for (n = first; n < AFE_CONFIG_REGS && (s->dirty & (1u << n)); n++);
+    *reg = (uint8_t)(first + AFE_CONFIG_FIRST_REG);
+    *count = (uint8_t)(n - first);
+    return &s->config[first];
+}
+
+
+void afe_shadow_flushed(afe_shadow_t *s, uint8_t reg, uint8_t count)
+{
+    for (uint8_t n = INDEX(reg); count > 0 && n < AFE_CONFIG_REGS; n++, count--)
+    {
+        s->dirty &= ~(1u << n);
+    }
+}
+
+
+uint8_t afe_shadow_compare(afe_shadow_t *s, uint8_t reg, const uint8_t data[], uint8_t count)
+{
+    uint8_t mismatches = 0;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t n = (uint8_t)(INDEX(reg) + i);
+        uint16_t bit;
+        uint8_t stable;
+
+        if (!afe_shadow_holds((uint8_t)(reg + i))) continue;
+        bit = 1u << n;
+        stable = stable_bits[n];
+        if (s->dirty & bit) continue;
+
+        if (!(s->valid & bit))
+        {
+            s->config[n] = data[i];
+            s->valid |= bit;
+        }
+        else if ((s->config[n] ^ data[i]) & stable)
+        {
+            s->dirty |= bit;
+            s->corrections++;
+            mismatches++;
+        }
+        s->config[n] = (uint8_t)((s->config[n] & stable) | (data[i] & ~stable));
+    }
+    return mismatches;
+}
+
+
+bool afe_shadow_read(const afe_shadow_t *s, uint8_t reg, uint8_t out[], uint8_t count)
+{
+    uint8_t n = INDEX(reg);
+    uint16_t mask;
+
+    if (!afe_shadow_holds(reg) || count == 0 || n + count > AFE_CONFIG_REGS) return false;
+
+    mask = (uint16_t)(((1u << count) - 1) << n);
+    if ((s->valid & mask) != mask || (s->dirty & mask) || (LIVE_REGS & mask)) return false;
+
+    memcpy(out, &s->config[n], count);
+    return true;
+}
+
+
+bool afe_shadow_set_calibration(afe_shadow_t *s, const uint8_t cal[AFE_CAL_BYTES])
+{
+    bool changed = s->cal_valid && memcmp(s->cal, cal, AFE_CAL_BYTES) != 0;
+
+    memcpy(s->cal, cal, AFE_CAL_BYTES);
+    s->cal_valid = true;
+    return changed;
+}
+
+
+void afe_shadow_configured(afe_shadow_t *s)
+{
+    s->state = AFE_STATE_READY;
+}
+
+
+bool afe_shadow_check_status(afe_shadow_t *s, uint8_t sys_stat)
+{
+    if (s->state == AFE_STATE_INIT) return false;
+
+    if ((sys_stat & AFE_SYS_STAT_DEVICE_XREADY) && s->state == AFE_STATE_READY)
+    {
+        s->state = AFE_STATE_RESET;
+        s->resets++;
+        s->config[INDEX(AFE_SYS_CTRL2_REG)] &= (uint8_t)~AFE_SYS_CTRL2_FETS;
+        s->dirty = s->valid;
+    }
+    return s->state == AFE_STATE_RESET;
+}
@@ -0,0 +1,133 @@
+/*
+ * File:    afe_shadow.h
+ * Summary: Shadow of the BQ76920 configuration registers and reset tracking
+ *
+ * Description:
+ *   Everything the firmware configures in the BQ76920 lives in volatile
+ *   registers 0x01..0x0B (CELLBAL1..CC_CFG). A power cycle of the chip
+ *   (brown-out, hot-plugging the EVM) returns them to their defaults: the
+ *   ADC, the Coulomb Counter and the protection thresholds all stop
+ *   silently. The chip flags that by setting DEVICE_XREADY in SYS_STAT.
+ *
+ *   This module keeps what each of those registers should contain, and the
+ *   factory ADC calibration. Writes are staged into the shadow and marked
+ *   dirty; the task flushes each address-contiguous run of dirty registers
+ *   as one I2C burst and reads it back to verify. A periodic scrub reads
+ *   the whole block and re-dirties whatever the device lost. Clean
+ *   registers the chip never changes by itself are read from the shadow.
+ *   After a reset every known register is dirtied, so recovery is just a
+ *   flush.
+ *
+ *   Bits the chip drives itself (LOAD_PRESENT, CC_ONESHOT, the FETs after
+ *   a protection trip) are not compared; the shadow takes them over from
+ *   each readback, so rewriting a register never turns a FET back on.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency, so the
+ *   flush and recovery sequences can be exercised on a PC.
+ */
+
+#ifndef _AFE_SHADOW_H
+#define _AFE_SHADOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AFE_SYS_STAT_REG            0x00
+#define AFE_SYS_STAT_DEVICE_XREADY  0x20    //set by the chip after a reset or internal fault, write 1 to clear
+#define AFE_CONFIG_FIRST_REG        0x01    //CELLBAL1
+#define AFE_CONFIG_REGS             11      //CELLBAL1..CC_CFG (0x01..0x0B)
+#define AFE_SYS_CTRL2_REG           0x05
+#define AFE_SYS_CTRL2_FETS          0x03    //DSG_ON | CHG_ON, never restored
+#define AFE_CAL_BYTES               3       //ADCGAIN1, ADCOFFSET, ADCGAIN2
+
+typedef enum
+{
+    AFE_STATE_INIT = 0,         //not configured yet, SYS_STAT is not trusted
+    AFE_STATE_READY,            //configured, no reset seen since
+    AFE_STATE_RESET             //DEVICE_XREADY seen, the shadow has to be written back
+} afe_state_t;
+
+typedef struct
+{
+    uint8_t config[AFE_CONFIG_REGS];    //what each register should contain
+    uint16_t valid;                     //bit n set: config[n] is known (written or read back)
+    uint16_t dirty;                     //bit n set: config[n] still has to be written
+    uint8_t cal[AFE_CAL_BYTES];
+    bool cal_valid;
+    afe_state_t state;
+    uint16_t resets;                    //resets detected since boot
+    uint16_t corrections;               //registers found wrong by a verify or scrub
+} afe_shadow_t;
+
+/**
+ * @brief Empty shadow, state AFE_STATE_INIT.
+ */
+void afe_shadow_init(afe_shadow_t *s);
+
+/**
+ * @brief True for the registers the shadow holds (0x01..0x0B).
+ */
+bool afe_shadow_holds(uint8_t reg);
+
+/**
+ * @brief Stages a write. Returns false if the register isn't shadowed
+ *        (the caller writes it directly). A value the register is already
+ *        known to hold is not dirtied again.
+ */
+bool afe_shadow_stage(afe_shadow_t *s, uint8_t reg, uint8_t value);
+
+/**
+ * @brief First run of consecutive dirty registers: its address, length
+ *        and the bytes to write. NULL when nothing is dirty.
+ */
+const uint8_t *afe_shadow_next_burst(const afe_shadow_t *s, uint8_t *reg, uint8_t *count);
+
+/**
+ * @brief Marks count registers from reg as written.
+ */
+void afe_shadow_flushed(afe_shadow_t *s, uint8_t reg, uint8_t count);
+
+/**
+ * @brief Checks count bytes read back from reg against the shadow.
+ *        Unknown registers are learned, the chip-driven bits are taken
+ *        over, registers with a pending write are skipped. A mismatch is
+ *        dirtied again and counted. Returns the number of mismatches.
+ */
+uint8_t afe_shadow_compare(afe_shadow_t *s, uint8_t reg, const uint8_t data[], uint8_t count);
+
+/**
+ * @brief Serves count registers from reg out of the shadow. Returns false
+ *        (out untouched) unless all of them are known, clean and never
+ *        changed by the chip itself.
+ */
+bool afe_shadow_read(const afe_shadow_t *s, uint8_t reg, uint8_t out[], uint8_t count);
+
+/**
+ * @brief Stores the calibration bytes just read. Returns true if a
+ *        previous copy existed and differs from them.
+ */
+bool afe_shadow_set_calibration(afe_shadow_t *s, const uint8_t cal[AFE_CAL_BYTES]);
+
+/**
+ * @brief Marks the configuration as written (AFE_STATE_READY).
+ */
+void afe_shadow_configured(afe_shadow_t *s);
+
+/**
+ * @brief Feeds one SYS_STAT reading. On a new reset every known register
+ *        is dirtied with the FET bits cleared (the host decides when to
+ *        switch them on again). Returns true while a reset is pending
+ *        (state AFE_STATE_RESET).
+ */
+bool afe_shadow_check_status(afe_shadow_t *s, uint8_t sys_stat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AFE_SHADOW_H */
@@ -0,0 +1,251 @@
+/*
+ * bms_math.c
+ * Conversion math shared by the firmware and the host replay tool.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+#include "bms_math.h"
+
+
+//Raw VCx code to millivolts. The uint32_t arithmetic (including the wrap
+//of a negative offset) is intentional, it is what the status output has
+//always printed. The firmware converts with bms_cells_raw_to_mV(); this is
+//the definition it has to match.
+uint32_t bms_cell_raw_to_mV(uint16_t raw_value, uint16_t gain_uV, int8_t offset_mV)
+{
+    return ((uint32_t)raw_value * gain_uV) / 1000 + offset_mV;
+}
+
+
+void bms_adc_scale_init(bms_adc_scale_t *scale, uint16_t gain_uV, int8_t offset_mV)
+{
+    scale->gain_uV = gain_uV;
+    scale->offset_mV = offset_mV;
+    scale->gain_recip = (gain_uV < 1000u) ? (uint16_t)(((uint32_t)gain_uV << 16) / 1000u) : 0;
+}
+
+
+//raw * gain / 1000 as (raw * gain_recip) >> 16. gain_recip is rounded down
+//by less than 1, so for any 16-bit raw the estimate is low by less than
+//raw / 65536 < 1: it is the exact quotient or one below, and the remainder
+//against 1000 tells which.
+uint16_t bms_cells_raw_to_mV(const bms_adc_scale_t *scale, const uint16_t raw[],
+                             uint16_t cell_mV[], uint8_t count)
+{
+    uint16_t errors = 0;
+
+    for (uint8_t n = 0; n < count; n++)
+    {
+        uint16_t raw_value = raw[n];
+        uint32_t voltage_mV;
+
+        if (scale->gain_recip != 0)
+        {
+            uint16_t q = (uint16_t)(((uint32_t)raw_value * scale->gain_recip) >> 16);
+            if ((uint32_t)raw_value * scale->gain_uV - (uint32_t)q * 1000u >= 1000u) q++;
+            voltage_mV = (uint32_t)q + scale->offset_mV;
+        }
+        else
+        {
+            voltage_mV = bms_cell_raw_to_mV(raw_value, scale->gain_uV, scale->offset_mV);
+        }
+
+        if (bms_cell_reading_is_error(raw_value, voltage_mV)) errors |= 1u << n;
+        cell_mV[n] = (uint16_t)voltage_mV;
+    }
+    return errors;
+}
+
+
+bool bms_cell_reading_is_error(uint16_t raw_value, uint32_t voltage_mV)
+{
+    return (raw_value < BMS_CELL_ERROR_RAW_MIN || voltage_mV > BMS_CELL_ERROR_MV_MAX);
+}
+
+
+//BAT_HI/LO = 1.9 mV/LSB. This used to be (uint32_t)(raw * 1.9f); for every
+//16-bit code that equals raw + floor(raw * 9 / 10), done here with the same
+//reciprocal trick as bms_cells_raw_to_mV() instead of float math.
+uint32_t bms_pack_raw_to_mV(uint16_t raw_value)
+{
+    uint16_t tenths = (uint16_t)(((uint32_t)raw_value * 58982u) >> 16);    //9/10 * 65536
+
+    if ((uint32_t)raw_value * 9u - (uint32_t)tenths * 10u >= 10u) tenths++;
+    return (uint32_t)raw_value + tenths;
+}
+
+
+void bms_ts_raw_to_temp(uint16_t raw_value, bms_temp_t *out)
+{
+    float v_ts1, r_therm, temp_c;
+
+    v_ts1 = raw_value * 0.00005f;  //volts
+
+    //Calculate thermistor resistance
+    float v_bias = 2.5f;         //REGOUT
+    float r_pullup = 10000.0f;   //10k resistor from REGOUT to TS1
+    r_therm = (v_ts1 * r_pullup) / (v_bias - v_ts1);
+
+    //Beta model temperature calculation
+    float t0 = 298.15f;          //25 C in Kelvin
+    float b = 3435.0f;           //Beta constant
+    float r0 = 10000.0f;         //10kOhm at 25 C
+
+    float temp_k = 1.0f / ( (1.0f / t0) + (1.0f / b) * logf(r_therm / r0) );
+    temp_c = temp_k - 273.15f;
+
+    out->v_ts1 = v_ts1;
+    out->r_therm = r_therm;
+    out->temp_c = temp_c;
+}
+
+
+//A Coulomb Counter can only work accurately if each updated value accounts
+//for the time since the previous one. The tick rate is 1000 Hz (1 ms/tick).
+float bms_elapsed_sec(uint32_t now_tick, uint32_t last_tick)
+{
+    return (last_tick == 0) ? 1.0f : (now_tick - last_tick) / (float)BMS_TICK_RATE_HZ;
+}
+
+
+float bms_cc_raw_to_current_A(int16_t cc_value, float cc_gain_uV, float shunt_ohm)
+{
+    float cc_voltage_V = (float)cc_value * cc_gain_uV * 1e-6f;
+    return cc_voltage_V / shunt_ohm;
+}
+
+
+float bms_soc_integrate(float remaining_mAh, float capacity_mAh, float current_A, float dt_sec)
+{
+    //Convert to charge (mAh) over elapsed time (3600.0f is # of seconds in 1 hour)
+    float delta_charge_mAh = (current_A * dt_sec * 1000.0f) / 3600.0f;
+
+    remaining_mAh -= delta_charge_mAh; //adding a negative value for discharge
+    if (remaining_mAh > capacity_mAh) remaining_mAh = capacity_mAh;
+    if (remaining_mAh < 0.0f) remaining_mAh = 0.0f;
+
+    return remaining_mAh;
+}
+
+
+float bms_soc_percent(float remaining_mAh, float capacity_mAh)
+{
+    return (remaining_mAh / capacity_mAh) * 100.0f;
+}
+
+
+//Open-circuit voltage (mV) at 0 %, 10 %, ... 100 % SoC, room temperature.
+//Typical datasheet curves; replace with the pack vendor's table if known.
+static const uint16_t ocv_table_mV[BMS_CHEM_COUNT][BMS_OCV_POINTS] =
+{
+    [BMS_CHEM_NMC] = { 3000, 3450, 3550, 3620, 3670, 3720, 3790, 3870, 3950, 4050, 4180 },
+    [BMS_CHEM_LFP] = { 2500, 3100, 3200, 3250, 3275, 3290, 3300, 3310, 3330, 3340, 3600 },
+};
+
+
+float bms_ocv_soc_percent(bms_chem_t chem, uint16_t cell_mV, bool *reliable)
+{
+    const uint16_t *table = ocv_table_mV[(chem < BMS_CHEM_COUNT) ? chem : BMS_CHEM_NMC];
+    uint8_t i;
+
+    if (reliable != NULL) *reliable = true;  //both ends of the curve are steep
+    if (cell_mV <= table[0]) return 0.0f;
+    if (cell_mV >= table[BMS_OCV_POINTS - 1]) return 100.0f;
+
+    for (i = 1; cell_mV > table[i]; i++);   //table[i - 1] < cell_mV <= table[i]
+
+    uint16_t span = table[i] - table[i - 1];
+    if (reliable != NULL) *reliable = (span >= BMS_OCV_MIN_SLOPE_MV);
+
+    return (i - 1) * 10.0f + 10.0f * (float)(cell_mV - table[i - 1]) / (float)span;
+}
+
+
+int32_t bms_ocv_mV_q16(bms_chem_t chem, int32_t soc_q16, int32_t *slope_q16)
+{
+    const uint16_t *table = ocv_table_mV[(chem < BMS_CHEM_COUNT) ? chem : BMS_CHEM_NMC];
+    uint16_t i;
+    int32_t offset_q16, span;
+
+    if (soc_q16 < 0) soc_q16 = 0;
+    if (soc_q16 > (100L << 16)) soc_q16 = 100L << 16;
+
+    i = (uint16_t)(soc_q16 >> 16) / 10;     //10 % per table step
+    if (i > BMS_OCV_POINTS - 2) i = BMS_OCV_POINTS - 2;
+    offset_q16 = soc_q16 - ((int32_t)(i * 10) << 16);
+    span = (int32_t)table[i + 1] - table[i];
+
+    //span mV per 10 %: (span * offset) / 10 stays well inside 32 bits
+    if (slope_q16 != NULL) *slope_q16 = (span << 16) / 10;
+    return ((int32_t)table[i] << 16) + (span * offset_q16) / 10;
+}
+
+
+bool bms_rest_detect(bms_rest_t *rest, float current_A, float dt_sec)
+{
+    //First-order low-pass so a single noisy CC reading doesn't end the rest
+    rest->avg_A += (current_A - rest->avg_A) * dt_sec / (BMS_REST_FILTER_SEC + dt_sec);
+
+    if (rest->avg_A > BMS_REST_CURRENT_A || rest->avg_A < -BMS_REST_CURRENT_A)
+    {
+        rest->rest_sec = 0.0f;
+        rest->anchored = false;
+        return false;
+    }
+
+    rest->rest_sec += dt_sec;
+    if (!rest->anchored && rest->rest_sec >= BMS_REST_TIME_SEC)
+    {
+        rest->anchored = true;
+        return true;
+    }
+    return false;
+}
+
+
+bool bms_cc_cal_sample(bms_cc_cal_t *cal, int16_t cc_value)
+{
+    float mean_lsb;
+
+    if (cc_value > BMS_CC_CAL_MAX_LSB || cc_value < -BMS_CC_CAL_MAX_LSB)
+    {
+        bms_cc_cal_restart(cal);
+        return false;
+    }
+
+    cal->sum += cc_value;
+    if (++cal->count < BMS_CC_CAL_SAMPLES) return false;
+
+    mean_lsb = (float)cal->sum / BMS_CC_CAL_SAMPLES;
+    if (cal->valid)
+    {
+        cal->offset_lsb += (mean_lsb - cal->offset_lsb) * BMS_CC_CAL_BLEND;
+    }
+    else
+    {
+        cal->offset_lsb = mean_lsb;
+        cal->valid = true;
+    }
+    bms_cc_cal_restart(cal);
+    return true;
+}
+
+
+void bms_cc_cal_restart(bms_cc_cal_t *cal)
+{
+    cal->sum = 0;
+    cal->count = 0;
+}
+
+
+float bms_cc_cal_current_A(const bms_cc_cal_t *cal, int16_t cc_value, float cc_gain_uV,
+                           float shunt_ohm, float deadband_A)
+{
+    float cc_voltage_V = ((float)cc_value - cal->offset_lsb) * cc_gain_uV * 1e-6f;
+    float current_A = cc_voltage_V / shunt_ohm;
+
+    return (fabsf(current_A) < deadband_A) ? 0.0f : current_A;
+}
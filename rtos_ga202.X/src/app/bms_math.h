@@ -0,0 +1,205 @@
+/*
+ * File:    bms_math.h
+ * Summary: Conversion math shared by the firmware and the host replay tool
+ *
+ * Description:
+ *   Raw BQ76920 register values are turned into cell/pack voltages,
+ *   thermistor temperature, current and State of Charge here. The file has
+ *   no dependency on xc.h, FreeRTOS or the MCC drivers so that the exact
+ *   same source can be compiled for the host (Python_GUI_BQ76920/bms_replay.py
+ *   builds it as a shared library) and replay recorded sessions bit-for-bit.
+ */
+
+#ifndef _BMS_MATH_H
+#define _BMS_MATH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BMS_CELL_ERROR_RAW_MIN      10u     //raw codes below this are treated as open wire
+#define BMS_CELL_ERROR_MV_MAX       5000u   //anything above this is not a real Li-ion cell
+
+#define BMS_TICK_RATE_HZ            1000u   //must match configTICK_RATE_HZ
+
+#define BMS_OCV_POINTS              11      //0 %, 10 %, ... 100 %
+#define BMS_OCV_MIN_SLOPE_MV        20      //per 10 % step, flatter segments can't anchor SoC
+
+#define BMS_REST_CURRENT_A          0.05f   //filtered |I| below this counts as rest
+#define BMS_REST_FILTER_SEC         60.0f   //time constant of that filter, rides out CC noise
+#define BMS_REST_TIME_SEC           1800.0f //30 min for the cell voltage to relax to OCV
+
+#define BMS_CC_CAL_SAMPLES          16      //zero-current CC readings per offset estimate
+#define BMS_CC_CAL_MAX_LSB          8       //a reading further out than this isn't zero current
+#define BMS_CC_CAL_BLEND            0.25f   //weight of each new estimate once one exists
+
+/**
+ * @brief Cell chemistries with an open-circuit-voltage table.
+ */
+typedef enum
+{
+    BMS_CHEM_NMC = 0,   //Li-ion NMC/NCA, 4.2 V full
+    BMS_CHEM_LFP,       //LiFePO4, 3.6 V full (flat plateau, anchors only near the ends)
+    BMS_CHEM_COUNT
+} bms_chem_t;
+
+/**
+ * @brief Rest-period detector state. Zero-initialise before first use.
+ */
+typedef struct
+{
+    float avg_A;        //low-pass filtered current
+    float rest_sec;     //how long |avg_A| has stayed below BMS_REST_CURRENT_A
+    bool anchored;      //already reported during this rest period
+} bms_rest_t;
+
+/**
+ * @brief Coulomb Counter zero-current offset. Zero-initialise before first
+ *        use, or set offset_lsb/valid from a stored value.
+ */
+typedef struct
+{
+    float offset_lsb;   //CC reading at zero current, in CC LSBs
+    int32_t sum;        //readings collected towards the next estimate
+    uint8_t count;
+    bool valid;         //offset_lsb holds a measured (or restored) value
+} bms_cc_cal_t;
+
+/**
+ * @brief ADCGAIN/ADCOFFSET with the divide by 1000 precomputed as a
+ *        reciprocal. Refill with bms_adc_scale_init() whenever they are
+ *        (re)read.
+ */
+typedef struct
+{
+    uint16_t gain_uV;
+    int8_t offset_mV;
+    uint16_t gain_recip;    //floor(gain_uV * 65536 / 1000), 0 if that doesn't fit
+} bms_adc_scale_t;
+
+/**
+ * @brief Thermistor values derived from one TS1 reading.
+ */
+typedef struct
+{
+    float v_ts1;        //volts at the TS1 pin
+    float r_therm;      //thermistor resistance (Ohms)
+    float temp_c;       //temperature (Celsius)
+} bms_temp_t;
+
+/**
+ * @brief Converts a VCx raw reading to millivolts using the factory
+ *        ADCGAIN (uV/LSB) and ADCOFFSET (mV) calibration values.
+ */
+uint32_t bms_cell_raw_to_mV(uint16_t raw_value, uint16_t gain_uV, int8_t offset_mV);
+
+/**
+ * @brief Precomputes the reciprocal for bms_cells_raw_to_mV().
+ */
+void bms_adc_scale_init(bms_adc_scale_t *scale, uint16_t gain_uV, int8_t offset_mV);
+
+/**
+ * @brief Converts count raw VCx codes at once, bit-exact with
+ *        bms_cell_raw_to_mV() (cast to 16 bits) but with 16x16->32
+ *        multiplies only, no divide. Returns a mask of the readings that
+ *        bms_cell_reading_is_error() rejects (bit n = raw[n]).
+ */
+uint16_t bms_cells_raw_to_mV(const bms_adc_scale_t *scale, const uint16_t raw[],
+                             uint16_t cell_mV[], uint8_t count);
+
+/**
+ * @brief Returns true if a cell reading looks like an open input or garbage.
+ */
+bool bms_cell_reading_is_error(uint16_t raw_value, uint32_t voltage_mV);
+
+/**
+ * @brief Converts a BAT_HI/BAT_LO raw reading to millivolts (1.9 mV/LSB).
+ */
+uint32_t bms_pack_raw_to_mV(uint16_t raw_value);
+
+/**
+ * @brief Converts a TS1 raw reading into voltage, resistance and temperature
+ *        (10k pull-up from REGOUT, 10k/3435 NTC beta model).
+ */
+void bms_ts_raw_to_temp(uint16_t raw_value, bms_temp_t *out);
+
+/**
+ * @brief Elapsed seconds between two tick counts. The very first sample
+ *        (last_tick == 0) is weighted as one second.
+ */
+float bms_elapsed_sec(uint32_t now_tick, uint32_t last_tick);
+
+/**
+ * @brief Converts a signed CC_HI/CC_LO reading to pack current in Amps.
+ */
+float bms_cc_raw_to_current_A(int16_t cc_value, float cc_gain_uV, float shunt_ohm);
+
+/**
+ * @brief Integrates current over dt_sec and returns the new remaining
+ *        capacity, clamped to [0, capacity_mAh].
+ */
+float bms_soc_integrate(float remaining_mAh, float capacity_mAh, float current_A, float dt_sec);
+
+/**
+ * @brief Remaining capacity as a percentage of capacity_mAh.
+ */
+float bms_soc_percent(float remaining_mAh, float capacity_mAh);
+
+/**
+ * @brief SoC (%) of a relaxed cell from its open-circuit voltage, linear
+ *        between table points and clamped to 0..100 %.
+ *
+ * @param reliable Set to false when the voltage sits on a segment flatter
+ *                 than BMS_OCV_MIN_SLOPE_MV, where a few mV of error move
+ *                 SoC by several %. May be NULL.
+ */
+float bms_ocv_soc_percent(bms_chem_t chem, uint16_t cell_mV, bool *reliable);
+
+/**
+ * @brief Fixed-point OCV lookup for the EKF: open-circuit voltage and its
+ *        slope at a given SoC.
+ *
+ * @param soc_q16   SoC in % (Q16.16), clamped to 0..100 %.
+ * @param slope_q16 Receives dOCV/dSoC in mV per % (Q16.16). May be NULL.
+ * @return OCV in mV (Q16.16).
+ */
+int32_t bms_ocv_mV_q16(bms_chem_t chem, int32_t soc_q16, int32_t *slope_q16);
+
+/**
+ * @brief Feeds one current sample to the rest detector. Returns true once
+ *        per rest period, when the filtered current has stayed below
+ *        BMS_REST_CURRENT_A for BMS_REST_TIME_SEC.
+ */
+bool bms_rest_detect(bms_rest_t *rest, float current_A, float dt_sec);
+
+/**
+ * @brief Feeds one CC reading taken while no current can flow (both FETs
+ *        off). Every BMS_CC_CAL_SAMPLES readings the mean becomes the new
+ *        offset (the first one directly, later ones blended in). A reading
+ *        outside +/-BMS_CC_CAL_MAX_LSB discards the readings collected so
+ *        far. Returns true when offset_lsb was updated.
+ */
+bool bms_cc_cal_sample(bms_cc_cal_t *cal, int16_t cc_value);
+
+/**
+ * @brief Drops readings collected towards the next estimate, e.g. when
+ *        the FETs were switched on in the middle of a window.
+ */
+void bms_cc_cal_restart(bms_cc_cal_t *cal);
+
+/**
+ * @brief bms_cc_raw_to_current_A() with the offset removed. Results with a
+ *        magnitude below deadband_A are returned as 0.
+ */
+float bms_cc_cal_current_A(const bms_cc_cal_t *cal, int16_t cc_value, float cc_gain_uV,
+                           float shunt_ohm, float deadband_A);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BMS_MATH_H */
@@ -0,0 +1,110 @@
+/*
+ * capacity_learn.c
+ * Full-charge capacity learning between SoC anchor points.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <math.h>
+#include <stddef.h>
+
+#include "capacity_learn.h"
+
+
+void cap_learn_init(cap_learn_t *cl, float nominal_mAh, bms_chem_t chem)
+{
+    cl->nominal_mAh = nominal_mAh;
+    cl->learned_mAh = nominal_mAh;
+    cl->cycle_mAh = 0.0f;
+    cl->cycles = 0;
+    cl->learn_count = 0;
+    cl->anchor_soc = -1.0f;
+    cl->since_anchor_mAh = 0.0f;
+    cl->throughput_mAh = 0.0f;
+    cl->full_mV = (uint16_t)((bms_ocv_mV_q16(chem, 100L << 16, NULL) >> 16) - CAP_FULL_MARGIN_MV);
+    cl->at_full = false;
+}
+
+
+bool cap_learn_integrate(cap_learn_t *cl, float current_A, float dt_sec)
+{
+    float delta_mAh = (current_A * dt_sec * 1000.0f) / 3600.0f;
+
+    if (cl->anchor_soc >= 0.0f)
+    {
+        cl->since_anchor_mAh += delta_mAh;
+        cl->throughput_mAh += fabsf(delta_mAh);
+        if (cl->throughput_mAh > CAP_LEARN_MAX_THROUGHPUT * cl->learned_mAh)
+        {
+            cl->anchor_soc = -1.0f;     //too much CC error to learn from
+        }
+    }
+
+    if (delta_mAh > 0.0f)
+    {
+        cl->cycle_mAh += delta_mAh;
+        if (cl->cycle_mAh >= cl->nominal_mAh)
+        {
+            cl->cycle_mAh -= cl->nominal_mAh;
+            if (cl->cycles < UINT16_MAX) cl->cycles++;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool cap_learn_anchor(cap_learn_t *cl, float soc_percent)
+{
+    bool updated = false;
+
+    if (cl->anchor_soc >= 0.0f)
+    {
+        float delta_soc = cl->anchor_soc - soc_percent;    //> 0 after a discharge
+
+        if (fabsf(delta_soc) >= CAP_LEARN_MIN_DELTA_SOC)
+        {
+            float measured_mAh = cl->since_anchor_mAh * 100.0f / delta_soc;
+
+            if (measured_mAh >= CAP_LEARN_MIN_RATIO * cl->nominal_mAh &&
+                measured_mAh <= CAP_LEARN_MAX_RATIO * cl->nominal_mAh)
+            {
+                float weight = CAP_LEARN_GAIN * fabsf(delta_soc) / 100.0f;
+                cl->learned_mAh += (measured_mAh - cl->learned_mAh) * weight;
+                if (cl->learn_count < UINT16_MAX) cl->learn_count++;
+                updated = true;
+            }
+        }
+    }
+
+    cl->anchor_soc = soc_percent;
+    cl->since_anchor_mAh = 0.0f;
+    cl->throughput_mAh = 0.0f;
+    return updated;
+}
+
+
+bool cap_learn_detect_full(cap_learn_t *cl, uint16_t cell_mV, float current_A)
+{
+    float taper_A = CAP_FULL_TAPER_C * cl->learned_mAh / 1000.0f;
+
+    if (cell_mV == 0) return false;
+
+    if (cl->at_full)
+    {
+        if (cell_mV + CAP_FULL_HYSTERESIS_MV < cl->full_mV) cl->at_full = false;
+        return false;
+    }
+
+    if (cell_mV >= cl->full_mV && fabsf(current_A) < taper_A)
+    {
+        cl->at_full = true;
+        return true;
+    }
+    return false;
+}
+
+
+float cap_learn_soh_percent(const cap_learn_t *cl)
+{
+    return cl->learned_mAh * 100.0f / cl->nominal_mAh;
+}
@@ -0,0 +1,94 @@
+/*
+ * File:    capacity_learn.h
+ * Summary: Full-charge capacity learning, cycle count and State of Health
+ *
+ * Description:
+ *   Between two points where SoC is known independently of the Coulomb
+ *   Counter (an "anchor": end of a full charge, or an OCV reading after a
+ *   rest in a steep part of the curve) the counted charge divided by the SoC
+ *   difference is a direct measurement of the capacity. Each measurement
+ *   spanning at least CAP_LEARN_MIN_DELTA_SOC is blended into the learned
+ *   full-charge capacity, weighted by how wide it was. An empty-voltage
+ *   trigger under load is deliberately not used: the IR drop makes it fire
+ *   well above 0 %, which would bias the capacity low.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency, the host
+ *   replay tool builds it too.
+ */
+
+#ifndef _CAPACITY_LEARN_H
+#define _CAPACITY_LEARN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bms_math.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAP_LEARN_MIN_DELTA_SOC     50.0f   //% between anchors for a measurement
+#define CAP_LEARN_GAIN              0.5f    //blend weight of a 100 % wide measurement
+#define CAP_LEARN_MIN_RATIO         0.5f    //measurements outside these fractions of
+#define CAP_LEARN_MAX_RATIO         1.2f    //the nominal capacity are rejected
+#define CAP_LEARN_MAX_THROUGHPUT    2.0f    //segment abandoned after this many capacities moved
+
+#define CAP_FULL_MARGIN_MV          30      //full: cell avg within this of OCV(100 %)
+#define CAP_FULL_HYSTERESIS_MV      100     //re-armed once it drops this far below
+#define CAP_FULL_TAPER_C            0.05f   //and |I| below C/20 (charge terminated)
+
+/**
+ * @brief Learner state. The fields marked "stored" are the ones worth
+ *        keeping across resets, restore them after cap_learn_init().
+ */
+typedef struct
+{
+    float nominal_mAh;
+    float learned_mAh;          //stored: full-charge capacity
+    float cycle_mAh;            //stored: discharge counted towards the next cycle
+    uint16_t cycles;            //stored: equivalent full cycles (nominal capacity each)
+    uint16_t learn_count;       //stored: measurements accepted so far
+    float anchor_soc;           //SoC at the last anchor, < 0 if there is none
+    float since_anchor_mAh;     //net charge removed since that anchor
+    float throughput_mAh;       //charge moved either way since that anchor
+    uint16_t full_mV;           //full-charge detection threshold
+    bool at_full;               //full already reported, waiting for hysteresis
+} cap_learn_t;
+
+/**
+ * @brief Starts with learned = nominal and no anchor.
+ */
+void cap_learn_init(cap_learn_t *cl, float nominal_mAh, bms_chem_t chem);
+
+/**
+ * @brief Counts one CC interval (+ = discharge) towards the segment since
+ *        the last anchor and towards the cycle count. Returns true when the
+ *        cycle count went up.
+ */
+bool cap_learn_integrate(cap_learn_t *cl, float current_A, float dt_sec);
+
+/**
+ * @brief Reports a point where SoC is known. Closes the current segment
+ *        (learning from it if it is wide enough) and starts a new one.
+ *        Returns true when learned_mAh changed.
+ */
+bool cap_learn_anchor(cap_learn_t *cl, float soc_percent);
+
+/**
+ * @brief Full-charge detector: true once when the mean cell voltage is at
+ *        the top of the OCV curve while (almost) no current flows.
+ */
+bool cap_learn_detect_full(cap_learn_t *cl, uint16_t cell_mV, float current_A);
+
+/**
+ * @brief Learned capacity as a percentage of nominal.
+ */
+float cap_learn_soh_percent(const cap_learn_t *cl);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CAPACITY_LEARN_H */
@@ -0,0 +1,42 @@
+/*
+ * cc_meter.c
+ * Coulomb Counter readings to mean current over the measured interval.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <string.h>
+
+#include "cc_meter.h"
+
+
+void cc_meter_init(cc_meter_t *m)
+{
+    memset(m, 0, sizeof(*m));
+}
+
+
+float cc_meter_add(cc_meter_t *m, float current_A, uint32_t now_ms, uint32_t *dt_ms)
+{
+    float mean_A = 0.0f;
+
+    *dt_ms = 0;
+    if (m->have_last)
+    {
+        *dt_ms = now_ms - m->last_ms;
+        mean_A = (m->last_A + current_A) * 0.5f;
+        if (*dt_ms > m->gap_max_ms) m->gap_max_ms = *dt_ms;
+    }
+    m->have_last = true;
+    m->last_A = current_A;
+    m->last_ms = now_ms;
+    m->readings++;
+    return mean_A;
+}
+
+
+const char *cc_meter_mode_name(uint8_t mode)
+{
+    static const char *const names[CC_METER_MODES] = { "continuous", "periodic", "oneshot" };
+
+    return (mode < CC_METER_MODES) ? names[mode] : "?";
+}
@@ -0,0 +1,78 @@
+/*
+ * File:    cc_meter.h
+ * Summary: Coulomb Counter metering modes and charge integration over gaps
+ *
+ * Description:
+ *   The BQ76920 Coulomb Counter either converts continuously (CC_EN, one
+ *   250 ms conversion after the other) or once per CC_ONESHOT write. A pack
+ *   in storage or standby doesn't need four conversions a second, so the
+ *   CC path has three modes:
+ *     continuous  CC_EN while Active, every measurement reads the latest
+ *                 conversion (one-shots in Idle, power_state.c)
+ *     periodic    CC_EN off, one CC_ONESHOT every period_s
+ *     oneshot     CC_EN off, a conversion only when asked for
+ *
+ *   Each reading is the mean current of the 250 ms conversion that ended
+ *   just before it. Between two readings the current is taken to move in a
+ *   straight line from one to the other (trapezoid), weighted by the time
+ *   measured between them. A reading that is missed or arrives late only
+ *   widens one interval, none is lost or counted twice, and the error a
+ *   step in the current leaves averages out instead of always falling on
+ *   the same side, as holding the new reading over the whole interval did.
+ *
+ *   No hardware or RTOS dependency; bms_replay.py --metering checks the
+ *   modes against the true charge of a simulated standby pack.
+ */
+
+#ifndef _CC_METER_H
+#define _CC_METER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CC_METER_MODES              3
+
+typedef enum
+{
+    CC_METER_CONTINUOUS = 0,
+    CC_METER_PERIODIC,
+    CC_METER_ONESHOT
+} cc_meter_mode_t;
+
+typedef struct
+{
+    bool have_last;                 //last_* hold a reading
+    float last_A;                   //current of the last reading
+    uint32_t last_ms;               //tick (ms) it was taken
+    uint32_t readings;              //since init
+    uint32_t gap_max_ms;            //longest interval integrated
+} cc_meter_t;
+
+/**
+ * @brief No reading yet.
+ */
+void cc_meter_init(cc_meter_t *m);
+
+/**
+ * @brief Adds a reading of current_A taken at now_ms (wraps like the
+ *        tick count) and returns the mean current over the interval since
+ *        the previous reading, whose length goes to *dt_ms. The first
+ *        reading only starts the first interval: 0 A over 0 ms.
+ */
+float cc_meter_add(cc_meter_t *m, float current_A, uint32_t now_ms, uint32_t *dt_ms);
+
+/**
+ * @brief "continuous", "periodic", "oneshot", "?" if out of range.
+ */
+const char *cc_meter_mode_name(uint8_t mode);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CC_METER_H */
@@ -0,0 +1,149 @@
+/*
+ * cell_stats.c
+ * Rolling per-cell voltage statistics.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "cell_stats.h"
+
+
+//(a + b) % window for a, b < window, without a division
+static uint8_t ring_add(uint8_t a, uint8_t b, uint8_t window)
+{
+    uint8_t i = (uint8_t)(a + b);
+    return (i >= window) ? (uint8_t)(i - window) : i;
+}
+
+
+void cell_stats_init(cell_stats_t *cs, uint8_t cells, uint8_t window, uint8_t decimate)
+{
+    if (cells > CELL_STATS_MAX_CELLS) cells = CELL_STATS_MAX_CELLS;
+    if (window < 1) window = 1;
+    if (window > CELL_STATS_MAX_WINDOW) window = CELL_STATS_MAX_WINDOW;
+    if (decimate < 1) decimate = 1;
+    if (decimate > CELL_STATS_MAX_DECIMATE) decimate = CELL_STATS_MAX_DECIMATE;
+
+    memset(cs, 0, sizeof(*cs));
+    cs->cells = cells;
+    cs->window = window;
+    cs->decimate = decimate;
+}
+
+
+//Slides one cell's window: drops the sample at pos (if the window is full)
+//and adds x there
+static void window_push(cell_window_t *w, uint8_t pos, uint8_t window, bool full, uint16_t x)
+{
+    uint8_t back;
+
+    if (full)
+    {
+        uint16_t old = w->ring[pos];
+        w->sum -= old;
+        w->sum_sq -= (uint32_t)old * old;
+
+        //The oldest sample can only be at the head of either queue
+        if (w->min_len > 0 && w->min_q[w->min_head] == pos)
+        {
+            w->min_head = ring_add(w->min_head, 1, window);
+            w->min_len--;
+        }
+        if (w->max_len > 0 && w->max_q[w->max_head] == pos)
+        {
+            w->max_head = ring_add(w->max_head, 1, window);
+            w->max_len--;
+        }
+    }
+
+    w->ring[pos] = x;
+    w->sum += x;
+    w->sum_sq += (uint32_t)x * x;
+
+    //Older samples that can no longer be the min (or max) leave the queue
+    while (w->min_len > 0)
+    {
+        back = ring_add(w->min_head, w->min_len - 1, window);
+        if (w->ring[w->min_q[back]] < x) break;
+        w->min_len--;
+    }
+    w->min_q[ring_add(w->min_head, w->min_len, window)] = pos;
+    w->min_len++;
+
+    while (w->max_len > 0)
+    {
+        back = ring_add(w->max_head, w->max_len - 1, window);
+        if (w->ring[w->max_q[back]] > x) break;
+        w->max_len--;
+    }
+    w->max_q[ring_add(w->max_head, w->max_len, window)] = pos;
+    w->max_len++;
+}
+
+
+bool cell_stats_add(cell_stats_t *cs, const uint16_t cell_mV[])
+{
+    bool full = (cs->count == cs->window);
+
+    for (uint8_t c = 0; c < cs->cells; c++)
+    {
+        cs->cell[c].block_sum += cell_mV[c];
+    }
+    if (++cs->block_count < cs->decimate) return false;
+
+    for (uint8_t c = 0; c < cs->cells; c++)
+    {
+        cell_window_t *w = &cs->cell[c];
+        uint16_t x = (uint16_t)((w->block_sum + cs->decimate / 2) / cs->decimate);
+
+        w->block_sum = 0;
+        window_push(w, cs->pos, cs->window, full, x);
+    }
+    cs->block_count = 0;
+    cs->pos = ring_add(cs->pos, 1, cs->window);
+    if (!full) cs->count++;
+    return true;
+}
+
+
+bool cell_stats_get(const cell_stats_t *cs, uint8_t cell, cell_stat_t *out)
+{
+    const cell_window_t *w = &cs->cell[cell];
+    uint32_t n = cs->count;
+    uint64_t spread;
+
+    if (n == 0 || cell >= cs->cells) return false;
+
+    //n^2 * variance, exact in integers: n * sum(x^2) - sum(x)^2
+    spread = n * w->sum_sq - (uint64_t)w->sum * w->sum;
+
+    out->min_mV = w->ring[w->min_q[w->min_head]];
+    out->max_mV = w->ring[w->max_q[w->max_head]];
+    out->mean_mV = (float)w->sum / (float)n;
+    out->sd_mV = sqrtf((float)spread) / (float)n;
+    return true;
+}
+
+
+float cell_stats_imbalance_mV(const cell_stats_t *cs, uint8_t *weakest)
+{
+    uint32_t lowest = UINT32_MAX;
+    uint32_t highest = 0;
+
+    if (cs->count == 0 || cs->cells == 0) return 0.0f;
+
+    //Compare sums rather than means, they share the divisor
+    for (uint8_t c = 0; c < cs->cells; c++)
+    {
+        uint32_t sum = cs->cell[c].sum;
+        if (sum < lowest)
+        {
+            lowest = sum;
+            if (weakest) *weakest = c;
+        }
+        if (sum > highest) highest = sum;
+    }
+    return (float)(highest - lowest) / (float)cs->count;
+}
@@ -0,0 +1,98 @@
+/*
+ * File:    cell_stats.h
+ * Summary: Rolling per-cell voltage statistics and pack imbalance
+ *
+ * Description:
+ *   Keeps min, max, mean and standard deviation of each cell over the last
+ *   `window` samples. Every add is O(1): the mean and variance come from
+ *   running integer sums (an old sample is subtracted exactly, so nothing
+ *   drifts however long it runs), min and max from monotonic queues
+ *   (amortised O(1), each sample enters and leaves a queue once).
+ *
+ *   One sample can be the average of `decimate` snapshots, which stretches
+ *   the window in time without more RAM: 16 samples of 15 snapshots at the
+ *   2 s loop period cover 8 minutes.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency, the host
+ *   replay tool builds it too.
+ */
+
+#ifndef _CELL_STATS_H
+#define _CELL_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cell_topology.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CELL_STATS_MAX_CELLS
+#define CELL_STATS_MAX_CELLS    CELL_TOPOLOGY_AFE_CELLS     //every input of BMS_AFE, ~84 B of RAM each
+#endif
+#define CELL_STATS_MAX_WINDOW   16      //samples per window, sets the RAM used
+#define CELL_STATS_MAX_DECIMATE 250     //snapshots averaged into one sample
+
+typedef struct
+{
+    uint16_t ring[CELL_STATS_MAX_WINDOW];   //samples, oldest at cell_stats_t.pos once full
+    uint8_t min_q[CELL_STATS_MAX_WINDOW];   //ring positions, values rising from the head
+    uint8_t max_q[CELL_STATS_MAX_WINDOW];   //ring positions, values falling from the head
+    uint8_t min_head, min_len;
+    uint8_t max_head, max_len;
+    uint32_t sum;
+    uint64_t sum_sq;
+    uint32_t block_sum;                     //snapshots towards the next sample
+} cell_window_t;
+
+typedef struct
+{
+    cell_window_t cell[CELL_STATS_MAX_CELLS];
+    uint8_t cells;
+    uint8_t window;
+    uint8_t decimate;
+    uint8_t pos;                            //next ring position written
+    uint8_t count;                          //samples in the window so far
+    uint8_t block_count;                    //snapshots in block_sum
+} cell_stats_t;
+
+typedef struct
+{
+    uint16_t min_mV;
+    uint16_t max_mV;
+    float mean_mV;
+    float sd_mV;
+} cell_stat_t;
+
+/**
+ * @brief Empties the windows. window and decimate are clamped to
+ *        1..CELL_STATS_MAX_WINDOW and 1..CELL_STATS_MAX_DECIMATE.
+ */
+void cell_stats_init(cell_stats_t *cs, uint8_t cells, uint8_t window, uint8_t decimate);
+
+/**
+ * @brief Adds one snapshot of `cells` voltages. Returns true when it
+ *        completed a sample (every `decimate` snapshots).
+ */
+bool cell_stats_add(cell_stats_t *cs, const uint16_t cell_mV[]);
+
+/**
+ * @brief Window statistics of one cell. Returns false while the window is
+ *        still empty.
+ */
+bool cell_stats_get(const cell_stats_t *cs, uint8_t cell, cell_stat_t *out);
+
+/**
+ * @brief Spread between the highest and lowest window mean (mV). The
+ *        lowest cell's index goes to *weakest. 0 while the window is empty.
+ */
+float cell_stats_imbalance_mV(const cell_stats_t *cs, uint8_t *weakest);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CELL_STATS_H */
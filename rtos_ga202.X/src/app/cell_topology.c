@@ -0,0 +1,89 @@
+/*
+ * cell_topology.c
+ * Populated VC inputs for each BQ769x0 variant and cell count.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <stddef.h>
+
+#include "cell_topology.h"
+
+//One group of five inputs wired for 3, 4 or 5 cells
+#define GROUP_3     0x13    //VCx1, VCx2, VCx5
+#define GROUP_4     0x17    //VCx1, VCx2, VCx3, VCx5
+#define GROUP_5     0x1F
+#define GROUPS(g0, g1, g2)  ((uint16_t)((g0) | ((g1) << 5) | ((g2) << 10)))
+
+//Extra cells go to the lowest group first
+static const cell_topology_t topologies[] =
+{
+    { BMS_AFE_BQ76920,  3, GROUPS(GROUP_3, 0, 0) },
+    { BMS_AFE_BQ76920,  4, GROUPS(GROUP_4, 0, 0) },
+    { BMS_AFE_BQ76920,  5, GROUPS(GROUP_5, 0, 0) },
+
+    { BMS_AFE_BQ76930,  6, GROUPS(GROUP_3, GROUP_3, 0) },
+    { BMS_AFE_BQ76930,  7, GROUPS(GROUP_4, GROUP_3, 0) },
+    { BMS_AFE_BQ76930,  8, GROUPS(GROUP_4, GROUP_4, 0) },
+    { BMS_AFE_BQ76930,  9, GROUPS(GROUP_5, GROUP_4, 0) },
+    { BMS_AFE_BQ76930, 10, GROUPS(GROUP_5, GROUP_5, 0) },
+
+    { BMS_AFE_BQ76940,  9, GROUPS(GROUP_3, GROUP_3, GROUP_3) },
+    { BMS_AFE_BQ76940, 10, GROUPS(GROUP_4, GROUP_3, GROUP_3) },
+    { BMS_AFE_BQ76940, 11, GROUPS(GROUP_4, GROUP_4, GROUP_3) },
+    { BMS_AFE_BQ76940, 12, GROUPS(GROUP_4, GROUP_4, GROUP_4) },
+    { BMS_AFE_BQ76940, 13, GROUPS(GROUP_5, GROUP_4, GROUP_4) },
+    { BMS_AFE_BQ76940, 14, GROUPS(GROUP_5, GROUP_5, GROUP_4) },
+    { BMS_AFE_BQ76940, 15, GROUPS(GROUP_5, GROUP_5, GROUP_5) },
+};
+
+
+const cell_topology_t *cell_topology_find(bms_afe_t afe, uint8_t cells)
+{
+    for (uint8_t i = 0; i < sizeof(topologies) / sizeof(topologies[0]); i++)
+    {
+        if (topologies[i].afe == afe && topologies[i].cells == cells) return &topologies[i];
+    }
+    return NULL;
+}
+
+
+uint8_t cell_topology_inputs(bms_afe_t afe)
+{
+    return (uint8_t)CELL_TOPOLOGY_INPUTS((uint8_t)afe);
+}
+
+
+uint8_t cell_topology_input(const cell_topology_t *t, uint8_t cell)
+{
+    uint8_t vc;
+
+    for (vc = 0; vc < CELL_TOPOLOGY_MAX_CELLS; vc++)
+    {
+        if ((t->vc_mask & (1u << vc)) && cell-- == 0) break;
+    }
+    return vc;
+}
+
+
+static uint16_t frame_word(const uint8_t *frame, uint8_t offset)
+{
+    return ((uint16_t)frame[offset] << 8) | frame[offset + 1];
+}
+
+
+void cell_topology_convert(const cell_topology_t *t, const uint8_t *frame,
+                           const bms_adc_scale_t *scale, cell_frame_t *out)
+{
+    uint16_t mask = t->vc_mask;
+    uint8_t n = 0;
+
+    for (uint8_t offset = 0; mask != 0; mask >>= 1, offset += 2)
+    {
+        if (mask & 1) out->raw[n++] = frame_word(frame, offset);
+    }
+    out->errors = bms_cells_raw_to_mV(scale, out->raw, out->mV, n);
+
+    out->bat_raw = frame_word(frame, CELL_TOPOLOGY_BAT_OFFSET);
+    out->bat_mV = bms_pack_raw_to_mV(out->bat_raw);
+    out->ts1_raw = frame_word(frame, CELL_TOPOLOGY_TS1_OFFSET);
+}
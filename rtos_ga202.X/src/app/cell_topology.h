@@ -0,0 +1,106 @@
+/*
+ * File:    cell_topology.h
+ * Summary: Which VCx inputs carry a cell, per AFE variant and cell count
+ *
+ * Description:
+ *   The BQ76920/30/40 measure 5/10/15 VC inputs in groups of five. A group
+ *   wired for fewer than five cells shorts its unused inputs to the one
+ *   below (3 cells: VCx3 and VCx4 tied to VCx2), so the populated inputs
+ *   are the lower ones plus the top of each group. The table in
+ *   cell_topology.c lists the mask for every supported count; measurement
+ *   code goes through it instead of skipping inputs by hand.
+ *
+ *   The cells, BAT and TS1 are read as one burst from VC1_HI to TS1_LO (a
+ *   frame) and converted in one pass with bms_cells_raw_to_mV().
+ *
+ *   vc_mask uses the same bit order as CELLBAL1..3 (bit n = VC(n+1)), so a
+ *   balancing request can be checked against it directly.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency, the host
+ *   replay tool builds it too.
+ */
+
+#ifndef _CELL_TOPOLOGY_H
+#define _CELL_TOPOLOGY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bms_math.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CELL_TOPOLOGY_MAX_CELLS     15                              //BQ76940
+#define CELL_TOPOLOGY_FRAME_BYTES   34                              //VC1_HI (0x0C)..TS1_LO (0x2D)
+#define CELL_TOPOLOGY_BAT_OFFSET    30                              //BAT_HI (0x2A)
+#define CELL_TOPOLOGY_TS1_OFFSET    32                              //TS1_HI (0x2C)
+
+typedef enum
+{
+    BMS_AFE_BQ76920 = 0,        //VC1..VC5,  3-5 cells
+    BMS_AFE_BQ76930 = 1,        //VC1..VC10, 6-10 cells
+    BMS_AFE_BQ76940 = 2         //VC1..VC15, 9-15 cells
+} bms_afe_t;
+
+//The AFE the firmware is built for. Per-cell tables (cell_stats.h,
+//meas_snapshot.h) are sized for all of its inputs; build with e.g.
+//-DBMS_AFE=BMS_AFE_BQ76940 for a larger pack.
+#ifndef BMS_AFE
+#define BMS_AFE                     BMS_AFE_BQ76920
+#endif
+#define CELL_TOPOLOGY_INPUTS(afe)   (5 * ((afe) + 1))               //cell_topology_inputs() as a constant
+#define CELL_TOPOLOGY_AFE_CELLS     CELL_TOPOLOGY_INPUTS(BMS_AFE)
+
+/**
+ * @brief One converted frame. raw[] and mV[] hold the populated cells
+ *        only, in cell_topology_input() order.
+ */
+typedef struct
+{
+    uint16_t raw[CELL_TOPOLOGY_MAX_CELLS];
+    uint16_t mV[CELL_TOPOLOGY_MAX_CELLS];
+    uint16_t errors;            //bit n set: cell n reads as an open input
+    uint16_t bat_raw;
+    uint32_t bat_mV;
+    uint16_t ts1_raw;
+} cell_frame_t;
+
+typedef struct
+{
+    bms_afe_t afe;
+    uint8_t cells;
+    uint16_t vc_mask;           //bit n set: VC(n+1) measures a cell
+} cell_topology_t;
+
+/**
+ * @brief Table entry for this AFE and cell count, NULL if the AFE can't be
+ *        wired for that many cells.
+ */
+const cell_topology_t *cell_topology_find(bms_afe_t afe, uint8_t cells);
+
+/**
+ * @brief Number of VC inputs the AFE has (5, 10 or 15).
+ */
+uint8_t cell_topology_inputs(bms_afe_t afe);
+
+/**
+ * @brief VC input index (0 = VC1) of the cell-th populated cell.
+ */
+uint8_t cell_topology_input(const cell_topology_t *t, uint8_t cell);
+
+/**
+ * @brief Converts a CELL_TOPOLOGY_FRAME_BYTES burst from VC1_HI: the
+ *        populated cells, BAT and TS1 (raw only, its float math lives in
+ *        bms_ts_raw_to_temp()).
+ */
+void cell_topology_convert(const cell_topology_t *t, const uint8_t *frame,
+                           const bms_adc_scale_t *scale, cell_frame_t *out);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CELL_TOPOLOGY_H */
@@ -0,0 +1,192 @@
+/*
+ * clock_profile.c
+ * Oscillator profile switching with divisors derived from one Fosc value
+ */
+
+#include <xc.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "clock_profile.h"
+#include "clock.h"
+#include "i2c1.h"
+#include "trace.h"
+#include "uart1.h"
+
+#define TICK_TIMER_PRESCALE     8   //same 1:8 prescale the PIC24 port uses
+
+#define OSC_NOSC_FRCPLL         0x01
+#define OSC_NOSC_FRCDIV         0x07
+
+typedef struct
+{
+    const char *name;
+    uint8_t  nosc;      //OSCCON NOSC
+    uint16_t clkdiv;    //CLKDIV (DOZE 1:8 disabled, RCDIV in bits 10:8)
+    uint32_t fosc_hz;
+} clock_profile_desc_t;
+
+static const clock_profile_desc_t clock_profiles[CLOCK_PROFILE_COUNT] =
+{
+    [CLOCK_PROFILE_LOW_POWER]   = { "low",  OSC_NOSC_FRCDIV, 0x3100,  4000000UL },  //FRC/2
+    [CLOCK_PROFILE_PERFORMANCE] = { "fast", OSC_NOSC_FRCPLL, 0x3000, 32000000UL },  //FRC/1 x4 PLL
+};
+
+static clock_profile_t active_profile = CLOCK_PROFILE_LOW_POWER;
+static bool auto_mode = true;
+
+static TickType_t window_start = 0;
+static uint32_t window_tx_start = 0;
+static uint8_t low_windows = 0;
+
+
+void clock_profile_divisors(clock_profile_t profile, uint32_t baud, uint32_t i2c_hz,
+                            clock_profile_divisors_t *out)
+{
+    uint32_t fcy = clock_profiles[profile].fosc_hz / 2;
+
+    out->fcy_hz = fcy;
+    out->uart_brg = UART1_BRGCompute(fcy, baud, &out->uart_error_permille);
+    out->i2c_brg = I2C1_BRGCompute(fcy, i2c_hz);
+    out->tick_pr1 = (uint16_t)(((fcy / TICK_TIMER_PRESCALE) / configTICK_RATE_HZ) - 1);
+}
+
+
+bool clock_profile_set(clock_profile_t profile)
+{
+    const clock_profile_desc_t *desc;
+    clock_profile_divisors_t div;
+
+    if (profile >= CLOCK_PROFILE_COUNT) return false;
+    if (profile == active_profile) return true;
+
+    desc = &clock_profiles[profile];
+    clock_profile_divisors(profile, UART1_BaudRateGet(), I2C1_BusSpeedGet(), &div);
+    if (div.uart_error_permille > UART1_BAUD_MAX_ERROR_PERMILLE ||
+        div.uart_error_permille < -UART1_BAUD_MAX_ERROR_PERMILLE ||
+        div.i2c_brg == 0)
+    {
+        return false;
+    }
+
+    UART1_TxFlush();    //don't garble a byte that is still queued or shifting out
+
+    taskENTER_CRITICAL();
+    {
+        //Entering the PLL: set the FRC postscaler first so the PLL input is
+        //right when it locks. Leaving it: switch first, then divide down.
+        if (desc->nosc == OSC_NOSC_FRCPLL) CLKDIV = desc->clkdiv;
+
+        __builtin_write_OSCCONH(desc->nosc);
+        __builtin_write_OSCCONL(OSCCON | 0x01);     //OSWEN
+        while (OSCCONbits.OSWEN);
+        if (desc->nosc == OSC_NOSC_FRCPLL)
+        {
+            while (!OSCCONbits.LOCK);
+        }
+
+        if (desc->nosc != OSC_NOSC_FRCPLL) CLKDIV = desc->clkdiv;
+
+        //Trace stamps count Fcy cycles: tell the host the rate they had so far
+        trace_event(TRACE_CLOCK, (uint8_t)(CLOCK_PeripheralFrequencyGet() / 1000000UL));
+        CLOCK_SystemFrequencyHz = desc->fosc_hz;
+        active_profile = profile;
+
+        //Everything below derives from CLOCK_SystemFrequencyHz
+        TMR1 = 0;
+        PR1 = div.tick_pr1;
+        UART1_BaudRateSet(UART1_BaudRateGet());
+        I2C1_BRGUpdate();
+    }
+    taskEXIT_CRITICAL();
+
+    return true;
+}
+
+
+clock_profile_t clock_profile_get(void)
+{
+    return active_profile;
+}
+
+
+const char *clock_profile_name(clock_profile_t profile)
+{
+    return (profile < CLOCK_PROFILE_COUNT) ? clock_profiles[profile].name : "?";
+}
+
+
+void clock_profile_set_auto(bool enable)
+{
+    auto_mode = enable;
+    low_windows = 0;
+}
+
+
+bool clock_profile_is_auto(void)
+{
+    return auto_mode;
+}
+
+
+clock_profile_t clock_profile_service(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - window_start;
+
+    if (elapsed < pdMS_TO_TICKS(CLOCK_PROFILE_LOAD_WINDOW_MS)) return active_profile;
+
+    //8N1: 10 bit times per byte
+    uint32_t capacity = (UART1_BaudRateGet() / 10) * elapsed / configTICK_RATE_HZ;
+    uint32_t sent = UART1_TxByteCountGet() - window_tx_start;
+    uint32_t load_pct = (capacity > 0) ? (sent * 100) / capacity : 0;
+
+    window_start = now;
+    window_tx_start = UART1_TxByteCountGet();
+
+    if (!auto_mode) return active_profile;
+
+    if (load_pct >= CLOCK_PROFILE_LOAD_HIGH_PCT)
+    {
+        low_windows = 0;
+        return CLOCK_PROFILE_PERFORMANCE;
+    }
+    else if (load_pct < CLOCK_PROFILE_LOAD_LOW_PCT)
+    {
+        if (low_windows < CLOCK_PROFILE_LOW_WINDOWS) low_windows++;
+        if (low_windows >= CLOCK_PROFILE_LOW_WINDOWS)
+        {
+            return CLOCK_PROFILE_LOW_POWER;     //refused by the switch if the baud rate needs the PLL
+        }
+    }
+    else
+    {
+        low_windows = 0;
+    }
+    return active_profile;
+}
+
+
+//Replaces the port's weak tick setup so the first tick period also comes
+//from the active profile rather than the compile-time configCPU_CLOCK_HZ.
+void vApplicationSetupTickTimerInterrupt(void)
+{
+    clock_profile_divisors_t div;
+
+    clock_profile_divisors(active_profile, UART1_BaudRateGet(), I2C1_BusSpeedGet(), &div);
+
+    //Prescale of 8
+    T1CON = 0;
+    TMR1 = 0;
+    PR1 = div.tick_pr1;
+
+    IPC0bits.T1IP = configKERNEL_INTERRUPT_PRIORITY;
+    IFS0bits.T1IF = 0;
+    IEC0bits.T1IE = 1;
+
+    T1CONbits.TCKPS0 = 1;
+    T1CONbits.TCKPS1 = 0;
+    T1CONbits.TON = 1;
+}
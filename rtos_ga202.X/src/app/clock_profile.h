@@ -0,0 +1,88 @@
+/*
+ * File:    clock_profile.h
+ * Summary: Runtime selection between a low-power and a 32 MHz clock
+ *
+ * Description:
+ *   Each profile describes one oscillator setting. Switching profiles
+ *   updates CLOCK_SystemFrequencyHz and then re-derives every divisor that
+ *   depends on it (UART1 BRG, I2C1 BRG, FreeRTOS tick period) from that one
+ *   value. In automatic mode the profile follows the UART telemetry load.
+ */
+
+#ifndef _CLOCK_PROFILE_H
+#define _CLOCK_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    CLOCK_PROFILE_LOW_POWER = 0,    //FRCDIV, FRC/2: Fosc 4 MHz, 2 MIPS (boot default)
+    CLOCK_PROFILE_PERFORMANCE,      //FRCPLL, FRC x4: Fosc 32 MHz, 16 MIPS
+    CLOCK_PROFILE_COUNT
+} clock_profile_t;
+
+/**
+ * @brief Divisors derived for one profile.
+ */
+typedef struct
+{
+    uint32_t fcy_hz;
+    uint16_t uart_brg;
+    int16_t  uart_error_permille;   //INT16_MAX if the baud rate is out of range
+    uint16_t i2c_brg;               //0 if the bus speed can't be reached
+    uint16_t tick_pr1;
+} clock_profile_divisors_t;
+
+//Automatic switching thresholds, in % of the UART link capacity
+#define CLOCK_PROFILE_LOAD_WINDOW_MS    1000
+#define CLOCK_PROFILE_LOAD_HIGH_PCT     50
+#define CLOCK_PROFILE_LOAD_LOW_PCT      10
+#define CLOCK_PROFILE_LOW_WINDOWS       10  //quiet windows before slowing down
+
+/**
+ * @brief Computes the divisors a profile would use. Pure function, no
+ *        hardware access.
+ */
+void clock_profile_divisors(clock_profile_t profile, uint32_t baud, uint32_t i2c_hz,
+                            clock_profile_divisors_t *out);
+
+/**
+ * @brief Switches the oscillator and reprograms UART1, I2C1 and the tick
+ *        timer. Must be called from task context while the I2C bus is idle.
+ *
+ * @return false if the current baud rate or I2C speed can't be generated
+ *         in the requested profile (nothing is changed in that case).
+ */
+bool clock_profile_set(clock_profile_t profile);
+
+clock_profile_t clock_profile_get(void);
+
+const char *clock_profile_name(clock_profile_t profile);
+
+/**
+ * @brief Enables/disables load-driven switching (enabled at boot).
+ */
+void clock_profile_set_auto(bool enable);
+
+bool clock_profile_is_auto(void);
+
+/**
+ * @brief Call periodically from task context. Returns the profile to run
+ *        in: in automatic mode the performance profile when UART load
+ *        exceeds LOAD_HIGH_PCT and the low-power one after LOW_WINDOWS
+ *        windows below LOAD_LOW_PCT, otherwise the active one. The caller
+ *        switches with clock_profile_set(), once the I2C bus is idle.
+ */
+clock_profile_t clock_profile_service(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CLOCK_PROFILE_H */
@@ -0,0 +1,128 @@
+/*
+ * cmd_parse.c
+ * Command line tokenizer, number parser and table lookup.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "cmd_parse.h"
+
+
+uint16_t cmd_key(const char *name, uint8_t len)
+{
+    if (len == 0) return 0;
+    return (uint16_t)(((uint16_t)len << 10) ^ ((uint16_t)(uint8_t)name[0] << 5) ^
+                      (uint8_t)name[len - 1]);
+}
+
+
+uint8_t cmd_tokenize(char *line, const char *words[], uint8_t max)
+{
+    uint8_t count = 0;
+
+    while (*line != '\0')
+    {
+        if (*line == ' ')
+        {
+            *line++ = '\0';
+            continue;
+        }
+        if (count < max) words[count] = line;
+        if (count < 0xFF) count++;
+        while (*line != '\0' && *line != ' ') line++;
+    }
+    for (uint8_t i = count; i < max; i++) words[i] = NULL;
+    return count;
+}
+
+
+const char *cmd_parse_number(const char *s, uint32_t *value)
+{
+    uint32_t v = 0;
+    const char *start;
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+    {
+        for (start = s += 2; ; s++)
+        {
+            uint8_t d;
+            if (*s >= '0' && *s <= '9') d = (uint8_t)(*s - '0');
+            else if (*s >= 'a' && *s <= 'f') d = (uint8_t)(*s - 'a' + 10);
+            else if (*s >= 'A' && *s <= 'F') d = (uint8_t)(*s - 'A' + 10);
+            else break;
+            if (v > 0x0FFFFFFFUL) return NULL;
+            v = (v << 4) | d;
+        }
+    }
+    else
+    {
+        for (start = s; *s >= '0' && *s <= '9'; s++)
+        {
+            uint8_t d = (uint8_t)(*s - '0');
+            if (v > 429496729UL || (v == 429496729UL && d > 5)) return NULL;
+            v = (v << 3) + (v << 1) + d;    //v * 10 without a library multiply
+        }
+    }
+
+    if (s == start) return NULL;
+    *value = v;
+    return s;
+}
+
+
+bool cmd_parse_uint(const char *s, uint32_t *value)
+{
+    const char *end = cmd_parse_number(s, value);
+    return end != NULL && *end == '\0';
+}
+
+
+const cmd_entry_t *cmd_find(const cmd_entry_t table[], uint8_t count, const char *name)
+{
+    size_t len = strlen(name);
+    uint16_t key;
+
+    if (len == 0 || len > 0xFF) return NULL;
+    key = cmd_key(name, (uint8_t)len);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (table[i].key == key && strcmp(table[i].name, name) == 0) return &table[i];
+    }
+    return NULL;
+}
+
+
+cmd_status_t cmd_dispatch(const cmd_entry_t table[], uint8_t count, char *line,
+                          const cmd_entry_t **entry)
+{
+    const char *words[CMD_MAX_ARGS + 1];
+    uint8_t n = cmd_tokenize(line, words, CMD_MAX_ARGS + 1);
+    const cmd_entry_t *e;
+    cmd_args_t args;
+    uint8_t i;
+
+    *entry = NULL;
+    if (n == 0) return CMD_EMPTY;
+    e = cmd_find(table, count, words[0]);
+    if (e == NULL) return CMD_UNKNOWN;
+    *entry = e;
+
+    //Required arguments come first, so only the first missing one matters
+    args.argc = (uint8_t)(n - 1);
+    if (args.argc > strlen(e->schema)) return CMD_BAD_ARGS;
+    if (e->schema[args.argc] == 'N' || e->schema[args.argc] == 'W') return CMD_BAD_ARGS;
+
+    for (i = 0; i < CMD_MAX_ARGS; i++)
+    {
+        args.argv[i] = (i < args.argc) ? words[i + 1] : NULL;
+        args.num[i] = 0;
+        if (i < args.argc && (e->schema[i] == 'N' || e->schema[i] == 'n') &&
+            !cmd_parse_uint(args.argv[i], &args.num[i]))
+        {
+            return CMD_BAD_ARGS;
+        }
+    }
+    return e->handler(&args) ? CMD_OK : CMD_REJECTED;
+}
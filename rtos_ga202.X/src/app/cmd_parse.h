@@ -0,0 +1,114 @@
+/*
+ * File:    cmd_parse.h
+ * Summary: Table-driven UART command dispatch
+ *
+ * Description:
+ *   A command line is split in place into words (no strtok, so any number
+ *   of tasks can parse at once), the first word is looked up in a const
+ *   table by a length/first/last-character key, then confirmed with one
+ *   strcmp. Each entry carries an argument schema: its arguments are
+ *   counted and the numeric ones converted before the handler runs, so
+ *   handlers get values instead of strings. Numbers are decimal or 0x hex,
+ *   parsed without strtol (no errno, no 32-bit multiply per digit).
+ *
+ *   The "help" text is the usage string of each table entry.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency; printing
+ *   the result is left to the caller, so the parser runs on a PC too.
+ */
+
+#ifndef _CMD_PARSE_H
+#define _CMD_PARSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CMD_MAX_ARGS    3
+
+/**
+ * @brief Lookup key of a command name given as a string literal, a compile
+ *        time constant for the table. Must match cmd_key().
+ */
+#define CMD_KEY(name)   ((uint16_t)(((sizeof(name) - 1) << 10) ^ \
+                                    ((uint16_t)(uint8_t)(name)[0] << 5) ^ \
+                                    (uint8_t)(name)[sizeof(name) - 2]))
+
+typedef struct
+{
+    uint8_t argc;                       //arguments after the command name
+    const char *argv[CMD_MAX_ARGS];     //NULL past argc
+    uint32_t num[CMD_MAX_ARGS];         //value of each 'n'/'N' argument, 0 otherwise
+} cmd_args_t;
+
+/**
+ * @brief Runs a command. Returns false for arguments it can't use; the
+ *        caller then prints the entry's usage.
+ */
+typedef bool (*cmd_handler_t)(const cmd_args_t *args);
+
+typedef struct
+{
+    uint16_t key;           //CMD_KEY(name)
+    const char *name;
+    const char *schema;     //one letter per argument: N number, W word;
+                            //lower case (n, w) = optional, only after the required ones
+    cmd_handler_t handler;
+    const char *usage;      //"name [args]", also the help line
+} cmd_entry_t;
+
+typedef enum
+{
+    CMD_OK = 0,
+    CMD_EMPTY,              //blank line
+    CMD_UNKNOWN,            //name not in the table
+    CMD_BAD_ARGS,           //too few/many arguments or a malformed number
+    CMD_REJECTED            //the handler returned false
+} cmd_status_t;
+
+/**
+ * @brief Key of the first len characters of name, same as CMD_KEY().
+ */
+uint16_t cmd_key(const char *name, uint8_t len);
+
+/**
+ * @brief Splits line in place at spaces. Up to max words go to words[];
+ *        returns the number found, which may be more than max.
+ */
+uint8_t cmd_tokenize(char *line, const char *words[], uint8_t max);
+
+/**
+ * @brief Parses a decimal or 0x/0X hex number at s. Returns the character
+ *        after its last digit, or NULL if there are no digits or the value
+ *        does not fit in 32 bits.
+ */
+const char *cmd_parse_number(const char *s, uint32_t *value);
+
+/**
+ * @brief Like cmd_parse_number() but the whole word must be the number.
+ */
+bool cmd_parse_uint(const char *s, uint32_t *value);
+
+/**
+ * @brief Table entry for a command name, NULL if there is none.
+ */
+const cmd_entry_t *cmd_find(const cmd_entry_t table[], uint8_t count, const char *name);
+
+/**
+ * @brief Tokenizes line (modified in place), looks the command up, checks
+ *        and converts its arguments against the schema and runs the
+ *        handler. *entry is set whenever the command was found, so the
+ *        caller can print its usage on CMD_BAD_ARGS or CMD_REJECTED.
+ */
+cmd_status_t cmd_dispatch(const cmd_entry_t table[], uint8_t count, char *line,
+                          const cmd_entry_t **entry);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CMD_PARSE_H */
@@ -0,0 +1,201 @@
+/*
+ * crash.c
+ * Trap and fatal hook capture into persistent RAM, reported after reset
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "crash.h"
+#include "traps.h"
+#include "uart1.h"
+#include "uart_fmt.h"
+
+#define RECORD_MAGIC    0x4352      //"CR"
+
+typedef struct
+{
+    uint16_t magic;
+    uint16_t crashes;               //records made since the first one
+    bool pending;                   //not printed at boot yet
+    uint8_t type;                   //crash_type_t
+    uint32_t pc;                    //trapped PC, 0 for the RTOS hooks
+    uint16_t sp;                    //W15 when the trap hit
+    uint8_t ipl;                    //CPU priority then: > 0 in an ISR or critical section
+    char task[CRASH_NAME_BYTES];
+    uint32_t uptime;                //ticks
+    crash_event_t events[CRASH_EVENTS];     //oldest first
+    uint16_t check;
+} crash_record_t;
+
+static const char *const type_names[CRASH_TYPES] =
+{
+    "oscillator fail", "stack error", "address error", "math error",
+    "stack overflow", "malloc failed"
+};
+
+//Not cleared at startup, so it survives the reset it explains
+static crash_record_t record __attribute__((persistent));
+
+static crash_event_t ring[CRASH_EVENTS];
+static uint8_t ring_next = 0;
+
+
+static uint16_t record_sum(void)
+{
+    const uint8_t *p = (const uint8_t *)&record;
+    uint16_t sum = 0;
+
+    for (uint16_t i = 0; i < offsetof(crash_record_t, check); i++)
+    {
+        sum = (uint16_t)((sum << 1 | sum >> 15) + p[i]);
+    }
+    return (uint16_t)~sum;
+}
+
+
+static bool record_valid(void)
+{
+    return record.magic == RECORD_MAGIC && record.check == record_sum();
+}
+
+
+static void record_seal(void)
+{
+    record.magic = RECORD_MAGIC;
+    record.check = record_sum();
+}
+
+
+//Two tasks logging at once can lose an event, which is fine for a trail
+void crash_event(uint16_t code)
+{
+    uint8_t n = ring_next;
+
+    ring_next = (uint8_t)((n + 1) % CRASH_EVENTS);
+    ring[n].tick = xTaskGetTickCount();
+    ring[n].code = code;
+}
+
+
+void crash_fatal(crash_type_t type, const char *task)
+{
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    uint16_t crashes = record_valid() ? record.crashes : 0;
+
+    memset(&record, 0, sizeof(record));
+    record.crashes = crashes + 1;
+    record.pending = true;
+    record.type = (uint8_t)type;
+    if (type <= CRASH_MATH_ERR)
+    {
+        record.pc = ((uint32_t)(TRAPS_stacked_pc[1] & 0x7F) << 16) | TRAPS_stacked_pc[0];
+        record.sp = (uint16_t)(TRAPS_stacked_sp - 4);
+        record.ipl = (uint8_t)(((TRAPS_stacked_pc[1] >> 13) & 0x07) | ((TRAPS_stacked_pc[1] >> 4) & 0x08));
+    }
+    if (task == NULL && current != NULL) task = pcTaskGetName(current);
+    if (task != NULL) strncpy(record.task, task, CRASH_NAME_BYTES);
+    record.uptime = xTaskGetTickCountFromISR();
+    for (uint8_t i = 0; i < CRASH_EVENTS; i++)
+    {
+        record.events[i] = ring[(ring_next + i) % CRASH_EVENTS];
+    }
+    record_seal();
+
+#ifdef __DEBUG
+    __builtin_software_breakpoint();
+#endif
+    __asm__ volatile ("reset");
+    while (1);
+}
+
+
+//Overrides the weak MCC handler, called by every trap vector in traps.c
+void TRAPS_halt_on_error(uint16_t code)
+{
+    crash_fatal((crash_type_t)code, NULL);
+}
+
+
+//Crash: <type> at PC 0x<pc>, SP 0x<sp>, IPL <n>, task <name>, up <s> s (<n> total)
+//  events: 0x<code> (-<ms> ms) ... (oldest first)
+static void send_record(void)
+{
+    uart1_send_string("Crash: ");
+    uart1_send_string(record.type < CRASH_TYPES ? type_names[record.type] : "unknown");
+    if (record.type <= CRASH_MATH_ERR)
+    {
+        uart1_send_string(" at PC 0x");
+        uart1_send_hex((uint16_t)(record.pc >> 16), 2);
+        uart1_send_hex((uint16_t)record.pc, 4);
+        uart1_send_string(", SP 0x");
+        uart1_send_hex(record.sp, 4);
+        uart1_send_string(", IPL ");
+        uart1_send_u16(record.ipl);
+    }
+    uart1_send_string(", task ");
+    for (uint8_t i = 0; i < CRASH_NAME_BYTES && record.task[i] != '\0'; i++)
+    {
+        UART1_Write(record.task[i]);
+    }
+    uart1_send_string(", up ");
+    uart1_send_u32(record.uptime / configTICK_RATE_HZ);
+    uart1_send_string(" s (");
+    uart1_send_u16(record.crashes);
+    uart1_send_string(" total)\r\n  events:");
+    for (uint8_t i = 0; i < CRASH_EVENTS; i++)
+    {
+        if (record.events[i].code == 0) continue;       //ring not full yet
+        uart1_send_string(" 0x");
+        uart1_send_hex(record.events[i].code, 4);
+        uart1_send_string(" (-");
+        uart1_send_u32((record.uptime - record.events[i].tick) * portTICK_PERIOD_MS);
+        uart1_send_string(" ms)");
+    }
+    uart1_send_string("\r\n");
+}
+
+
+void crash_report(void)
+{
+    if (!record_valid() || !record.pending) return;
+    send_record();
+    record.pending = false;
+    record_seal();
+}
+
+
+bool crash_command(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+
+    if (arg == NULL)
+    {
+        if (record_valid()) send_record();
+        else uart1_send_string("Crash: none recorded\r\n");
+    }
+    else if (strcmp(arg, "clear") == 0)
+    {
+        record.magic = 0;
+        uart1_send_string("ACK CRASH CLEAR\r\n");
+    }
+    else if (strcmp(arg, "test") == 0)
+    {
+        volatile uint16_t *odd = (volatile uint16_t *)0x0801;
+
+        uart1_send_string("ACK CRASH TEST\r\n");
+        vTaskDelay(pdMS_TO_TICKS(50));      //let the ACK out before the reset
+        (void)*odd;                         //word read from an odd address: address error trap
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+/*
+ * File:    crash.h
+ * Summary: Post-mortem record of traps and fatal RTOS hooks
+ *
+ * Description:
+ *   A CPU trap (traps.c calls TRAPS_halt_on_error(), which this module
+ *   overrides), a task stack overflow or a failed allocation used to
+ *   disable interrupts and spin until someone attached a debugger. Now the
+ *   cause, the trapped PC and stack pointer, the running task and the last
+ *   CRASH_EVENTS events are written to a record in persistent RAM, and the
+ *   chip resets itself. The next boot prints the record once, and the
+ *   "crash" command shows it again at any time.
+ *
+ *   Events are 16-bit codes the application logs as it runs (the BQ76920
+ *   task logs its watchdog activity codes), kept in a small ring with the
+ *   tick they happened at.
+ */
+
+#ifndef _CRASH_H
+#define _CRASH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmd_parse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRASH_EVENTS        8
+#define CRASH_NAME_BYTES    8       //not terminated if full
+
+typedef enum
+{
+    CRASH_OSC_FAIL = 0,             //same values as TRAPS_ERROR_CODE
+    CRASH_STACK_ERR,
+    CRASH_ADDRESS_ERR,
+    CRASH_MATH_ERR,
+    CRASH_STACK_OVERFLOW,           //vApplicationStackOverflowHook
+    CRASH_MALLOC_FAILED,            //vApplicationMallocFailedHook
+    CRASH_TYPES
+} crash_type_t;
+
+typedef struct
+{
+    uint32_t tick;
+    uint16_t code;
+} crash_event_t;
+
+/**
+ * @brief Adds an event to the ring the next crash record copies.
+ */
+void crash_event(uint16_t code);
+
+/**
+ * @brief Records the crash and resets the chip. task names the culprit
+ *        if the caller knows it (stack overflow), otherwise the running
+ *        task is taken. Does not return.
+ */
+void crash_fatal(crash_type_t type, const char *task);
+
+/**
+ * @brief Prints the record if it hasn't been reported yet. For the boot
+ *        banner.
+ */
+void crash_report(void);
+
+/**
+ * @brief "crash" prints the last record, "crash clear" forgets it,
+ *        "crash test" triggers an address error trap.
+ */
+bool crash_command(const cmd_args_t *args);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CRASH_H */
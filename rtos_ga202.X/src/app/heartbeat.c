@@ -0,0 +1,129 @@
+/*
+ * heartbeat.c
+ * RB14 heartbeat and CPU load, run by the FreeRTOS timer task
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+
+#include "heartbeat.h"
+#include "clock.h"
+#include "pin_manager.h"
+#include "uart1.h"
+#include "uart_fmt.h"
+#include "watchdog.h"
+
+//The idle task silent this long means the tasks leave it no time at all.
+//Longer than any task's own timeout, so a task spinning in a wait is
+//caught (and named) by its check-in first.
+#define IDLE_TIMEOUT_MS     15000
+
+#define WINDOW_PERIODS      (HEARTBEAT_LOAD_WINDOW_MS / HEARTBEAT_PERIOD_MS)
+
+static volatile uint32_t idle_loops = 0;
+static uint32_t last_loops = 0;
+static uint32_t window_loops = 0;
+static uint32_t window_fcy = 0;
+static uint8_t periods = 0;
+static uint32_t idle_rate = 0;          //loops/s per MHz of Fcy, last window
+static uint32_t idle_rate_max = 0;      //same, most idle window so far
+static uint8_t cpu_load = HEARTBEAT_LOAD_UNKNOWN;
+static uint8_t watchdog_id = SUPERVISOR_NONE;
+
+
+static void heartbeat_expired(TimerHandle_t timer)
+{
+    uint32_t fcy = CLOCK_PeripheralFrequencyGet();
+    uint32_t loops = idle_loops;        //the idle task can't run meanwhile
+    uint32_t delta = loops - last_loops;
+
+    (void)timer;
+
+    IO_RB14_Toggle();
+    last_loops = loops;
+    if (delta != 0) watchdog_checkin(watchdog_id, 0);
+
+    //A clock switch in the window would mix two loop rates: start again
+    if (fcy != window_fcy)
+    {
+        window_fcy = fcy;
+        window_loops = 0;
+        periods = 0;
+        return;
+    }
+    window_loops += delta;
+    if (++periods < WINDOW_PERIODS) return;
+
+    idle_rate = window_loops * (1000UL / HEARTBEAT_LOAD_WINDOW_MS) / (fcy / 1000000UL);
+    if (idle_rate > idle_rate_max) idle_rate_max = idle_rate;
+    if (idle_rate_max != 0)
+    {
+        cpu_load = (uint8_t)(100 - (idle_rate * 100 + idle_rate_max / 2) / idle_rate_max);
+    }
+    window_loops = 0;
+    periods = 0;
+}
+
+
+void heartbeat_init(void)
+{
+    TimerHandle_t timer = xTimerCreate("beat", pdMS_TO_TICKS(HEARTBEAT_PERIOD_MS), pdTRUE,
+                                       NULL, heartbeat_expired);
+
+    watchdog_id = watchdog_register("idle", IDLE_TIMEOUT_MS);
+    if (timer == NULL || xTimerStart(timer, 0) != pdPASS)
+    {
+        uart1_send_string("FAILED TO START HEARTBEAT TIMER\r\n");
+    }
+}
+
+
+void heartbeat_idle(void)
+{
+    //Kept whole for the timer task, which may preempt the idle task
+    //between the two halves of the increment
+    __builtin_disi(0x3FFF);
+    idle_loops++;
+    DISICNT = 0;
+}
+
+
+uint8_t heartbeat_cpu_load(void)
+{
+    return cpu_load;
+}
+
+
+//"CPU load: <n> % (idle <rate> of <max> loops/s per MHz)"
+bool heartbeat_command(const cmd_args_t *args)
+{
+    uint8_t load;
+    uint32_t rate, rate_max;
+
+    (void)args;
+
+    taskENTER_CRITICAL();       //one window's values, not halves of two
+    load = cpu_load;
+    rate = idle_rate;
+    rate_max = idle_rate_max;
+    taskEXIT_CRITICAL();
+
+    if (load == HEARTBEAT_LOAD_UNKNOWN)
+    {
+        uart1_send_string("CPU load: measuring\r\n");
+        return true;
+    }
+    uart1_send_string("CPU load: ");
+    uart1_send_u16(load);
+    uart1_send_string(" % (idle ");
+    uart1_send_u32(rate);
+    uart1_send_string(" of ");
+    uart1_send_u32(rate_max);
+    uart1_send_string(" loops/s per MHz)\r\n");
+    return true;
+}
@@ -0,0 +1,62 @@
+/*
+ * File:    heartbeat.h
+ * Summary: Timer-service heartbeat on RB14 and CPU load from idle time
+ *
+ * Description:
+ *   A FreeRTOS software timer toggles RB14 every HEARTBEAT_PERIOD_MS, so
+ *   a probe on the pin sees a square wave for as long as the tick and the
+ *   timer task run. The idle hook only counts its loops. The timer turns
+ *   that count into a CPU load every HEARTBEAT_LOAD_WINDOW_MS, relative to
+ *   the most idle window seen (the first second after boot, while the
+ *   BQ76920 tasks are still waiting to start, is close to 100 % idle).
+ *   Loops are counted per MHz of Fcy so the clock profiles compare.
+ *
+ *   The timer also checks in for the "idle" watchdog entry, but only if
+ *   the idle task ran since the last period.
+ */
+
+#ifndef _HEARTBEAT_H
+#define _HEARTBEAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmd_parse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HEARTBEAT_PERIOD_MS         100     //RB14 toggles at this rate: 5 Hz square wave
+#define HEARTBEAT_LOAD_WINDOW_MS    1000
+
+#define HEARTBEAT_LOAD_UNKNOWN      0xFF
+
+/**
+ * @brief Creates and starts the timer and registers the "idle" watchdog
+ *        entry. Call before vTaskStartScheduler().
+ */
+void heartbeat_init(void);
+
+/**
+ * @brief Counts one idle loop. Call from vApplicationIdleHook().
+ */
+void heartbeat_idle(void);
+
+/**
+ * @brief CPU load over the last window in %, HEARTBEAT_LOAD_UNKNOWN
+ *        before the first one.
+ */
+uint8_t heartbeat_cpu_load(void);
+
+/**
+ * @brief "cpu" prints the load and the idle loop rates it came from.
+ */
+bool heartbeat_command(const cmd_args_t *args);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HEARTBEAT_H */
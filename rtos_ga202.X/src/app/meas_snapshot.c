@@ -0,0 +1,49 @@
+/*
+ * meas_snapshot.c
+ * Double-buffered measurement snapshot.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <string.h>
+
+#include "meas_snapshot.h"
+
+
+void meas_snapshot_init(meas_snapshot_t *s)
+{
+    memset(s->buffer, 0, sizeof(s->buffer));
+    s->generation = 0;
+}
+
+
+void meas_snapshot_publish(meas_snapshot_t *s, const measurement_t *m)
+{
+    uint16_t next = (uint16_t)(s->generation + 1);
+
+    //0 means "never published"; 2 keeps the buffers alternating across
+    //the wrap (65535 used buffer 1)
+    if (next == 0) next = 2;
+
+    s->buffer[next & 1] = *m;
+    MEAS_SNAPSHOT_BARRIER();        //the whole set before the generation
+    s->generation = next;
+}
+
+
+uint16_t meas_snapshot_read(const meas_snapshot_t *s, measurement_t *m)
+{
+    uint16_t generation;
+    measurement_t copy;
+
+    do
+    {
+        generation = s->generation;
+        if (generation == 0) return 0;
+        MEAS_SNAPSHOT_BARRIER();
+        copy = s->buffer[generation & 1];
+        MEAS_SNAPSHOT_BARRIER();
+    } while (s->generation != generation);
+
+    *m = copy;
+    return generation;
+}
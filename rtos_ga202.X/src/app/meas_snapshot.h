@@ -0,0 +1,99 @@
+/*
+ * File:    meas_snapshot.h
+ * Summary: Double-buffered measurement snapshot with a generation counter
+ *
+ * Description:
+ *   The measurement task owns the SoC, the capacity and the last register
+ *   frame. Other tasks used to read those globals directly, and on the
+ *   16-bit PIC24 a float or a 32-bit tick is two stores: a reader
+ *   preempted between them, or preempting the writer, gets half of each.
+ *
+ *   One writer fills a complete measurement_t per update and publishes it
+ *   here. Two buffers alternate: the writer fills the one readers are not
+ *   meant to use, then bumps the generation, whose low bit selects the
+ *   current buffer (a 16-bit store, atomic on the PIC24). A reader notes
+ *   the generation, copies that buffer and checks the generation again; if
+ *   it moved, the writer may have reused the buffer meanwhile and the copy
+ *   is retried. Neither side blocks or disables interrupts. A reader at a
+ *   higher priority than the writer never retries (the writer can't run
+ *   during its copy); a lower one retries at most once per publish.
+ *
+ *   No hardware or RTOS dependency, so it can be stressed on a PC.
+ */
+
+#ifndef _MEAS_SNAPSHOT_H
+#define _MEAS_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cell_topology.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MEAS_SNAPSHOT_CELLS
+#define MEAS_SNAPSHOT_CELLS     CELL_TOPOLOGY_AFE_CELLS     //every input of BMS_AFE
+#endif
+
+//Orders the buffer accesses against the generation. A compiler barrier is
+//enough on the single-core PIC24; a multi-core host needs a real fence.
+#ifndef MEAS_SNAPSHOT_BARRIER
+#define MEAS_SNAPSHOT_BARRIER()     __asm__ volatile ("" ::: "memory")
+#endif
+
+//One coherent set, all from the same measurement update
+typedef struct
+{
+    uint32_t tick;                      //ms, when the Coulomb Counter was read
+    float current_A;                    //discharge positive
+    float soc_percent;
+    float remaining_mAh;
+    float learned_mAh;
+    int16_t cc_raw;
+    uint16_t pack_mV;
+    uint16_t cell_mV[MEAS_SNAPSHOT_CELLS];
+    uint16_t cell_errors;               //bit n set: cell n reads as an open input
+    uint16_t period_ms;                 //until the next update
+    uint16_t adc_gain_uV;               //the calibration cell_mV was converted with
+    int8_t adc_offset_mV;
+    uint8_t cells;
+    uint8_t soc_engine;
+    uint8_t sample_tier;                //sample_tier_t the period comes from
+    uint8_t sample_reasons;             //SAMPLE_REASON_* bits of the last update
+    bool sample_forced;                 //tier pinned by "rate", not chosen from the load
+    uint8_t power_state;                //power_state_t of the BQ76920
+    bool frame_valid;                   //cell_mV and pack_mV were read this update
+    bool fets_off;                      //CHG and DSG both off
+} measurement_t;
+
+typedef struct
+{
+    volatile uint16_t generation;       //0 before the first publish, low bit: current buffer
+    measurement_t buffer[2];
+} meas_snapshot_t;
+
+/**
+ * @brief Empties the snapshot: reads return generation 0 until the first
+ *        publish.
+ */
+void meas_snapshot_init(meas_snapshot_t *s);
+
+/**
+ * @brief Makes m the current set. Only one task may publish.
+ */
+void meas_snapshot_publish(meas_snapshot_t *s, const measurement_t *m);
+
+/**
+ * @brief Copies the current set into m. Returns its generation, 0 (and m
+ *        untouched) if nothing was published yet.
+ */
+uint16_t meas_snapshot_read(const meas_snapshot_t *s, measurement_t *m);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _MEAS_SNAPSHOT_H */
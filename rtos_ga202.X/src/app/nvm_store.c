@@ -0,0 +1,193 @@
+/*
+ * nvm_store.c
+ * Append-only settings record in a reserved program flash page
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "nvm_store.h"
+
+#define FLASH_PAGE_PC_UNITS     1024    //erase page: 512 instructions, 2 PC units each
+#define SLOT_PC_UNITS           (NVM_STORE_SLOT_WORDS * 2)
+#define HEADER_WORDS            4       //magic, size, checksum, spare
+#define DATA_WORDS              (NVM_STORE_SLOT_WORDS - HEADER_WORDS)
+
+#define NVM_MAGIC               0xB5A3u
+#define NVMCON_WRITE_DWORD      0x4001  //WREN, program two instruction words
+#define NVMCON_ERASE_PAGE       0x4003  //WREN, erase one page
+#define WRITE_LATCH_TBLPAG      0xFA
+
+//The linker places this page, noload keeps it out of the hex file
+static __prog__ uint8_t nvm_page[FLASH_PAGE_PC_UNITS]
+    __attribute__((space(prog), aligned(FLASH_PAGE_PC_UNITS), noload));
+
+
+static uint32_t slot_address(uint8_t slot)
+{
+    return (uint32_t)nvm_page + (uint32_t)slot * SLOT_PC_UNITS;
+}
+
+
+//Low 16 bits of the instruction word at addr
+static uint16_t flash_read_word(uint32_t addr)
+{
+    uint16_t saved_tblpag = TBLPAG;
+    uint16_t word;
+
+    TBLPAG = (uint16_t)(addr >> 16);
+    word = __builtin_tblrdl((uint16_t)addr);
+    TBLPAG = saved_tblpag;
+    return word;
+}
+
+
+//Runs one NVM operation and waits for it; the CPU stalls while it does
+static void flash_command(uint16_t nvmcon, uint32_t addr)
+{
+    NVMADRU = (uint16_t)(addr >> 16);
+    NVMADR = (uint16_t)addr;
+    NVMCON = nvmcon;
+    __builtin_write_NVM();          //unlock sequence, interrupts held off for it
+    while (NVMCONbits.WR);
+    NVMCONbits.WREN = 0;
+}
+
+
+//Programs two instruction words; the upper bytes are left erased
+static void flash_write_pair(uint32_t addr, uint16_t word0, uint16_t word1)
+{
+    uint16_t saved_tblpag = TBLPAG;
+
+    TBLPAG = WRITE_LATCH_TBLPAG;
+    __builtin_tblwtl(0, word0);
+    __builtin_tblwth(0, 0xFF);
+    __builtin_tblwtl(2, word1);
+    __builtin_tblwth(2, 0xFF);
+    TBLPAG = saved_tblpag;
+
+    flash_command(NVMCON_WRITE_DWORD, addr);
+}
+
+
+//Rotate-and-add, so swapped words give a different result
+static uint16_t record_checksum(const uint16_t *words, uint16_t size)
+{
+    uint16_t sum = NVM_MAGIC ^ size;
+
+    for (uint8_t i = 0; i < (size + 1) / 2; i++)
+    {
+        sum = (uint16_t)((sum << 1) | (sum >> 15)) + words[i];
+    }
+    return sum;
+}
+
+
+static bool slot_is_erased(uint8_t slot)
+{
+    uint32_t addr = slot_address(slot);
+
+    for (uint8_t i = 0; i < NVM_STORE_SLOT_WORDS; i++)
+    {
+        if (flash_read_word(addr + i * 2) != 0xFFFF) return false;
+    }
+    return true;
+}
+
+
+//Reads a slot's data words. Returns the record size, or 0 if the slot
+//doesn't hold a complete record.
+static uint16_t slot_read(uint8_t slot, uint16_t words[DATA_WORDS])
+{
+    uint32_t addr = slot_address(slot);
+    uint16_t size;
+
+    if (flash_read_word(addr) != NVM_MAGIC) return 0;
+    size = flash_read_word(addr + 2);
+    if (size == 0 || size > NVM_STORE_MAX_BYTES) return 0;
+
+    for (uint8_t i = 0; i < DATA_WORDS; i++)
+    {
+        words[i] = flash_read_word(addr + (HEADER_WORDS + i) * 2);
+    }
+    return (record_checksum(words, size) == flash_read_word(addr + 4)) ? size : 0;
+}
+
+
+//Index of the newest valid slot, or -1
+static int8_t newest_slot(uint16_t words[DATA_WORDS], uint16_t *size)
+{
+    int8_t newest = -1;
+
+    for (uint8_t slot = 0; slot < NVM_STORE_SLOTS; slot++)
+    {
+        if (slot_read(slot, words) != 0) newest = (int8_t)slot;
+    }
+    if (newest >= 0) *size = slot_read((uint8_t)newest, words);
+    return newest;
+}
+
+
+bool nvm_store_load(void *data, uint16_t size)
+{
+    uint16_t words[DATA_WORDS];
+    uint16_t stored_size;
+
+    if (newest_slot(words, &stored_size) < 0) return false;
+
+    memcpy(data, words, (stored_size < size) ? stored_size : size);
+    return true;
+}
+
+
+bool nvm_store_save(const void *data, uint16_t size)
+{
+    uint16_t words[DATA_WORDS];
+    uint16_t current[DATA_WORDS];
+    uint16_t current_size = 0;
+    uint16_t checksum;
+    int8_t last_used = -1;
+    uint8_t slot;
+    uint32_t addr;
+
+    if (size == 0 || size > NVM_STORE_MAX_BYTES) return false;
+
+    memset(words, 0xFF, sizeof(words));
+    memcpy(words, data, size);
+    checksum = record_checksum(words, size);
+
+    //Nothing to do if the newest record already says the same
+    if (newest_slot(current, &current_size) >= 0 && current_size == size &&
+        memcmp(current, words, size) == 0)
+    {
+        return true;
+    }
+
+    //Next erased slot after anything written, including half-written slots
+    for (slot = 0; slot < NVM_STORE_SLOTS; slot++)
+    {
+        if (!slot_is_erased(slot)) last_used = (int8_t)slot;
+    }
+    slot = (uint8_t)(last_used + 1);
+    if (slot >= NVM_STORE_SLOTS)
+    {
+        //A reset between this erase and the writes below loses the stored
+        //record; the caller's defaults are used on the next boot
+        flash_command(NVMCON_ERASE_PAGE, slot_address(0));
+        slot = 0;
+    }
+
+    //Data first and the magic word last, so a reset part-way through
+    //leaves a slot that load() ignores
+    addr = slot_address(slot);
+    for (uint8_t i = 0; i < DATA_WORDS; i += 2)
+    {
+        flash_write_pair(addr + (HEADER_WORDS + i) * 2, words[i], words[i + 1]);
+    }
+    flash_write_pair(addr + 4, checksum, 0xFFFF);
+    flash_write_pair(addr, NVM_MAGIC, size);
+
+    return (slot_read(slot, current) == size) && (memcmp(current, words, size) == 0);
+}
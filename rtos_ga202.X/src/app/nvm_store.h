@@ -0,0 +1,50 @@
+/*
+ * File:    nvm_store.h
+ * Summary: Settings record kept in one page of program flash
+ *
+ * Description:
+ *   The PIC24FJ128GA202 has no data EEPROM, so values that must survive a
+ *   reset (calibration, learned battery data) go into a reserved flash page.
+ *   The page is used as a log of fixed-size slots: each save programs the
+ *   next erased slot and loading returns the newest valid one, so the page
+ *   is only erased once every NVM_STORE_SLOTS saves.
+ *
+ *   The caller owns the record layout. Only ever append fields to it: a
+ *   record saved by older firmware is shorter, and load() leaves the fields
+ *   it doesn't cover untouched so they keep their defaults.
+ */
+
+#ifndef _NVM_STORE_H
+#define _NVM_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NVM_STORE_SLOT_WORDS    32      //instruction words per slot (16 data bits each)
+#define NVM_STORE_SLOTS         16      //512-instruction erase page / slot size
+#define NVM_STORE_MAX_BYTES     ((NVM_STORE_SLOT_WORDS - 4) * 2)    //56, after the header
+
+/**
+ * @brief Copies the newest valid record into data (at most size bytes).
+ *        Returns false, and leaves data untouched, if there is none.
+ */
+bool nvm_store_load(void *data, uint16_t size);
+
+/**
+ * @brief Appends a record of size bytes (at most NVM_STORE_MAX_BYTES).
+ *        Stalls the CPU for the flash operation, a few ms when the page
+ *        has to be erased, so call it where that is accounted for (see
+ *        watchdog_pause()). Returns false if the write did not verify.
+ */
+bool nvm_store_save(const void *data, uint16_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NVM_STORE_H */
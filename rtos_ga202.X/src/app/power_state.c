@@ -0,0 +1,91 @@
+/*
+ * power_state.c
+ * Active / Idle / Ship decisions and register values.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <math.h>
+
+#include "power_state.h"
+
+
+void power_init(power_t *p)
+{
+    p->state = POWER_ACTIVE;
+    p->reason = POWER_REASON_BOOT;
+    p->quiet_ms = 0;
+}
+
+
+uint8_t power_update(power_t *p, const power_config_t *cfg, float current_A, uint16_t limit_mV,
+                     uint32_t dt_ms)
+{
+    if (p->state == POWER_SHIP) return POWER_SHIP;
+
+    if (fabsf(current_A) * 1000.0f >= cfg->idle_mA)
+    {
+        p->quiet_ms = 0;
+        return POWER_ACTIVE;
+    }
+    if (p->state == POWER_IDLE) return POWER_IDLE;
+
+    p->quiet_ms = (p->quiet_ms > UINT32_MAX - dt_ms) ? UINT32_MAX : p->quiet_ms + dt_ms;
+    if (cfg->idle_after_ms == 0 || p->quiet_ms < cfg->idle_after_ms) return POWER_ACTIVE;
+    if (limit_mV <= cfg->limit_margin_mV) return POWER_ACTIVE;
+    return POWER_IDLE;
+}
+
+
+void power_entered(power_t *p, uint8_t state, uint8_t reason)
+{
+    p->state = state;
+    p->reason = reason;
+    p->quiet_ms = 0;
+}
+
+
+void power_activity(power_t *p)
+{
+    p->quiet_ms = 0;
+}
+
+
+uint8_t power_ctrl1(uint8_t state, uint8_t ctrl1)
+{
+    ctrl1 &= (uint8_t)~(POWER_CTRL1_LOAD_PRESENT | POWER_CTRL1_SHUT_A);
+    if (state == POWER_ACTIVE) return (uint8_t)(ctrl1 | POWER_CTRL1_ADC_EN);
+    return (uint8_t)(ctrl1 & ~POWER_CTRL1_ADC_EN);
+}
+
+
+uint8_t power_ctrl2(uint8_t state, uint8_t ctrl2)
+{
+    ctrl2 &= (uint8_t)~POWER_CTRL2_CC_ONESHOT;
+    if (state == POWER_ACTIVE) return (uint8_t)(ctrl2 | POWER_CTRL2_CC_EN);
+    return (uint8_t)(ctrl2 & ~POWER_CTRL2_CC_EN);
+}
+
+
+uint8_t power_ship_value(uint8_t ctrl1, uint8_t n)
+{
+    static const uint8_t shut[POWER_SHIP_WRITES] = { 0, POWER_CTRL1_SHUT_B, POWER_CTRL1_SHUT_A };
+
+    ctrl1 &= (uint8_t)~(POWER_CTRL1_LOAD_PRESENT | POWER_CTRL1_SHUT_A | POWER_CTRL1_SHUT_B);
+    return (uint8_t)(ctrl1 | shut[(n < POWER_SHIP_WRITES) ? n : 0]);
+}
+
+
+const char *power_state_name(uint8_t state)
+{
+    static const char *const names[POWER_STATES] = { "active", "idle", "ship" };
+
+    return (state < POWER_STATES) ? names[state] : "?";
+}
+
+
+const char *power_reason_name(uint8_t reason)
+{
+    static const char *const names[POWER_REASONS] = { "boot", "command", "quiet", "current", "load", "reset" };
+
+    return (reason < POWER_REASONS) ? names[reason] : "?";
+}
@@ -0,0 +1,136 @@
+/*
+ * File:    power_state.h
+ * Summary: Active, Idle and Ship power states of the BQ76920
+ *
+ * Description:
+ *   Active is how the firmware always ran the BQ76920: ADC on (cell
+ *   voltages, OV and UV protection) and the Coulomb Counter converting
+ *   every 250 ms. Idle turns both off; the measurement task triggers CC
+ *   conversions (CC_ONESHOT) instead, one per update or at the metering
+ *   cadence (cc_meter.h). SCD and OCD keep
+ *   working, they are comparators and don't need the ADC. Ship is the
+ *   chip's SHIP mode: everything off, REGOUT included, until a boot signal
+ *   on TS1 restarts it as after a power-on.
+ *
+ *   Active -> Idle after idle_after_ms with |I| below idle_mA, as long as
+ *   no cell was within limit_margin_mV of OV or UV at the last reading:
+ *   with the ADC off nothing would see one cross. Idle -> Active when a
+ *   one-shot reads idle_mA or more, when LOAD_PRESENT is set (valid while
+ *   CHG is off) or on a command. Ship is only entered on command, through
+ *   the SHUT_A/SHUT_B write sequence.
+ *
+ *   This file decides and computes the register values; taskBQ76920.c
+ *   writes them. No hardware or RTOS dependency.
+ */
+
+#ifndef _POWER_STATE_H
+#define _POWER_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POWER_STATES                3
+
+typedef enum
+{
+    POWER_ACTIVE = 0,
+    POWER_IDLE,
+    POWER_SHIP
+} power_state_t;
+
+//What caused the last change, for reports
+typedef enum
+{
+    POWER_REASON_BOOT = 0,
+    POWER_REASON_COMMAND,
+    POWER_REASON_QUIET,             //idle_after_ms without current
+    POWER_REASON_CURRENT,           //a one-shot read idle_mA or more
+    POWER_REASON_LOAD,              //LOAD_PRESENT
+    POWER_REASON_RESET,             //the chip restarted (after SHIP or a brown-out)
+    POWER_REASONS
+} power_reason_t;
+
+//BQ76920 bits the states use
+#define POWER_CTRL1_LOAD_PRESENT    0x80    //SYS_CTRL1, read only, valid while CHG is off
+#define POWER_CTRL1_ADC_EN          0x10
+#define POWER_CTRL1_SHUT_A          0x02
+#define POWER_CTRL1_SHUT_B          0x01
+#define POWER_CTRL2_CC_EN           0x40    //SYS_CTRL2: continuous conversions
+#define POWER_CTRL2_CC_ONESHOT      0x20    //one conversion, cleared by the chip
+#define POWER_CTRL2_CHG_ON          0x01
+
+#define POWER_SHIP_WRITES           3       //SYS_CTRL1 writes that enter SHIP mode
+
+typedef struct
+{
+    uint32_t idle_after_ms;         //quiet this long enters Idle, 0: only on command
+    uint16_t idle_mA;               //|I| below it is quiet, from it Idle wakes
+    uint16_t limit_margin_mV;       //no Idle with a cell this close to OV or UV
+} power_config_t;
+
+typedef struct
+{
+    uint8_t state;                  //power_state_t
+    uint8_t reason;                 //power_reason_t of the last change
+    uint32_t quiet_ms;              //time below idle_mA without a command
+} power_t;
+
+/**
+ * @brief Active, no quiet time yet.
+ */
+void power_init(power_t *p);
+
+/**
+ * @brief Takes one measurement into account and returns the state it
+ *        asks for; p->state only changes through power_entered().
+ *        limit_mV is the closest a cell was to OV or UV at the last
+ *        reading (0xFFFF if unknown), dt_ms the time since the previous
+ *        update.
+ */
+uint8_t power_update(power_t *p, const power_config_t *cfg, float current_A, uint16_t limit_mV,
+                     uint32_t dt_ms);
+
+/**
+ * @brief Records that state is in effect (registers written).
+ */
+void power_entered(power_t *p, uint8_t state, uint8_t reason);
+
+/**
+ * @brief Restarts the quiet time (a command was received).
+ */
+void power_activity(power_t *p);
+
+/**
+ * @brief SYS_CTRL1 / SYS_CTRL2 for state, from their current values.
+ *        SHUT_A is always cleared: written after SHUT_B it ships the pack.
+ */
+uint8_t power_ctrl1(uint8_t state, uint8_t ctrl1);
+uint8_t power_ctrl2(uint8_t state, uint8_t ctrl2);
+
+/**
+ * @brief Value n (0..POWER_SHIP_WRITES-1) of the SHIP sequence: SHUT_A/B
+ *        at 00, 01 then 10, the other bits of ctrl1 kept. The writes must
+ *        follow each other with no other write to the chip in between.
+ */
+uint8_t power_ship_value(uint8_t ctrl1, uint8_t n);
+
+/**
+ * @brief "active", "idle", "ship", "?" if out of range.
+ */
+const char *power_state_name(uint8_t state);
+
+/**
+ * @brief "boot", "command", "quiet", "current", "load", "reset".
+ */
+const char *power_reason_name(uint8_t reason);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _POWER_STATE_H */
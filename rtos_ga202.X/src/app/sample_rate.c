@@ -0,0 +1,139 @@
+/*
+ * sample_rate.c
+ * Measurement rate tiers.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "sample_rate.h"
+
+
+//Threshold a reading has to fall below to leave the tier it triggers
+static uint16_t calmer(uint16_t threshold, uint8_t hysteresis)
+{
+    return (uint16_t)((uint32_t)threshold * (100u - hysteresis) / 100u);
+}
+
+
+//Same for a margin, which has to grow to leave
+static uint16_t wider(uint16_t margin, uint8_t hysteresis)
+{
+    uint32_t m = (uint32_t)margin * (100u + hysteresis) / 100u;
+    return (m > 0xFFFF) ? 0xFFFF : (uint16_t)m;
+}
+
+
+static uint16_t distance(uint16_t a, uint16_t b)
+{
+    return (a > b) ? (uint16_t)(a - b) : (uint16_t)(b - a);
+}
+
+
+void sample_rate_init(sample_rate_t *sr, uint8_t tier)
+{
+    memset(sr, 0, sizeof(*sr));
+    sr->tier = (tier < SAMPLE_TIERS) ? tier : SAMPLE_TIER_NORMAL;
+    sr->limit_mV = 0xFFFF;
+}
+
+
+//|dV/dt| of the lowest and highest cell, once the span is long enough
+static void update_dvdt(sample_rate_t *sr, uint16_t min_mV, uint16_t max_mV, uint32_t dt_ms)
+{
+    uint16_t d;
+    uint32_t rate;
+
+    if (sr->have_ref) sr->ref_age_ms += dt_ms;
+    if (min_mV == 0) return;
+    if (sr->have_ref)
+    {
+        if (sr->ref_age_ms < SAMPLE_RATE_DVDT_SPAN_MS) return;
+        d = distance(min_mV, sr->ref_min_mV);
+        if (distance(max_mV, sr->ref_max_mV) > d) d = distance(max_mV, sr->ref_max_mV);
+        rate = (uint32_t)d * 1000u / sr->ref_age_ms;
+        sr->mV_per_s = (rate > 0xFFFF) ? 0xFFFF : (uint16_t)rate;
+    }
+    sr->ref_min_mV = min_mV;
+    sr->ref_max_mV = max_mV;
+    sr->ref_age_ms = 0;
+    sr->have_ref = true;
+}
+
+
+//Closest a cell is to a trip point, 0 at or past it. Kept from the last
+//reading while the cells can't be read.
+static void update_limit(sample_rate_t *sr, uint16_t min_mV, uint16_t max_mV,
+                         uint16_t uv_mV, uint16_t ov_mV)
+{
+    uint16_t limit = 0xFFFF;
+
+    if (min_mV == 0) return;
+    if (uv_mV != 0) limit = (min_mV > uv_mV) ? (uint16_t)(min_mV - uv_mV) : 0;
+    if (ov_mV != 0)
+    {
+        uint16_t to_ov = (max_mV < ov_mV) ? (uint16_t)(ov_mV - max_mV) : 0;
+        if (to_ov < limit) limit = to_ov;
+    }
+    sr->limit_mV = limit;
+}
+
+
+uint8_t sample_rate_update(sample_rate_t *sr, const sample_rate_config_t *cfg, float current_A,
+                           uint16_t min_mV, uint16_t max_mV, uint16_t uv_mV, uint16_t ov_mV,
+                           uint32_t dt_ms)
+{
+    uint8_t h = (cfg->hysteresis_percent > 50) ? 50 : cfg->hysteresis_percent;
+    bool in_fast = (sr->tier == SAMPLE_TIER_FAST);
+    float mA = fabsf(current_A) * 1000.0f;
+    uint8_t want;
+
+    update_dvdt(sr, min_mV, max_mV, dt_ms);
+    update_limit(sr, min_mV, max_mV, uv_mV, ov_mV);
+
+    sr->reasons = 0;
+    if (mA >= (in_fast ? calmer(cfg->fast_mA, h) : cfg->fast_mA)) sr->reasons |= SAMPLE_REASON_CURRENT;
+    if (sr->mV_per_s >= (in_fast ? calmer(cfg->fast_mV_per_s, h) : cfg->fast_mV_per_s))
+    {
+        sr->reasons |= SAMPLE_REASON_DVDT;
+    }
+    if (sr->limit_mV <= (in_fast ? wider(cfg->limit_margin_mV, h) : cfg->limit_margin_mV))
+    {
+        sr->reasons |= SAMPLE_REASON_LIMIT;
+    }
+
+    if (sr->reasons != 0) want = SAMPLE_TIER_FAST;
+    else if (mA < ((sr->tier == SAMPLE_TIER_IDLE) ? cfg->idle_mA : calmer(cfg->idle_mA, h))) want = SAMPLE_TIER_IDLE;
+    else want = SAMPLE_TIER_NORMAL;
+
+    if (want > sr->tier)
+    {
+        sr->tier = want;
+        sr->calm_ms = 0;
+    }
+    else if (want < sr->tier)
+    {
+        uint32_t calm_ms = (uint32_t)sr->calm_ms + dt_ms;
+
+        sr->calm_ms = (calm_ms > 0xFFFF) ? 0xFFFF : (uint16_t)calm_ms;
+        if (sr->calm_ms >= cfg->calm_ms)
+        {
+            sr->tier--;
+            sr->calm_ms = 0;
+        }
+    }
+    else
+    {
+        sr->calm_ms = 0;
+    }
+    return sr->tier;
+}
+
+
+const char *sample_rate_tier_name(uint8_t tier)
+{
+    static const char *const names[SAMPLE_TIERS] = { "idle", "normal", "fast" };
+
+    return (tier < SAMPLE_TIERS) ? names[tier] : "?";
+}
@@ -0,0 +1,109 @@
+/*
+ * File:    sample_rate.h
+ * Summary: Measurement rate tiers from current, dV/dt and cell limits
+ *
+ * Description:
+ *   The measurement task used to wake every 2 s whatever the pack did. A
+ *   pack on the shelf needs far fewer samples, and a pack under heavy
+ *   load, with cells moving fast or close to the OV/UV trip points wants
+ *   them as often as the Coulomb Counter converts (250 ms).
+ *
+ *   After each sample this picks one of SAMPLE_TIERS periods:
+ *     fast    |I| >= fast_mA, |dV/dt| >= fast_mV_per_s, or a cell within
+ *             limit_margin_mV of OV or UV
+ *     idle    |I| < idle_mA and none of the above
+ *     normal  anything in between
+ *   Moving to a faster tier is immediate. Moving down takes calm_ms of
+ *   samples in a row that allow it, one tier at a time, and the thresholds
+ *   to leave a tier are hysteresis_percent calmer than those to enter it,
+ *   so a current sitting on a threshold doesn't toggle the rate. calm_ms
+ *   is time rather than a sample count so that a pulsed load with gaps
+ *   shorter than it keeps the fast tier: dropping out between pulses
+ *   would let the slower period beat with the pulses and miss them.
+ *
+ *   dV/dt is the larger change of the lowest and highest cell, measured
+ *   over at least SAMPLE_RATE_DVDT_SPAN_MS so that ADC noise at the fast
+ *   rate doesn't read as movement.
+ *
+ *   Only the timing changes: the caller integrates each reading over the
+ *   measured interval since the previous one, so charge is counted the
+ *   same way at any rate.
+ *
+ *   No hardware or RTOS dependency; bms_replay.py --sampling runs it on a
+ *   PC to compare the tiers against fixed rates.
+ */
+
+#ifndef _SAMPLE_RATE_H
+#define _SAMPLE_RATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_TIERS                3
+#define SAMPLE_RATE_DVDT_SPAN_MS    2000    //shortest interval dV/dt is taken over
+
+typedef enum
+{
+    SAMPLE_TIER_IDLE = 0,
+    SAMPLE_TIER_NORMAL,
+    SAMPLE_TIER_FAST
+} sample_tier_t;
+
+//sample_rate_t.reasons: what asked for the fast tier at the last update
+#define SAMPLE_REASON_CURRENT       0x01
+#define SAMPLE_REASON_DVDT          0x02
+#define SAMPLE_REASON_LIMIT         0x04
+
+typedef struct
+{
+    uint16_t period_ms[SAMPLE_TIERS];   //idle, normal, fast
+    uint16_t idle_mA;                   //below it the pack counts as idle
+    uint16_t fast_mA;                   //heavy current
+    uint16_t fast_mV_per_s;             //a cell moving this fast
+    uint16_t limit_margin_mV;           //a cell this close to OV or UV
+    uint8_t hysteresis_percent;         //0..50
+    uint16_t calm_ms;                   //calm for this long before stepping down a tier
+} sample_rate_config_t;
+
+typedef struct
+{
+    uint8_t tier;                       //sample_tier_t in use
+    uint8_t reasons;                    //SAMPLE_REASON_* bits
+    bool have_ref;                      //ref_* hold a reading
+    uint16_t calm_ms;                   //time the samples have allowed a slower tier
+    uint16_t ref_min_mV, ref_max_mV;    //lowest and highest cell at the start of the dV/dt span
+    uint32_t ref_age_ms;                //time since then
+    uint16_t mV_per_s;                  //last |dV/dt|
+    uint16_t limit_mV;                  //last distance of a cell to OV or UV, 0xFFFF if unknown
+} sample_rate_t;
+
+/**
+ * @brief Starts in tier with no voltage history.
+ */
+void sample_rate_init(sample_rate_t *sr, uint8_t tier);
+
+/**
+ * @brief Takes one sample into account and returns the tier to use until
+ *        the next one. min_mV/max_mV are the lowest and highest cell, 0 if
+ *        the cells couldn't be read this time. uv_mV/ov_mV are the trip
+ *        points, 0 if unknown. dt_ms is the time since the last update.
+ */
+uint8_t sample_rate_update(sample_rate_t *sr, const sample_rate_config_t *cfg, float current_A,
+                           uint16_t min_mV, uint16_t max_mV, uint16_t uv_mV, uint16_t ov_mV,
+                           uint32_t dt_ms);
+
+/**
+ * @brief Name of a tier ("idle", "normal", "fast"), "?" if out of range.
+ */
+const char *sample_rate_tier_name(uint8_t tier);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SAMPLE_RATE_H */
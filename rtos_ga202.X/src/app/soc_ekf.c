@@ -0,0 +1,139 @@
+/*
+ * soc_ekf.c
+ * Fixed-point extended Kalman filter for State of Charge.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <stdint.h>
+
+#include "soc_ekf.h"
+
+#define ONE_Q16             65536L
+#define SOC_MAX_Q16         (100L << 16)
+#define MAX_CURRENT_MA      32000L      //keeps mA * ms and mOhm * mA in 32 bits
+#define MIN_VARIANCE_Q24    16L         //~1e-6, stops round-off driving P negative
+#define MAX_VARIANCE_Q24    (INT32_MAX / 2)
+#define MAX_SOC_STEP_Q16    (1L << 16)  //largest SoC correction per update, 1 %
+
+
+//Q16.16 * Q16.16 -> Q16.16 (also Q16.16 * Q8.24 -> Q8.24)
+static int32_t q16_mul(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> 16);
+}
+
+
+//Microvolts to mV Q16.16: * 65536 / 1000 as * 67109 / 1024
+static int32_t uV_to_mV_q16(int32_t uV)
+{
+    return (int32_t)(((int64_t)uV * 67109) >> 10);
+}
+
+
+//exp(-x) for x in Q16.16: second-order Taylor on x/8, then squared three
+//times. Within 0.1 % of exp() up to x = 4, which covers dt up to 4 * tau.
+static int32_t exp_neg_q16(int32_t x)
+{
+    int32_t y;
+
+    if (x > (8L << 16)) return 0;
+    x >>= 3;
+    y = ONE_Q16 - x + (int32_t)(((int64_t)x * x) >> 17);
+    y = q16_mul(y, y);
+    y = q16_mul(y, y);
+    return q16_mul(y, y);
+}
+
+
+static int32_t clamp_variance(int32_t p)
+{
+    if (p < MIN_VARIANCE_Q24) return MIN_VARIANCE_Q24;
+    if (p > MAX_VARIANCE_Q24) return MAX_VARIANCE_Q24;
+    return p;
+}
+
+
+void soc_ekf_init(soc_ekf_t *ekf, const soc_ekf_model_t *model,
+                  int32_t soc_q16, int32_t sigma_q16)
+{
+    if (sigma_q16 > SOC_EKF_Q16(11.0)) sigma_q16 = SOC_EKF_Q16(11.0);
+
+    ekf->model = model;
+    ekf->soc = soc_q16;
+    ekf->v1 = 0;
+    ekf->p00 = clamp_variance((int32_t)(((int64_t)sigma_q16 * sigma_q16) >> 8));
+    ekf->p01 = 0;
+    ekf->p11 = SOC_EKF_Q24(25.0);       //V1 unknown to about 5 mV
+
+    //Done once here so update() needs no division for the prediction
+    soc_ekf_set_capacity(ekf, model->capacity_mAh);
+    ekf->inv_tau = (int32_t)((1LL << 32) / ((int32_t)model->tau_s * 1000L));
+}
+
+
+void soc_ekf_update(soc_ekf_t *ekf, int32_t current_mA, uint16_t dt_ms, uint16_t cell_mV)
+{
+    const soc_ekf_model_t *m = ekf->model;
+    int32_t a, dt_q16, r1_i, ocv, h0, resid, k0, k1, dsoc;
+    int64_t ph0, ph1, s;
+
+    if (dt_ms > 60000u) dt_ms = 60000u;
+    if (current_mA > MAX_CURRENT_MA) current_mA = MAX_CURRENT_MA;
+    if (current_mA < -MAX_CURRENT_MA) current_mA = -MAX_CURRENT_MA;
+
+    //Predict: SoC drops with discharge, V1 relaxes toward R1 * I
+    ekf->soc -= (int32_t)(((int64_t)(current_mA * (int32_t)dt_ms) * ekf->soc_per_mAms) >> 32);
+    a = exp_neg_q16((int32_t)(((int64_t)dt_ms * ekf->inv_tau) >> 16));
+    r1_i = uV_to_mV_q16((int32_t)m->r1_mohm * current_mA);
+    ekf->v1 = q16_mul(a, ekf->v1) + q16_mul(ONE_Q16 - a, r1_i);
+
+    //P = F P F' + Q with F = diag(1, a); Q grows with dt
+    dt_q16 = (int32_t)(((int64_t)dt_ms * 67109) >> 10);
+    ekf->p00 = clamp_variance(ekf->p00 + q16_mul(m->q_soc, dt_q16));
+    ekf->p01 = q16_mul(a, ekf->p01);
+    ekf->p11 = clamp_variance(q16_mul(q16_mul(a, a), ekf->p11) + q16_mul(m->q_v1, dt_q16));
+
+    if (cell_mV == 0) return;
+
+    //Correct: h(x) = OCV(SoC) - V1 - R0 * I, so H = [dOCV/dSoC, -1]
+    ocv = bms_ocv_mV_q16(m->chem, ekf->soc, &h0);
+    resid = ((int32_t)cell_mV << 16)
+          - (ocv - ekf->v1 - uV_to_mV_q16((int32_t)m->r0_mohm * current_mA));
+
+    ph0 = (((int64_t)ekf->p00 * h0) >> 16) - ekf->p01;     //P H', Q8.24
+    ph1 = (((int64_t)ekf->p01 * h0) >> 16) - ekf->p11;
+    s = ((h0 * ph0) >> 16) - ph1 + m->r_meas;                //H P H' + R, Q8.24
+    if (s <= 0) return;
+
+    k0 = (int32_t)((ph0 << 16) / s);                          //gain, Q16.16
+    k1 = (int32_t)((ph1 << 16) / s);
+
+    //The OCV table is piecewise linear, so H jumps at each 10 % point. Just
+    //below a steep segment a flat-segment gain can turn a few mV of noise
+    //into a large SoC step; cap it and let the next updates finish the job.
+    dsoc = q16_mul(k0, resid);
+    if (dsoc > MAX_SOC_STEP_Q16) dsoc = MAX_SOC_STEP_Q16;
+    if (dsoc < -MAX_SOC_STEP_Q16) dsoc = -MAX_SOC_STEP_Q16;
+    ekf->soc += dsoc;
+    ekf->v1 += q16_mul(k1, resid);
+    if (ekf->soc < 0) ekf->soc = 0;
+    if (ekf->soc > SOC_MAX_Q16) ekf->soc = SOC_MAX_Q16;
+
+    //P = (I - K H) P
+    ekf->p00 = clamp_variance(ekf->p00 - q16_mul(k0, (int32_t)ph0));
+    ekf->p01 = ekf->p01 - q16_mul(k0, (int32_t)ph1);
+    ekf->p11 = clamp_variance(ekf->p11 - q16_mul(k1, (int32_t)ph1));
+}
+
+
+void soc_ekf_set_capacity(soc_ekf_t *ekf, uint16_t capacity_mAh)
+{
+    if (capacity_mAh == 0) return;
+    ekf->soc_per_mAms = (int32_t)((100LL << 48) / ((int64_t)capacity_mAh * 3600000LL));
+}
+
+
+int32_t soc_ekf_soc(const soc_ekf_t *ekf)
+{
+    return ekf->soc;
+}
@@ -0,0 +1,97 @@
+/*
+ * File:    soc_ekf.h
+ * Summary: Fixed-point extended Kalman filter for State of Charge
+ *
+ * Description:
+ *   One-RC equivalent circuit per cell: OCV(SoC) - V1 - R0*I, where V1 is
+ *   the polarisation voltage across R1||C1. State is [SoC, V1], the input
+ *   is the Coulomb Counter current and the measurement is the mean cell
+ *   voltage. SoC and voltages are Q16.16 (% and mV) and the covariance is
+ *   Q8.24 (it spans 100 %^2 down to 1e-6 %^2), with 64-bit intermediates,
+ *   so no floating point is needed on the PIC24. One update costs two
+ *   64-bit divisions; everything else is multiplies and shifts.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency, the host
+ *   replay tool builds it too.
+ */
+
+#ifndef _SOC_EKF_H
+#define _SOC_EKF_H
+
+#include <stdint.h>
+
+#include "bms_math.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOC_EKF_Q16(x)      ((int32_t)((x) * 65536.0))      //constant to Q16.16
+#define SOC_EKF_Q24(x)      ((int32_t)((x) * 16777216.0))   //constant to Q8.24
+
+/**
+ * @brief Cell model and noise tuning. Current is positive for discharge,
+ *        the same sign the Coulomb Counter code uses.
+ */
+typedef struct
+{
+    bms_chem_t chem;        //OCV table
+    uint16_t capacity_mAh;
+    uint16_t r0_mohm;       //series (ohmic) resistance
+    uint16_t r1_mohm;       //polarisation resistance
+    uint16_t tau_s;         //R1 * C1
+    int32_t  q_soc;         //process noise on SoC per second, %^2 Q8.24
+    int32_t  q_v1;          //process noise on V1 per second, mV^2 Q8.24
+    int32_t  r_meas;        //measurement noise, mV^2 Q8.24
+} soc_ekf_model_t;
+
+/**
+ * @brief Filter state. Only soc is meant to be read by callers.
+ */
+typedef struct
+{
+    int32_t soc;            //% Q16.16
+    int32_t v1;             //mV Q16.16
+    int32_t p00;            //var(SoC), %^2 Q8.24
+    int32_t p01;            //cov(SoC, V1), %*mV Q8.24
+    int32_t p11;            //var(V1), mV^2 Q8.24
+    int32_t soc_per_mAms;   //% per mA*ms, Q16.48 (>> 32 gives Q16.16)
+    int32_t inv_tau;        //1 / (tau in ms), Q0.32
+    const soc_ekf_model_t *model;
+} soc_ekf_t;
+
+/**
+ * @brief Starts the filter at soc_q16 (%) with a standard deviation of
+ *        sigma_q16 (%, at most 11 %). The model must stay valid while the
+ *        filter is used.
+ */
+void soc_ekf_init(soc_ekf_t *ekf, const soc_ekf_model_t *model,
+                  int32_t soc_q16, int32_t sigma_q16);
+
+/**
+ * @brief One predict + correct step.
+ *
+ * @param current_mA Pack current over the last interval (+ = discharge).
+ * @param dt_ms      Length of that interval (clamped to 60 s).
+ * @param cell_mV    Mean cell voltage at the end of it, 0 to skip the
+ *                   correction (prediction only).
+ */
+void soc_ekf_update(soc_ekf_t *ekf, int32_t current_mA, uint16_t dt_ms, uint16_t cell_mV);
+
+/**
+ * @brief Replaces the model's capacity, e.g. with a learned one. The state
+ *        and covariance are kept.
+ */
+void soc_ekf_set_capacity(soc_ekf_t *ekf, uint16_t capacity_mAh);
+
+/**
+ * @brief SoC estimate in % (Q16.16).
+ */
+int32_t soc_ekf_soc(const soc_ekf_t *ekf);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SOC_EKF_H */
@@ -0,0 +1,132 @@
+/*
+ * supervisor.c
+ * Task check-in bookkeeping and the record of a missed check-in.
+ * Keep this file free of hardware and RTOS includes so it builds on a PC.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "supervisor.h"
+
+#define RECORD_MAGIC    0x5744      //"WD"
+
+
+void supervisor_init(supervisor_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+
+uint8_t supervisor_register(supervisor_t *s, const char *name, uint16_t timeout, uint16_t now)
+{
+    supervisor_task_t *t;
+
+    if (s->count >= SUPERVISOR_MAX_TASKS) return SUPERVISOR_NONE;
+    t = &s->task[s->count];
+    t->name = name;
+    t->timeout = timeout;
+    t->last_checkin = now;
+    t->activity = 0;
+    return s->count++;
+}
+
+
+void supervisor_checkin(supervisor_t *s, uint8_t id, uint16_t now, uint16_t activity)
+{
+    if (id >= s->count) return;
+    s->task[id].activity = activity;
+    s->task[id].last_checkin = now;
+}
+
+
+void supervisor_activity(supervisor_t *s, uint8_t id, uint16_t activity)
+{
+    if (id >= s->count) return;
+    s->task[id].activity = activity;
+}
+
+
+void supervisor_pause(supervisor_t *s, uint16_t now)
+{
+    s->paused_at = now;
+    s->paused = true;
+}
+
+
+void supervisor_resume(supervisor_t *s, uint16_t now)
+{
+    uint16_t length = (uint16_t)(now - s->paused_at);
+
+    for (uint8_t i = 0; i < s->count; i++)
+    {
+        supervisor_task_t *t = &s->task[i];
+
+        //A check-in during the pause already counts from its own time
+        if ((uint16_t)(t->last_checkin - s->paused_at) > length)
+        {
+            t->last_checkin = (uint16_t)(t->last_checkin + length);
+        }
+    }
+    s->paused = false;      //last, a poll in between still sees the pause
+}
+
+
+bool supervisor_poll(supervisor_t *s, uint16_t now, supervisor_record_t *record)
+{
+    const supervisor_task_t *late = NULL;
+    uint16_t worst = 0;
+
+    if (s->tripped) return false;
+    if (s->paused) return true;
+
+    for (uint8_t i = 0; i < s->count; i++)
+    {
+        const supervisor_task_t *t = &s->task[i];
+        uint16_t silent = (uint16_t)(now - t->last_checkin);
+
+        //How far past its own timeout, so a starved low-priority task
+        //doesn't take the blame for the one that is spinning
+        if (silent > t->timeout && (uint16_t)(silent - t->timeout) >= worst)
+        {
+            worst = (uint16_t)(silent - t->timeout);
+            late = t;
+        }
+    }
+    if (late == NULL) return true;
+
+    s->tripped = true;
+    if (!supervisor_record_valid(record)) memset(record, 0, sizeof(*record));
+    record->trips++;
+    record->pending = true;
+    strncpy(record->name, late->name, SUPERVISOR_NAME_BYTES);
+    record->activity = late->activity;
+    record->silent = (uint16_t)(now - late->last_checkin);
+    return false;
+}
+
+
+static uint16_t record_sum(const supervisor_record_t *record)
+{
+    const uint8_t *p = (const uint8_t *)record;
+    uint16_t sum = 0;
+
+    for (size_t i = 0; i < offsetof(supervisor_record_t, check); i++)
+    {
+        sum = (uint16_t)((sum << 1 | sum >> 15) + p[i]);
+    }
+    return (uint16_t)~sum;
+}
+
+
+void supervisor_record_seal(supervisor_record_t *record)
+{
+    record->magic = RECORD_MAGIC;
+    record->check = record_sum(record);
+}
+
+
+bool supervisor_record_valid(const supervisor_record_t *record)
+{
+    return record->magic == RECORD_MAGIC && record->check == record_sum(record);
+}
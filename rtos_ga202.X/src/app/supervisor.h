@@ -0,0 +1,132 @@
+/*
+ * File:    supervisor.h
+ * Summary: Per-task liveness check-ins that gate the watchdog
+ *
+ * Description:
+ *   Each supervised task registers with a timeout and checks in from its
+ *   main loop. supervisor_poll() runs periodically (watchdog.c calls it
+ *   from the tick hook) and tells the caller to clear the WDT only while
+ *   every task has checked in within its timeout. The first miss latches:
+ *   the most overdue task, what it was last doing and how long it has been
+ *   silent go into a supervisor_record_t and the WDT is never cleared
+ *   again, so the chip resets with the reason saved.
+ *
+ *   Tasks also report an activity code as they go (which step, which I2C
+ *   register); the code is task specific and only printed.
+ *
+ *   Times are the low 16 bits of the tick count. A 16-bit store is one
+ *   instruction on the PIC24, so a check-in can't be torn by the tick
+ *   interrupt and needs no critical section. Timeouts must stay below
+ *   32768 ticks.
+ *
+ *   Like bms_math.c this file has no hardware or RTOS dependency, so a
+ *   hung task can be simulated on a PC.
+ */
+
+#ifndef _SUPERVISOR_H
+#define _SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SUPERVISOR_MAX_TASKS    5       //the four BQ76920 tasks and the idle heartbeat
+#define SUPERVISOR_NAME_BYTES   8       //task name kept in the record, not terminated if full
+#define SUPERVISOR_NONE         0xFF    //supervisor_register() failed
+
+typedef struct
+{
+    const char *name;
+    uint16_t timeout;                   //ticks
+    volatile uint16_t last_checkin;     //tick of the last check-in
+    volatile uint16_t activity;         //last code the task reported
+} supervisor_task_t;
+
+typedef struct
+{
+    supervisor_task_t task[SUPERVISOR_MAX_TASKS];
+    uint8_t count;
+    bool tripped;                       //a task missed its check-in, stop clearing the WDT
+    volatile bool paused;               //supervisor_pause() until supervisor_resume()
+    uint16_t paused_at;
+} supervisor_t;
+
+/**
+ * @brief What the supervisor saw when it stopped clearing the WDT. Meant to
+ *        live in RAM that survives a reset; check guards against the
+ *        random contents after power-up.
+ */
+typedef struct
+{
+    uint16_t magic;
+    uint16_t trips;                     //misses recorded since the record was first made
+    bool pending;                       //not reported yet
+    char name[SUPERVISOR_NAME_BYTES];
+    uint16_t activity;
+    uint16_t silent;                    //ticks since its last check-in
+    uint32_t uptime;                    //tick count at the miss (filled in by the caller)
+    uint16_t check;
+} supervisor_record_t;
+
+/**
+ * @brief No tasks, not tripped.
+ */
+void supervisor_init(supervisor_t *s);
+
+/**
+ * @brief Adds a task that must check in every timeout ticks, counting from
+ *        now. Returns its id, SUPERVISOR_NONE if the table is full.
+ */
+uint8_t supervisor_register(supervisor_t *s, const char *name, uint16_t timeout, uint16_t now);
+
+/**
+ * @brief The task is alive, doing activity.
+ */
+void supervisor_checkin(supervisor_t *s, uint8_t id, uint16_t now, uint16_t activity);
+
+/**
+ * @brief Records what the task is doing without counting as a check-in.
+ */
+void supervisor_activity(supervisor_t *s, uint8_t id, uint16_t activity);
+
+/**
+ * @brief Stops judging check-ins, for code that stalls every task at once
+ *        (a flash erase holds the CPU). supervisor_poll() returns true
+ *        meanwhile. Pauses don't nest.
+ */
+void supervisor_pause(supervisor_t *s, uint16_t now);
+
+/**
+ * @brief Judges check-ins again. The paused time is not counted against
+ *        any task: tasks that didn't check in meanwhile have their last
+ *        check-in moved forward by it, so a task that was already late
+ *        stays exactly as late.
+ */
+void supervisor_resume(supervisor_t *s, uint16_t now);
+
+/**
+ * @brief True if the WDT may be cleared. On the first miss the most
+ *        overdue task is written to *record (pending, trips incremented,
+ *        not sealed) and false is returned from then on.
+ */
+bool supervisor_poll(supervisor_t *s, uint16_t now, supervisor_record_t *record);
+
+/**
+ * @brief Sets magic and check after the record was changed.
+ */
+void supervisor_record_seal(supervisor_record_t *record);
+
+/**
+ * @brief True if the record was sealed, false for uninitialized RAM.
+ */
+bool supervisor_record_valid(const supervisor_record_t *record);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SUPERVISOR_H */
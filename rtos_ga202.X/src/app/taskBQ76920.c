@@ -1,427 +1,2966 @@
 /*
  * taskBQ76920.c
- * FreeRTOS task for communicating with BQ76920 battery monitor over I2C
- * and logging status via UART with support for commands: g, read, write
+ * FreeRTOS tasks for the BQ76920 battery monitor, highest priority first:
+ * protection (SYS_STAT faults, reset recovery, scrub), measurement
+ * (Coulomb Counter, cells, SoC), telemetry (formats what the other two
+ * report onto the UART) and the console. Each measurement is published as
+ * a snapshot (meas_snapshot.c) the other tasks copy without locking.
+ * The measurement rate follows the load (sample_rate.c), and a quiet pack
+ * puts the BQ76920 into Idle or, on command, SHIP mode (power_state.c).
+ * The Coulomb Counter converts continuously or in one-shots, periodic or
+ * on demand, integrated over the time between readings (cc_meter.c).
+ * Commands (g, read, write, baud, clock, i2c, soc, cc, cap, stats, cells,
+ * rate, power, meter, crash, trace, cpu, tasks, help) are dispatched from the table below,
+ * batches of read/write are separated by ';'. Configuration registers go
+ * through a shadow (afe_shadow.c) that is flushed in bursts, verified,
+ * scrubbed and restored after a reset of the BQ76920.
  */
 
 #include <xc.h>
 #include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
+#include "semphr.h"
 
 #include "taskBQ76920.h"
+#include "afe_shadow.h"
+#include "bms_math.h"
+#include "capacity_learn.h"
+#include "cc_meter.h"
+#include "cell_stats.h"
+#include "cell_topology.h"
+#include "clock.h"
+#include "clock_profile.h"
+#include "cmd_parse.h"
+#include "crash.h"
+#include "heartbeat.h"
 #include "i2c1.h"
+#include "meas_snapshot.h"
+#include "nvm_store.h"
+#include "power_state.h"
+#include "sample_rate.h"
+#include "soc_ekf.h"
+#include "tmr2.h"
+#include "trace.h"
 #include "uart1.h"
-
-#include <math.h>
+#include "uart_fmt.h"
+#include "watchdog.h"
 
 #define BQ76920_I2C_ADDR     0x08 //Current device address of BQ76920 chip
 
 //Predefined Register addresses inside of BQ76920
 #define SYS_CTRL1_REG        0x04
 #define SYS_CTRL2_REG        0x05
+#define OV_TRIP_REG          0x09
+#define UV_TRIP_REG          0x0A
 #define VC1_HI_REG           0x0C
-#define BAT_HI_REG           0x2A
-#define TS1_HI_REG           0x2C
 #define CC_HI_REG            0x32
 #define CC_LO_REG            0x33
 #define ADCGAIN1_REG         0x50
 #define ADCOFFSET_REG        0x51
 #define ADCGAIN2_REG         0x59
 
+#define BAUD_CONFIRM_MS      3000 //time the host gets to confirm a baud change
+#define BAUD_MAX             4000000UL //Fcy / 4 on the performance clock
+#define UART_LINE_BYTES      96   //longest command line + 1, batches need the room
+
+//SYS_STAT protection faults, each cleared by writing 1
+#define SYS_STAT_OCD         0x01
+#define SYS_STAT_SCD         0x02
+#define SYS_STAT_OV          0x04
+#define SYS_STAT_UV          0x08
+#define SYS_STAT_OVRD_ALERT  0x10
+#define SYS_STAT_FAULTS      0x1F
+
+#define SYS_CTRL2_CHG_ON     0x01
+#define SYS_CTRL2_DSG_ON     0x02
+#define SYS_CTRL2_FET_MASK   0x03 //DSG_ON | CHG_ON
+#define CC_CONVERSION_MS     250  //CC_READY period in continuous mode
+#define CC_ONESHOT_MS        (CC_CONVERSION_MS + 10) //wait for a CC_ONESHOT or first ADC conversion
+#define CC_DEADBAND_MA       20   //|current| below this, after offset removal, reads as 0
+#define CC_OFFSET_SAVE_LSB   0.1f //re-store the offset once it has moved this far
+#define AFE_SCRUB_MS         60000 //compare the configuration registers with the shadow this often
+#define READ_CHUNK_BYTES     16   //registers per I2C read for "read", any length is split into these
+
+//Tasks. Stacks are in words, "tasks" shows how much of each was ever used.
+//Watchdog timeouts cover the longest wait of each loop: the AFE bring-up
+//for protection, the boot CC calibration (checked in every 250 ms) for
+//measurement, and the console holding the UART (3 s baud confirm plus
+//output) for telemetry and the console itself.
+#define PROTECT_PRIORITY     4
+#define PROTECT_STACK_WORDS  192
+#define PROTECT_PERIOD_MS    50   //SYS_STAT poll
+#define PROTECT_TIMEOUT_MS   3000
+#define MEASURE_PRIORITY     3    //same as the timer task
+#define MEASURE_STACK_WORDS  256
+#define MEASURE_PERIOD_MS    2000 //Coulomb Counter, cell frame and SoC, normal tier
+#define MEASURE_IDLE_MS      8000 //no load; stays under MEASURE_TIMEOUT_MS
+#define MEASURE_FAST_MS      CC_CONVERSION_MS //every Coulomb Counter conversion
+#define MEASURE_TIMEOUT_MS   10000
+#define TELEMETRY_PRIORITY   2
+#define TELEMETRY_STACK_WORDS 160
+#define TELEMETRY_TIMEOUT_MS 10000
+#define TELEMETRY_QUEUE_LENGTH 8
+#define TELEMETRY_IDLE_MS    1000 //check in this often when there is nothing to send
+#define CONSOLE_PRIORITY     1
+#define CONSOLE_STACK_WORDS  (320 + (CELL_STATS_MAX_CELLS - 5) * sizeof(cell_stat_t) / 2) //measure_reply_t
+#define CONSOLE_TIMEOUT_MS   10000
+
+//Watchdog activity codes: step in the high byte (each belongs to one
+//task), BQ76920 register of the last I2C transfer in the low byte (0x0432:
+//stuck reading CC_HI; telemetry puts the message type there)
+#define ACTIVITY_BOOT        0x0100 //protection: AFE bring-up
+#define ACTIVITY_UART        0x0200 //console: waiting for a line
+#define ACTIVITY_STATUS      0x0300 //protection: SYS_STAT poll
+#define ACTIVITY_CC          0x0400 //measurement: periodic update
+#define ACTIVITY_COMMAND     0x0500 //console
+#define ACTIVITY_SCRUB       0x0600 //protection
+#define ACTIVITY_FAULT       0x0700 //protection: switching the FETs off
+#define ACTIVITY_CC_CAL      0x0800 //measurement: boot CC calibration
+#define ACTIVITY_TELEMETRY   0x0900
+#define ACTIVITY_REQUEST     0x0A00 //measurement: change asked for by a command
+#define ACTIVITY_POWER       0x0B00 //measurement or protection: power state change
+#define ACTIVITY_FLASH       0x0C00 //measurement: writing the stored settings
+
+
+//Factory ADC calibration, written and used under the AFE lock
+static uint16_t adc_gain_uV = 365;
+static int8_t adc_offset_mV = 0;
+static bms_adc_scale_t adc_scale;   //the two above, ready for bms_cells_raw_to_mV()
+
+#define BATTERY_CAPACITY_MAH 3200.0f //nominal mAh of my pack, SoC uses the learned capacity
+#define BATTERY_CHEMISTRY    BMS_CHEM_NMC //selects the OCV table used to anchor SoC
+
+//SoC engine at boot, can be changed at runtime with "soc cc" / "soc ekf"
+#define SOC_ENGINE_CC        0 //Coulomb counting, re-anchored from OCV at rest
+#define SOC_ENGINE_EKF       1 //Kalman filter on CC current and cell voltage
+#define SOC_ENGINE_DEFAULT   SOC_ENGINE_CC
+
+#define SOC_EKF_SIGMA_PERCENT 5.0 //assumed error of the SoC the filter starts from
+
+//Rolling cell statistics, "stats window <n> [<snapshots>]" changes them
+#define CELL_STATS_WINDOW    16 //samples in the window
+#define CELL_STATS_DECIMATE  1  //measurements averaged per sample
+
+//Cell wiring: AFE variant (BMS_AFE, cell_topology.h) and cell count,
+//cell_topology.c maps them to the VC inputs in use. "cells <n>" changes the
+//count at runtime.
+#define BATTERY_CELLS        3  //VC1, VC2, VC5 with VC3/VC4 shorted to VC2
+
+static const cell_topology_t *topology;
+
+//Owned by the measurement task, the other tasks see them through snapshot
+static float remaining_capacity_mAh = BATTERY_CAPACITY_MAH; //replaced from OCV at boot
+static cap_learn_t capacity;
+static float soc_percent = 100.0f;
+static const float coulomb_counter_gain_uV = 369.0f;
+static const float shunt_resistance_ohm = 0.01f;
+static measurement_t measured;          //being filled for the next publish
+static meas_snapshot_t snapshot;
+
+//Measurement rate tiers, "rate" shows or pins them. Protection polls
+//SYS_STAT every PROTECT_PERIOD_MS whatever the tier.
+#define SAMPLING_AUTO        0xFF //sampling_forced: follow sample_rate_update()
+#define IDLE_CURRENT_MA      50   //below it the pack is idle, for the rate and the power state
+#define LIMIT_MARGIN_MV      100  //a cell this close to OV/UV needs the fast rate and the ADC
+static const sample_rate_config_t sampling_config =
+{
+    { MEASURE_IDLE_MS, MEASURE_PERIOD_MS, MEASURE_FAST_MS },
+    IDLE_CURRENT_MA,        //idle below 50 mA
+    3000,                   //fast from 3 A
+    5,                      //or a cell moving 5 mV/s
+    LIMIT_MARGIN_MV,        //or a cell within 100 mV of OV/UV
+    20,                     //leave 20 % below the entry thresholds
+    15000                   //15 s calm per tier down, longer than gaps in a pulsed load
+};
+static sample_rate_t sampling;
+static uint8_t sampling_forced = SAMPLING_AUTO;
 
-uint16_t adc_gain_uV = 365;
-int8_t adc_offset_mV = 0;
+//Power states, "power" shows or changes them. power.state only changes
+//with the AFE lock held (the protection task wakes Idle on LOAD_PRESENT),
+//the rest belongs to the measurement task.
+#define POWER_IDLE_AFTER_S   300  //quiet time before Idle unless stored otherwise, 0: never
+static power_config_t power_config = { POWER_IDLE_AFTER_S * 1000UL, IDLE_CURRENT_MA, LIMIT_MARGIN_MV };
+static power_t power = { POWER_ACTIVE, POWER_REASON_BOOT, 0 };
+static volatile bool command_seen = false;  //set by the console, restarts the quiet time
 
-float remaining_capacity_mAh = 3200.0f; //battery milliAmp Hours from Chemistry for my pack
-float soc_percent = 100.0f;
-float coulomb_counter_gain_uV = 369.0f;
-float shunt_resistance_ohm = 0.01f;
+//Coulomb Counter metering, "meter" shows or changes it. Continuous is
+//CC_EN while Active; periodic and oneshot keep CC_EN off and start one
+//conversion every meter_period_s or on "meter sample". Updates without a
+//reading still read the cells; the charge of the gap is counted at the
+//next reading. meter_mode only changes with the AFE lock held (protection
+//restores SYS_CTRL2 from it), the rest belongs to the measurement task.
+#define METER_PERIOD_S       60   //periodic interval unless stored otherwise
+#define METER_PERIOD_MAX_S   3600
+static uint8_t meter_mode = CC_METER_CONTINUOUS;
+static uint16_t meter_period_s = METER_PERIOD_S;
+static cc_meter_t meter;
+static bool meter_sample = false;   //"meter sample": take a reading at this update
 
 static TickType_t last_update_tick = 0;
+static bms_rest_t soc_rest = { 0.0f, 0.0f, false };
+static uint8_t soc_engine = SOC_ENGINE_DEFAULT;
+static bms_cc_cal_t cc_cal = { 0.0f, 0, 0, false };
+static cell_stats_t cell_stats;
+static afe_shadow_t afe_shadow;
+static TickType_t last_scrub_tick = 0;
+static uint16_t cc_deadband_mA = CC_DEADBAND_MA;
+
+//Values kept across resets in flash (nvm_store). Only append fields, so a
+//record written by older firmware still loads.
+typedef struct
+{
+    float cc_offset_lsb;
+    float learned_mAh;
+    float cycle_mAh;
+    uint16_t cycles;
+    uint16_t learn_count;
+    uint16_t cell_count;
+    uint16_t idle_after_s;
+    uint16_t meter_mode;
+    uint16_t meter_period_s;
+} stored_settings_t;
+
+static stored_settings_t stored;
+static bool stored_valid = false;
+static bool stored_dirty = false;       //save_stored_settings() asked, not written yet
+static soc_ekf_t soc_ekf;
+
+//One-RC cell model for the Kalman filter. R0/R1/tau are typical 18650 NMC
+//figures; measure them for the pack in use (pulse test) for best results.
+static const soc_ekf_model_t soc_model =
+{
+    BATTERY_CHEMISTRY,
+    (uint16_t)BATTERY_CAPACITY_MAH,
+    50,                     //R0 mOhm
+    30,                     //R1 mOhm
+    60,                     //tau s
+    SOC_EKF_Q24(0.000001),  //SoC process noise, %^2/s
+    SOC_EKF_Q24(0.01),      //V1 process noise, mV^2/s
+    SOC_EKF_Q24(4.0),       //cell voltage noise, mV^2
+};
+
+//The SoC, capacity, CC calibration, cell statistics and stored settings
+//above belong to the measurement task; commands change them through
+//measure_requests. afe_shadow, adc_scale and the I2C bus are shared under
+//afe_mutex, UART1 output under uart_mutex.
+
+//One task's handle, watchdog entry and current activity
+typedef struct
+{
+    TaskHandle_t handle;
+    uint8_t watchdog_id;
+    uint16_t activity;
+} task_context_t;
+
+typedef struct
+{
+    TaskFunction_t run;
+    const char *name;               //also the watchdog entry, 8 characters at most
+    uint16_t stack_words;
+    UBaseType_t priority;
+    uint16_t timeout_ms;
+    uint8_t trace_id;               //trace_task_t
+    task_context_t *context;
+} task_def_t;
+
+//What protection and measurement report. They never wait for the UART:
+//messages are queued (dropped and counted if the queue is full) and the
+//telemetry task formats them.
+typedef enum
+{
+    TELEMETRY_TEXT = 1,             //text: one line, without "\r\n"
+    TELEMETRY_MEASUREMENT,          //a: current A, b: SoC %, value: raw CC, tick
+    TELEMETRY_CC_OFFSET,            //a: offset LSB
+    TELEMETRY_ANCHOR,               //flags: ANCHOR_*, a: SoC %, value: cell avg mV
+    TELEMETRY_FULL_CHARGE,          //value: cell avg mV
+    TELEMETRY_CAPACITY,             //a: learned mAh, b: SoH %, value: cycles, value2: updates
+    TELEMETRY_SCRUB,                //value: registers wrong, flags: 1 if rewritten
+    TELEMETRY_RESTORED,             //tick: ms taken, value: resets since boot
+    TELEMETRY_FAULT,                //flags: SYS_STAT faults, value: faults since boot,
+                                    //value2: 1 if the FETs read back off, tick: response us
+    TELEMETRY_POWER                 //flags: power_state_t, value: power_reason_t, tick: us taken
+} telemetry_type_t;
+
+#define ANCHOR_BOOT          0 //"SoC from OCV"
+#define ANCHOR_REST          1 //"SoC re-anchored at rest"
+#define ANCHOR_EKF_REST      2 //"OCV at rest", the filter keeps its own SoC
+#define ANCHOR_SKIPPED       3 //flat part of the OCV curve
+
+typedef struct
+{
+    uint8_t type;                   //telemetry_type_t
+    uint8_t flags;
+    uint16_t value;
+    uint16_t value2;
+    const char *text;
+    float a;
+    float b;
+    uint32_t tick;
+} telemetry_msg_t;
+
+//Commands that change measurement state are carried out by the measurement
+//task between two updates. It answers with a copy of what the command
+//reports, so the console never sees the state half-updated.
+typedef enum
+{
+    MEASURE_REPORT = 0,             //no change
+    MEASURE_SOC_ENGINE,             //value: SOC_ENGINE_*
+    MEASURE_CC_CAL,
+    MEASURE_CC_DEADBAND,            //value: mA
+    MEASURE_CAP_RESET,
+    MEASURE_CELLS,                  //value: cell count
+    MEASURE_STATS_RESET,
+    MEASURE_STATS_WINDOW,           //value: samples, value2: snapshots per sample or MEASURE_KEEP
+    MEASURE_RATE,                   //value: sample_tier_t or SAMPLING_AUTO
+    MEASURE_POWER,                  //value: power_state_t
+    MEASURE_POWER_AUTO,             //value: quiet s before Idle, 0: never
+    MEASURE_WAKE,                   //protection left Idle, no reply
+    MEASURE_METER,                  //value: cc_meter_mode_t, value2: period s or MEASURE_KEEP
+    MEASURE_METER_SAMPLE            //one CC reading now
+} measure_op_t;
+
+#define MEASURE_KEEP         0xFFFF
+
+typedef struct
+{
+    bool ok;                        //the change was valid and made
+    const cell_topology_t *topology;
+    bms_cc_cal_t cc_cal;
+    uint16_t cc_deadband_mA;
+    float learned_mAh;
+    float soh_percent;
+    uint16_t cycles;
+    uint16_t learn_count;
+    uint8_t stats_cells;            //cell_stats_t fields
+    uint8_t stats_count;
+    uint8_t stats_window;
+    uint8_t stats_decimate;
+    cell_stat_t stats[CELL_STATS_MAX_CELLS];
+    float imbalance_mV;
+    uint8_t weakest;
+    power_t power;
+    uint16_t idle_after_s;
+    uint8_t meter_mode;
+    uint16_t meter_period_s;
+    cc_meter_t meter;
+} measure_reply_t;
+
+typedef struct
+{
+    uint8_t op;                     //measure_op_t
+    uint16_t value;
+    uint16_t value2;
+    measure_reply_t *reply;         //filled in before the console is notified, NULL for MEASURE_WAKE
+} measure_request_t;
+
+//Protection timing for "tasks", from the wake-up of a poll. Each field is
+//one word written by the protection task only.
+typedef struct
+{
+    uint16_t poll_max_us;           //SYS_STAT read and checked, no fault
+    uint16_t fault_last_us;         //fault seen, FETs read back off and SYS_STAT cleared
+    uint16_t fault_max_us;
+    uint16_t lock_wait_max_us;      //blocked on afe_mutex by a lower priority task
+    uint16_t faults;                //fault events since boot
+} protect_stats_t;
 
-static void taskBQ76920_Run(void *pvParameters);
+static task_context_t protect_ctx = { NULL, SUPERVISOR_NONE, 0 };
+static task_context_t measure_ctx = { NULL, SUPERVISOR_NONE, 0 };
+static task_context_t telemetry_ctx = { NULL, SUPERVISOR_NONE, 0 };
+static task_context_t console_ctx = { NULL, SUPERVISOR_NONE, 0 };
+static task_context_t *bus_owner = NULL;    //holder of afe_mutex, for i2c_activity()
+static SemaphoreHandle_t afe_mutex;
+static SemaphoreHandle_t uart_mutex;
+static QueueHandle_t telemetry_queue;
+static QueueHandle_t measure_requests;
+static uint16_t telemetry_dropped = 0;
+static protect_stats_t protect_stats;
+
+static void protection_task(void *pvParameters);
+static void measurement_task(void *pvParameters);
+static void telemetry_task(void *pvParameters);
+static void console_task(void *pvParameters);
+static void afe_lock(task_context_t *ctx);
+static void afe_unlock(void);
+static void uart_lock(void);
+static void uart_unlock(void);
+static void telemetry_post(const telemetry_msg_t *msg);
+static void telemetry_text(const char *text);
+static void send_telemetry(const telemetry_msg_t *msg);
+static void poll_status(void);
+static bool handle_faults(uint8_t faults);
+static uint16_t cycles_to_us(uint32_t cycles);
+static void measure_apply(const measure_request_t *req);
+static bool measure_request(uint8_t op, uint16_t value, uint16_t value2, measure_reply_t *reply);
+static bool switch_clock_profile(clock_profile_t profile);
+static bool tasks_command(const cmd_args_t *args);
+static size_t uart_read_line(char *line, size_t size, TickType_t timeout_ticks);
+static void change_baud_rate(uint32_t baud);
+static bool status_command(const cmd_args_t *args);
+static bool write_command(const cmd_args_t *args);
+static bool read_command(const cmd_args_t *args);
+static bool baud_command(const cmd_args_t *args);
+static bool help_command(const cmd_args_t *args);
+static bool change_clock_profile(const cmd_args_t *args);
+static bool i2c_speed_and_timing(const cmd_args_t *args);
+static bool select_soc_engine(const cmd_args_t *args);
+static bool sample_rate_command(const cmd_args_t *args);
+static bool power_command(const cmd_args_t *args);
+static bool meter_command(const cmd_args_t *args);
+static uint16_t sampling_period_ms(void);
+static void read_trip_points(uint16_t *uv_mV, uint16_t *ov_mV);
+static void update_sampling(float current_A, const cell_frame_t *frame, uint16_t uv_mV,
+                            uint16_t ov_mV, float dt_sec);
+static void start_soc_ekf(void);
+static void update_soc_ekf(float current_A, float dt_sec, uint16_t cell_mV);
+static bool read_cc_raw(int16_t *cc_value);
+static bool cc_fets_off(void);
+static void load_stored_settings(void);
+static void save_stored_settings(void);
+static void flush_stored_settings(void);
+static void calibrate_cc_offset(void);
+static void cc_offset_updated(void);
+static bool cc_offset_command(const cmd_args_t *args);
+static void learn_from_anchor(float anchor_soc);
+static void send_capacity(float learned_mAh, float soh_percent, uint16_t cycles, uint16_t updates);
+static bool capacity_command(const cmd_args_t *args);
 static void enable_BQ76920(void);
 static void read_adc_gain_and_offset(void);
+static bool write_register(uint8_t reg, uint8_t value);
+static bool read_registers(uint8_t reg, uint8_t *data, uint8_t len);
+static bool flush_registers(void);
+static void scrub_registers(void);
+static void check_device_reset(uint8_t sys_stat);
+static bool set_power_state(uint8_t state, uint8_t reason, uint32_t start);
+static bool enter_ship_mode(uint8_t ctrl1, uint8_t ctrl2);
+static bool check_load_present(void);
+static void update_power_state(float current_A, float dt_sec);
+static bool cc_oneshot(void);
+static uint8_t meter_ctrl2(uint8_t state, uint8_t ctrl2);
+static bool set_meter_mode(uint8_t mode);
+static bool meter_reading_due(TickType_t now);
+static bool read_frame_oneshot(cell_frame_t *frame);
+static void set_activity(task_context_t *ctx, uint16_t code);
+static void i2c_activity(uint8_t reg);
 static void execute_uart_command(const char *line);
-static void send_uart_hex_bytes(uint8_t *data, uint8_t len);
+static void execute_batch(const char *line);
+static bool parse_read_range(const char *arg1, const char *arg2, uint8_t *reg, uint16_t *len);
+static void send_register_range(uint8_t reg, uint16_t len, bool compact);
+static void batch_item(uint8_t *items);
+static void send_raw_suffix(uint16_t raw_value);
+static void send_cell_voltage(const cell_topology_t *t, uint8_t cell, const cell_frame_t *frame);
 static void read_and_send_status(void);
-void read_external_temp(void);
+static bool select_cell_count(uint8_t cells);
+static bool cell_count_command(const cmd_args_t *args);
+static bool read_frame(const cell_topology_t *t, cell_frame_t *frame);
+static uint16_t average_cell_mV(const cell_topology_t *t, const cell_frame_t *frame);
+static void anchor_soc_from_ocv(bool at_rest);
+static void feed_cell_stats(const cell_frame_t *frame);
+static void send_cell_stats(const measure_reply_t *m);
+static bool cell_stats_command(const cmd_args_t *args);
+static void send_external_temp(uint16_t raw_value);
 void update_soc_from_cc(void);
+static void publish_measurement(void);
+
+//UART commands. Handlers run in the console task only: the parser is
+//reentrant, the state they change is not.
+static const cmd_entry_t commands[] =
+{
+    { CMD_KEY("g"),     "g",     "",    status_command,       "g" },
+    { CMD_KEY("read"),  "read",  "Ww",  read_command,         "read <reg> <len> | read <first>-<last>" },
+    { CMD_KEY("write"), "write", "NN",  write_command,        "write <reg> <value>" },
+    { CMD_KEY("baud"),  "baud",  "n",   baud_command,         "baud [<rate>]" },
+    { CMD_KEY("clock"), "clock", "w",   change_clock_profile, "clock [low|fast|auto]" },
+    { CMD_KEY("i2c"),   "i2c",   "w",   i2c_speed_and_timing, "i2c [<speed>|reset]" },
+    { CMD_KEY("soc"),   "soc",   "w",   select_soc_engine,    "soc [cc|ekf]" },
+    { CMD_KEY("cc"),    "cc",    "wn",  cc_offset_command,    "cc [cal|deadband <mA>]" },
+    { CMD_KEY("cap"),   "cap",   "w",   capacity_command,     "cap [reset]" },
+    { CMD_KEY("cells"), "cells", "n",   cell_count_command,   "cells [<n>]" },
+    { CMD_KEY("stats"), "stats", "wnn", cell_stats_command,   "stats [reset|window <n> [<snapshots>]]" },
+    { CMD_KEY("rate"),  "rate",  "w",   sample_rate_command,  "rate [auto|idle|normal|fast]" },
+    { CMD_KEY("power"), "power", "wn",  power_command,        "power [active|idle|ship|auto <s>]" },
+    { CMD_KEY("meter"), "meter", "wn",  meter_command,        "meter [continuous|periodic [<s>]|oneshot|sample]" },
+    { CMD_KEY("crash"), "crash", "w",   crash_command,        "crash [clear|test]" },
+    { CMD_KEY("trace"), "trace", "",    trace_command,        "trace" },
+    { CMD_KEY("cpu"),   "cpu",   "",    heartbeat_command,    "cpu" },
+    { CMD_KEY("tasks"), "tasks", "",    tasks_command,        "tasks" },
+    { CMD_KEY("help"),  "help",  "w",   help_command,         "help [<command>]" },
+};
+#define COMMAND_COUNT   ((uint8_t)(sizeof(commands) / sizeof(commands[0])))
+
+static const task_def_t task_defs[] =
+{
+    { protection_task,  "protect", PROTECT_STACK_WORDS,   PROTECT_PRIORITY,   PROTECT_TIMEOUT_MS,   TRACE_TASK_PROTECT,   &protect_ctx },
+    { measurement_task, "measure", MEASURE_STACK_WORDS,   MEASURE_PRIORITY,   MEASURE_TIMEOUT_MS,   TRACE_TASK_MEASURE,   &measure_ctx },
+    { telemetry_task,   "telem",   TELEMETRY_STACK_WORDS, TELEMETRY_PRIORITY, TELEMETRY_TIMEOUT_MS, TRACE_TASK_TELEMETRY, &telemetry_ctx },
+    { console_task,     "console", CONSOLE_STACK_WORDS,   CONSOLE_PRIORITY,   CONSOLE_TIMEOUT_MS,   TRACE_TASK_CONSOLE,   &console_ctx },
+};
+#define TASK_COUNT      ((uint8_t)(sizeof(task_defs) / sizeof(task_defs[0])))
 
 
 //Initialize tasks
 void taskBQ76920_init(void)
 {
-    BaseType_t result = xTaskCreate(taskBQ76920_Run, "BQ76920", 512, NULL, 1, NULL);
-    if (result != pdPASS)
+    meas_snapshot_init(&snapshot);
+    sample_rate_init(&sampling, SAMPLE_TIER_NORMAL);
+    afe_mutex = xSemaphoreCreateMutex();
+    uart_mutex = xSemaphoreCreateMutex();
+    telemetry_queue = xQueueCreate(TELEMETRY_QUEUE_LENGTH, sizeof(telemetry_msg_t));
+    measure_requests = xQueueCreate(1, sizeof(measure_request_t));
+    if (afe_mutex == NULL || uart_mutex == NULL || telemetry_queue == NULL || measure_requests == NULL)
     {
-        uart1_send_string("FAILED TO CREATE BQ76920 TASK\r\n");
+        uart1_send_string("FAILED TO CREATE BQ76920 QUEUES\r\n");
+        return;
     }
-    else
+
+    for (const task_def_t *def = task_defs; def < task_defs + TASK_COUNT; def++)
     {
-        uart1_send_string("Created BQ76920 Task\r\n");
+        if (xTaskCreate(def->run, def->name, def->stack_words, NULL, def->priority,
+                        &def->context->handle) != pdPASS)
+        {
+            uart1_send_string("FAILED TO CREATE TASK ");
+            uart1_send_string(def->name);
+            uart1_send_string("\r\n");
+            continue;
+        }
+        vTaskSetApplicationTaskTag(def->context->handle, (TaskHookFunction_t)(uintptr_t)def->trace_id);
+        def->context->watchdog_id = watchdog_register(def->name, def->timeout_ms);
     }
+    uart1_send_string("Created BQ76920 Tasks\r\n");
 }
 
 
-//task loop
-static void taskBQ76920_Run(void* pvParameters)
+//Brings the BQ76920 up, then polls SYS_STAT every PROTECT_PERIOD_MS and
+//scrubs the configuration every AFE_SCRUB_MS
+static void protection_task(void *pvParameters)
 {
-    (void)pvParameters;
-    char line[64];
+    TickType_t wake;
 
+    (void)pvParameters;
     vTaskDelay(pdMS_TO_TICKS(1000));
+    watchdog_checkin(protect_ctx.watchdog_id, ACTIVITY_BOOT);
+    afe_lock(&protect_ctx);
+    set_activity(&protect_ctx, ACTIVITY_BOOT);
+    afe_shadow_init(&afe_shadow);
     enable_BQ76920();
     read_adc_gain_and_offset();
+    afe_shadow_configured(&afe_shadow);
+    scrub_registers();      //learns the registers not written yet
+    afe_unlock();
+    xTaskNotifyGive(measure_ctx.handle);
 
+    wake = xTaskGetTickCount();
     while (1)
     {
-        size_t i = 0;
-        const TickType_t timeout_ticks = pdMS_TO_TICKS(2000); // 2 seconds
-        TickType_t start = xTaskGetTickCount();
-
-        //Clear overrun if needed
-        if (U1STAbits.OERR)
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(PROTECT_PERIOD_MS));
+        watchdog_checkin(protect_ctx.watchdog_id, ACTIVITY_STATUS);
+        poll_status();
+        if ((xTaskGetTickCount() - last_scrub_tick) >= pdMS_TO_TICKS(AFE_SCRUB_MS))
         {
-            U1STAbits.OERR = 0; //Clear Overrun Error
-            uart1_send_string("UART Overrun cleared\r\n");
+            afe_lock(&protect_ctx);
+            set_activity(&protect_ctx, ACTIVITY_SCRUB);
+            scrub_registers();
+            afe_unlock();
         }
+    }
+}
 
-        memset(line, 0, sizeof(line)); //Clear buffer before receiving
 
-        while (i < sizeof(line) - 1)
-        {
-            if (UART1_IsRxReady())
-            {
-                char c = UART1_Read();
-                if (c == '\r' || c == '\n') break;
-                if (c >= 32 && c <= 126) line[i++] = c;
-            }
-            else
-            {
-                vTaskDelay(pdMS_TO_TICKS(1));
-            }
+//Starts once the protection task has configured the BQ76920, then updates
+//at the period of the current sampling tier. Requests from commands are
+//served in between. The integration uses the measured tick interval, so
+//serving one early or late, or changing the period, leaves no time
+//uncounted.
+static void measurement_task(void *pvParameters)
+{
+    measure_request_t req;
+    TickType_t last;
 
-            if ((xTaskGetTickCount() - start) > timeout_ticks)
-            {
-                //uart1_send_string("UART Timeout...\r\n");
-                i = 0; //Clear buffer
-                break;
-            }
-        }
+    (void)pvParameters;
+    while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) == 0)
+    {
+        watchdog_checkin(measure_ctx.watchdog_id, ACTIVITY_CC_CAL);
+    }
+    set_activity(&measure_ctx, ACTIVITY_CC_CAL);
+    cap_learn_init(&capacity, BATTERY_CAPACITY_MAH, BATTERY_CHEMISTRY);
+    cc_meter_init(&meter);
+    load_stored_settings();
+    if (!select_cell_count((uint8_t)stored.cell_count) && !select_cell_count(BATTERY_CELLS))
+    {
+        telemetry_text("Invalid BATTERY_CELLS, using all inputs");
+        select_cell_count(cell_topology_inputs(BMS_AFE));
+    }
+    calibrate_cc_offset();
+    if (meter_mode != CC_METER_CONTINUOUS && !set_meter_mode(meter_mode))
+    {
+        telemetry_text("Metering mode not set, continuous");
+        afe_lock(&measure_ctx);
+        meter_mode = CC_METER_CONTINUOUS;
+        afe_unlock();
+    }
+    anchor_soc_from_ocv(false);  //start from the cell voltages instead of assuming 100 %
+    start_soc_ekf();
+    publish_measurement();
+    xTaskNotifyGive(console_ctx.handle);
+
+    last = xTaskGetTickCount();
+    while (1)
+    {
+        TickType_t period = pdMS_TO_TICKS(sampling_period_ms());
+        TickType_t elapsed = xTaskGetTickCount() - last;
+        TickType_t left = (elapsed < period) ? period - elapsed : 0;
 
-        line[i] = '\0';
-        
+        flush_stored_settings();
+        watchdog_checkin(measure_ctx.watchdog_id, ACTIVITY_CC);
+        if (xQueueReceive(measure_requests, &req, left) == pdPASS)
+        {
+            set_activity(&measure_ctx, ACTIVITY_REQUEST);
+            measure_apply(&req);
+            publish_measurement();
+            if (req.reply != NULL) xTaskNotifyGive(console_ctx.handle);
+            //Leaving Idle: the ADC and CC have a conversion in one fast period
+            if (req.op == MEASURE_WAKE) last = xTaskGetTickCount();
+            continue;
+        }
+        //On time: keep the schedule. Overran, or the period just got
+        //shorter than the time already waited: start again from now.
+        last = (elapsed < period) ? last + period : xTaskGetTickCount();
+        set_activity(&measure_ctx, ACTIVITY_CC);
         update_soc_from_cc();   //polling the Coulomb Counter
-        
-        if (i > 0)
+    }
+}
+
+
+//Formats queued reports onto the UART, one message per hold of the UART
+static void telemetry_task(void *pvParameters)
+{
+    telemetry_msg_t msg;
+    uint16_t dropped_seen = 0;
+
+    (void)pvParameters;
+    while (1)
+    {
+        watchdog_checkin(telemetry_ctx.watchdog_id, ACTIVITY_TELEMETRY);
+        if (xQueueReceive(telemetry_queue, &msg, pdMS_TO_TICKS(TELEMETRY_IDLE_MS)) != pdPASS) continue;
+
+        set_activity(&telemetry_ctx, (uint16_t)(ACTIVITY_TELEMETRY | msg.type));
+        uart_lock();
+        if (telemetry_dropped != dropped_seen)
         {
-            execute_uart_command(line);
+            dropped_seen = telemetry_dropped;
+            uart1_send_string("Telemetry: ");
+            uart1_send_u16(dropped_seen);
+            uart1_send_string(" messages dropped since boot\r\n");
         }
+        send_telemetry(&msg);
+        uart_unlock();
     }
 }
 
 
-//Enables various functions by ensuring that certain bits within registers
-//are set correctly
-static void enable_BQ76920(void)
+//Reads command lines and runs them, holding the UART for each whole reply
+//so telemetry lines don't land inside it
+static void console_task(void *pvParameters)
 {
-    I2C1_MESSAGE_STATUS status;
-    uint8_t data[2];
+    char line[UART_LINE_BYTES];
+    uint16_t lost_seen = 0;
 
-    //Enable ADC, TS1 temperature, and Coulomb Counter
-    data[0] = SYS_CTRL1_REG;
-    data[1] = 0x19;
-    I2C1_MasterWrite(data, 2, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    if (status != I2C1_MESSAGE_COMPLETE)
+    (void)pvParameters;
+    //Commands report measurement state, which exists after the boot calibration
+    while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) == 0)
     {
-        uart1_send_string("Enable SYS_CTRL1 failed!\r\n");
-        I2C1_Initialize();
+        watchdog_checkin(console_ctx.watchdog_id, ACTIVITY_UART);
     }
 
-    vTaskDelay(pdMS_TO_TICKS(2));  // small delay
+    while (1)
+    {
+        watchdog_checkin(console_ctx.watchdog_id, ACTIVITY_UART);
+        set_activity(&console_ctx, ACTIVITY_UART);
+        size_t i = uart_read_line(line, sizeof(line), pdMS_TO_TICKS(2000)); // 2 seconds
 
-    //Enable CHG and DSG FETs
-    data[0] = SYS_CTRL2_REG;
-    data[1] = 0xC0;
-    I2C1_MasterWrite(data, 2, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    if (status != I2C1_MESSAGE_COMPLETE)
-        uart1_send_string("Enable SYS_CTRL2 failed!\r\n");
+        uart_lock();
+        //The RX interrupt clears overruns, a line that lost bytes is reported
+        if (UART1_RxLostCountGet() != lost_seen)
+        {
+            lost_seen = UART1_RxLostCountGet();
+            uart1_send_string("UART: ");
+            uart1_send_u16(lost_seen);
+            uart1_send_string(" received bytes lost since boot\r\n");
+        }
+        if (i > 0)
+        {
+            set_activity(&console_ctx, ACTIVITY_COMMAND);
+            command_seen = true;
+            execute_uart_command(line);
+        }
+        switch_clock_profile(clock_profile_service());
+        uart_unlock();
+    }
 }
 
 
-//Extract ADC gain and offset calibration values from BQ76920
-static void read_adc_gain_and_offset(void)
+//The AFE lock is held for one I2C exchange, burst or shadow update at a
+//time (a measurement frame is the longest, about 4 ms at 100 kHz), never
+//across UART output, so the protection task waits for at most one of them
+//from a lower priority task (which inherits its priority)
+static void afe_lock(task_context_t *ctx)
 {
-    I2C1_MESSAGE_STATUS status;
-    uint8_t gain1 = 0, gain2 = 0, offset = 0;
-    uint8_t reg;
+    xSemaphoreTake(afe_mutex, portMAX_DELAY);
+    bus_owner = ctx;
+}
 
-    reg = ADCGAIN1_REG;
-    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    I2C1_MasterRead(&gain1, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
 
-    reg = ADCOFFSET_REG;
-    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    I2C1_MasterRead(&offset, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
+static void afe_unlock(void)
+{
+    xSemaphoreGive(afe_mutex);
+}
 
-    reg = ADCGAIN2_REG;
-    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    I2C1_MasterRead(&gain2, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
 
-    adc_gain_uV = (((gain2 >> 2) & 0x03) << 3 | (gain1 & 0x07)) + 365;
-    adc_offset_mV = (int8_t)offset;
+static void uart_lock(void)
+{
+    xSemaphoreTake(uart_mutex, portMAX_DELAY);
 }
 
-//Handle read/write UART commands
-static void execute_uart_command(const char *line)
-{
-    char cmd_buf[64];
-    strncpy(cmd_buf, line, sizeof(cmd_buf));
-    cmd_buf[sizeof(cmd_buf) - 1] = '\0';
 
-    uart1_send_string("CMD Received: ");
-    uart1_send_string(cmd_buf);
-    uart1_send_string("\r\n");
+static void uart_unlock(void)
+{
+    xSemaphoreGive(uart_mutex);
+}
 
-    char *cmd = strtok(cmd_buf, " ");
-    if (!cmd) {
-        uart1_send_string("CMD Parse Error\r\n");
-        return;
-    }
 
-    if (strcmp(cmd, "g") == 0) {
-        uart1_send_string("Status Triggered\r\n");
-        read_and_send_status();
-    }
-    else if (strcmp(cmd, "write") == 0) {
-        char *arg1 = strtok(NULL, " ");
-        char *arg2 = strtok(NULL, " ");
-        if (arg1 && arg2) {
-            uint8_t reg = (uint8_t)strtol(arg1, NULL, 0);
-            uint8_t val = (uint8_t)strtol(arg2, NULL, 0);
-            uint8_t data[2] = { reg, val };
-            I2C1_MESSAGE_STATUS status;
-            I2C1_MasterWrite(data, 2, BQ76920_I2C_ADDR, &status);
-            while (status == I2C1_MESSAGE_PENDING);
-            uart1_send_string((status == I2C1_MESSAGE_COMPLETE) ? "ACK\r\n" : "WRITE FAIL\r\n");
-        } else {
-            uart1_send_string("Invalid write format\r\n");
-        }
-    }
-    else if (strcmp(cmd, "read") == 0) {
-        char *arg1 = strtok(NULL, " ");
-        char *arg2 = strtok(NULL, " ");
-        if (arg1 && arg2) {
-            uint8_t reg = (uint8_t)strtol(arg1, NULL, 0);
-            uint8_t len = (uint8_t)strtol(arg2, NULL, 0);
-            if (len > 8) len = 8;
-            uint8_t buffer[8];
-            I2C1_MESSAGE_STATUS status;
-            I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-            while (status == I2C1_MESSAGE_PENDING);
-            if (status != I2C1_MESSAGE_COMPLETE) {
-                uart1_send_string("READ CMD FAIL\r\n"); return;
-            }
-            I2C1_MasterRead(buffer, len, BQ76920_I2C_ADDR, &status);
-            while (status == I2C1_MESSAGE_PENDING);
-            (status == I2C1_MESSAGE_COMPLETE) ? send_uart_hex_bytes(buffer, len) : uart1_send_string("READ FAIL\r\n");
-        } else {
-            uart1_send_string("Invalid read format\r\n");
-        }
-    }
-    else {
-        uart1_send_string("Unknown command\r\n");
+static void telemetry_post(const telemetry_msg_t *msg)
+{
+    if (xQueueSend(telemetry_queue, msg, 0) != pdPASS)
+    {
+        taskENTER_CRITICAL();   //posted from two priorities
+        telemetry_dropped++;
+        taskEXIT_CRITICAL();
     }
 }
 
 
-//Print bytes as hexadecimal values over UART
-static void send_uart_hex_bytes(uint8_t *data, uint8_t len)
+//A fixed line; text has to outlive the queue (a string literal)
+static void telemetry_text(const char *text)
 {
-    char buf[16];
-    for (uint8_t i = 0; i < len; i++) {
-        sprintf(buf, "0x%02X ", data[i]);
-        uart1_send_string(buf);
-    }
-    uart1_send_string("\r\n");
+    telemetry_msg_t msg = { TELEMETRY_TEXT, 0, 0, 0, text, 0.0f, 0.0f, 0 };
+    telemetry_post(&msg);
 }
 
 
-//Function is called when user sends 'g' in GUI to get a general status update
-//of the battery pack (Cell voltages, pack voltage)
-static void read_and_send_status(void)
+static void send_telemetry(const telemetry_msg_t *msg)
 {
-    I2C1_MESSAGE_STATUS status;
-    uint8_t reg;
-    uint8_t buffer[10]; //need to store 10 bytes of data (VC1_HIGH_BYTE - VC5_LOW_BYTE)
-    char uart_buf[64];
-    uint16_t raw_value;
-    uint32_t voltage_mV;
+    static const char *const fault_names[5] = { "OCD", "SCD", "OV", "UV", "ALERT" };
+    static const char *const anchor_names[4] =
+    {
+        "SoC from OCV: ", "SoC re-anchored at rest: ", "OCV at rest: ",
+        "SoC OCV skipped: flat region ("
+    };
 
-    uart1_send_string("\r\n======== BQ76920 Status ========\r\n");
-    //Calculate individual cell voltages
-    reg = VC1_HI_REG;
-    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    if (status == I2C1_MESSAGE_COMPLETE)
+    switch (msg->type)
     {
-        I2C1_MasterRead(buffer, 10, BQ76920_I2C_ADDR, &status);
-        while (status == I2C1_MESSAGE_PENDING);
-        if (status == I2C1_MESSAGE_COMPLETE)
+    case TELEMETRY_TEXT:
+        uart1_send_string(msg->text);
+        uart1_send_string("\r\n");
+        break;
+    case TELEMETRY_MEASUREMENT:
+        //raw/tick are appended so a captured UART log can be replayed offline
+        uart1_send_string("Current: ");
+        uart1_send_float(msg->a, 2);
+        uart1_send_string(" A | SoC: ");
+        uart1_send_float(msg->b, 2);
+        uart1_send_string(" % (raw: 0x");
+        uart1_send_hex(msg->value, 4);
+        uart1_send_string(", tick: ");
+        uart1_send_u32(msg->tick);
+        uart1_send_string(")\r\n");
+        break;
+    case TELEMETRY_CC_OFFSET:
+        uart1_send_string("CC offset: ");
+        uart1_send_float(msg->a, 4);
+        uart1_send_string(" LSB\r\n");
+        break;
+    case TELEMETRY_ANCHOR:
+        uart1_send_string(anchor_names[msg->flags]);
+        if (msg->flags != ANCHOR_SKIPPED)
         {
-            uart1_send_string("Cell Voltages:\r\n");
-            for (int i = 0; i < 2; i++) //this loop would ideally cover all 3 cells at once,
-                    //but since VC2 through VC4 were all shorted per data sheet for a 3-cell
-                    //configuration, VC3 and VC4 needed to be skipped
+            uart1_send_float(msg->a, 2);
+            uart1_send_string(" % (");
+        }
+        uart1_send_string("cell avg ");
+        uart1_send_u16(msg->value);
+        uart1_send_string(" mV)\r\n");
+        break;
+    case TELEMETRY_FULL_CHARGE:
+        uart1_send_string("Full charge (cell avg ");
+        uart1_send_u16(msg->value);
+        uart1_send_string(" mV)\r\n");
+        break;
+    case TELEMETRY_CAPACITY:
+        uart1_send_string("Capacity learned: ");
+        send_capacity(msg->a, msg->b, msg->value, msg->value2);
+        break;
+    case TELEMETRY_SCRUB:
+        uart1_send_string("BQ76920 scrub: ");
+        uart1_send_u16(msg->value);
+        uart1_send_string(msg->flags ? " registers rewritten\r\n" : " registers wrong, rewrite failed\r\n");
+        break;
+    case TELEMETRY_RESTORED:
+        uart1_send_string("BQ76920 restored in ");
+        uart1_send_u32(msg->tick);
+        uart1_send_string(" ms (");
+        uart1_send_u16(msg->value);
+        uart1_send_string(" resets since boot), FETs left off\r\n");
+        break;
+    case TELEMETRY_FAULT:
+        uart1_send_string("BQ76920 fault:");
+        for (uint8_t n = 0; n < 5; n++)
+        {
+            if (msg->flags & (1u << n))
             {
-                raw_value = (buffer[i * 2] << 8) | buffer[i * 2 + 1];   //get raw value
-                voltage_mV = ((uint32_t)raw_value * adc_gain_uV) / 1000 + adc_offset_mV; //convert raw to voltage (mV)
-                sprintf(uart_buf, (raw_value < 10 || voltage_mV > 5000) ?
-                    "  C%d: ERROR (raw: 0x%04X)\r\n" :      
-                    "  C%d: %lu mV (raw: 0x%04X)\r\n",
-                    i + 1, (raw_value < 10 || voltage_mV > 5000) ? raw_value : voltage_mV, raw_value);
-                uart1_send_string(uart_buf); //to display on GUI using UART
+                UART1_Write(' ');
+                uart1_send_string(fault_names[n]);
             }
-            
-            int i = 4; //Display VC5. Uses same code in for loop above, just need i = 4 now
-            raw_value = (buffer[i * 2] << 8) | buffer[i * 2 + 1];
-            voltage_mV = ((uint32_t)raw_value * adc_gain_uV) / 1000 + adc_offset_mV;
-            sprintf(uart_buf, (raw_value < 10 || voltage_mV > 5000) ?
-                "  C%d: ERROR (raw: 0x%04X)\r\n" :
-                "  C%d: %lu mV (raw: 0x%04X)\r\n",
-                i + 1, (raw_value < 10 || voltage_mV > 5000) ? raw_value : voltage_mV, raw_value);
-            uart1_send_string(uart_buf);
         }
+        uart1_send_string(msg->value2 ? ", FETs off in " : ", FETs not confirmed off after ");
+        uart1_send_u32(msg->tick);
+        uart1_send_string(" us (");
+        uart1_send_u16(msg->value);
+        uart1_send_string(" since boot)\r\n");
+        break;
+    case TELEMETRY_POWER:
+        uart1_send_string("Power: ");
+        uart1_send_string(power_state_name(msg->flags));
+        uart1_send_string(" (");
+        uart1_send_string(power_reason_name((uint8_t)msg->value));
+        uart1_send_string(") in ");
+        uart1_send_u32(msg->tick);
+        uart1_send_string(" us\r\n");
+        break;
+    default:
+        break;
     }
+}
 
-    //Pack Voltage Calculate and Display
-    reg = BAT_HI_REG;
-    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    if (status == I2C1_MESSAGE_COMPLETE)
+
+//Collect one printable line from UART1. Returns its length, or 0 if nothing
+//complete arrived before the timeout (partial input is discarded). Bytes
+//wait in the driver's receive queue while this task sleeps or is preempted.
+static size_t uart_read_line(char *line, size_t size, TickType_t timeout_ticks)
+{
+    size_t i = 0;
+    TickType_t start = xTaskGetTickCount();
+
+    memset(line, 0, size); //Clear buffer before receiving
+
+    while (i < size - 1)
     {
-        I2C1_MasterRead(buffer, 2, BQ76920_I2C_ADDR, &status);
-        while (status == I2C1_MESSAGE_PENDING);
-        if (status == I2C1_MESSAGE_COMPLETE)
+        if (UART1_IsRxReady())
+        {
+            char c = UART1_Read();
+            if (c == '\r' || c == '\n') break;
+            if (c >= 32 && c <= 126) line[i++] = c;
+        }
+        else
         {
-            raw_value = (buffer[0] << 8) | buffer[1];
-            voltage_mV = (uint32_t)raw_value * 1.9f;  //BAT_HI/LO = 1.9 mV/LSB
-            sprintf(uart_buf, "Pack Voltage: %lu mV (raw: 0x%04X)\r\n", voltage_mV, raw_value);
-            uart1_send_string(uart_buf);
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+
+        if ((xTaskGetTickCount() - start) > timeout_ticks)
+        {
+            //uart1_send_string("UART Timeout...\r\n");
+            i = 0; //Clear buffer
+            break;
         }
     }
-    
-    read_external_temp(); //adds thermister temperature to output
-    
-    uart1_send_string("================================\r\n"); //formatting
+
+    line[i] = '\0';
+    return i;
+}
+
+
+//The register helpers below, down to read_adc_gain_and_offset(), use the
+//I2C bus and the shadow: callers hold the AFE lock. poll_status() takes it
+//itself.
+
+//Enables various functions by ensuring that certain bits within registers
+//are set correctly
+static void enable_BQ76920(void)
+{
+    //Enable ADC, TS1 temperature, and Coulomb Counter
+    afe_shadow_stage(&afe_shadow, SYS_CTRL1_REG, 0x19);
+    if (!flush_registers())
+    {
+        telemetry_text("Enable SYS_CTRL1 failed!");
+        I2C1_Initialize();
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(2));  // small delay
+
+    //Enable CHG and DSG FETs
+    afe_shadow_stage(&afe_shadow, SYS_CTRL2_REG, 0xC0);
+    if (!flush_registers())
+        telemetry_text("Enable SYS_CTRL2 failed!");
+
+    //The power-on DEVICE_XREADY is not a reset to recover from
+    write_register(AFE_SYS_STAT_REG, AFE_SYS_STAT_DEVICE_XREADY);
+}
+
+
+//Direct write of a register the shadow doesn't hold (SYS_STAT, test
+//registers), or of bits it doesn't (CC_ONESHOT, the SHIP sequence).
+//Configuration registers are staged with afe_shadow_stage().
+static bool write_register(uint8_t reg, uint8_t value)
+{
+    I2C1_MESSAGE_STATUS status;
+    uint8_t data[2] = { reg, value };
+
+    i2c_activity(reg);
+    I2C1_MasterWrite(data, 2, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    return status == I2C1_MESSAGE_COMPLETE;
 }
 
 
-//Read and calculate external thermister temperature and send to GUI
-void read_external_temp(void)
+static bool read_registers(uint8_t reg, uint8_t *data, uint8_t len)
 {
     I2C1_MESSAGE_STATUS status;
-    uint8_t reg = TS1_HI_REG;
-    uint8_t buffer[2];
-    uint16_t raw_value;
-    float v_ts1, r_therm, temp_c;
-    char uart_buf[128];
 
-    //Read TS1
+    i2c_activity(reg);
     I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
     while (status == I2C1_MESSAGE_PENDING);
-    if (status != I2C1_MESSAGE_COMPLETE) return;
+    if (status != I2C1_MESSAGE_COMPLETE) return false;
 
-    I2C1_MasterRead(buffer, 2, BQ76920_I2C_ADDR, &status);
+    I2C1_MasterRead(data, len, BQ76920_I2C_ADDR, &status);
     while (status == I2C1_MESSAGE_PENDING);
-    if (status != I2C1_MESSAGE_COMPLETE) return;
+    return status == I2C1_MESSAGE_COMPLETE;
+}
+
+
+//Writes each run of dirty shadow registers as one auto-increment burst and
+//reads it back. Stops at the first failure or mismatch; whatever is still
+//dirty goes out with the next flush. True when the shadow is clean.
+static bool flush_registers(void)
+{
+    I2C1_MESSAGE_STATUS status;
+    uint8_t data[1 + AFE_CONFIG_REGS];
+    uint8_t readback[AFE_CONFIG_REGS];
+    const uint8_t *values;
+    uint8_t reg, count;
+
+    while ((values = afe_shadow_next_burst(&afe_shadow, &reg, &count)) != NULL)
+    {
+        data[0] = reg;
+        memcpy(&data[1], values, count);
+        i2c_activity(reg);
+        I2C1_MasterWrite(data, 1 + count, BQ76920_I2C_ADDR, &status);
+        while (status == I2C1_MESSAGE_PENDING);
+        if (status != I2C1_MESSAGE_COMPLETE) return false;
+        afe_shadow_flushed(&afe_shadow, reg, count);
 
-    raw_value = (buffer[0] << 8) | buffer[1];
-    v_ts1 = raw_value * 0.00005f;  //volts
+        if (!read_registers(reg, readback, count)) return false;
+        if (afe_shadow_compare(&afe_shadow, reg, readback, count) != 0) return false;
+    }
+    return true;
+}
 
-    //Calculate thermistor resistance
-    float v_bias = 2.5f;         //REGOUT
-    float r_pullup = 10000.0f;   //10k resistor from REGOUT to TS1
-    r_therm = (v_ts1 * r_pullup) / (v_bias - v_ts1);
 
-    //Beta model temperature calculation
-    float t0 = 298.15f;          //25C in Kelvin
-    float b = 3435.0f;           //Beta constant
-    float r0 = 10000.0f;         //10kOhm at 25C
+//Reads the whole configuration block (one transaction) and rewrites any
+//register that no longer holds its shadow value
+static void scrub_registers(void)
+{
+    uint8_t block[AFE_CONFIG_REGS];
+    uint8_t mismatches;
 
-    float temp_k = 1.0f / ( (1.0f / t0) + (1.0f / b) * logf(r_therm / r0) );
-    temp_c = temp_k - 273.15f;
+    last_scrub_tick = xTaskGetTickCount();
+    if (afe_shadow.state != AFE_STATE_READY) return;    //check_device_reset() owns recovery
+    if (!read_registers(AFE_CONFIG_FIRST_REG, block, AFE_CONFIG_REGS)) return;
 
-    uart1_send_string("External Temperature Sensor:\r\n");
-    snprintf(uart_buf, sizeof(uart_buf),
-        "  Voltage:    %.3f V\r\n"
-        "  Resistance: %.0f Ohms\r\n"
-        "  Temp:       %.2f C (raw: 0x%04X)\r\n",
-        v_ts1, r_therm, temp_c, raw_value);
+    mismatches = afe_shadow_compare(&afe_shadow, AFE_CONFIG_FIRST_REG, block, AFE_CONFIG_REGS);
+    if (mismatches == 0) return;
 
-    uart1_send_string(uart_buf);
+    telemetry_msg_t msg = { TELEMETRY_SCRUB, 0, mismatches, 0, NULL, 0.0f, 0.0f, 0 };
+    msg.flags = flush_registers();
+    telemetry_post(&msg);
 }
 
 
-//Use Coulomb Counter to calculate State of Charge (SoC) and display on GUI
-void update_soc_from_cc(void)
+//After a BQ76920 reset its registers are back at their defaults (ADC and
+//CC off, no protection): clear DEVICE_XREADY, re-read the calibration and
+//flush the shadow, which the reset has dirtied. A failed flush leaves the
+//reset pending, so the next poll retries. Waking from SHIP is such a
+//reset; it and any other reset come back Active.
+static void check_device_reset(uint8_t sys_stat)
 {
-    //Use TickType task to account for time delays. A Coulomb Counter can only
-    //work accurately if each updated value for current, SoC, etc. (anything using
-    //the Coulomb Counter) accounts for the time it took to display from the previous
-    //value(s). Here, the frequency of the tick rate is 1000 Hz, or 1 ms per tick.
-    TickType_t now = xTaskGetTickCount();
-    float dt_sec = (last_update_tick == 0) ? 1.0f : (now - last_update_tick) / 1000.0f;
-    last_update_tick = now;
+    TickType_t start = xTaskGetTickCount();
+    measure_request_t wake = { MEASURE_WAKE, 0, 0, NULL };
+    uint8_t ctrl1, ctrl2;
 
-    I2C1_MESSAGE_STATUS status;
-    uint8_t reg = CC_HI_REG;
-    uint8_t cc_raw[2];
-    char uart_buf[64];
+    if (!afe_shadow_check_status(&afe_shadow, sys_stat)) return;
 
-    //Read CC_HI and CC_LO
-    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    if (status != I2C1_MESSAGE_COMPLETE) return;
+    telemetry_text("BQ76920 reset detected, restoring configuration");
+    if (!write_register(AFE_SYS_STAT_REG, AFE_SYS_STAT_DEVICE_XREADY)) return;
+    read_adc_gain_and_offset();
+    ctrl1 = afe_shadow.config[SYS_CTRL1_REG - AFE_CONFIG_FIRST_REG];
+    ctrl2 = afe_shadow.config[SYS_CTRL2_REG - AFE_CONFIG_FIRST_REG];
+    afe_shadow_stage(&afe_shadow, SYS_CTRL1_REG, power_ctrl1(POWER_ACTIVE, ctrl1));
+    afe_shadow_stage(&afe_shadow, SYS_CTRL2_REG, meter_ctrl2(POWER_ACTIVE, ctrl2));
+    if (!flush_registers()) return;
+    afe_shadow_configured(&afe_shadow);
+    if (power.state != POWER_ACTIVE)
+    {
+        power_entered(&power, POWER_ACTIVE, POWER_REASON_RESET);
+        xQueueSend(measure_requests, &wake, 0);
+    }
 
-    I2C1_MasterRead(cc_raw, 2, BQ76920_I2C_ADDR, &status);
-    while (status == I2C1_MESSAGE_PENDING);
-    if (status != I2C1_MESSAGE_COMPLETE) return;
-
-    int16_t cc_value = (int16_t)((cc_raw[0] << 8) | cc_raw[1]); //signed value;
-    //Should be negative, but was having issues. Wasn't using a load tester for
-    //higher current draw, so maybe very small positive values that were yielded
-    //were the result of rounding. Fixed for now by subtracting delta_charge_mAh
-    //in line 419 below. Again, rough estimate Coulomb counter. Adjust mAh in
-    //remaining_capacity_mAh variable according to pack and battery chemistry.
-    
-    //Convert to current in Amps
-    float cc_voltage_V = (float)cc_value * coulomb_counter_gain_uV * 1e-6f;
-    float current_A = cc_voltage_V / shunt_resistance_ohm;
+    telemetry_msg_t msg = { TELEMETRY_RESTORED, 0, afe_shadow.resets, 0, NULL, 0.0f, 0.0f, 0 };
+    msg.tick = (uint32_t)(xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    telemetry_post(&msg);
+}
+
+
+//The chip has already opened the FET a fault concerns (CHG for OV, DSG for
+//the others, both for an ALERT override). Take that into the shadow so no
+//flush or scrub switches it back on, confirm it by reading SYS_CTRL2, then
+//clear the fault bits so the host can switch the FET on again once the
+//cause is gone. True if the FETs read back off.
+static bool handle_faults(uint8_t faults)
+{
+    uint8_t ctrl2 = afe_shadow.config[SYS_CTRL2_REG - AFE_CONFIG_FIRST_REG];
+    uint8_t fets = 0;
+
+    set_activity(&protect_ctx, ACTIVITY_FAULT);
+    if (faults & SYS_STAT_OV) fets |= SYS_CTRL2_CHG_ON;
+    if (faults & (SYS_STAT_UV | SYS_STAT_SCD | SYS_STAT_OCD)) fets |= SYS_CTRL2_DSG_ON;
+    if (faults & SYS_STAT_OVRD_ALERT) fets |= SYS_CTRL2_FET_MASK;
+
+    afe_shadow_stage(&afe_shadow, SYS_CTRL2_REG, (uint8_t)(ctrl2 & ~fets));
+    if (!flush_registers()) return false;
+    if (!read_registers(SYS_CTRL2_REG, &ctrl2, 1) || (ctrl2 & fets) != 0) return false;
+    return write_register(AFE_SYS_STAT_REG, faults);
+}
 
-    //Convert to charge (mAh) over elapsed time (3600.0f is # of seconds in 1 hour)
-    float delta_charge_mAh = (current_A * dt_sec * 1000.0f) / 3600.0f; 
 
-    remaining_capacity_mAh -= delta_charge_mAh; //adding a negative value for discharge
-    if (remaining_capacity_mAh > 3200.0f) remaining_capacity_mAh = 3200.0f;
-    if (remaining_capacity_mAh < 0.0f) remaining_capacity_mAh = 0.0f;
+//Writes the registers of a power state and makes it current; start is the
+//TMR2 count the change is timed from for the report. SYS_CTRL2 is read
+//first so the FET bits written back are those in effect, not a copy a
+//fault may have changed since. Caller holds the AFE lock.
+static bool set_power_state(uint8_t state, uint8_t reason, uint32_t start)
+{
+    uint8_t ctrl1 = afe_shadow.config[SYS_CTRL1_REG - AFE_CONFIG_FIRST_REG];
+    uint8_t ctrl2;
+    bool ok;
 
-    soc_percent = (remaining_capacity_mAh / 3200.0f) * 100.0f;
+    if (!read_registers(SYS_CTRL2_REG, &ctrl2, 1)) return false;
+    if (state == POWER_SHIP)
+    {
+        ok = enter_ship_mode(ctrl1, ctrl2);
+    }
+    else
+    {
+        afe_shadow_stage(&afe_shadow, SYS_CTRL1_REG, power_ctrl1(state, ctrl1));
+        afe_shadow_stage(&afe_shadow, SYS_CTRL2_REG, meter_ctrl2(state, ctrl2));
+        ok = flush_registers();
+    }
+    if (!ok) return false;
+    power_entered(&power, state, reason);
+
+    telemetry_msg_t msg = { TELEMETRY_POWER, state, reason, 0, NULL, 0.0f, 0.0f, 0 };
+    msg.tick = cycles_to_us(TMR2_Counter32BitGet() - start);
+    telemetry_post(&msg);
+    return true;
+}
+
+
+//FETs off through the shadow, so the pack is disconnected before the chip
+//goes and stays so after it wakes, then the three SHUT_A/SHUT_B writes
+//back to back. The BQ76920 turns off at the last one, REGOUT with it, and
+//answers nothing until a boot signal on TS1 resets it.
+static bool enter_ship_mode(uint8_t ctrl1, uint8_t ctrl2)
+{
+    afe_shadow_stage(&afe_shadow, SYS_CTRL2_REG, (uint8_t)(ctrl2 & ~SYS_CTRL2_FET_MASK));
+    if (!flush_registers()) return false;
+    for (uint8_t n = 0; n < POWER_SHIP_WRITES; n++)
+    {
+        if (!write_register(SYS_CTRL1_REG, power_ship_value(ctrl1, n))) return false;
+    }
+    return true;
+}
+
+
+//Idle: a load pulls CHG up and sets LOAD_PRESENT, which the chip only
+//reports while CHG is off. Checked with every SYS_STAT poll, so a load
+//brings the ADC and CC back within PROTECT_PERIOD_MS instead of the next
+//one-shot. Caller holds the AFE lock.
+static bool check_load_present(void)
+{
+    uint8_t ctrl1;
+
+    if (afe_shadow.config[SYS_CTRL2_REG - AFE_CONFIG_FIRST_REG] & SYS_CTRL2_CHG_ON) return false;
+    return read_registers(SYS_CTRL1_REG, &ctrl1, 1) && (ctrl1 & POWER_CTRL1_LOAD_PRESENT);
+}
+
+
+//One SYS_STAT read per period: recovers from a reset of the BQ76920 and
+//handles protection faults. Timed from the wake-up for "tasks"; only
+//interrupts and the transaction of a lower task holding the AFE lock can
+//delay it.
+static void poll_status(void)
+{
+    uint32_t start = TMR2_Counter32BitGet();
+    uint16_t waited, taken;
+    uint8_t sys_stat, faults = 0;
+    bool fets_off = false, woke = false;
+
+    afe_lock(&protect_ctx);
+    waited = cycles_to_us(TMR2_Counter32BitGet() - start);
+    set_activity(&protect_ctx, ACTIVITY_STATUS);
+    if (read_registers(AFE_SYS_STAT_REG, &sys_stat, 1))
+    {
+        check_device_reset(sys_stat);   //before anything relies on the BQ76920 configuration
+        if (afe_shadow.state == AFE_STATE_READY) faults = sys_stat & SYS_STAT_FAULTS;
+        if (faults != 0) fets_off = handle_faults(faults);
+        if (faults == 0 && power.state == POWER_IDLE && check_load_present())
+        {
+            woke = set_power_state(POWER_ACTIVE, POWER_REASON_LOAD, start);
+        }
+    }
+    afe_unlock();
+    taken = cycles_to_us(TMR2_Counter32BitGet() - start);
+
+    if (woke)
+    {
+        measure_request_t req = { MEASURE_WAKE, 0, 0, NULL };
+        xQueueSend(measure_requests, &req, 0);  //full: a command is pending and wakes it anyway
+    }
+
+    if (waited > protect_stats.lock_wait_max_us) protect_stats.lock_wait_max_us = waited;
+    if (faults == 0)
+    {
+        if (taken > protect_stats.poll_max_us) protect_stats.poll_max_us = taken;
+        return;
+    }
+    protect_stats.faults++;
+    protect_stats.fault_last_us = taken;
+    if (taken > protect_stats.fault_max_us) protect_stats.fault_max_us = taken;
+
+    telemetry_msg_t msg = { TELEMETRY_FAULT, faults, protect_stats.faults, fets_off, NULL, 0.0f, 0.0f, taken };
+    telemetry_post(&msg);
+}
+
+
+//TMR2/TMR3 cycles (Fcy) to us, saturating
+static uint16_t cycles_to_us(uint32_t cycles)
+{
+    uint32_t us = cycles / (CLOCK_PeripheralFrequencyGet() / 1000000UL);
+    return (us > 0xFFFF) ? 0xFFFF : (uint16_t)us;
+}
+
+
+//What a task is doing, for the watchdog record and the crash events
+static void set_activity(task_context_t *ctx, uint16_t code)
+{
+    if ((code ^ ctx->activity) & 0xFF00) trace_event(TRACE_STEP, (uint8_t)(code >> 8));
+    ctx->activity = code;
+    watchdog_activity(ctx->watchdog_id, code);
+    crash_event(code);
+}
+
+
+//About to talk to reg: keeps the step of the task holding the bus,
+//replaces the register
+static void i2c_activity(uint8_t reg)
+{
+    set_activity(bus_owner, (uint16_t)((bus_owner->activity & 0xFF00) | reg));
+}
+
+
+//Extract ADC gain and offset calibration values from BQ76920. Runs at boot
+//and after a device reset, the result is kept in afe_shadow.
+static void read_adc_gain_and_offset(void)
+{
+    I2C1_MESSAGE_STATUS status;
+    uint8_t gain1 = 0, gain2 = 0, offset = 0;
+    uint8_t reg;
+
+    reg = ADCGAIN1_REG;
+    i2c_activity(reg);
+    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    I2C1_MasterRead(&gain1, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+
+    reg = ADCOFFSET_REG;
+    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    I2C1_MasterRead(&offset, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+
+    reg = ADCGAIN2_REG;
+    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    I2C1_MasterRead(&gain2, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+
+    uint8_t cal[AFE_CAL_BYTES] = { gain1, offset, gain2 };
+    if (afe_shadow_set_calibration(&afe_shadow, cal))
+    {
+        telemetry_text("ADC calibration changed");
+    }
+
+    adc_gain_uV = (((gain2 >> 2) & 0x03) << 3 | (gain1 & 0x07)) + 365;
+    adc_offset_mV = (int8_t)offset;
+    bms_adc_scale_init(&adc_scale, adc_gain_uV, adc_offset_mV);
+}
+
+//Handle read/write UART commands
+static void execute_uart_command(const char *line)
+{
+    if (strchr(line, ';') != NULL) {
+        execute_batch(line);
+        return;
+    }
+
+    char cmd_buf[UART_LINE_BYTES];
+    strncpy(cmd_buf, line, sizeof(cmd_buf));
+    cmd_buf[sizeof(cmd_buf) - 1] = '\0';
+
+    uart1_send_string("CMD Received: ");
+    uart1_send_string(cmd_buf);
+    uart1_send_string("\r\n");
+
+    const cmd_entry_t *entry;
+    cmd_status_t status;
+
+    trace_event(TRACE_COMMAND, 0);
+    status = cmd_dispatch(commands, COMMAND_COUNT, cmd_buf, &entry);
+    trace_event(TRACE_COMMAND_END, entry != NULL ? (uint8_t)(entry - commands) : 0xFF);
+    switch (status) {
+    case CMD_EMPTY:
+        uart1_send_string("CMD Parse Error\r\n");
+        break;
+    case CMD_UNKNOWN:
+        uart1_send_string("Unknown command\r\n");
+        break;
+    case CMD_BAD_ARGS:
+    case CMD_REJECTED:
+        uart1_send_string("Usage: ");
+        uart1_send_string(entry->usage);
+        uart1_send_string("\r\n");
+        break;
+    default:
+        break;
+    }
+}
+
+
+//"g": one status block
+static bool status_command(const cmd_args_t *args)
+{
+    (void)args;
+    uart1_send_string("Status Triggered\r\n");
+    read_and_send_status();
+    return true;
+}
+
+
+//"write <reg> <value>". Shadowed registers are staged and flushed, so the
+//write is verified by reading it back.
+static bool write_command(const cmd_args_t *args)
+{
+    bool ok;
+
+    if (args->num[0] > 0xFF || args->num[1] > 0xFF) return false;
+    afe_lock(&console_ctx);
+    if (afe_shadow_stage(&afe_shadow, (uint8_t)args->num[0], (uint8_t)args->num[1])) {
+        ok = flush_registers();
+    } else {
+        ok = write_register((uint8_t)args->num[0], (uint8_t)args->num[1]);
+    }
+    afe_unlock();
+    uart1_send_string(ok ? "ACK\r\n" : "WRITE FAIL\r\n");
+    return true;
+}
+
+
+//"read <reg> <len>" or "read <first>-<last>"
+static bool read_command(const cmd_args_t *args)
+{
+    uint8_t reg;
+    uint16_t len;
+
+    if (!parse_read_range(args->argv[0], args->argv[1], &reg, &len)) return false;
+    send_register_range(reg, len, false);
+    return true;
+}
+
+
+//"baud" reports the rate, "baud <rate>" changes it
+static bool baud_command(const cmd_args_t *args)
+{
+    if (args->argc > 0 && args->num[0] > BAUD_MAX) {
+        uart1_send_string("BAUD FAIL\r\n");
+    } else if (args->argc > 0) {
+        change_baud_rate(args->num[0]);
+    } else {
+        uart1_send_string("Baud: ");
+        uart1_send_u32(UART1_BaudRateGet());
+        uart1_send_string("\r\n");
+    }
+    return true;
+}
+
+
+//"help" lists the usage of every command, "help <command>" of one
+static bool help_command(const cmd_args_t *args)
+{
+    const cmd_entry_t *entry;
+
+    if (args->argc > 0) {
+        entry = cmd_find(commands, COMMAND_COUNT, args->argv[0]);
+        if (entry == NULL) return false;
+        uart1_send_string(entry->usage);
+        uart1_send_string("\r\n");
+        return true;
+    }
+    for (entry = commands; entry < commands + COMMAND_COUNT; entry++) {
+        uart1_send_string(entry->usage);
+        uart1_send_string("\r\n");
+    }
+    return true;
+}
+
+
+//"tasks": stack use of each task and the protection timing
+//  protect: priority 4, stack 88 of 192 words used
+//  ...
+//  Protection: poll max 412 us, AFE wait max 230 us, 0 faults (last 0 us, max 0 us)
+//  Telemetry: 0 messages dropped, UART: 0 received bytes lost
+static bool tasks_command(const cmd_args_t *args)
+{
+    (void)args;
+    for (const task_def_t *def = task_defs; def < task_defs + TASK_COUNT; def++)
+    {
+        uart1_send_string("  ");
+        uart1_send_string(def->name);
+        uart1_send_string(": priority ");
+        uart1_send_u16((uint16_t)def->priority);
+        if (def->context->handle == NULL)
+        {
+            uart1_send_string(", not running\r\n");
+            continue;
+        }
+        uart1_send_string(", stack ");
+        uart1_send_u16(def->stack_words - (uint16_t)uxTaskGetStackHighWaterMark(def->context->handle));
+        uart1_send_string(" of ");
+        uart1_send_u16(def->stack_words);
+        uart1_send_string(" words used\r\n");
+    }
+    uart1_send_string("Protection: poll max ");
+    uart1_send_u16(protect_stats.poll_max_us);
+    uart1_send_string(" us, AFE wait max ");
+    uart1_send_u16(protect_stats.lock_wait_max_us);
+    uart1_send_string(" us, ");
+    uart1_send_u16(protect_stats.faults);
+    uart1_send_string(" faults (last ");
+    uart1_send_u16(protect_stats.fault_last_us);
+    uart1_send_string(" us, max ");
+    uart1_send_u16(protect_stats.fault_max_us);
+    uart1_send_string(" us)\r\nTelemetry: ");
+    uart1_send_u16(telemetry_dropped);
+    uart1_send_string(" messages dropped, UART: ");
+    uart1_send_u16(UART1_RxLostCountGet());
+    uart1_send_string(" received bytes lost\r\n");
+    return true;
+}
+
+
+//Switch the UART to a new baud rate. The ACK goes out at the old rate, then
+//the host has BAUD_CONFIRM_MS to send "baud ok" at the new rate. If it
+//doesn't, the old rate is restored so a host that missed the switch can
+//still talk to us.
+static void change_baud_rate(uint32_t baud)
+{
+    char buf[16];
+    int16_t error;
+    uint32_t old_baud = UART1_BaudRateGet();
+
+    UART1_BRGCompute(CLOCK_PeripheralFrequencyGet(), baud, &error);
+    if (error > UART1_BAUD_MAX_ERROR_PERMILLE || error < -UART1_BAUD_MAX_ERROR_PERMILLE) {
+        //Rates above 38400 need the PLL, try the performance clock first
+        clock_profile_divisors_t div;
+        clock_profile_divisors(CLOCK_PROFILE_PERFORMANCE, baud, I2C1_BusSpeedGet(), &div);
+        if (div.uart_error_permille > UART1_BAUD_MAX_ERROR_PERMILLE ||
+            div.uart_error_permille < -UART1_BAUD_MAX_ERROR_PERMILLE ||
+            !switch_clock_profile(CLOCK_PROFILE_PERFORMANCE)) {
+            uart1_send_string("BAUD FAIL\r\n");
+            return;
+        }
+    }
+
+    uart1_send_string("ACK BAUD ");
+    uart1_send_u32(baud);
+    uart1_send_string("\r\n");
+    UART1_BaudRateSet(baud);    //drains the ACK before switching
+
+    if (uart_read_line(buf, sizeof(buf), pdMS_TO_TICKS(BAUD_CONFIRM_MS)) > 0 &&
+        strcmp(buf, "baud ok") == 0) {
+        uart1_send_string("ACK BAUD OK\r\n");
+    } else {
+        UART1_BaudRateSet(old_baud);
+        uart1_send_string("BAUD REVERTED\r\n");
+    }
+}
+
+
+//Report or select the clock profile: "clock", "clock low|fast|auto".
+//Picking a profile by hand turns automatic switching off.
+static bool change_clock_profile(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+
+    if (arg == NULL) {
+        uart1_send_string("Clock: ");
+        uart1_send_string(clock_profile_name(clock_profile_get()));
+        uart1_send_string(" ");
+        uart1_send_u32(CLOCK_SystemFrequencyGet());
+        uart1_send_string(clock_profile_is_auto() ? " Hz (auto)\r\n" : " Hz\r\n");
+        return true;
+    }
+
+    if (strcmp(arg, "auto") == 0) {
+        clock_profile_set_auto(true);
+        uart1_send_string("ACK CLOCK AUTO\r\n");
+        return true;
+    }
+
+    clock_profile_t profile;
+    if (strcmp(arg, "low") == 0) {
+        profile = CLOCK_PROFILE_LOW_POWER;
+    } else if (strcmp(arg, "fast") == 0) {
+        profile = CLOCK_PROFILE_PERFORMANCE;
+    } else {
+        return false;
+    }
+
+    //Refused if the current baud rate can't be generated in that profile
+    if (switch_clock_profile(profile)) {
+        clock_profile_set_auto(false);
+        uart1_send_string("ACK CLOCK\r\n");
+    } else {
+        uart1_send_string("CLOCK FAIL\r\n");
+    }
+    return true;
+}
+
+
+//Clock switches retime the UART and the I2C bus. The UART is drained first
+//(the console holds it, nothing new is queued), so the AFE lock is held for
+//the switch only, not for the output still going out.
+static bool switch_clock_profile(clock_profile_t profile)
+{
+    bool ok;
+
+    if (profile == clock_profile_get()) return true;
+    UART1_TxFlush();
+    afe_lock(&console_ctx);
+    ok = clock_profile_set(profile);
+    afe_unlock();
+    return ok;
+}
+
+
+//"i2c" reports bus speed and start-to-stop transaction times,
+//"i2c 400000" changes the bus speed, "i2c reset" clears the statistics.
+static bool i2c_speed_and_timing(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+    uint32_t speed;
+    bool ok;
+
+    if (arg == NULL) {
+        I2C1_TIMING t;
+        I2C1_TimingGet(&t);
+        uart1_send_string("I2C: ");
+        uart1_send_u32(I2C1_BusSpeedGet());
+        if (t.count == 0) {
+            uart1_send_string(" Hz | no transactions\r\n");
+        } else {
+            uart1_send_string(" Hz | n=");
+            uart1_send_u32(t.count);
+            uart1_send_string(" last=");
+            uart1_send_u16(t.last_us);
+            uart1_send_string(" min=");
+            uart1_send_u16(t.min_us);
+            uart1_send_string(" avg=");
+            uart1_send_u32(t.total_us / t.count);
+            uart1_send_string(" max=");
+            uart1_send_u16(t.max_us);
+            uart1_send_string(" us\r\n");
+        }
+        return true;
+    }
+
+    if (strcmp(arg, "reset") == 0) {
+        I2C1_TimingReset();
+        uart1_send_string("ACK I2C RESET\r\n");
+        return true;
+    }
+
+    if (!cmd_parse_uint(arg, &speed)) return false;
+    if (speed > I2C1_FAST_MODE_HZ) {
+        uart1_send_string("I2C FAIL\r\n");
+        return true;
+    }
+    afe_lock(&console_ctx);
+    ok = I2C1_BusSpeedSet(speed);
+    afe_unlock();
+    if (!ok) {
+        //Fast mode needs more than the low-power clock, try the PLL
+        clock_profile_divisors_t div;
+        clock_profile_divisors(CLOCK_PROFILE_PERFORMANCE, UART1_BaudRateGet(), speed, &div);
+        if (div.i2c_brg == 0 || !switch_clock_profile(CLOCK_PROFILE_PERFORMANCE)) {
+            uart1_send_string("I2C FAIL\r\n");
+            return true;
+        }
+        afe_lock(&console_ctx);
+        ok = I2C1_BusSpeedSet(speed);
+        afe_unlock();
+        if (!ok) {
+            uart1_send_string("I2C FAIL\r\n");
+            return true;
+        }
+    }
+    I2C1_TimingReset();     //old samples were taken at the old speed
+    uart1_send_string("ACK I2C\r\n");
+    return true;
+}
+
+
+//"op; op; ..." of read/write ops, for register dumps and configuration
+//sequences in one round trip. No echo, one reply line:
+//  BATCH <item>; <item>; ...
+//A read gives "0x<reg>: <hex> <hex> ...". Consecutive writes to shadowed
+//registers are flushed together, before the next read (which has to see
+//them) or at the end, and give one ACK/WRITE FAIL item.
+static void execute_batch(const char *line)
+{
+    char ops[UART_LINE_BYTES];
+    char *op, *next;
+    uint8_t items = 0;
+    bool staged = false;
+    bool ok;
+
+    strncpy(ops, line, sizeof(ops));
+    ops[sizeof(ops) - 1] = '\0';
+
+    uart1_send_string("BATCH");
+    for (op = ops; op != NULL; op = next)
+    {
+        next = strchr(op, ';');
+        if (next != NULL) *next++ = '\0';
+
+        const char *words[3];
+        uint8_t count = cmd_tokenize(op, words, 3);
+        uint32_t reg32, val32;
+        if (count == 0) continue;       //empty op, e.g. a trailing ';'
+        bool is_write = count == 3 && strcmp(words[0], "write") == 0 &&
+                        cmd_parse_uint(words[1], &reg32) && reg32 <= 0xFF &&
+                        cmd_parse_uint(words[2], &val32) && val32 <= 0xFF;
+        uint8_t reg = is_write ? (uint8_t)reg32 : 0;
+        uint8_t val = is_write ? (uint8_t)val32 : 0;
+
+        if (is_write) {
+            afe_lock(&console_ctx);
+            ok = afe_shadow_stage(&afe_shadow, reg, val);
+            afe_unlock();
+            if (ok) {
+                staged = true;
+                continue;
+            }
+        }
+        if (staged) {
+            batch_item(&items);
+            afe_lock(&console_ctx);
+            ok = flush_registers();
+            afe_unlock();
+            uart1_send_string(ok ? "ACK" : "WRITE FAIL");
+            staged = false;
+        }
+
+        uint16_t len;
+        batch_item(&items);
+        if (is_write) {
+            afe_lock(&console_ctx);
+            ok = write_register(reg, val);
+            afe_unlock();
+            uart1_send_string(ok ? "ACK" : "WRITE FAIL");
+        } else if (count <= 3 && strcmp(words[0], "read") == 0 &&
+                   parse_read_range(words[1], words[2], &reg, &len)) {
+            send_register_range(reg, len, true);
+        } else {
+            uart1_send_string("Invalid op ");
+            uart1_send_string(words[0]);
+        }
+    }
+    if (staged) {
+        batch_item(&items);
+        afe_lock(&console_ctx);
+        ok = flush_registers();
+        afe_unlock();
+        uart1_send_string(ok ? "ACK" : "WRITE FAIL");
+    }
+    uart1_send_string("\r\n");
+}
+
+
+//Separator before the next item of a batch reply
+static void batch_item(uint8_t *items)
+{
+    uart1_send_string((*items)++ ? "; " : " ");
+}
+
+
+//"<reg> <len>" or "<first>-<last>" (inclusive). False if malformed or past
+//register 0xFF.
+static bool parse_read_range(const char *arg1, const char *arg2, uint8_t *reg, uint16_t *len)
+{
+    const char *end;
+    uint32_t first, last;
+
+    if (arg1 == NULL || (end = cmd_parse_number(arg1, &first)) == NULL) return false;
+    if (*end == '-' && arg2 == NULL) {
+        if (!cmd_parse_uint(end + 1, &last) || last < first) return false;
+    } else if (*end == '\0' && arg2 != NULL) {
+        if (!cmd_parse_uint(arg2, &last) || last == 0 || last > 0x100) return false;
+        last += first - 1;
+    } else {
+        return false;
+    }
+
+    if (last > 0xFF) return false;
+    *len = (uint16_t)(last - first + 1);
+    *reg = (uint8_t)first;
+    return true;
+}
+
+
+//Reads len registers from reg, READ_CHUNK_BYTES per transaction (clean
+//configuration registers come from the shadow, no bus needed), and sends
+//them as "0x19 0xC0 ..." or, compact for batches, "0x04: 19 C0 ...".
+static void send_register_range(uint8_t reg, uint16_t len, bool compact)
+{
+    uint8_t chunk[READ_CHUNK_BYTES];
+
+    if (compact) {
+        uart1_send_string("0x");
+        uart1_send_hex(reg, 2);
+        UART1_Write(':');
+    }
+    while (len > 0) {
+        uint8_t n = (len > READ_CHUNK_BYTES) ? READ_CHUNK_BYTES : (uint8_t)len;
+        bool ok;
+        afe_lock(&console_ctx);
+        ok = afe_shadow_read(&afe_shadow, reg, chunk, n) || read_registers(reg, chunk, n);
+        afe_unlock();
+        if (!ok) {
+            uart1_send_string(compact ? " READ FAIL" : "READ FAIL");
+            break;
+        }
+        for (uint8_t i = 0; i < n; i++) {
+            if (compact) {
+                UART1_Write(' ');
+                uart1_send_hex(chunk[i], 2);
+            } else {
+                uart1_send_string("0x");
+                uart1_send_hex(chunk[i], 2);
+                UART1_Write(' ');
+            }
+        }
+        reg += n;
+        len -= n;
+    }
+    if (!compact) uart1_send_string("\r\n");
+}
+
+
+//Append " (raw: 0xXXXX)" and end the line
+static void send_raw_suffix(uint16_t raw_value)
+{
+    uart1_send_string(" (raw: 0x");
+    uart1_send_hex(raw_value, 4);
+    uart1_send_string(")\r\n");
+}
+
+
+//"  Cn: <mV> mV (raw: 0xXXXX)" or "  Cn: ERROR (raw: 0xXXXX)", n being the
+//VC input the cell is measured on
+static void send_cell_voltage(const cell_topology_t *t, uint8_t cell, const cell_frame_t *frame)
+{
+    uart1_send_string("  C");
+    uart1_send_u16(cell_topology_input(t, cell) + 1);
+    if (frame->errors & (1u << cell)) {
+        uart1_send_string(": ERROR");
+    } else {
+        uart1_send_string(": ");
+        uart1_send_u16(frame->mV[cell]);
+        uart1_send_string(" mV");
+    }
+    send_raw_suffix(frame->raw[cell]); //to display on GUI using UART
+}
+
+
+//Function is called when user sends 'g' in GUI to get a general status update
+//of the battery pack (Cell voltages, pack voltage, temperature), all from
+//one register frame
+static void read_and_send_status(void)
+{
+    measure_reply_t m;
+    cell_frame_t frame;
+    bool ok;
+
+    measure_request(MEASURE_REPORT, 0, 0, &m);
+    if (m.power.state == POWER_IDLE && measure_request(MEASURE_POWER, POWER_ACTIVE, 0, &m))
+    {
+        vTaskDelay(pdMS_TO_TICKS(CC_ONESHOT_MS));   //the ADC registers held the reading from before Idle
+    }
+    afe_lock(&console_ctx);
+    ok = read_frame(m.topology, &frame);
+    afe_unlock();
+
+    uart1_send_string("\r\n======== BQ76920 Status ========\r\n");
+    if (ok)
+    {
+        //Individual cell voltages, only the VC inputs the topology populates
+        uart1_send_string("Cell Voltages:\r\n");
+        for (uint8_t n = 0; n < m.topology->cells; n++)
+        {
+            send_cell_voltage(m.topology, n, &frame);
+        }
+
+        //Only matches the real SoC when the pack has been resting
+        uint16_t cell_mV = average_cell_mV(m.topology, &frame);
+        if (cell_mV != 0)
+        {
+            uart1_send_string("  OCV SoC: ");
+            uart1_send_float(bms_ocv_soc_percent(BATTERY_CHEMISTRY, cell_mV, NULL), 1);
+            uart1_send_string(" %\r\n");
+        }
+        send_cell_stats(&m);
+
+        uart1_send_string("Pack Voltage: ");
+        uart1_send_u32(frame.bat_mV);
+        uart1_send_string(" mV");
+        send_raw_suffix(frame.bat_raw);
+
+        send_external_temp(frame.ts1_raw); //adds thermister temperature to output
+    }
+    else
+    {
+        uart1_send_string("READ FAIL\r\n");
+    }
+    send_capacity(m.learned_mAh, m.soh_percent, m.cycles, m.learn_count);
+    
+    uart1_send_string("================================\r\n"); //formatting
+}
+
+
+//Read VC1_HI through TS1_LO in one transaction, so cells, pack and
+//temperature come from the same ADC cycle, and convert the cells t
+//populates. Caller holds the AFE lock (adc_scale comes with it).
+static bool read_frame(const cell_topology_t *t, cell_frame_t *frame)
+{
+    I2C1_MESSAGE_STATUS status;
+    uint8_t reg = VC1_HI_REG;
+    uint8_t buffer[CELL_TOPOLOGY_FRAME_BYTES];
+
+    i2c_activity(reg);
+    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    if (status != I2C1_MESSAGE_COMPLETE) return false;
+
+    I2C1_MasterRead(buffer, CELL_TOPOLOGY_FRAME_BYTES, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    if (status != I2C1_MESSAGE_COMPLETE) return false;
+
+    cell_topology_convert(t, buffer, &adc_scale, frame);
+    return true;
+}
+
+
+//Mean of the populated cells, ignoring readings that look like an open
+//input. Returns 0 if none are usable.
+static uint16_t average_cell_mV(const cell_topology_t *t, const cell_frame_t *frame)
+{
+    uint32_t sum_mV = 0;
+    uint8_t count = 0;
+
+    for (uint8_t n = 0; n < t->cells; n++)
+    {
+        if (!(frame->errors & (1u << n)))
+        {
+            sum_mV += frame->mV[n];
+            count++;
+        }
+    }
+    return (count > 0) ? (uint16_t)(sum_mV / count) : 0;
+}
+
+
+//Switches to the topology for this many cells (on BMS_AFE) and restarts
+//the statistics. Returns false, changing nothing, if it isn't valid.
+static bool select_cell_count(uint8_t cells)
+{
+    const cell_topology_t *t = cell_topology_find(BMS_AFE, cells);
+
+    if (t == NULL) return false;
+    topology = t;
+    cell_stats_init(&cell_stats, t->cells, CELL_STATS_WINDOW, CELL_STATS_DECIMATE);
+    return true;
+}
+
+
+//"cells" lists the VC inputs in use, "cells <n>" rewires for n cells and
+//stores the count
+static bool cell_count_command(const cmd_args_t *args)
+{
+    measure_reply_t m;
+
+    if (args->argc > 0)
+    {
+        if (args->num[0] > 0xFF || !measure_request(MEASURE_CELLS, (uint16_t)args->num[0], 0, &m))
+        {
+            uart1_send_string("Cell count not supported by this AFE\r\n");
+            return true;
+        }
+    }
+    else
+    {
+        measure_request(MEASURE_REPORT, 0, 0, &m);
+    }
+
+    uart1_send_string("Cells: ");
+    uart1_send_u16(m.topology->cells);
+    uart1_send_string(" (");
+    for (uint8_t n = 0; n < m.topology->cells; n++)
+    {
+        if (n > 0) UART1_Write(' ');
+        uart1_send_string("VC");
+        uart1_send_u16(cell_topology_input(m.topology, n) + 1);
+    }
+    uart1_send_string(")\r\n");
+    return true;
+}
+
+
+//Set the Coulomb integrator from the open-circuit voltage. At boot this is
+//always done (it beats assuming a full pack); after a rest period it is
+//skipped on flat parts of the OCV curve where it could add error. Reliable
+//readings are also capacity-learning anchors; with the EKF engine the
+//filter keeps its own SoC and the reading is only used for learning.
+static void anchor_soc_from_ocv(bool at_rest)
+{
+    cell_frame_t frame;
+    uint16_t cell_mV;
+    bool reliable, ok;
+
+    if (power.state == POWER_IDLE)
+    {
+        ok = read_frame_oneshot(&frame);
+    }
+    else
+    {
+        afe_lock(&measure_ctx);
+        ok = read_frame(topology, &frame);
+        afe_unlock();
+    }
+    if (!ok) return;
+    cell_mV = average_cell_mV(topology, &frame);
+    if (cell_mV == 0) return;
+
+    telemetry_msg_t msg = { TELEMETRY_ANCHOR, 0, cell_mV, 0, NULL, 0.0f, 0.0f, 0 };
+    float ocv_soc = bms_ocv_soc_percent(BATTERY_CHEMISTRY, cell_mV, &reliable);
+    if (at_rest && !reliable)
+    {
+        msg.flags = ANCHOR_SKIPPED;
+    }
+    else if (at_rest && soc_engine == SOC_ENGINE_EKF)
+    {
+        learn_from_anchor(ocv_soc);
+        msg.flags = ANCHOR_EKF_REST;
+        msg.a = ocv_soc;
+    }
+    else
+    {
+        if (reliable) learn_from_anchor(ocv_soc);
+        remaining_capacity_mAh = ocv_soc * capacity.learned_mAh / 100.0f;
+        soc_percent = bms_soc_percent(remaining_capacity_mAh, capacity.learned_mAh);
+        msg.flags = at_rest ? ANCHOR_REST : ANCHOR_BOOT;
+        msg.a = soc_percent;
+    }
+    telemetry_post(&msg);
+}
+
+
+//Calculate external thermister temperature from a TS1 reading and send to GUI
+static void send_external_temp(uint16_t raw_value)
+{
+    bms_temp_t temp;
+
+    bms_ts_raw_to_temp(raw_value, &temp);
+
+    uart1_send_string("External Temperature Sensor:\r\n");
+    uart1_send_string("  Voltage:    ");
+    uart1_send_float(temp.v_ts1, 3);
+    uart1_send_string(" V\r\n  Resistance: ");
+    uart1_send_float(temp.r_therm, 0);
+    uart1_send_string(" Ohms\r\n  Temp:       ");
+    uart1_send_float(temp.temp_c, 2);
+    uart1_send_string(" C");
+    send_raw_suffix(raw_value);
+}
+
+
+//Use Coulomb Counter to calculate State of Charge (SoC) and display on GUI
+void update_soc_from_cc(void)
+{
+    //Use TickType task to account for time delays. A Coulomb Counter can only
+    //work accurately if each updated value for current, SoC, etc. (anything using
+    //the Coulomb Counter) accounts for the time it took to display from the previous
+    //value(s). Here, the frequency of the tick rate is 1000 Hz, or 1 ms per tick.
+    //Without continuous conversions (Idle, or periodic / oneshot metering)
+    //a reading starts one conversion and waits for it first. Idle updates
+    //without a reading have nothing to read.
+    bool active = (power.state == POWER_ACTIVE);
+    bool oneshot = (power.state == POWER_IDLE) || (active && meter_mode != CC_METER_CONTINUOUS);
+    bool reading = (power.state != POWER_SHIP) && (!oneshot || meter_reading_due(xTaskGetTickCount()));
+
+    meter_sample = false;
+    if (power.state == POWER_IDLE && !reading) return;
+    if (oneshot && reading && !cc_oneshot()) return;
+
+    TickType_t now = xTaskGetTickCount();
+    float dt_sec = bms_elapsed_sec(now, last_update_tick);
+    last_update_tick = now;
+    if (power.state == POWER_SHIP) return;  //BQ76920 off, FETs off: no charge to count
+
+    int16_t cc_value = measured.cc_raw;
+    cell_frame_t frame;
+    bool fets_off, frame_ok = false;
+    uint16_t uv_mV, ov_mV;
+    uint32_t meter_ms = 0;
+
+    //CC, FETs and cells in one hold of the bus, then the math without it.
+    //With the ADC off (Idle) the cell registers are stale and not read.
+    afe_lock(&measure_ctx);
+    if (reading && !read_cc_raw(&cc_value))
+    {
+        afe_unlock();
+        return;
+    }
+    fets_off = cc_fets_off();
+    if (active) frame_ok = read_frame(topology, &frame);
+    measured.adc_gain_uV = adc_gain_uV;     //what frame was converted with
+    measured.adc_offset_mV = adc_offset_mV;
+    read_trip_points(&uv_mV, &ov_mV);
+    afe_unlock();
+
+    //The CC reads a few LSB at zero load. With both FETs off no current can
+    //flow, so those readings are the offset: keep measuring it then, and
+    //subtract it (plus a small dead-band) from every reading. Discharge
+    //stays positive, bms_soc_integrate() subtracts it.
+    if (reading && fets_off)
+    {
+        if (bms_cc_cal_sample(&cc_cal, cc_value)) cc_offset_updated();
+    }
+    else if (reading)
+    {
+        bms_cc_cal_restart(&cc_cal);
+    }
+
+    //Convert to current in Amps. Charge is counted with the mean current
+    //since the previous reading over the time between them, so updates
+    //without a reading keep the last current and count nothing.
+    float current_A = measured.current_A;
+    float mean_A = 0.0f;
+    if (reading)
+    {
+        current_A = bms_cc_cal_current_A(&cc_cal, cc_value, coulomb_counter_gain_uV,
+                                         shunt_resistance_ohm, cc_deadband_mA / 1000.0f);
+        mean_A = cc_meter_add(&meter, current_A, (uint32_t)(now * portTICK_PERIOD_MS), &meter_ms);
+    }
+    float meter_sec = meter_ms / 1000.0f;
+
+    //Mean cell voltage, for the EKF and the full-charge check (0 if unread)
+    uint16_t cell_mV = 0;
+    if (frame_ok)
+    {
+        cell_mV = average_cell_mV(topology, &frame);
+        feed_cell_stats(&frame);
+    }
+
+    if (reading && cap_learn_integrate(&capacity, mean_A, meter_sec))
+    {
+        save_stored_settings();     //one more cycle
+    }
+
+    if (reading && soc_engine == SOC_ENGINE_EKF)
+    {
+        update_soc_ekf(mean_A, meter_sec, cell_mV);
+    }
+    else if (reading)
+    {
+        remaining_capacity_mAh = bms_soc_integrate(remaining_capacity_mAh, capacity.learned_mAh,
+                                                   mean_A, meter_sec);
+        soc_percent = bms_soc_percent(remaining_capacity_mAh, capacity.learned_mAh);
+    }
+
+    //After BMS_REST_TIME_SEC without load the cells read their OCV, which
+    //removes whatever offset the integrator has picked up since
+    if (reading && bms_rest_detect(&soc_rest, mean_A, meter_sec))
+    {
+        anchor_soc_from_ocv(true);
+    }
+
+    //End of a full charge: the other anchor capacity learning uses
+    if (cap_learn_detect_full(&capacity, cell_mV, current_A))
+    {
+        learn_from_anchor(100.0f);
+        if (soc_engine == SOC_ENGINE_CC)
+        {
+            remaining_capacity_mAh = capacity.learned_mAh;
+            soc_percent = 100.0f;
+        }
+        telemetry_msg_t full = { TELEMETRY_FULL_CHARGE, 0, cell_mV, 0, NULL, 0.0f, 0.0f, 0 };
+        telemetry_post(&full);
+    }
+
+    //One report per reading: bms_replay.py integrates between them as here
+    if (reading)
+    {
+        telemetry_msg_t msg = { TELEMETRY_MEASUREMENT, 0, (uint16_t)cc_value, 0, NULL,
+                                current_A, soc_percent, (uint32_t)now };
+        telemetry_post(&msg);
+    }
+
+    update_sampling(current_A, frame_ok ? &frame : NULL, uv_mV, ov_mV, dt_sec);
+    update_power_state(current_A, dt_sec);
+
+    measured.tick = (uint32_t)now;
+    measured.current_A = current_A;
+    measured.cc_raw = cc_value;
+    measured.fets_off = fets_off;
+    measured.frame_valid = frame_ok;
+    if (frame_ok)
+    {
+        measured.pack_mV = (uint16_t)frame.bat_mV;
+        measured.cell_errors = frame.errors;
+        for (uint8_t n = 0; n < topology->cells && n < MEAS_SNAPSHOT_CELLS; n++)
+        {
+            measured.cell_mV[n] = frame.mV[n];
+        }
+    }
+    publish_measurement();
+}
+
+
+//Completes measured with the SoC state and makes it the snapshot other
+//tasks read. Measurement task only.
+static void publish_measurement(void)
+{
+    measured.soc_percent = soc_percent;
+    measured.remaining_mAh = remaining_capacity_mAh;
+    measured.learned_mAh = capacity.learned_mAh;
+    measured.cells = topology->cells;
+    measured.soc_engine = soc_engine;
+    measured.sample_tier = (sampling_forced == SAMPLING_AUTO) ? sampling.tier : sampling_forced;
+    measured.sample_reasons = sampling.reasons;
+    measured.sample_forced = (sampling_forced != SAMPLING_AUTO);
+    measured.period_ms = sampling_period_ms();
+    measured.power_state = power.state;
+    meas_snapshot_publish(&snapshot, &measured);
+}
+
+
+//Kalman filter step: CC current is the input, the mean cell voltage the
+//measurement. If the cells couldn't be read (cell_mV 0) it only predicts.
+static void update_soc_ekf(float current_A, float dt_sec, uint16_t cell_mV)
+{
+    float current_mA = current_A * 1000.0f;
+    float dt_ms = dt_sec * 1000.0f;
+
+    //The filter takes at most 60 s a step: a longer gap between metering
+    //readings goes in as several, the cells only with the last
+    while (dt_ms > 60000.0f)
+    {
+        soc_ekf_update(&soc_ekf, (int32_t)(current_mA + ((current_mA < 0.0f) ? -0.5f : 0.5f)),
+                       60000u, 0);
+        dt_ms -= 60000.0f;
+    }
+
+    soc_ekf_update(&soc_ekf, (int32_t)(current_mA + ((current_mA < 0.0f) ? -0.5f : 0.5f)),
+                   (uint16_t)(dt_ms + 0.5f), cell_mV);
+
+    soc_percent = (float)soc_ekf_soc(&soc_ekf) / 65536.0f;
+    remaining_capacity_mAh = soc_percent * capacity.learned_mAh / 100.0f;
+}
+
+
+//(Re)start the filter from the current SoC, whichever engine produced it
+static void start_soc_ekf(void)
+{
+    soc_ekf_init(&soc_ekf, &soc_model, (int32_t)(soc_percent * 65536.0f),
+                 SOC_EKF_Q16(SOC_EKF_SIGMA_PERCENT));
+    soc_ekf_set_capacity(&soc_ekf, (uint16_t)capacity.learned_mAh);
+}
+
+
+//"soc" reports the engine in use, "soc cc" / "soc ekf" switches. Both
+//engines hand over the current SoC, so switching doesn't cause a jump.
+static bool select_soc_engine(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+    measure_reply_t m;
+    measurement_t now;
+
+    if (arg == NULL)
+    {
+        //reported from the snapshot, no need to wait for the measurement task
+    }
+    else if (strcmp(arg, "ekf") == 0)
+    {
+        measure_request(MEASURE_SOC_ENGINE, SOC_ENGINE_EKF, 0, &m);
+    }
+    else if (strcmp(arg, "cc") == 0)
+    {
+        measure_request(MEASURE_SOC_ENGINE, SOC_ENGINE_CC, 0, &m);
+    }
+    else
+    {
+        return false;
+    }
+
+    //A request is answered after the snapshot is published, so it shows the change
+    meas_snapshot_read(&snapshot, &now);
+    uart1_send_string("SoC engine: ");
+    uart1_send_string((now.soc_engine == SOC_ENGINE_EKF) ? "ekf" : "cc");
+    uart1_send_string(" (SoC ");
+    uart1_send_float(now.soc_percent, 2);
+    uart1_send_string(" %)\r\n");
+    return true;
+}
+
+
+//"rate" shows the sampling tier, "rate idle|normal|fast" pins one, "rate
+//auto" lets the load pick again
+static bool sample_rate_command(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+    measure_reply_t m;
+    measurement_t now;
+    uint8_t tier;
+
+    if (arg != NULL)
+    {
+        if (strcmp(arg, "auto") == 0)
+        {
+            tier = SAMPLING_AUTO;
+        }
+        else
+        {
+            for (tier = 0; tier < SAMPLE_TIERS; tier++)
+            {
+                if (strcmp(arg, sample_rate_tier_name(tier)) == 0) break;
+            }
+            if (tier == SAMPLE_TIERS) return false;
+        }
+        measure_request(MEASURE_RATE, tier, 0, &m);
+    }
+
+    meas_snapshot_read(&snapshot, &now);
+    uart1_send_string("Sampling: ");
+    uart1_send_string(sample_rate_tier_name(now.sample_tier));
+    uart1_send_string(" every ");
+    uart1_send_u16(now.period_ms);
+    if (now.sample_forced)
+    {
+        uart1_send_string(" ms (fixed)\r\n");
+    }
+    else
+    {
+        uart1_send_string(" ms (auto");
+        if (now.sample_reasons & SAMPLE_REASON_CURRENT) uart1_send_string(", current");
+        if (now.sample_reasons & SAMPLE_REASON_DVDT) uart1_send_string(", dV/dt");
+        if (now.sample_reasons & SAMPLE_REASON_LIMIT) uart1_send_string(", near limit");
+        uart1_send_string(")\r\n");
+    }
+    return true;
+}
+
+
+//"power" shows the power state, "power active|idle|ship" changes it,
+//"power auto <s>" sets the quiet time before Idle (0: only on command).
+//Nothing answers after SHIP until the BQ76920 is woken, and nothing at all
+//if it powers this board through REGOUT, hence the notice first.
+static bool power_command(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+    measure_reply_t m;
+    uint8_t state;
+
+    if (arg == NULL)
+    {
+        measure_request(MEASURE_REPORT, 0, 0, &m);
+    }
+    else if (strcmp(arg, "auto") == 0 && args->argc == 2 && args->num[1] <= 0xFFFF)
+    {
+        measure_request(MEASURE_POWER_AUTO, (uint16_t)args->num[1], 0, &m);
+    }
+    else
+    {
+        for (state = 0; state < POWER_STATES; state++)
+        {
+            if (strcmp(arg, power_state_name(state)) == 0) break;
+        }
+        if (state == POWER_STATES) return false;
+        if (state == POWER_SHIP)
+        {
+            uart1_send_string("Entering SHIP mode, FETs off. Boot signal on TS1 to wake.\r\n");
+            UART1_TxFlush();
+        }
+        if (!measure_request(MEASURE_POWER, state, 0, &m)) uart1_send_string("Power change failed\r\n");
+    }
+
+    uart1_send_string("Power: ");
+    uart1_send_string(power_state_name(m.power.state));
+    uart1_send_string(" (");
+    uart1_send_string(power_reason_name(m.power.reason));
+    if (m.idle_after_s == 0)
+    {
+        uart1_send_string("), idle on command only\r\n");
+        return true;
+    }
+    uart1_send_string("), idle after ");
+    uart1_send_u16(m.idle_after_s);
+    uart1_send_string(" s quiet");
+    if (m.power.state == POWER_ACTIVE)
+    {
+        uart1_send_string(" (");
+        uart1_send_u32(m.power.quiet_ms / 1000UL);
+        uart1_send_string(" s so far)");
+    }
+    uart1_send_string("\r\n");
+    return true;
+}
+
+
+//"meter" shows the Coulomb Counter metering, "meter continuous|oneshot"
+//changes it, "meter periodic [<s>]" converts once every <s> (1 to 3600,
+//kept if left out) and "meter sample" takes a reading now in any mode.
+static bool meter_command(const cmd_args_t *args)
+{
+    const char *arg = args->argv[0];
+    measure_reply_t m;
+    uint16_t period_s = MEASURE_KEEP;
+    uint8_t mode;
+    bool ok = true;
+
+    if (arg == NULL)
+    {
+        measure_request(MEASURE_REPORT, 0, 0, &m);
+    }
+    else if (strcmp(arg, "sample") == 0)
+    {
+        ok = measure_request(MEASURE_METER_SAMPLE, 0, 0, &m);
+    }
+    else
+    {
+        for (mode = 0; mode < CC_METER_MODES; mode++)
+        {
+            if (strcmp(arg, cc_meter_mode_name(mode)) == 0) break;
+        }
+        if (mode == CC_METER_MODES) return false;
+        if (mode == CC_METER_PERIODIC && args->argc == 2)
+        {
+            if (args->num[1] == 0 || args->num[1] > METER_PERIOD_MAX_S) return false;
+            period_s = (uint16_t)args->num[1];
+        }
+        ok = measure_request(MEASURE_METER, mode, period_s, &m);
+    }
+    if (!ok) uart1_send_string("Metering failed\r\n");
+
+    uart1_send_string("Metering: ");
+    uart1_send_string(cc_meter_mode_name(m.meter_mode));
+    if (m.meter_mode == CC_METER_PERIODIC)
+    {
+        uart1_send_string(" every ");
+        uart1_send_u16(m.meter_period_s);
+        uart1_send_string(" s");
+    }
+    uart1_send_string(", ");
+    uart1_send_u32(m.meter.readings);
+    uart1_send_string(" readings, longest gap ");
+    uart1_send_u32(m.meter.gap_max_ms);
+    uart1_send_string(" ms\r\n");
+    return true;
+}
+
+
+//Period until the next measurement, the idle one while the AFE is in Idle
+//or SHIP unless a tier is pinned. Measurement task only.
+static uint16_t sampling_period_ms(void)
+{
+    uint8_t tier = (sampling_forced == SAMPLING_AUTO) ? sampling.tier : sampling_forced;
+
+    if (sampling_forced == SAMPLING_AUTO && power.state != POWER_ACTIVE) tier = SAMPLE_TIER_IDLE;
+
+    return sampling_config.period_ms[tier];
+}
+
+
+//OV and UV trip points in mV from the shadow, 0 while unknown. Caller
+//holds the AFE lock.
+static void read_trip_points(uint16_t *uv_mV, uint16_t *ov_mV)
+{
+    uint8_t trip[2];    //OV_TRIP, UV_TRIP
+
+    *uv_mV = 0;
+    *ov_mV = 0;
+    if (!afe_shadow_read(&afe_shadow, OV_TRIP_REG, trip, 2)) return;
+
+    //The 8 bits are the middle of a 14-bit ADC code, 10-xxxx-xxxx-1000
+    //for OV and 01-xxxx-xxxx-0000 for UV
+    *ov_mV = (uint16_t)bms_cell_raw_to_mV(0x2008 | ((uint16_t)trip[0] << 4), adc_gain_uV, adc_offset_mV);
+    *uv_mV = (uint16_t)bms_cell_raw_to_mV(0x1000 | ((uint16_t)trip[1] << 4), adc_gain_uV, adc_offset_mV);
+}
+
+
+//Picks the tier for the next measurement from this one. frame is NULL if
+//the cells couldn't be read.
+static void update_sampling(float current_A, const cell_frame_t *frame, uint16_t uv_mV,
+                            uint16_t ov_mV, float dt_sec)
+{
+    uint16_t min_mV = 0, max_mV = 0;
+
+    for (uint8_t n = 0; frame != NULL && n < topology->cells; n++)
+    {
+        if (frame->errors & (1u << n)) continue;
+        if (min_mV == 0 || frame->mV[n] < min_mV) min_mV = frame->mV[n];
+        if (frame->mV[n] > max_mV) max_mV = frame->mV[n];
+    }
+    if (dt_sec > 60.0f) dt_sec = 60.0f;
+    sample_rate_update(&sampling, &sampling_config, current_A, min_mV, max_mV, uv_mV, ov_mV,
+                       (uint32_t)(dt_sec * 1000.0f + 0.5f));
+}
+
+
+//Enters Idle after a quiet spell and leaves it when a one-shot sees
+//current. A command restarts the quiet time. Measurement task only.
+static void update_power_state(float current_A, float dt_sec)
+{
+    uint8_t want;
+
+    if (command_seen)
+    {
+        command_seen = false;
+        power_activity(&power);
+    }
+    if (dt_sec > 60.0f) dt_sec = 60.0f;
+    want = power_update(&power, &power_config, current_A, sampling.limit_mV,
+                        (uint32_t)(dt_sec * 1000.0f + 0.5f));
+    if (want == power.state) return;
+
+    set_activity(&measure_ctx, ACTIVITY_POWER);
+    afe_lock(&measure_ctx);
+    if (power.state != want)    //the protection task may have woken it meanwhile
+    {
+        set_power_state(want, (want == POWER_IDLE) ? POWER_REASON_QUIET : POWER_REASON_CURRENT,
+                        TMR2_Counter32BitGet());
+    }
+    afe_unlock();
+}
+
+
+//Idle: starts one CC conversion and waits for it. CC_ONESHOT is not in
+//the shadow (the chip clears it when done), so SYS_CTRL2 is read and
+//written directly in one hold of the bus.
+static bool cc_oneshot(void)
+{
+    uint8_t ctrl2;
+    bool ok;
+
+    afe_lock(&measure_ctx);
+    ok = read_registers(SYS_CTRL2_REG, &ctrl2, 1) &&
+         write_register(SYS_CTRL2_REG, (uint8_t)(ctrl2 | POWER_CTRL2_CC_ONESHOT));
+    afe_unlock();
+    if (ok) vTaskDelay(pdMS_TO_TICKS(CC_ONESHOT_MS));
+    return ok;
+}
+
+
+//SYS_CTRL2 for a power state under the metering mode: continuous
+//conversions only while Active and metering continuously. Caller holds
+//the AFE lock.
+static uint8_t meter_ctrl2(uint8_t state, uint8_t ctrl2)
+{
+    if (state == POWER_ACTIVE && meter_mode != CC_METER_CONTINUOUS) state = POWER_IDLE;
+    return power_ctrl2(state, ctrl2);
+}
+
+
+//Makes mode current and writes the CC_EN it needs. SYS_CTRL2 is read
+//first, as in set_power_state(). The meter keeps its last reading, so the
+//interval across the change is counted by the next one. Measurement task.
+static bool set_meter_mode(uint8_t mode)
+{
+    uint8_t ctrl2;
+    bool ok;
+
+    if (mode >= CC_METER_MODES) return false;
+    afe_lock(&measure_ctx);
+    ok = (power.state != POWER_SHIP) && read_registers(SYS_CTRL2_REG, &ctrl2, 1);
+    if (ok)
+    {
+        meter_mode = mode;
+        afe_shadow_stage(&afe_shadow, SYS_CTRL2_REG, meter_ctrl2(power.state, ctrl2));
+        ok = flush_registers();
+    }
+    afe_unlock();
+    return ok;
+}
+
+
+//Whether an update without continuous conversions takes a reading: in
+//Idle with continuous metering each one, periodic the one nearest to
+//meter_period_s after the last reading, oneshot only on request.
+static bool meter_reading_due(TickType_t now)
+{
+    uint32_t since_ms;
+
+    if (meter_sample || meter_mode == CC_METER_CONTINUOUS) return true;
+    if (meter_mode == CC_METER_ONESHOT) return false;
+    if (!meter.have_last) return true;
+    since_ms = (uint32_t)(now * portTICK_PERIOD_MS) - meter.last_ms;
+    return since_ms + sampling_period_ms() / 2 >= meter_period_s * 1000UL;
+}
+
+
+//Idle keeps the ADC off, so its registers hold the last reading before
+//Idle. For a reading that has to be current (the OCV anchor) the ADC is
+//switched on for one conversion. Leaves it on if the protection task
+//woke the AFE meanwhile. Measurement task only.
+static bool read_frame_oneshot(cell_frame_t *frame)
+{
+    const uint8_t *ctrl1 = &afe_shadow.config[SYS_CTRL1_REG - AFE_CONFIG_FIRST_REG];
+    bool ok;
+
+    afe_lock(&measure_ctx);
+    afe_shadow_stage(&afe_shadow, SYS_CTRL1_REG, power_ctrl1(POWER_ACTIVE, *ctrl1));
+    ok = flush_registers();
+    afe_unlock();
+    if (!ok) return false;
+    vTaskDelay(pdMS_TO_TICKS(CC_ONESHOT_MS));
+
+    afe_lock(&measure_ctx);
+    ok = read_frame(topology, frame);
+    if (power.state == POWER_IDLE)
+    {
+        afe_shadow_stage(&afe_shadow, SYS_CTRL1_REG, power_ctrl1(POWER_IDLE, *ctrl1));
+        flush_registers();
+    }
+    afe_unlock();
+    return ok;
+}
+
+
+//Read CC_HI and CC_LO as one signed value. Caller holds the AFE lock.
+static bool read_cc_raw(int16_t *cc_value)
+{
+    I2C1_MESSAGE_STATUS status;
+    uint8_t reg = CC_HI_REG;
+    uint8_t cc_raw[2];
+
+    i2c_activity(reg);
+    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    if (status != I2C1_MESSAGE_COMPLETE) return false;
+
+    I2C1_MasterRead(cc_raw, 2, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    if (status != I2C1_MESSAGE_COMPLETE) return false;
+
+    *cc_value = (int16_t)((cc_raw[0] << 8) | cc_raw[1]);
+    return true;
+}
+
+
+//True only if SYS_CTRL2 could be read and shows CHG and DSG both off.
+//Caller holds the AFE lock.
+static bool cc_fets_off(void)
+{
+    I2C1_MESSAGE_STATUS status;
+    uint8_t reg = SYS_CTRL2_REG;
+    uint8_t value;
+
+    i2c_activity(reg);
+    I2C1_MasterWrite(&reg, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    if (status != I2C1_MESSAGE_COMPLETE) return false;
+
+    I2C1_MasterRead(&value, 1, BQ76920_I2C_ADDR, &status);
+    while (status == I2C1_MESSAGE_PENDING);
+    return (status == I2C1_MESSAGE_COMPLETE) && ((value & SYS_CTRL2_FET_MASK) == 0);
+}
+
+
+//Start from the CC offset and battery history stored before the last
+//reset. Fields a shorter (older) record doesn't have keep the defaults.
+static void load_stored_settings(void)
+{
+    stored.cc_offset_lsb = 0.0f;
+    stored.learned_mAh = capacity.learned_mAh;
+    stored.cycle_mAh = capacity.cycle_mAh;
+    stored.cycles = capacity.cycles;
+    stored.learn_count = capacity.learn_count;
+    stored.cell_count = BATTERY_CELLS;
+    stored.idle_after_s = POWER_IDLE_AFTER_S;
+    stored.meter_mode = CC_METER_CONTINUOUS;
+    stored.meter_period_s = METER_PERIOD_S;
+
+    stored_valid = nvm_store_load(&stored, sizeof(stored));
+    if (!stored_valid) return;
+
+    power_config.idle_after_ms = stored.idle_after_s * 1000UL;
+    if (stored.meter_mode < CC_METER_MODES) meter_mode = (uint8_t)stored.meter_mode;
+    if (stored.meter_period_s > 0 && stored.meter_period_s <= METER_PERIOD_MAX_S)
+    {
+        meter_period_s = stored.meter_period_s;
+    }
+    cc_cal.offset_lsb = stored.cc_offset_lsb;
+    cc_cal.valid = true;
+
+    //Out of range (or not a number) means a corrupt record: keep nominal
+    if (stored.learned_mAh >= CAP_LEARN_MIN_RATIO * BATTERY_CAPACITY_MAH &&
+        stored.learned_mAh <= CAP_LEARN_MAX_RATIO * BATTERY_CAPACITY_MAH)
+    {
+        capacity.learned_mAh = stored.learned_mAh;
+    }
+    if (stored.cycle_mAh >= 0.0f && stored.cycle_mAh < BATTERY_CAPACITY_MAH)
+    {
+        capacity.cycle_mAh = stored.cycle_mAh;
+    }
+    capacity.cycles = stored.cycles;
+    capacity.learn_count = stored.learn_count;
+}
+
+
+//Only marks the settings for saving: every flash write goes through
+//flush_stored_settings() at the top of the measurement loop, so a burst of
+//changes costs one write and the stall happens at one known point.
+static void save_stored_settings(void)
+{
+    stored_dirty = true;
+}
+
+
+//Writes the settings if a save was asked for. Programming flash stalls the
+//CPU with interrupts held off, briefly for each word pair written and for a
+//few ms when the page is erased (every NVM_STORE_SLOTS saves). Meanwhile the
+//protection task can't poll SYS_STAT, so the firmware's reaction to a fault
+//(and its report) comes that much later; the BQ76920 still opens the FETs
+//on OV, UV, SCD and OCD by itself. The supervisor is paused so the stall
+//isn't blamed on whichever task it caught. UART input arriving during an
+//erase can overrun the RX FIFO (counted as lost bytes).
+static void flush_stored_settings(void)
+{
+    if (!stored_dirty) return;
+    stored_dirty = false;
+
+    if (cc_cal.valid) stored.cc_offset_lsb = cc_cal.offset_lsb;
+    stored.learned_mAh = capacity.learned_mAh;
+    stored.cycle_mAh = capacity.cycle_mAh;
+    stored.cycles = capacity.cycles;
+    stored.learn_count = capacity.learn_count;
+    stored.cell_count = topology->cells;
+    stored.idle_after_s = (uint16_t)(power_config.idle_after_ms / 1000UL);
+    stored.meter_mode = meter_mode;
+    stored.meter_period_s = meter_period_s;
+
+    set_activity(&measure_ctx, ACTIVITY_FLASH);
+    watchdog_pause();
+    stored_valid = nvm_store_save(&stored, sizeof(stored));
+    watchdog_resume();
+    if (!stored_valid) telemetry_text("Settings save failed");
+}
+
+
+//Boot calibration: the FETs are still off after enable_BQ76920(), so take
+//a fresh offset from BMS_CC_CAL_SAMPLES conversions (about 4 s). It
+//replaces the stored one rather than being blended in.
+static void calibrate_cc_offset(void)
+{
+    bms_cc_cal_t boot = { 0.0f, 0, 0, false };
+    int16_t cc_value;
+
+    for (uint8_t n = 0; n < 2 * BMS_CC_CAL_SAMPLES && !boot.valid; n++)
+    {
+        bool fets_off, ok;
+
+        vTaskDelay(pdMS_TO_TICKS(CC_CONVERSION_MS));
+        watchdog_checkin(measure_ctx.watchdog_id, measure_ctx.activity);     //up to 8 s at boot
+        afe_lock(&measure_ctx);
+        fets_off = cc_fets_off();
+        ok = fets_off && read_cc_raw(&cc_value);
+        afe_unlock();
+        if (!fets_off) return;          //keep the stored offset
+        if (ok) bms_cc_cal_sample(&boot, cc_value);
+    }
+
+    if (boot.valid)
+    {
+        cc_cal.offset_lsb = boot.offset_lsb;
+        cc_cal.valid = true;
+        cc_offset_updated();
+    }
+}
+
+
+//Reports a new offset estimate and stores it once it has moved far enough
+//from the stored one (keeps flash erases rare)
+static void cc_offset_updated(void)
+{
+    float moved = cc_cal.offset_lsb - stored.cc_offset_lsb;
+    telemetry_msg_t msg = { TELEMETRY_CC_OFFSET, 0, 0, 0, NULL, cc_cal.offset_lsb, 0.0f, 0 };
+
+    telemetry_post(&msg);
+
+    if (!stored_valid || moved >= CC_OFFSET_SAVE_LSB || moved <= -CC_OFFSET_SAVE_LSB)
+    {
+        save_stored_settings();
+    }
+}
+
+
+//"cc" reports the offset and dead-band, "cc deadband <mA>" sets the
+//dead-band, "cc cal" discards the offset so the next FETs-off window
+//measures it from scratch.
+static bool cc_offset_command(const cmd_args_t *args)
+{
+    const char *arg1 = args->argv[0];
+    measure_reply_t m;
+    bool fets_off;
+
+    if (arg1 == NULL)
+    {
+        measure_request(MEASURE_REPORT, 0, 0, &m);
+    }
+    else if (strcmp(arg1, "deadband") == 0 && args->argc == 2 && args->num[1] <= 0xFFFF)
+    {
+        measure_request(MEASURE_CC_DEADBAND, (uint16_t)args->num[1], 0, &m);
+    }
+    else if (strcmp(arg1, "cal") == 0)
+    {
+        measure_request(MEASURE_CC_CAL, 0, 0, &m);
+    }
+    else
+    {
+        return false;
+    }
+    afe_lock(&console_ctx);
+    fets_off = cc_fets_off();
+    afe_unlock();
+
+    uart1_send_string("CC offset: ");
+    if (m.cc_cal.valid)
+    {
+        uart1_send_float(m.cc_cal.offset_lsb, 4);
+        uart1_send_string(" LSB (");
+        uart1_send_float(bms_cc_raw_to_current_A(1, coulomb_counter_gain_uV, shunt_resistance_ohm)
+                         * m.cc_cal.offset_lsb * 1000.0f, 1);
+        uart1_send_string(" mA)");
+    }
+    else
+    {
+        uart1_send_string("not measured");
+    }
+    uart1_send_string(", dead-band ");
+    uart1_send_u16(m.cc_deadband_mA);
+    uart1_send_string(" mA");
+    uart1_send_string(fets_off ? ", FETs off: calibrating\r\n" : "\r\n");
+    return true;
+}
+
+
+//A point where SoC is known: closes the capacity-learning segment. The
+//state is stored at every anchor, which also keeps the partial cycle.
+static void learn_from_anchor(float anchor_soc)
+{
+    if (cap_learn_anchor(&capacity, anchor_soc))
+    {
+        soc_ekf_set_capacity(&soc_ekf, (uint16_t)capacity.learned_mAh);
+        telemetry_msg_t msg = { TELEMETRY_CAPACITY, 0, capacity.cycles, capacity.learn_count, NULL,
+                                capacity.learned_mAh, cap_learn_soh_percent(&capacity), 0 };
+        telemetry_post(&msg);
+    }
+    save_stored_settings();
+}
+
+
+static void send_capacity(float learned_mAh, float soh_percent, uint16_t cycles, uint16_t updates)
+{
+    uart1_send_string("Capacity: ");
+    uart1_send_float(learned_mAh, 0);
+    uart1_send_string(" mAh (SoH ");
+    uart1_send_float(soh_percent, 1);
+    uart1_send_string(" %, ");
+    uart1_send_u16(cycles);
+    uart1_send_string(" cycles, ");
+    uart1_send_u16(updates);
+    uart1_send_string(" updates)\r\n");
+}
+
+
+//"cap" reports the learned capacity, "cap reset" starts over from the
+//nominal capacity with no cycles (e.g. after fitting a new pack)
+static bool capacity_command(const cmd_args_t *args)
+{
+    measure_reply_t m;
+
+    if (args->argv[0] == NULL)
+    {
+        measure_request(MEASURE_REPORT, 0, 0, &m);
+    }
+    else if (strcmp(args->argv[0], "reset") == 0)
+    {
+        measure_request(MEASURE_CAP_RESET, 0, 0, &m);
+    }
+    else
+    {
+        return false;
+    }
+    send_capacity(m.learned_mAh, m.soh_percent, m.cycles, m.learn_count);
+    return true;
+}
+
+
+//One snapshot into the rolling statistics. Skipped if any populated cell
+//reads as an open input, so the windows stay aligned across cells.
+static void feed_cell_stats(const cell_frame_t *frame)
+{
+    if (frame->errors != 0) return;
+    cell_stats_add(&cell_stats, frame->mV);
+}
+
+
+//Block for the 'g' status:
+//  Cell Stats (last N samples):
+//    Cn: min <mV> max <mV> avg <mV> sd <mV> mV
+//    Imbalance: <mV> mV, weakest Cn
+static void send_cell_stats(const measure_reply_t *m)
+{
+    if (m->stats_count == 0) return;
+
+    uart1_send_string("Cell Stats (last ");
+    uart1_send_u16(m->stats_count);
+    uart1_send_string(" samples):\r\n");
+    for (uint8_t n = 0; n < m->stats_cells; n++)
+    {
+        const cell_stat_t *st = &m->stats[n];
+        uart1_send_string("  C");
+        uart1_send_u16(cell_topology_input(m->topology, n) + 1);
+        uart1_send_string(": min ");
+        uart1_send_u16(st->min_mV);
+        uart1_send_string(" max ");
+        uart1_send_u16(st->max_mV);
+        uart1_send_string(" avg ");
+        uart1_send_float(st->mean_mV, 1);
+        uart1_send_string(" sd ");
+        uart1_send_float(st->sd_mV, 1);
+        uart1_send_string(" mV\r\n");
+    }
+    uart1_send_string("  Imbalance: ");
+    uart1_send_float(m->imbalance_mV, 1);
+    uart1_send_string(" mV, weakest C");
+    uart1_send_u16(cell_topology_input(m->topology, m->weakest) + 1);
+    uart1_send_string("\r\n");
+}
+
+
+//"stats" prints one line for polling:
+//  Stats N: Cn min,max,avg,sd ... delta <mV> weakest Cn
+//"stats reset" empties the windows, "stats window <n> [<snapshots>]" resizes
+//them (and empties them)
+static bool cell_stats_command(const cmd_args_t *args)
+{
+    const char *arg1 = args->argv[0];
+    measure_reply_t m;
+
+    if (arg1 != NULL)
+    {
+        if (strcmp(arg1, "reset") == 0)
+        {
+            measure_request(MEASURE_STATS_RESET, 0, 0, &m);
+        }
+        else if (strcmp(arg1, "window") == 0 && args->argc >= 2 &&
+                 args->num[1] <= 0xFF && args->num[2] <= 0xFF)
+        {
+            uint16_t decimate = (args->argc == 3) ? (uint16_t)args->num[2] : MEASURE_KEEP;
+            measure_request(MEASURE_STATS_WINDOW, (uint16_t)args->num[1], decimate, &m);
+        }
+        else
+        {
+            return false;
+        }
+        uart1_send_string("Stats window: ");
+        uart1_send_u16(m.stats_window);
+        uart1_send_string(" x ");
+        uart1_send_u16(m.stats_decimate);
+        uart1_send_string(" snapshots\r\n");
+        return true;
+    }
+
+    measure_request(MEASURE_REPORT, 0, 0, &m);
+    uart1_send_string("Stats ");
+    uart1_send_u16(m.stats_count);
+    uart1_send_string(":");
+    for (uint8_t n = 0; n < m.stats_cells && m.stats_count > 0; n++)
+    {
+        const cell_stat_t *st = &m.stats[n];
+        uart1_send_string(" C");
+        uart1_send_u16(cell_topology_input(m.topology, n) + 1);
+        UART1_Write(' ');
+        uart1_send_u16(st->min_mV);
+        UART1_Write(',');
+        uart1_send_u16(st->max_mV);
+        UART1_Write(',');
+        uart1_send_float(st->mean_mV, 1);
+        UART1_Write(',');
+        uart1_send_float(st->sd_mV, 1);
+    }
+    uart1_send_string(" delta ");
+    uart1_send_float(m.imbalance_mV, 1);
+    uart1_send_string(" weakest C");
+    uart1_send_u16(cell_topology_input(m.topology, m.weakest) + 1);
+    uart1_send_string("\r\n");
+    return true;
+}
+
+
+//Runs in the measurement task: makes the change a command asked for and
+//copies what the command reports into its reply
+static void measure_apply(const measure_request_t *req)
+{
+    measure_reply_t *r = req->reply;
+    uint32_t readings;
+    uint8_t decimate;
+
+    if (req->op == MEASURE_WAKE)
+    {
+        //Expect the load that woke it: sample fast until it proves calm
+        sample_rate_init(&sampling, SAMPLE_TIER_FAST);
+        return;
+    }
+
+    r->ok = true;
+    switch (req->op)
+    {
+    case MEASURE_SOC_ENGINE:
+        //Both engines hand over the current SoC, so switching doesn't cause
+        //a jump (remaining_capacity_mAh was kept in step by the EKF)
+        if (req->value == SOC_ENGINE_EKF && soc_engine != SOC_ENGINE_EKF) start_soc_ekf();
+        soc_engine = (uint8_t)req->value;
+        break;
+    case MEASURE_CC_CAL:
+        cc_cal.offset_lsb = 0.0f;
+        cc_cal.valid = false;
+        bms_cc_cal_restart(&cc_cal);
+        break;
+    case MEASURE_CC_DEADBAND:
+        cc_deadband_mA = req->value;
+        break;
+    case MEASURE_CAP_RESET:
+        cap_learn_init(&capacity, BATTERY_CAPACITY_MAH, BATTERY_CHEMISTRY);
+        soc_ekf_set_capacity(&soc_ekf, (uint16_t)capacity.learned_mAh);
+        save_stored_settings();
+        break;
+    case MEASURE_CELLS:
+        r->ok = select_cell_count((uint8_t)req->value);
+        if (r->ok) save_stored_settings();
+        break;
+    case MEASURE_STATS_RESET:
+        cell_stats_init(&cell_stats, cell_stats.cells, cell_stats.window, cell_stats.decimate);
+        break;
+    case MEASURE_STATS_WINDOW:
+        decimate = (req->value2 == MEASURE_KEEP) ? cell_stats.decimate : (uint8_t)req->value2;
+        cell_stats_init(&cell_stats, cell_stats.cells, (uint8_t)req->value, decimate);
+        break;
+    case MEASURE_RATE:
+        sampling_forced = (uint8_t)req->value;
+        break;
+    case MEASURE_POWER:
+        set_activity(&measure_ctx, ACTIVITY_POWER);
+        afe_lock(&measure_ctx);
+        r->ok = (power.state == POWER_SHIP) ? false :
+                set_power_state((uint8_t)req->value, POWER_REASON_COMMAND, TMR2_Counter32BitGet());
+        afe_unlock();
+        if (r->ok && req->value == POWER_ACTIVE) sample_rate_init(&sampling, SAMPLE_TIER_FAST);
+        break;
+    case MEASURE_POWER_AUTO:
+        power_config.idle_after_ms = req->value * 1000UL;
+        power_activity(&power);
+        save_stored_settings();
+        break;
+    case MEASURE_METER:
+        r->ok = set_meter_mode((uint8_t)req->value);
+        if (r->ok && req->value2 != MEASURE_KEEP) meter_period_s = req->value2;
+        if (r->ok) save_stored_settings();
+        break;
+    case MEASURE_METER_SAMPLE:
+        //An update of its own, between the scheduled ones
+        readings = meter.readings;
+        meter_sample = true;
+        update_soc_from_cc();
+        r->ok = (meter.readings != readings);
+        break;
+    default:
+        break;
+    }
+
+    r->topology = topology;
+    r->cc_cal = cc_cal;
+    r->cc_deadband_mA = cc_deadband_mA;
+    r->learned_mAh = capacity.learned_mAh;
+    r->soh_percent = cap_learn_soh_percent(&capacity);
+    r->cycles = capacity.cycles;
+    r->learn_count = capacity.learn_count;
+    r->stats_cells = cell_stats.cells;
+    r->stats_count = cell_stats.count;
+    r->stats_window = cell_stats.window;
+    r->stats_decimate = cell_stats.decimate;
+    for (uint8_t n = 0; n < cell_stats.cells && cell_stats.count > 0; n++)
+    {
+        cell_stats_get(&cell_stats, n, &r->stats[n]);
+    }
+    r->weakest = 0;
+    r->imbalance_mV = cell_stats_imbalance_mV(&cell_stats, &r->weakest);
+    r->power = power;
+    r->idle_after_s = (uint16_t)(power_config.idle_after_ms / 1000UL);
+    r->meter_mode = meter_mode;
+    r->meter_period_s = meter_period_s;
+    r->meter = meter;
+}
+
+
+//From the console: has the measurement task run op and waits for its
+//reply (at most one of its updates). Returns reply->ok.
+static bool measure_request(uint8_t op, uint16_t value, uint16_t value2, measure_reply_t *reply)
+{
+    measure_request_t req = { op, value, value2, reply };
 
-    sprintf(uart_buf, "Current: %.2f A | SoC: %.2f %%\r\n", current_A, soc_percent);
-    uart1_send_string(uart_buf);
+    xQueueSend(measure_requests, &req, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return reply->ok;
 }
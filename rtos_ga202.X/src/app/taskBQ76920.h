@@ -4,8 +4,9 @@
  * Summary: Task header for interfacing with BQ76920 battery monitor
  * 
  * Description:
- *   This module sets up a FreeRTOS task that communicates with the BQ76920
- *   over I2C to read cell voltages and state of charge (SoC).
+ *   This module sets up the FreeRTOS tasks that communicate with the
+ *   BQ76920 over I2C: protection (fault polling, FETs off), measurement
+ *   (cell voltages and state of charge), telemetry and the UART console.
  *   The readings are transmitted over UART for display/debugging.
  */
 
@@ -17,20 +18,14 @@ extern "C" {
 #endif
 
 /**
- * @brief Initializes the BQ76920 I2C/UART task.
+ * @brief Initializes the BQ76920 I2C/UART tasks.
  * 
- * This function initializes any hardware interfaces required (I2C1, UART1)
- * and registers the FreeRTOS task that will run periodic voltage monitoring.
+ * This function creates the locks and queues shared by the tasks and
+ * registers the four FreeRTOS tasks and their watchdog entries.
  */
 void taskBQ76920_init(void);
 
 
-extern uint16_t adc_gain_uV;
-extern int8_t adc_offset_mV;
-
-
-
-
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,86 @@
+/*
+ * trace.c
+ * Ring buffer of cycle-stamped events and its binary dump
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "trace.h"
+#include "clock.h"
+#include "uart1.h"
+#include "uart_fmt.h"
+
+typedef struct
+{
+    uint16_t cycles_lo;             //TMR2
+    uint16_t cycles_hi;             //TMR3, latched by the TMR2 read
+    uint8_t type;
+    uint8_t arg;
+} trace_record_t;
+
+static trace_record_t buffer[TRACE_EVENTS];
+static uint8_t head = 0;            //next slot
+static uint8_t count = 0;
+static volatile bool recording = true;
+
+
+void trace_event(uint8_t type, uint8_t arg)
+{
+    //DISI rather than the kernel critical section: it costs one cycle,
+    //also holds off interrupts above the kernel priority and works before
+    //the scheduler starts. Stamp inside it so the records stay in order.
+    __builtin_disi(0x3FFF);
+    if (recording)
+    {
+        trace_record_t *r = &buffer[head];
+
+        head = (head + 1) & (TRACE_EVENTS - 1);
+        if (count < TRACE_EVENTS) count++;
+        r->cycles_lo = TMR2;
+        r->cycles_hi = TMR3HLD;
+        r->type = type;
+        r->arg = arg;
+    }
+    DISICNT = 0;
+}
+
+
+static void send_u16_le(uint16_t value)
+{
+    UART1_Write((uint8_t)value);
+    UART1_Write((uint8_t)(value >> 8));
+}
+
+
+bool trace_command(const cmd_args_t *args)
+{
+    uint8_t first;
+
+    (void)args;
+
+    //Stop first so the dump's own UART traffic doesn't overwrite it
+    recording = false;
+    first = (uint8_t)((head - count) & (TRACE_EVENTS - 1));
+
+    uart1_send_string("TRACE ");
+    uart1_send_u16(count);
+    UART1_Write(' ');
+    uart1_send_u32(CLOCK_PeripheralFrequencyGet());
+    uart1_send_string("\r\n");
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const trace_record_t *r = &buffer[(first + i) & (TRACE_EVENTS - 1)];
+
+        send_u16_le(r->cycles_lo);
+        send_u16_le(r->cycles_hi);
+        UART1_Write(r->type);
+        UART1_Write(r->arg);
+    }
+    uart1_send_string("\r\n");
+
+    count = 0;
+    recording = true;
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * File:    trace.h
+ * Summary: Binary ring buffer of timed firmware events
+ *
+ * Description:
+ *   Task switches (traceTASK_SWITCHED_IN in FreeRTOSConfig.h), I2C
+ *   transactions, UART TX queue drains, command dispatch, BQ76920 task
+ *   steps and clock switches are logged as 6-byte records stamped with the
+ *   free-running TMR2/TMR3 cycle counter (tmr2.c). The last TRACE_EVENTS
+ *   are kept. The "trace" command sends them in binary, oldest first:
+ *
+ *     TRACE <count> <fcy_hz>\r\n
+ *     <count> x { uint32_t cycles, uint8_t type, uint8_t arg }, little-endian
+ *     \r\n
+ *
+ *   fcy_hz is the counter rate when the dump starts. A TRACE_CLOCK record
+ *   carries the rate in MHz that was in force before it, so the host can
+ *   walk back from the newest record. Python_GUI_BQ76920/trace_view.py
+ *   turns the dump into a Chrome tracing (chrome://tracing, Perfetto) JSON
+ *   timeline.
+ *
+ *   This header is included by FreeRTOSConfig.h, keep it free of RTOS
+ *   includes.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmd_parse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_EVENTS        64      //power of 2, 6 bytes each
+
+typedef enum
+{
+    TRACE_TASK = 1,                 //arg: trace_task_t switched in
+    TRACE_I2C_START,                //arg: 0
+    TRACE_I2C_DONE,                 //arg: 0 stop sent, 1 bus collision
+    TRACE_UART_DRAIN,               //arg: 0, the TX interrupt emptied the queue
+    TRACE_COMMAND,                  //arg: 0, a command line is dispatched
+    TRACE_COMMAND_END,              //arg: its index in the command table, 0xFF if unknown
+    TRACE_STEP,                     //arg: step of a BQ76920 task (activity code high byte)
+    TRACE_CLOCK                     //arg: Fcy in MHz before the switch
+} trace_type_t;
+
+//Task ids, set as the FreeRTOS application task tag of each task
+typedef enum
+{
+    TRACE_TASK_IDLE = 0,            //untagged tasks show up as idle
+    TRACE_TASK_TIMER,
+    TRACE_TASK_PROTECT,
+    TRACE_TASK_MEASURE,
+    TRACE_TASK_TELEMETRY,
+    TRACE_TASK_CONSOLE
+} trace_task_t;
+
+/**
+ * @brief Logs one event. Callable from tasks and interrupts, about 20
+ *        instruction cycles.
+ */
+void trace_event(uint8_t type, uint8_t arg);
+
+/**
+ * @brief "trace" sends the buffer in binary and starts a new one.
+ */
+bool trace_command(const cmd_args_t *args);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TRACE_H */
@@ -0,0 +1,170 @@
+/*
+ * uart_fmt.c
+ * Integer, hex and fixed-point formatting written directly to UART1
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart_fmt.h"
+#include "uart1.h"
+
+static const uint32_t pow10_u32[9] =
+{
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL
+};
+
+static const uint16_t pow10_u16[4] = { 10000u, 1000u, 100u, 10u };
+
+static const float pow10_f[5] = { 1.0f, 10.0f, 100.0f, 1000.0f, 10000.0f };
+
+static const char hex_digits[16] =
+{
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+
+//Writes all 10 decimal digits of value, leading zeros included
+static void u32_to_digits(uint32_t value, char digits[10])
+{
+    for (uint8_t i = 0; i < 9; i++)
+    {
+        char digit = '0';
+        while (value >= pow10_u32[i])
+        {
+            value -= pow10_u32[i];
+            digit++;
+        }
+        digits[i] = digit;
+    }
+    digits[9] = (char)('0' + value);
+}
+
+
+void uart1_send_u16(uint16_t value)
+{
+    bool leading = true;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        char digit = '0';
+        while (value >= pow10_u16[i])
+        {
+            value -= pow10_u16[i];
+            digit++;
+        }
+        if (digit != '0' || !leading)
+        {
+            UART1_Write(digit);
+            leading = false;
+        }
+    }
+    UART1_Write((uint8_t)('0' + value));
+}
+
+
+void uart1_send_u32(uint32_t value)
+{
+    char digits[10];
+    uint8_t i = 0;
+
+    if (value <= 0xFFFFu)
+    {
+        uart1_send_u16((uint16_t)value);    //16-bit subtractions are cheaper
+        return;
+    }
+
+    u32_to_digits(value, digits);
+    while (digits[i] == '0') i++;           //value > 0xFFFF, so this stops early
+    for (; i < 10; i++)
+    {
+        UART1_Write(digits[i]);
+    }
+}
+
+
+void uart1_send_i32(int32_t value)
+{
+    if (value < 0)
+    {
+        UART1_Write('-');
+        uart1_send_u32(0u - (uint32_t)value);   //also right for INT32_MIN
+    }
+    else
+    {
+        uart1_send_u32((uint32_t)value);
+    }
+}
+
+
+void uart1_send_hex(uint16_t value, uint8_t digits)
+{
+    if (digits > 4) digits = 4;
+
+    while (digits > 0)
+    {
+        digits--;
+        UART1_Write(hex_digits[(value >> (digits * 4)) & 0x0F]);
+    }
+}
+
+
+void uart1_send_fixed(int32_t value, uint8_t decimals)
+{
+    uint32_t magnitude = (uint32_t)value;
+    char digits[10];
+    uint8_t point, i = 0;
+
+    if (value < 0)
+    {
+        UART1_Write('-');
+        magnitude = 0u - (uint32_t)value;
+    }
+
+    if (decimals == 0)
+    {
+        uart1_send_u32(magnitude);
+        return;
+    }
+    if (decimals > 9) decimals = 9;
+
+    u32_to_digits(magnitude, digits);
+    point = 10 - decimals;                  //index of the first fractional digit
+    while (i < point - 1 && digits[i] == '0') i++;
+    for (; i < 10; i++)
+    {
+        if (i == point) UART1_Write('.');
+        UART1_Write(digits[i]);
+    }
+}
+
+
+void uart1_send_float(float value, uint8_t decimals)
+{
+    float scaled;
+
+    if (value != value)
+    {
+        uart1_send_string("nan");
+        return;
+    }
+
+    if (decimals > 4) decimals = 4;
+    scaled = value * pow10_f[decimals];
+    scaled += (scaled < 0.0f) ? -0.5f : 0.5f;
+
+    if (scaled >= 2147483648.0f)
+    {
+        uart1_send_string("inf");
+    }
+    else if (scaled < -2147483648.0f)
+    {
+        uart1_send_string("-inf");
+    }
+    else
+    {
+        uart1_send_fixed((int32_t)scaled, decimals);
+    }
+}
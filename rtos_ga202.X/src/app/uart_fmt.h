@@ -0,0 +1,60 @@
+/*
+ * File:    uart_fmt.h
+ * Summary: sprintf-free number formatting straight into the UART1 TX queue
+ *
+ * Description:
+ *   Each function writes its digits with UART1_Write(), so nothing is built
+ *   in a stack buffer first. Decimal conversion subtracts powers of ten
+ *   instead of dividing. The PIC24 has no 32-bit divide instruction, so this
+ *   avoids the library divide calls that printf makes for every digit.
+ */
+
+#ifndef _UART_FMT_H
+#define _UART_FMT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Unsigned decimal, same output as "%u".
+ */
+void uart1_send_u16(uint16_t value);
+
+/**
+ * @brief Unsigned decimal, same output as "%lu".
+ */
+void uart1_send_u32(uint32_t value);
+
+/**
+ * @brief Signed decimal, same output as "%ld".
+ */
+void uart1_send_i32(int32_t value);
+
+/**
+ * @brief Upper-case hex with a fixed number of digits (1..4) and no prefix,
+ *        e.g. uart1_send_hex(raw, 4) matches "%04X".
+ */
+void uart1_send_hex(uint16_t value, uint8_t digits);
+
+/**
+ * @brief Fixed-point decimal: prints value / 10^decimals with exactly
+ *        `decimals` fractional digits, e.g. (-1234, 2) -> "-12.34".
+ */
+void uart1_send_fixed(int32_t value, uint8_t decimals);
+
+/**
+ * @brief Float with `decimals` fractional digits (0..4), rounded half away
+ *        from zero. Prints "nan", or "inf"/"-inf" when the scaled value
+ *        does not fit in 32 bits.
+ */
+void uart1_send_float(float value, uint8_t decimals);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _UART_FMT_H */
@@ -0,0 +1,129 @@
+/*
+ * watchdog.c
+ * WDT servicing from the tick hook and the persistent record of a miss
+ */
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "watchdog.h"
+#include "uart1.h"
+#include "uart_fmt.h"
+
+#define RCON_WDTO       0x0010
+
+static supervisor_t supervisor;
+static uint16_t poll_ticks = 0;
+static bool started = false;
+
+//Not cleared at startup, so it survives the WDT reset it explains
+static supervisor_record_t record __attribute__((persistent));
+
+
+static uint16_t now16(void)
+{
+    return (uint16_t)xTaskGetTickCount();
+}
+
+
+uint8_t watchdog_register(const char *name, uint16_t timeout_ms)
+{
+    uint8_t id;
+
+    taskENTER_CRITICAL();
+    id = supervisor_register(&supervisor, name, (uint16_t)pdMS_TO_TICKS(timeout_ms), now16());
+    taskEXIT_CRITICAL();
+    return id;
+}
+
+
+void watchdog_checkin(uint8_t id, uint16_t activity)
+{
+    supervisor_checkin(&supervisor, id, now16(), activity);
+}
+
+
+void watchdog_activity(uint8_t id, uint16_t activity)
+{
+    supervisor_activity(&supervisor, id, activity);
+}
+
+
+void watchdog_pause(void)
+{
+    taskENTER_CRITICAL();
+    supervisor_pause(&supervisor, now16());
+    taskEXIT_CRITICAL();
+}
+
+
+void watchdog_resume(void)
+{
+    taskENTER_CRITICAL();
+    supervisor_resume(&supervisor, now16());
+    taskEXIT_CRITICAL();
+}
+
+
+//"Watchdog: <task> silent <ms> ms, activity 0x<code>, up <s> s (<n> total)"
+void watchdog_report(uint16_t reset_cause)
+{
+    if (supervisor_record_valid(&record) && record.pending)
+    {
+        uart1_send_string("Watchdog: ");
+        for (uint8_t i = 0; i < SUPERVISOR_NAME_BYTES && record.name[i] != '\0'; i++)
+        {
+            UART1_Write(record.name[i]);
+        }
+        uart1_send_string(" silent ");
+        uart1_send_u32((uint32_t)record.silent * portTICK_PERIOD_MS);
+        uart1_send_string(" ms, activity 0x");
+        uart1_send_hex(record.activity, 4);
+        uart1_send_string(", up ");
+        uart1_send_u32(record.uptime / configTICK_RATE_HZ);
+        uart1_send_string(" s (");
+        uart1_send_u16(record.trips);
+        uart1_send_string(" total)\r\n");
+
+        record.pending = false;
+        supervisor_record_seal(&record);
+    }
+    else if (reset_cause & RCON_WDTO)
+    {
+        uart1_send_string("Watchdog: no task record, the tick interrupt had stopped\r\n");
+    }
+}
+
+
+void watchdog_start(void)
+{
+    ClrWdt();
+    RCONbits.SWDTEN = 1;
+    started = true;
+}
+
+
+void watchdog_tick(void)
+{
+    bool tripped = supervisor.tripped;
+    TickType_t now;
+
+    if (!started || ++poll_ticks < pdMS_TO_TICKS(WATCHDOG_POLL_MS)) return;
+    poll_ticks = 0;
+
+    now = xTaskGetTickCountFromISR();
+    if (supervisor_poll(&supervisor, (uint16_t)now, &record))
+    {
+        ClrWdt();
+    }
+    else if (!tripped)
+    {
+        //The miss just happened: finish the record, then let the WDT expire
+        record.uptime = now;
+        supervisor_record_seal(&record);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * File:    watchdog.h
+ * Summary: WDT serviced only while every supervised task checks in
+ *
+ * Description:
+ *   The WDT (LPRC, 1:128 x 1:1024, about 4 s) is switched on by software
+ *   just before the scheduler starts. From then on the tick hook polls the
+ *   supervisor (supervisor.c) every WATCHDOG_POLL_MS and clears the WDT
+ *   only if all registered tasks have checked in within their timeouts.
+ *
+ *   When one doesn't, its name, last activity code and silence go into a
+ *   record in persistent RAM (not cleared by the C startup code), and the
+ *   WDT resets the chip a few seconds later. watchdog_report() prints that
+ *   record once after the reboot. A WDT reset with no record means the
+ *   tick interrupt itself stopped (interrupts disabled, a trap loop).
+ */
+
+#ifndef _WATCHDOG_H
+#define _WATCHDOG_H
+
+#include <stdint.h>
+
+#include "supervisor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WATCHDOG_POLL_MS    250
+
+/**
+ * @brief Supervises the calling code: it must call watchdog_checkin()
+ *        at least every timeout_ms (below 32 s). Returns the id to check
+ *        in with, SUPERVISOR_NONE if the table is full.
+ */
+uint8_t watchdog_register(const char *name, uint16_t timeout_ms);
+
+/**
+ * @brief The task is alive, now doing activity (its own code, 0 if unused).
+ */
+void watchdog_checkin(uint8_t id, uint16_t activity);
+
+/**
+ * @brief Updates the activity code only, e.g. before a blocking transfer.
+ */
+void watchdog_activity(uint8_t id, uint16_t activity);
+
+/**
+ * @brief Holds the supervisor around an operation that stalls every task,
+ *        such as a flash write (see supervisor_pause()). The WDT is still
+ *        cleared meanwhile, so the stall must stay well below its 4 s.
+ */
+void watchdog_pause(void);
+void watchdog_resume(void);
+
+/**
+ * @brief Prints the record of a missed check-in if one is pending, given
+ *        the RCON value captured at boot. Call before watchdog_start().
+ */
+void watchdog_report(uint16_t reset_cause);
+
+/**
+ * @brief Enables the WDT. Call right before vTaskStartScheduler().
+ */
+void watchdog_start(void);
+
+/**
+ * @brief Poll from vApplicationTickHook().
+ */
+void watchdog_tick(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _WATCHDOG_H */
@@ -49,6 +49,7 @@
 
 #include <xc.h>
 #include "clock.h"
+#include "trace.h"
 
 /*-----------------------------------------------------------
  * Application specific definitions.
@@ -74,7 +75,7 @@
 #define configISR_STACK_SIZE                    ( 400 )
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 #define configSUPPORT_STATIC_ALLOCATION         0
-#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 3 * 1024 )
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) 3 * 1024 + 512 )   /* 4 BQ76920 tasks, see taskBQ76920.c */
 #define configMAX_TASK_NAME_LEN                 ( 16 )
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
@@ -91,7 +92,7 @@
 
 /* Hook function related definitions. */
 #define configUSE_IDLE_HOOK                     1
-#define configUSE_TICK_HOOK                     0
+#define configUSE_TICK_HOOK                     1
 #define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_MALLOC_FAILED_HOOK            1
 
@@ -101,18 +102,22 @@
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
 /* Co-routine related definitions. */
-#define configUSE_CO_ROUTINES                   1
+#define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         2
 
 /* Software timer related definitions. */
 #define configUSE_TIMERS                        1
 #define configTIMER_TASK_PRIORITY               3
-#define configTIMER_QUEUE_LENGTH                50
+#define configTIMER_QUEUE_LENGTH                8     /* one timer (heartbeat.c), 10 B per entry */
 #define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
-#define configUSE_DAEMON_TASK_STARTUP_HOOK      0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK      1     /* tags the timer task for trace.c */
 
 /* Misc */
-#define configUSE_APPLICATION_TASK_TAG          0
+#define configUSE_APPLICATION_TASK_TAG          1     /* holds the trace_task_t id */
+
+/* Trace hooks (trace.c). Runs inside vTaskSwitchContext(), pxCurrentTCB is
+the task about to run. */
+#define traceTASK_SWITCHED_IN()     trace_event( TRACE_TASK, ( uint8_t ) ( uintptr_t ) pxCurrentTCB->pxTaskTag )
 
 
 /* Interrupt nesting behaviour configuration. */
@@ -129,11 +134,11 @@ Only API functions that end in ...FromISR() can be used within interrupts. */
 #define INCLUDE_uxTaskPriorityGet               1
 #define INCLUDE_vTaskDelete                     0
 #define INCLUDE_vTaskSuspend                    0
-#define INCLUDE_vTaskDelayUntil                 0
+#define INCLUDE_vTaskDelayUntil                 1
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          0
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_eTaskGetState                   1
 #define INCLUDE_xEventGroupSetBitFromISR        0
@@ -26,7 +26,6 @@
 #include <stdlib.h>      // Defines EXIT_FAILURE
 
 #include <FreeRTOS.h>
-#include <croutine.h>
 #include <task.h>
 
 #include <pin_manager.h>
@@ -34,17 +33,11 @@
 #include "FreeRTOSConfig.h"
 
 #include "board.h"
+#include "heartbeat.h"
 #include "taskBQ76920.h"
+#include "watchdog.h"
+#include "crash.h"
 
-/* Only one co-routine is created so the index is not significant. */
-#define crfFLASH_INDEX             (0)
-
-/* The number of flash co-routines to create. */
-#define mainNUM_FLASH_COROUTINES   (1)
-
-static void taskHeartbeat_Init(unsigned portBASE_TYPE uxPriority);
-static void taskHeartbeat_Execute(void);
-static void prvMainCoRoutine(CoRoutineHandle_t xHandle, unsigned portBASE_TYPE uxIndex);
 /*
                          Main application
  */
@@ -65,12 +58,11 @@ int main(void)
     //=========================================================================
     //    Application Task initialization
     //=========================================================================
-    taskHeartbeat_Init(mainNUM_FLASH_COROUTINES);
-    
 //Initialize UART and I2C, then initialize the task I created
     UART1_Initialize();
     I2C1_Initialize();
     taskBQ76920_init();
+    heartbeat_init();   //RB14 and CPU load, from the timer task
     
   
     
@@ -81,6 +73,8 @@ if (resetCause & 0x0001) uart1_send_string("Reset cause: MCLR\r\n");
 if (resetCause & 0x0010) uart1_send_string("Reset cause: WDT Timeout\r\n");
 if (resetCause & 0x0040) uart1_send_string("Reset cause: Brown-out\r\n");
 if (resetCause & 0x0080) uart1_send_string("Reset cause: Power-on\r\n");
+watchdog_report(resetCause);
+crash_report();
 
 
 
@@ -96,6 +90,7 @@ if (resetCause & 0x0080) uart1_send_string("Reset cause: Power-on\r\n");
     //=========================================================================
     //    FreeRTOS scheduler
     //=========================================================================
+    watchdog_start();   //after RCON = 0, which would clear SWDTEN
     vTaskStartScheduler();
 
     /* If all is well then this line will never be reached.  If it is reached
@@ -116,36 +111,3 @@ if (resetCause & 0x0080) uart1_send_string("Reset cause: Power-on\r\n");
 /**
  End of File
 */
-
-static void prvMainCoRoutine(CoRoutineHandle_t xHandle, unsigned portBASE_TYPE uxIndex)
-{
-    /* Co-routines MUST start with a call to crSTART. */
-    crSTART(xHandle);
-
-    for (;;)
-    {
-        taskHeartbeat_Execute();
-        crDELAY(xHandle, pdMS_TO_TICKS(1000));
-    }
-
-    /* Co-routines MUST end with a call to crEND. */
-    crEND();
-}
-
-static void taskHeartbeat_Init( unsigned portBASE_TYPE uxPriority )
-{
-    xCoRoutineCreate( prvMainCoRoutine, uxPriority, crfFLASH_INDEX );
-}
-
-/*
-    Process the heartbeat. This is done in the main event loop (as
-    opposed to an interrupt) so we can see if the App has locked up.
-*/
-static void taskHeartbeat_Execute(void)
-{
-    portENTER_CRITICAL();
-    {
-//        IO_TOGGLE(LED_2);
-    }
-    portEXIT_CRITICAL();
-}
@@ -1,8 +1,10 @@
 #include "FreeRTOS.h"
 #include "task.h"
-#include "croutine.h"
 
 #include "../mcc_generated_files/pin_manager.h"
+#include "watchdog.h"
+#include "crash.h"
+#include "heartbeat.h"
 
 /*-----------------------------------------------------------*/
 
@@ -18,8 +20,27 @@ void vApplicationIdleHook( void )
 	function, because it is the responsibility of the idle task to clean up
 	memory allocated by the kernel to any task that has since been deleted. */
     
-    /* Schedule the co-routines from within the idle task hook. */
-    vCoRoutineSchedule();
+    /* Only counted: heartbeat.c turns the count into the CPU load. */
+    heartbeat_idle();
+}
+
+/*-----------------------------------------------------------*/
+
+void vApplicationTickHook( void )
+{
+	/* Called from the tick interrupt, so it keeps running while a task
+	spins. The WDT is only cleared here, and only while every supervised
+	task has checked in (watchdog.c). */
+	watchdog_tick();
+}
+
+/*-----------------------------------------------------------*/
+
+void vApplicationDaemonTaskStartupHook( void )
+{
+	/* Runs once in the timer task, so it can tag itself for the event
+	trace (trace.c). Tasks left untagged are traced as idle. */
+	vTaskSetApplicationTaskTag( NULL, ( TaskHookFunction_t ) TRACE_TASK_TIMER );
 }
 
 /*-----------------------------------------------------------*/
@@ -42,15 +63,13 @@ void vApplicationIdleHook( void )
 void vApplicationStackOverflowHook( TaskHandle_t xTask, char * pcTaskName )
 {
    ( void ) xTask;
-   ( void ) pcTaskName;
 
    /* Run time task stack overflow checking is performed if
    configCHECK_FOR_STACK_OVERFLOW is defined to 1 or 2.  This hook	function is
    called if a task stack overflow is detected.  Note the system/interrupt
-   stack is not checked. */
+   stack is not checked. Record it and reset (crash.c). */
    taskDISABLE_INTERRUPTS();
-   
-   for( ;; );
+   crash_fatal( CRASH_STACK_OVERFLOW, pcTaskName );
 }
 
 /*
@@ -94,8 +113,7 @@ void vApplicationMallocFailedHook( void )
       to query the size of free heap space that remains (although it does not
       provide information on how the remaining heap might be fragmented). */
    taskDISABLE_INTERRUPTS();
-   
-   for( ;; );
+   crash_fatal( CRASH_MALLOC_FAILED, NULL );
 }
 
 /*******************************************************************************
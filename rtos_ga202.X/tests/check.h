@@ -0,0 +1,38 @@
+/*
+ * check.h
+ * Minimal assertions for the host tests: a failed CHECK prints where and
+ * carries on, check_done() turns the count into the exit status.
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int check_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long check_a_ = (long long)(a), check_b_ = (long long)(b); \
+        if (check_a_ != check_b_) { \
+            printf("%s:%d: %s == %s failed (%lld != %lld)\n", \
+                   __FILE__, __LINE__, #a, #b, check_a_, check_b_); \
+            check_failures++; \
+        } \
+    } while (0)
+
+static inline int check_done(const char *name)
+{
+    printf("%s: %s\n", name, check_failures ? "FAILED" : "ok");
+    return check_failures ? 1 : 0;
+}
+
+#endif /* CHECK_H */
@@ -0,0 +1,827 @@
+/*
+ * sim.c
+ * Kernel, drivers and BQ76920 for running taskBQ76920.c on a PC (sim.h).
+ * Tasks are ucontext coroutines; only one runs at a time, so the model
+ * needs no locking. The kernel calls keep the FreeRTOS semantics the
+ * firmware relies on: fixed priorities, preemption when a higher priority
+ * task becomes ready, priority inheritance on mutexes, tick-based delays.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "clock.h"
+#include "clock_profile.h"
+#include "crash.h"
+#include "heartbeat.h"
+#include "i2c1.h"
+#include "nvm_store.h"
+#include "tmr2.h"
+#include "trace.h"
+#include "uart1.h"
+#include "watchdog.h"
+#include "sim.h"
+
+#define MAX_TASKS       8
+#define TASK_STACK      (256u * 1024u)
+#define FOREVER         UINT64_MAX
+
+uint64_t sim_us = 0;
+uint64_t sim_end_us = FOREVER;
+sim_line_fn sim_host = NULL;
+sim_hook_fn sim_input = NULL;
+sim_hook_fn sim_on_i2c = NULL;
+static uint64_t event_us = FOREVER;
+static sim_hook_fn event;
+unsigned long sim_i2c_transactions = 0;
+sim_i2c_t sim_i2c_last;
+
+uint32_t CLOCK_SystemFrequencyHz = 4000000;
+
+
+//Scheduler
+
+enum { TASK_READY, TASK_BLOCKED };
+
+typedef bool (*wait_fn)(void *arg);
+
+struct tskTaskControlBlock
+{
+    ucontext_t context;
+    TaskFunction_t code;
+    void *param;
+    const char *name;
+    UBaseType_t priority;
+    uint16_t stack_words;
+    int state;
+    uint64_t wake_us;               //timeout of a blocked task
+    wait_fn until;                  //or this becomes true
+    void *until_arg;
+    struct QueueDefinition *waiting_on;     //mutex, for priority inheritance
+    uint32_t notify;
+};
+
+struct QueueDefinition
+{
+    bool is_mutex;
+    struct tskTaskControlBlock *holder;
+    unsigned length, item_size, count, head;
+    uint8_t *items;
+};
+
+typedef struct tskTaskControlBlock task_t;
+typedef struct QueueDefinition queue_t;
+
+static task_t tasks[MAX_TASKS];
+static int task_count = 0;
+static task_t *current = NULL;
+static ucontext_t main_context;
+static bool started = false;
+
+
+//Base priority raised to that of any task waiting on a mutex it holds
+static UBaseType_t effective_priority(const task_t *t)
+{
+    UBaseType_t p = t->priority;
+
+    for (int i = 0; i < task_count; i++)
+    {
+        const task_t *w = &tasks[i];
+        if (w != t && w->state == TASK_BLOCKED && w->waiting_on != NULL && w->waiting_on->holder == t)
+        {
+            UBaseType_t q = effective_priority(w);
+            if (q > p) p = q;
+        }
+    }
+    return p;
+}
+
+static bool runnable(const task_t *t)
+{
+    if (t->state == TASK_READY) return true;
+    if (t->until != NULL && t->until(t->until_arg)) return true;
+    return sim_us >= t->wake_us;
+}
+
+static task_t *highest_runnable(void)
+{
+    task_t *best = NULL;
+
+    for (int i = 0; i < task_count; i++)
+    {
+        task_t *t = &tasks[i];
+        if (runnable(t) && (best == NULL || effective_priority(t) > effective_priority(best))) best = t;
+    }
+    return best;
+}
+
+static void switch_to(task_t *t)
+{
+    task_t *from = current;
+
+    if (t == from) return;
+    current = t;
+    swapcontext(from != NULL ? &from->context : &main_context, &t->context);
+}
+
+static uint64_t next_wake(void)
+{
+    uint64_t w = event_us > sim_us ? event_us : FOREVER;
+
+    for (int i = 0; i < task_count; i++)
+    {
+        if (tasks[i].state == TASK_BLOCKED && tasks[i].wake_us > sim_us && tasks[i].wake_us < w)
+            w = tasks[i].wake_us;
+    }
+    return w;
+}
+
+//Moves time on to t, runs a sim_at() event that has come due, and
+//returns from sim_start() once the run is over; the tasks never resume
+static void advance(uint64_t t)
+{
+    if (t > sim_us) sim_us = t;
+    if (sim_us >= event_us)
+    {
+        sim_hook_fn fn = event;
+        event_us = FOREVER;
+        fn();
+    }
+    if (sim_us < sim_end_us) return;
+    current = NULL;
+    setcontext(&main_context);
+}
+
+void sim_at(uint64_t us, sim_hook_fn fn)
+{
+    event_us = us;
+    event = fn;
+}
+
+//The running task gives way to a higher priority one that is ready
+static void preempt(void)
+{
+    task_t *t = highest_runnable();
+
+    if (t != NULL && t != current && effective_priority(t) > effective_priority(current)) switch_to(t);
+}
+
+//The running task waits until until(arg) or wake_us, whichever comes
+//first; holds mutex m for priority inheritance. With nothing to run,
+//time jumps to the next timeout. Returns until(arg).
+static bool block(wait_fn until, void *arg, uint64_t wake_us, queue_t *m)
+{
+    task_t *me = current;
+
+    for (;;)
+    {
+        task_t *t;
+
+        if (until != NULL && until(arg)) break;
+        if (sim_us >= wake_us) break;
+
+        me->state = TASK_BLOCKED;
+        me->until = until;
+        me->until_arg = arg;
+        me->wake_us = wake_us;
+        me->waiting_on = m;
+        while ((t = highest_runnable()) == NULL) advance(next_wake());
+        if (t != me) switch_to(t);
+        else me->state = TASK_READY;
+    }
+    me->state = TASK_READY;
+    me->until = NULL;
+    me->waiting_on = NULL;
+    me->wake_us = FOREVER;
+    return until != NULL && until(arg);
+}
+
+//Busy-waits until end_us; higher priority tasks run when they wake
+static void spin_until(uint64_t end_us)
+{
+    while (sim_us < end_us)
+    {
+        uint64_t step = next_wake();
+        advance(step < end_us ? step : end_us);
+        preempt();
+    }
+}
+
+void sim_cpu(uint32_t us)
+{
+    spin_until(sim_us + us);
+}
+
+static uint64_t timeout_us(TickType_t ticks)
+{
+    return ticks == portMAX_DELAY ? FOREVER : sim_us + (uint64_t)ticks * 1000u;
+}
+
+static void task_entry(void)
+{
+    current->code(current->param);
+    fprintf(stderr, "sim: task %s returned\n", current->name);
+    exit(1);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char * const name, const configSTACK_DEPTH_TYPE stack,
+                       void * const param, UBaseType_t priority, TaskHandle_t * const handle)
+{
+    task_t *t;
+
+    if (task_count == MAX_TASKS) return pdFAIL;
+    t = &tasks[task_count++];
+    getcontext(&t->context);
+    t->context.uc_stack.ss_size = TASK_STACK;
+    t->context.uc_stack.ss_sp = malloc(TASK_STACK);
+    t->context.uc_link = NULL;
+    makecontext(&t->context, task_entry, 0);
+    t->code = code;
+    t->param = param;
+    t->name = name;
+    t->priority = priority;
+    t->stack_words = stack;
+    t->state = TASK_READY;
+    t->wake_us = FOREVER;
+    if (handle != NULL) *handle = t;
+    return pdPASS;
+}
+
+void sim_start(void)
+{
+    task_t *t = highest_runnable();
+
+    if (t == NULL) return;
+    started = true;
+    current = NULL;
+    switch_to(t);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(sim_us / 1000u);
+}
+
+void vTaskDelay(const TickType_t ticks)
+{
+    block(NULL, NULL, sim_us + (uint64_t)ticks * 1000u, NULL);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t * const previous, const TickType_t increment)
+{
+    TickType_t next = *previous + increment;
+
+    *previous = next;
+    if ((TickType_t)(next - xTaskGetTickCount()) > increment) return pdFALSE;     //already late
+    block(NULL, NULL, (uint64_t)next * 1000u, NULL);
+    return pdTRUE;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t t)
+{
+    return t->stack_words / 2;
+}
+
+void vTaskSetApplicationTaskTag(TaskHandle_t t, TaskHookFunction_t tag)
+{
+}
+
+static bool notified(void *arg)
+{
+    return ((task_t *)arg)->notify != 0;
+}
+
+uint32_t ulTaskGenericNotifyTake(UBaseType_t index, BaseType_t clear, TickType_t ticks)
+{
+    uint32_t value;
+
+    block(notified, current, timeout_us(ticks), NULL);
+    value = current->notify;
+    if (value != 0) current->notify = clear ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskGenericNotify(TaskHandle_t t, UBaseType_t index, uint32_t value, eNotifyAction action,
+                              uint32_t *previous)
+{
+    t->notify++;
+    if (started) preempt();
+    return pdPASS;
+}
+
+
+//Queues and mutexes
+
+QueueHandle_t xQueueGenericCreate(const UBaseType_t length, const UBaseType_t item_size, const uint8_t type)
+{
+    queue_t *q = calloc(1, sizeof(*q));
+
+    q->length = length;
+    q->item_size = item_size;
+    q->items = calloc(length, item_size != 0 ? item_size : 1);
+    return q;
+}
+
+QueueHandle_t xQueueCreateMutex(const uint8_t type)
+{
+    queue_t *q = xQueueGenericCreate(1, 0, type);
+
+    q->is_mutex = true;
+    return q;
+}
+
+static bool has_space(void *arg)
+{
+    queue_t *q = arg;
+    return q->count < q->length;
+}
+
+static bool has_item(void *arg)
+{
+    queue_t *q = arg;
+    return q->count > 0;
+}
+
+static bool mutex_free(void *arg)
+{
+    queue_t *q = arg;
+    return q->holder == NULL;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t q, const void * const item, TickType_t ticks, const BaseType_t position)
+{
+    if (q->is_mutex)
+    {
+        if (q->holder != current)
+        {
+            fprintf(stderr, "sim: mutex given by %s, which doesn't hold it\n", current->name);
+            exit(1);
+        }
+        q->holder = NULL;
+        preempt();
+        return pdPASS;
+    }
+
+    if (!has_space(q) && (ticks == 0 || !block(has_space, q, timeout_us(ticks), NULL))) return errQUEUE_FULL;
+    memcpy(q->items + ((q->head + q->count) % q->length) * q->item_size, item, q->item_size);
+    q->count++;
+    if (started) preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void * const buffer, TickType_t ticks)
+{
+    if (!has_item(q) && (ticks == 0 || !block(has_item, q, timeout_us(ticks), NULL))) return pdFALSE;
+    memcpy(buffer, q->items + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueSemaphoreTake(QueueHandle_t q, TickType_t ticks)
+{
+    if (!mutex_free(q) && (ticks == 0 || !block(mutex_free, q, timeout_us(ticks), q))) return pdFALSE;
+    q->holder = current;
+    return pdPASS;
+}
+
+
+//BQ76920
+
+#define BQ_SYS_STAT         0x00
+#define BQ_SYS_CTRL1        0x04
+#define BQ_SYS_CTRL2        0x05
+#define BQ_CONFIG_LAST      0x0B
+#define BQ_VC1_HI           0x0C
+#define BQ_CC_HI            0x32
+#define BQ_CONVERSION_US    250000u
+
+#define CTRL1_LOAD_PRESENT  0x80
+#define CTRL1_ADC_EN        0x10
+#define CTRL2_CC_EN         0x40
+#define CTRL2_CC_ONESHOT    0x20
+#define CTRL2_CHG_ON        0x01
+
+uint8_t bq[0x100];
+bool sim_model = false;
+bool sim_load = false;
+bool sim_bq_off = false;
+uint16_t sim_cell_raw = 3700000 / 382;
+int16_t sim_cc_lsb = -16;
+unsigned sim_oneshots = 0;
+unsigned sim_nacks = 0;
+
+//Bits of SYS_STAT+1..CONFIG_LAST that read back as written
+static const uint8_t writable[BQ_CONFIG_LAST] =
+    { 0x1F, 0x1F, 0x1F, 0x18, 0xC0, 0x9F, 0x7F, 0xF0, 0xFF, 0xFF, 0x3F };
+
+static uint8_t bq_pointer;
+static bool i2c_busy;
+static uint32_t i2c_hz = 100000;
+static uint64_t adc_on_us, cc_on_us, oneshot_us;
+static int shut_step;
+
+static void set_cells(uint16_t raw)
+{
+    for (int c = 0; c < 5; c++)
+    {
+        uint16_t v = (uint16_t)(raw + c * 3);
+        bq[BQ_VC1_HI + 2 * c] = (uint8_t)(v >> 8);
+        bq[BQ_VC1_HI + 2 * c + 1] = (uint8_t)v;
+    }
+}
+
+void bq_por(void)
+{
+    memset(bq, 0, sizeof(bq));
+    bq[BQ_SYS_STAT] = 0x20;                 //DEVICE_XREADY
+    bq[0x09] = 0xAC;                        //OV_TRIP
+    bq[0x0A] = 0x97;                        //UV_TRIP
+    set_cells(3700000 / 382);
+    bq[0x2A] = 0x1E;                        //BAT
+    bq[0x2B] = 0x84;
+    bq[0x2C] = 0x0D;                        //TS1
+    bq[0x2D] = 0x10;
+    bq[BQ_CC_HI] = 0xFF;
+    bq[BQ_CC_HI + 1] = 0xF0;
+    bq[0x50] = 0x0D;                        //ADCGAIN1, ADCOFFSET, ADCGAIN2
+    bq[0x51] = 0x05;
+    bq[0x59] = 0x08;
+}
+
+void sim_bq_wake(void)
+{
+    bq_por();
+    sim_bq_off = false;
+    shut_step = 0;
+}
+
+static void plain_write(uint8_t reg, uint8_t value)
+{
+    if (reg == BQ_SYS_STAT) bq[BQ_SYS_STAT] &= (uint8_t)~value;
+    else if (reg <= BQ_CONFIG_LAST) bq[reg] = value & writable[reg - 1];
+}
+
+static void model_write(uint8_t reg, uint8_t value)
+{
+    if (reg != BQ_SYS_CTRL1)
+    {
+        shut_step = 0;
+        if (reg == BQ_SYS_CTRL2)
+        {
+            if ((value & CTRL2_CC_EN) && !(bq[BQ_SYS_CTRL2] & CTRL2_CC_EN)) cc_on_us = sim_us;
+            if (value & CTRL2_CC_ONESHOT)
+            {
+                oneshot_us = sim_us;
+                sim_oneshots++;
+            }
+            bq[BQ_SYS_CTRL2] = value;
+        }
+        else plain_write(reg, value);
+        return;
+    }
+
+    //SHUT_A/SHUT_B: 00, 01, 10 in consecutive writes
+    switch (value & 3)
+    {
+    case 0: shut_step = 1; break;
+    case 1: shut_step = shut_step == 1 ? 2 : 0; break;
+    case 2:
+        if (shut_step == 2)
+        {
+            sim_bq_off = true;
+            shut_step = 0;
+            return;
+        }
+        shut_step = 0;
+        break;
+    default: shut_step = 0; break;
+    }
+    if ((value & CTRL1_ADC_EN) && !(bq[BQ_SYS_CTRL1] & CTRL1_ADC_EN)) adc_on_us = sim_us;
+    bq[BQ_SYS_CTRL1] = value & (uint8_t)~CTRL1_LOAD_PRESENT;
+}
+
+static void model_read(uint8_t reg)
+{
+    if (reg == BQ_SYS_CTRL1)
+    {
+        bq[BQ_SYS_CTRL1] &= (uint8_t)~CTRL1_LOAD_PRESENT;
+        if (sim_load && !(bq[BQ_SYS_CTRL2] & CTRL2_CHG_ON)) bq[BQ_SYS_CTRL1] |= CTRL1_LOAD_PRESENT;
+    }
+    if (reg >= BQ_VC1_HI && reg < BQ_VC1_HI + 10 && (bq[BQ_SYS_CTRL1] & CTRL1_ADC_EN) &&
+        sim_us >= adc_on_us + BQ_CONVERSION_US)
+        set_cells(sim_cell_raw);
+    if (reg == BQ_CC_HI)
+    {
+        bool continuous = (bq[BQ_SYS_CTRL2] & CTRL2_CC_EN) && sim_us >= cc_on_us + BQ_CONVERSION_US;
+        bool oneshot = (bq[BQ_SYS_CTRL2] & CTRL2_CC_ONESHOT) && sim_us >= oneshot_us + BQ_CONVERSION_US;
+        if (continuous || oneshot)
+        {
+            bq[BQ_CC_HI] = (uint8_t)((uint16_t)sim_cc_lsb >> 8);
+            bq[BQ_CC_HI + 1] = (uint8_t)sim_cc_lsb;
+            bq[BQ_SYS_CTRL2] &= (uint8_t)~CTRL2_CC_ONESHOT;
+        }
+    }
+}
+
+//Start, address, bytes and stop, busy-waited as the driver does
+static void i2c_transfer(bool read, uint8_t reg, const uint8_t *data, uint8_t len)
+{
+    uint8_t bytes = (uint8_t)(1 + (read ? 0 : 1) + len);      //address, register, data
+
+    if (i2c_busy)
+    {
+        fprintf(stderr, "sim: I2C used by %s during a transfer\n", current->name);
+        exit(1);
+    }
+    i2c_busy = true;
+    spin_until(sim_us + (uint64_t)(bytes * 9u + 2u) * 1000000u / i2c_hz);
+    i2c_busy = false;
+    sim_i2c_transactions++;
+    sim_i2c_last.task = current->name;
+    sim_i2c_last.read = read;
+    sim_i2c_last.reg = reg;
+    sim_i2c_last.data = data;
+    sim_i2c_last.len = len;
+    if (sim_on_i2c != NULL) sim_on_i2c();
+}
+
+void I2C1_MasterWrite(uint8_t *data, uint8_t length, uint16_t address, I2C1_MESSAGE_STATUS *status)
+{
+    i2c_transfer(false, data[0], &data[1], (uint8_t)(length - 1));
+    if (sim_model && sim_bq_off)
+    {
+        sim_nacks++;
+        *status = I2C1_MESSAGE_ADDRESS_NO_ACK;
+        return;
+    }
+    bq_pointer = data[0];
+    for (uint8_t i = 1; i < length; i++)
+    {
+        uint8_t reg = bq_pointer++;
+        if (sim_model) model_write(reg, data[i]);
+        else plain_write(reg, data[i]);
+    }
+    *status = I2C1_MESSAGE_COMPLETE;
+}
+
+void I2C1_MasterRead(uint8_t *data, uint8_t length, uint16_t address, I2C1_MESSAGE_STATUS *status)
+{
+    i2c_transfer(true, bq_pointer, NULL, length);
+    if (sim_model && sim_bq_off)
+    {
+        sim_nacks++;
+        *status = I2C1_MESSAGE_ADDRESS_NO_ACK;
+        return;
+    }
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (sim_model) model_read(bq_pointer);
+        data[i] = bq[bq_pointer++];
+    }
+    *status = I2C1_MESSAGE_COMPLETE;
+}
+
+void I2C1_Initialize(void)
+{
+}
+
+bool I2C1_BusSpeedSet(uint32_t hz)
+{
+    i2c_hz = hz;
+    return true;
+}
+
+uint32_t I2C1_BusSpeedGet(void)
+{
+    return i2c_hz;
+}
+
+void I2C1_TimingGet(I2C1_TIMING *timing)
+{
+    memset(timing, 0, sizeof(*timing));
+}
+
+void I2C1_TimingReset(void)
+{
+}
+
+uint32_t TMR2_Counter32BitGet(void)
+{
+    return (uint32_t)(sim_us * (CLOCK_PeripheralFrequencyGet() / 1000000u));
+}
+
+
+//UART1: a line queue in, the 256 byte TX queue out
+
+static uint32_t baud = 9600;
+static char rx_queue[8192];
+static unsigned rx_head, rx_tail;
+static uint64_t rx_ready_us;
+static uint64_t tx_done_us;                 //when the TX queue will be empty
+static uint32_t tx_bytes;
+static char tx_line[1024];
+static unsigned tx_length;
+
+static uint64_t char_us(void)
+{
+    return 10u * 1000000u / baud;
+}
+
+void sim_send(const char *line)
+{
+    if (rx_ready_us < sim_us) rx_ready_us = sim_us;
+    while (*line != '\0') rx_queue[rx_tail++ % sizeof(rx_queue)] = *line++;
+    rx_queue[rx_tail++ % sizeof(rx_queue)] = '\n';
+}
+
+bool UART1_IsRxReady(void)
+{
+    if (rx_head == rx_tail && sim_input != NULL) sim_input();
+    return rx_head != rx_tail && sim_us >= rx_ready_us;
+}
+
+uint8_t UART1_Read(void)
+{
+    char c = rx_queue[rx_head++ % sizeof(rx_queue)];
+
+    rx_ready_us = sim_us + char_us();
+    return (uint8_t)c;
+}
+
+uint16_t UART1_RxLostCountGet(void)
+{
+    return 0;
+}
+
+void UART1_Write(uint8_t c)
+{
+    if (tx_done_us > sim_us + 255 * char_us()) spin_until(tx_done_us - 255 * char_us());     //queue full
+    if (tx_done_us < sim_us) tx_done_us = sim_us;
+    tx_done_us += char_us();
+    tx_bytes++;
+
+    if (c == '\n')
+    {
+        tx_line[tx_length] = '\0';
+        if (sim_host != NULL) sim_host(tx_line);
+        tx_length = 0;
+    }
+    else if (c != '\r' && tx_length < sizeof(tx_line) - 1) tx_line[tx_length++] = (char)c;
+}
+
+void UART1_TxFlush(void)
+{
+    spin_until(tx_done_us);
+}
+
+uint32_t UART1_TxByteCountGet(void)
+{
+    return tx_bytes;
+}
+
+void uart1_send_string(const char *str)
+{
+    while (*str != '\0') UART1_Write((uint8_t)*str++);
+}
+
+uint16_t UART1_BRGCompute(uint32_t fcy, uint32_t rate, int16_t *error_permille)
+{
+    if (error_permille != NULL) *error_permille = 0;
+    return 1;
+}
+
+bool UART1_BaudRateSet(uint32_t rate)
+{
+    baud = rate;
+    return true;
+}
+
+uint32_t UART1_BaudRateGet(void)
+{
+    return baud;
+}
+
+
+//The rest of the system, reduced to what the tasks see
+
+static uint8_t nvm[NVM_STORE_SLOT_WORDS * 2];
+static uint16_t nvm_size;
+
+bool nvm_store_load(void *data, uint16_t size)
+{
+    if (nvm_size == 0) return false;
+    memcpy(data, nvm, size < nvm_size ? size : nvm_size);
+    return true;
+}
+
+bool nvm_store_save(const void *data, uint16_t size)
+{
+    if (size > sizeof(nvm)) return false;
+    memcpy(nvm, data, size);
+    nvm_size = size;
+    return true;
+}
+
+void clock_profile_divisors(clock_profile_t profile, uint32_t rate, uint32_t i2c,
+                            clock_profile_divisors_t *out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+bool clock_profile_set(clock_profile_t profile)
+{
+    return profile == CLOCK_PROFILE_LOW_POWER;
+}
+
+clock_profile_t clock_profile_get(void)
+{
+    return CLOCK_PROFILE_LOW_POWER;
+}
+
+const char *clock_profile_name(clock_profile_t profile)
+{
+    return "low power";
+}
+
+void clock_profile_set_auto(bool enable)
+{
+}
+
+bool clock_profile_is_auto(void)
+{
+    return false;
+}
+
+clock_profile_t clock_profile_service(void)
+{
+    return CLOCK_PROFILE_LOW_POWER;
+}
+
+#define MAX_WATCHED 8
+static uint64_t last_checkin_us[MAX_WATCHED];
+static uint64_t checkin_gap_max_us[MAX_WATCHED];
+static uint8_t watched;
+
+uint8_t watchdog_register(const char *name, uint16_t timeout_ms)
+{
+    return watched < MAX_WATCHED ? watched++ : MAX_WATCHED - 1;
+}
+
+void watchdog_checkin(uint8_t id, uint16_t activity)
+{
+    if (last_checkin_us[id] != 0 && sim_us - last_checkin_us[id] > checkin_gap_max_us[id])
+        checkin_gap_max_us[id] = sim_us - last_checkin_us[id];
+    last_checkin_us[id] = sim_us;
+}
+
+void watchdog_activity(uint8_t id, uint16_t activity)
+{
+}
+
+void watchdog_pause(void)
+{
+}
+
+void watchdog_resume(void)
+{
+}
+
+uint64_t sim_checkin_gap_max(uint8_t id)
+{
+    return id < watched ? checkin_gap_max_us[id] : 0;
+}
+
+void crash_event(uint16_t code)
+{
+}
+
+bool crash_command(const cmd_args_t *args)
+{
+    uart1_send_string("Crash: none recorded\r\n");
+    return true;
+}
+
+void trace_event(uint8_t type, uint8_t arg)
+{
+}
+
+bool trace_command(const cmd_args_t *args)
+{
+    return true;
+}
+
+bool heartbeat_command(const cmd_args_t *args)
+{
+    uart1_send_string("CPU load: not measured\r\n");
+    return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * sim.h
+ * Host model that runs taskBQ76920.c unchanged: a fixed-priority
+ * preemptive scheduler for its four tasks, a BQ76920 on a 100 kHz I2C bus
+ * and a UART at the set baud rate. Time passes only in bus transfers,
+ * delays and sim_cpu(); a task is preempted as soon as a higher priority
+ * one becomes ready, and a mutex holder inherits the priority of its
+ * waiters, as on the target.
+ *
+ * A test sets up the model, calls taskBQ76920_init() and sim_start(),
+ * which returns once sim_us reaches sim_end_us. The hooks let it act on
+ * the model while the firmware runs.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*sim_line_fn)(const char *line);
+typedef void (*sim_hook_fn)(void);
+
+extern uint64_t sim_us;             //simulated time
+extern uint64_t sim_end_us;         //sim_start() returns here
+
+extern sim_line_fn sim_host;        //each line the firmware sends, without CR LF
+extern sim_hook_fn sim_input;       //called when the console finds no input; may sim_send()
+extern sim_hook_fn sim_on_i2c;      //called after each I2C transaction
+
+//BQ76920 register file. Without sim_model the configuration registers
+//keep their writable bits and SYS_STAT bits clear when written with 1.
+extern uint8_t bq[0x100];
+
+//Optional power model: ADC_EN gates the cell voltages, CC_EN and
+//CC_ONESHOT gate the Coulomb Counter (one conversion takes 250 ms),
+//LOAD_PRESENT follows sim_load while CHG is off, and the SHUT_A/SHUT_B
+//sequence turns the chip off until sim_bq_wake().
+extern bool sim_model;
+extern bool sim_load;
+extern bool sim_bq_off;             //the chip NACKs its address
+extern uint16_t sim_cell_raw;       //raw cell 1 reading, each next cell 3 LSB higher
+extern int16_t sim_cc_lsb;          //raw CC reading
+extern unsigned sim_oneshots;       //CC_ONESHOT writes
+extern unsigned sim_nacks;          //transactions the chip didn't answer
+extern unsigned long sim_i2c_transactions;
+
+//The transaction sim_on_i2c is called for, before the chip applies it
+typedef struct
+{
+    const char *task;               //name of the task that started it
+    bool read;
+    uint8_t reg;                    //first register: the pointer for a read
+    const uint8_t *data;            //the bytes a write carries, NULL for a read
+    uint8_t len;                    //data bytes; 0 for a write that only sets the pointer
+} sim_i2c_t;
+extern sim_i2c_t sim_i2c_last;
+
+//Puts the register file at its power-on values, DEVICE_XREADY set
+void bq_por(void);
+
+//Wakes the chip from SHIP, which is a power-on reset
+void sim_bq_wake(void);
+
+//Queues a console line; it arrives at the current baud rate
+void sim_send(const char *line);
+
+//Runs the tasks created so far until sim_end_us
+void sim_start(void);
+
+//Calls fn once at time us, whatever the tasks are doing; one event is
+//pending at a time, fn may set the next
+void sim_at(uint64_t us, sim_hook_fn fn);
+
+//The current task uses the CPU for us microseconds; it can be preempted
+void sim_cpu(uint32_t us);
+
+//Longest time between check-ins of each task registered with the
+//watchdog, in microseconds; 0 for ids not registered
+uint64_t sim_checkin_gap_max(uint8_t id);
+
+#endif /* SIM_H */
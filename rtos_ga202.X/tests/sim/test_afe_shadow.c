@@ -0,0 +1,212 @@
+/*
+ * test_afe_shadow.c
+ * The configuration shadow on the firmware, driven like a GUI session: a
+ * protection profile written as one batch, a redundant write, register
+ * reads every second, a register corrupted in the chip just after the
+ * scrub at 901 s and a reset of the chip at 1200 s. Counts what reaches
+ * the bus: one burst per run of dirty registers, no transaction at all for
+ * a read the shadow can serve, the corruption put right by the next scrub
+ * and the reset by one burst.
+ *
+ * Includes taskBQ76920.c for the shadow and its timing constants.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "sim.h"
+#include "taskBQ76920.c"
+
+#define CORRUPT_US      901500000u      //just after a scrub
+#define POR_US          1200000000u
+#define END_US          1300000000u
+#define CORRUPT_REG     0x09            //OV_TRIP
+
+//PROTECT..UV_TRIP, written as one batch
+static const uint8_t profile[5] = { 0x9F, 0x47, 0xD0, 0xB4, 0x8F };
+
+typedef enum
+{
+    CMD_NONE = 0,
+    CMD_PROFILE,        //the batch
+    CMD_SAME,           //a write of the value the register holds
+    CMD_SHADOWED,       //reads served from the shadow
+    CMD_LIVE            //SYS_CTRL1/2, changed by the chip, read from it
+} command_t;
+
+static command_t pending;
+static unsigned cmd_bursts, cmd_reads;         //console transactions since the command
+static unsigned console_bursts;                //over the whole run
+static unsigned replies[CMD_LIVE + 1], wrong_replies;
+
+static uint64_t corrupt_us, fixed_us, por_us, restored_us;
+static unsigned fix_bursts, restore_bursts;
+static unsigned scrubs;
+static uint16_t corrections_before;
+static unsigned scrub_lines, restored_lines;
+
+static void on_i2c(void)
+{
+    const sim_i2c_t *t = &sim_i2c_last;
+    bool burst = !t->read && t->len > 0;
+    bool protect = strcmp(t->task, "protect") == 0;
+
+    if (strcmp(t->task, "console") == 0)
+    {
+        if (burst)
+        {
+            cmd_bursts++;
+            console_bursts++;
+        }
+        if (t->read) cmd_reads++;
+    }
+    if (protect && t->read && t->reg == AFE_CONFIG_FIRST_REG && t->len == AFE_CONFIG_REGS) scrubs++;
+
+    //The corrupted register back in the chip
+    if (corrupt_us != 0 && fixed_us == 0)
+    {
+        if (protect && burst) fix_bursts++;
+        if (bq[CORRUPT_REG] == profile[CORRUPT_REG - 6]) fixed_us = sim_us;
+    }
+
+    //The whole block back after the reset
+    if (por_us != 0 && restored_us == 0)
+    {
+        if (protect && burst && t->reg != AFE_SYS_STAT_REG)
+        {
+            restore_bursts++;
+            CHECK_EQ(t->reg, AFE_CONFIG_FIRST_REG);
+            CHECK_EQ(t->len, AFE_CONFIG_REGS);
+        }
+        if (!(bq[AFE_SYS_STAT_REG] & AFE_SYS_STAT_DEVICE_XREADY) && memcmp(&bq[6], profile, sizeof(profile)) == 0)
+            restored_us = sim_us;
+    }
+}
+
+static void reset_chip(void)
+{
+    bq_por();
+    por_us = sim_us;
+}
+
+static void corrupt(void)
+{
+    corrections_before = afe_shadow.corrections;
+    bq[CORRUPT_REG] = 0x00;
+    corrupt_us = sim_us;
+    sim_at(POR_US, reset_chip);
+}
+
+static void send(command_t cmd, const char *line)
+{
+    pending = cmd;
+    cmd_bursts = 0;
+    cmd_reads = 0;
+    sim_send(line);
+}
+
+//The console gives up on a line 2 s after it starts waiting, so each
+//command goes out 1 s after the reply to the last one
+static uint64_t next_us = 5000000u;
+
+static void input(void)
+{
+    static unsigned step;
+
+    if (sim_us < next_us || pending != CMD_NONE) return;
+    switch (step)
+    {
+    case 0: sim_send("power auto 0"); next_us = 10000000u; break;
+    case 1: send(CMD_PROFILE, "write 6 0x9F; write 7 0x47; write 8 0xD0; write 9 0xB4; write 10 0x8F"); break;
+    case 2: send(CMD_SAME, "write 7 0x47"); break;
+    default:
+        //GUI polling: the profile, the balancing and CC_CFG, then the
+        //two control registers
+        switch (step % 4)
+        {
+        case 0: send(CMD_SHADOWED, "read 6 5"); break;
+        case 1: send(CMD_SHADOWED, "read 1 3"); break;
+        case 2: send(CMD_SHADOWED, "read 0x0B 1"); break;
+        default: send(CMD_LIVE, "read 4 2"); break;
+        }
+        break;
+    }
+    step++;
+}
+
+static void host(const char *line)
+{
+    if (getenv("ECHO") != NULL) printf("[%10.3f] %s\n", sim_us / 1e6, line);
+    if (strncmp(line, "BQ76920 scrub: 1 registers rewritten", 36) == 0) scrub_lines++;
+    if (strncmp(line, "BQ76920 restored in ", 20) == 0) restored_lines++;
+
+    switch (pending)
+    {
+    case CMD_PROFILE:
+        if (strcmp(line, "BATCH ACK") != 0) return;
+        if (cmd_bursts != 1 || cmd_reads != 1) wrong_replies++;
+        break;
+    case CMD_SAME:
+        if (strcmp(line, "ACK") != 0) return;
+        if (cmd_bursts != 0 || cmd_reads != 0) wrong_replies++;
+        break;
+    case CMD_SHADOWED:
+        if (strncmp(line, "0x", 2) != 0) return;
+        if (cmd_bursts != 0 || cmd_reads != 0) wrong_replies++;
+        if (line[2] == '9' && strcmp(line, "0x9F 0x47 0xD0 0xB4 0x8F ") != 0) wrong_replies++;
+        break;
+    case CMD_LIVE:
+        if (strncmp(line, "0x", 2) != 0) return;
+        if (cmd_bursts != 0 || cmd_reads != 1) wrong_replies++;
+        break;
+    default:
+        return;
+    }
+    replies[pending]++;
+    pending = CMD_NONE;
+    next_us = sim_us + 1000000u;
+}
+
+int main(void)
+{
+    bq_por();
+    sim_model = true;
+    sim_host = host;
+    sim_input = input;
+    sim_on_i2c = on_i2c;
+    sim_at(CORRUPT_US, corrupt);
+    sim_end_us = END_US;
+
+    taskBQ76920_init();
+    sim_start();
+
+    //Writes: the batch is one burst and one read-back, the redundant
+    //write none; reads of clean registers never touch the bus
+    CHECK_EQ(replies[CMD_PROFILE], 1);
+    CHECK_EQ(replies[CMD_SAME], 1);
+    CHECK(replies[CMD_SHADOWED] > 400);
+    CHECK(replies[CMD_LIVE] > 100);
+    CHECK_EQ(wrong_replies, 0);
+    CHECK_EQ(console_bursts, 1);
+
+    //Corruption: found by the next scrub, rewritten in one burst
+    CHECK(fixed_us != 0);
+    CHECK(fixed_us - corrupt_us <= (AFE_SCRUB_MS + PROTECT_PERIOD_MS) * 1000u);
+    CHECK_EQ(fix_bursts, 1);
+    CHECK_EQ(afe_shadow.corrections, corrections_before + 1);
+    CHECK_EQ(scrub_lines, 1);
+    CHECK(scrubs >= END_US / 1000u / AFE_SCRUB_MS);
+
+    //Reset: the whole block in one burst within a poll period or two
+    CHECK(restored_us != 0);
+    CHECK(restored_us - por_us <= 2 * PROTECT_PERIOD_MS * 1000u);
+    CHECK_EQ(restore_bursts, 1);
+    CHECK_EQ(restored_lines, 1);
+    CHECK_EQ(afe_shadow.resets, 1);
+
+    printf("afe shadow: %u shadowed reads, %u live, scrub fixed in %.1f s, reset restored in %.1f ms\n",
+           replies[CMD_SHADOWED], replies[CMD_LIVE], (fixed_us - corrupt_us) / 1e6, (restored_us - por_us) / 1e3);
+    return check_done("afe_shadow");
+}
@@ -0,0 +1,150 @@
+/*
+ * test_fault_response.c
+ * Worst-case fault response with the console flat out: a new command line
+ * is queued whenever the console looks for input, the longest register
+ * reads and the status dump among them, while OV, UV, SCD and OCD are set
+ * in the chip's SYS_STAT at points walked across the 50 ms and 2 s
+ * schedules. From each fault to the FETs it concerns reading back off
+ * must take one SYS_STAT poll period plus the handling and the longest
+ * console transaction holding the AFE lock.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "sim.h"
+#include "taskBQ76920.h"
+
+#define FAULTS          24
+#define FIRST_FAULT_US  10000000u
+#define FAULT_SPACING_US 3013000u   //walks the fault across the 50 ms and 2 s schedules
+#define FETS_ON_US      1000000u    //FETs switched on this long before each fault
+
+#define PROTECT_PERIOD_US   50000u
+//On top of the poll period: the longest console read holding the AFE
+//lock (41 bytes at 100 kHz), then SYS_STAT, the SYS_CTRL2 write and its
+//read-back, all at 100 kHz
+#define RESPONSE_BOUND_US   (PROTECT_PERIOD_US + 10000u)
+
+#define SYS_STAT_OCD    0x01
+#define SYS_STAT_SCD    0x02
+#define SYS_STAT_OV     0x04
+#define SYS_STAT_UV     0x08
+#define SYS_CTRL2_CHG   0x01
+#define SYS_CTRL2_DSG   0x02
+#define SYS_CTRL2_FETS  0x03
+
+static const uint8_t fault_bits[] =
+    { SYS_STAT_OV, SYS_STAT_UV, SYS_STAT_SCD, SYS_STAT_OCD, SYS_STAT_OV | SYS_STAT_SCD };
+
+//The console's heaviest work: the status dump, a read of every cell and
+//one of the configuration, the task table and the help text
+static const char *const flood[] =
+    { "g", "read 0x0C-0x34", "tasks", "read 0-0x0B", "help", "read 0x2A 10" };
+
+static uint64_t fault_us[FAULTS], off_us[FAULTS];
+static uint8_t fets_of[FAULTS];             //the FETs each fault must open
+static unsigned faults;                     //injected so far
+static bool fets_on_seen[FAULTS];
+static unsigned fault_lines, fets_off_lines;
+static unsigned reported_us_max;
+static unsigned long flood_lines;
+
+//The FETs of the last fault off. on_i2c runs before the chip applies a
+//transaction, so the write is seen at the read-back that follows it.
+static void on_i2c(void)
+{
+    unsigned n = faults;
+
+    if (n > 0 && off_us[n - 1] == 0 && (bq[5] & fets_of[n - 1]) == 0) off_us[n - 1] = sim_us;
+}
+
+static void inject(void)
+{
+    unsigned n = faults;
+    uint8_t bits = fault_bits[n % sizeof(fault_bits)];
+
+    fets_on_seen[n] = (bq[5] & SYS_CTRL2_FETS) == SYS_CTRL2_FETS;
+    fets_of[n] = bits & SYS_STAT_OV ? SYS_CTRL2_CHG : 0;
+    if (bits & (SYS_STAT_UV | SYS_STAT_SCD | SYS_STAT_OCD)) fets_of[n] |= SYS_CTRL2_DSG;
+    fault_us[n] = sim_us;
+    bq[0] |= bits;
+    faults++;
+    if (faults < FAULTS) sim_at(FIRST_FAULT_US + faults * FAULT_SPACING_US, inject);
+}
+
+static void input(void)
+{
+    static unsigned fets_sent;
+    static bool setup_sent;
+    char line[32];
+
+    if (!setup_sent)
+    {
+        sim_send("power auto 0");           //stay Active
+        setup_sent = true;
+        return;
+    }
+    if (fets_sent < FAULTS && sim_us >= FIRST_FAULT_US + fets_sent * FAULT_SPACING_US - FETS_ON_US)
+    {
+        snprintf(line, sizeof(line), "write 5 %u", (unsigned)(bq[5] | SYS_CTRL2_FETS));
+        sim_send(line);
+        fets_sent++;
+        return;
+    }
+    sim_send(flood[flood_lines++ % (sizeof(flood) / sizeof(flood[0]))]);
+}
+
+static void host(const char *line)
+{
+    const char *fets;
+    unsigned us;
+
+    if (getenv("ECHO") != NULL) printf("[%10.3f] %s\n", sim_us / 1e6, line);
+    if (strncmp(line, "BQ76920 fault:", 14) != 0) return;
+    fault_lines++;
+    fets = strstr(line, ", FETs");
+    if (fets != NULL && sscanf(fets, ", FETs off in %u us", &us) == 1)
+    {
+        fets_off_lines++;
+        if (us > reported_us_max) reported_us_max = us;
+    }
+}
+
+int main(void)
+{
+    uint64_t worst = 0;
+
+    bq_por();
+    sim_model = true;
+    sim_host = host;
+    sim_input = input;
+    sim_on_i2c = on_i2c;
+    sim_at(FIRST_FAULT_US, inject);
+    sim_end_us = FIRST_FAULT_US + FAULTS * FAULT_SPACING_US;
+
+    taskBQ76920_init();
+    sim_start();
+
+    CHECK_EQ(faults, FAULTS);
+    for (unsigned n = 0; n < faults; n++)
+    {
+        uint64_t took = off_us[n] - fault_us[n];
+
+        CHECK(fets_on_seen[n]);
+        CHECK(off_us[n] != 0);
+        if (off_us[n] == 0) continue;
+        CHECK(took <= RESPONSE_BOUND_US);
+        if (took > worst) worst = took;
+    }
+    CHECK_EQ(fault_lines, FAULTS);
+    CHECK_EQ(fets_off_lines, FAULTS);
+    CHECK(reported_us_max <= worst);
+    CHECK(flood_lines > FAULTS * FAULT_SPACING_US / 1000000u);
+    printf("fault response: worst %.1f ms over %u faults, %lu console lines\n",
+           worst / 1e3, faults, flood_lines);
+
+    return check_done("fault_response");
+}
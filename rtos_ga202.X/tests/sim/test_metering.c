@@ -0,0 +1,222 @@
+/*
+ * test_metering.c
+ * The Coulomb Counter modes on the firmware: continuous, periodic every
+ * 20 s with a 30 s bus outage inside, and one-shots 30 to 120 s apart,
+ * against the true charge of a pack current profile. The CC model
+ * converts the current at the time of the conversion, so apart from that
+ * sampling the firmware must match the trapezoid of the true current at
+ * its reading times, and come closer to the truth than holding each
+ * reading over the interval before it.
+ *
+ * Includes taskBQ76920.c for the meter and the remaining capacity.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "sim.h"
+#include "taskBQ76920.c"
+
+#define CC_OFFSET_LSB   (-2)            //what "cc cal" would find
+#define MAX_READINGS    4096
+
+#define PHASES          4
+static const char *const phase_name[PHASES] = { "continuous", "periodic 20 s", "oneshot", "continuous" };
+static const double phase_start_s[PHASES + 1] = { 30, 620, 1820, 2600, 2700 };
+
+//Pack current in CC LSB above the offset: a 300 s discharge triangle,
+//and a charge taper from 1300 to 1500 s
+static double profile_lsb(double t)
+{
+    double phase;
+
+    if (t < 20) return 0;
+    if (t >= 1300 && t < 1500) return -40 + 38 * (t - 1300) / 200;
+    phase = fmod(t - 20, 300) / 300;
+    return 2 + 38 * (phase < 0.5 ? 2 * phase : 2 - 2 * phase);
+}
+
+static double lsb_mAh_per_ms(void)
+{
+    return bms_cc_raw_to_current_A(1, 369.0f, 0.01f) / 3600.0;
+}
+
+//Charge between two ticks, 1 ms steps
+static double truth_mAh(uint32_t from_ms, uint32_t to_ms)
+{
+    double sum = 0;
+
+    for (uint32_t ms = from_ms; ms < to_ms; ms++) sum += profile_lsb((ms + 0.5) / 1000.0);
+    return sum * lsb_mAh_per_ms();
+}
+
+typedef struct
+{
+    float remaining_mAh;
+    uint32_t last_ms;
+    uint32_t readings;
+    unsigned oneshots;
+} mark_t;
+
+static mark_t marks[PHASES + 1];
+static int marked;
+static bool cc_en[PHASES];
+static uint32_t reading_ms[MAX_READINGS];
+static unsigned reading_count;
+static bool outage_done;
+static unsigned usage_lines, meter_lines;
+
+static void on_i2c(void)
+{
+    double t = sim_us / 1e6;
+
+    sim_cc_lsb = (int16_t)(lround(profile_lsb(t)) + CC_OFFSET_LSB);
+    if (!outage_done && t >= 1000 && t < 1030) sim_bq_off = true;
+    if (sim_bq_off && t >= 1030)
+    {
+        sim_bq_off = false;
+        outage_done = true;
+    }
+
+    if (reading_count < MAX_READINGS && meter.readings != 0 &&
+        (reading_count == 0 || reading_ms[reading_count - 1] != meter.last_ms))
+        reading_ms[reading_count++] = meter.last_ms;
+
+    if (marked <= PHASES && t >= phase_start_s[marked])
+    {
+        marks[marked].remaining_mAh = remaining_capacity_mAh;
+        marks[marked].last_ms = meter.last_ms;
+        marks[marked].readings = meter.readings;
+        marks[marked].oneshots = sim_oneshots;
+        marked++;
+    }
+    for (int p = 0; p < PHASES; p++)
+    {
+        if (t >= phase_start_s[p] + 10 && t < phase_start_s[p] + 11) cc_en[p] = (bq[SYS_CTRL2_REG] & POWER_CTRL2_CC_EN) != 0;
+    }
+}
+
+static void input(void)
+{
+    static double next_s = 10;
+    static int step;
+    static unsigned rnd = 12345;
+    double t = sim_us / 1e6;
+
+    if (t < next_s) return;
+    switch (step)
+    {
+    case 0:
+        //The CC offset is learned with the FETs off until now; discharge
+        //FET on before the load starts at 20 s
+        sim_send("write 5 0x42");
+        sim_send("power auto 0");
+        next_s = 600;
+        step++;
+        break;
+    case 1: sim_send("meter"); next_s = 611.3; step++; break;
+    case 2: sim_send("meter periodic 20"); next_s = 1810; step++; break;
+    case 3: sim_send("meter"); next_s = 1815; step++; break;
+    case 4: sim_send("meter oneshot"); next_s = 1830; step++; break;
+    case 5:
+        sim_send("meter sample");
+        rnd = rnd * 1103515245u + 12345u;
+        next_s = t + 30 + (rnd >> 16) % 91;
+        if (next_s > 2590)
+        {
+            next_s = 2590;
+            step++;
+        }
+        break;
+    case 6: sim_send("meter sample"); next_s = 2595; step++; break;
+    case 7: sim_send("meter"); next_s = 2600; step++; break;
+    case 8: sim_send("meter continuous"); next_s = 2650; step++; break;
+    case 9: sim_send("meter bogus"); next_s = 2651; step++; break;
+    case 10: sim_send("meter periodic 0"); next_s = 2652; step++; break;
+    default: next_s = 1e9; break;
+    }
+}
+
+static void host(const char *line)
+{
+    if (getenv("ECHO") != NULL) printf("[%9.3f] %s\n", sim_us / 1e6, line);
+    if (strncmp(line, "Usage: meter", 12) == 0) usage_lines++;
+    if (strncmp(line, "Metering: ", 10) == 0) meter_lines++;
+}
+
+//Trapezoid and held reading of the true current at the reading times
+static void reading_integrals(uint32_t from_ms, uint32_t to_ms, double *trapezoid, double *held)
+{
+    *trapezoid = 0;
+    *held = 0;
+    for (unsigned k = 1; k < reading_count; k++)
+    {
+        double a, b, dt;
+
+        if (reading_ms[k - 1] < from_ms || reading_ms[k] > to_ms) continue;
+        a = profile_lsb(reading_ms[k - 1] / 1000.0);
+        b = profile_lsb(reading_ms[k] / 1000.0);
+        dt = reading_ms[k] - reading_ms[k - 1];
+        *trapezoid += (a + b) / 2 * dt * lsb_mAh_per_ms();
+        *held += b * dt * lsb_mAh_per_ms();
+    }
+}
+
+int main(void)
+{
+    bq_por();
+    sim_model = true;
+    sim_cc_lsb = CC_OFFSET_LSB;
+    sim_host = host;
+    sim_input = input;
+    sim_on_i2c = on_i2c;
+    sim_end_us = (uint64_t)(phase_start_s[PHASES] * 1e6) + 500000u;
+
+    taskBQ76920_init();
+    sim_start();
+
+    CHECK_EQ(marked, PHASES + 1);
+    CHECK(outage_done);
+    CHECK(sim_nacks > 0);
+    CHECK_EQ(usage_lines, 2);
+    CHECK(meter_lines >= 5);
+    CHECK(meter.gap_max_ms >= 30000 + 20000);       //the outage lies inside one interval
+
+    for (int p = 0; p < PHASES && p + 1 < marked; p++)
+    {
+        const mark_t *a = &marks[p], *b = &marks[p + 1];
+        double firmware = a->remaining_mAh - b->remaining_mAh;
+        double truth = truth_mAh(a->last_ms, b->last_ms);
+        double trapezoid, held;
+        uint32_t readings = b->readings - a->readings;
+        unsigned oneshots = b->oneshots - a->oneshots;
+
+        reading_integrals(a->last_ms, b->last_ms, &trapezoid, &held);
+        printf("%-14s %4u readings %3u one-shots  firmware %8.3f mAh  truth %8.3f  trapezoid %8.3f  held %8.3f\n",
+               phase_name[p], readings, oneshots, firmware, truth, trapezoid, held);
+
+        CHECK(readings > 0);
+        CHECK(fabs(firmware - trapezoid) <= 0.005 * truth);
+        if (p == 0 || p == 3)
+        {
+            CHECK(cc_en[p]);
+            CHECK(fabs(firmware - truth) <= 0.001 * truth);
+            continue;
+        }
+
+        //CC off, one conversion per reading, and fewer readings
+        CHECK(!cc_en[p]);
+        CHECK_EQ(oneshots, readings);
+        CHECK(fabs(firmware - truth) <= 0.025 * truth);
+        CHECK(fabs(firmware - truth) < fabs(held - truth));
+    }
+
+    //Periodic: one reading per 20 s, none during the outage
+    CHECK(marks[2].readings - marks[1].readings >= (1200 - 30) / 20 - 1);
+    CHECK(marks[2].readings - marks[1].readings <= 1200 / 20);
+
+    return check_done("metering");
+}
@@ -0,0 +1,230 @@
+/*
+ * test_power_state.c
+ * The power states on the firmware against the BQ76920 model: Idle after
+ * 30 s of a 37 mA discharge, counted by one CC one-shot per reading with
+ * the ADC and continuous conversions off; a load waking it within one
+ * SYS_STAT poll through LOAD_PRESENT; then Idle and SHIP on command, the
+ * SHUT_A/SHUT_B writes back to back, and a boot signal bringing the pack
+ * back Active.
+ *
+ * Includes taskBQ76920.c for the power state, the meter and the
+ * remaining capacity.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "sim.h"
+#include "taskBQ76920.c"
+
+#define CC_OFFSET_LSB   (-2)            //what the firmware learns with the FETs off
+#define DISCHARGE_US    10000000u       //one LSB of discharge from here, below IDLE_CURRENT_MA
+#define LOAD_US         160000000u
+#define IDLE_US         185000000u      //"power idle"
+#define SHIP_US         195000000u      //"power ship"
+#define WAKE_US         230000000u      //boot signal on TS1
+#define END_US          240000000u
+
+//One poll period, then SYS_STAT, SYS_CTRL1, SYS_CTRL2 and the two
+//registers written back, at 100 kHz
+#define WAKE_BOUND_US   ((PROTECT_PERIOD_MS + 10u) * 1000u)
+
+#define LOG_SIZE        64
+
+typedef struct
+{
+    bool read;
+    uint8_t reg, len, value;
+} logged_t;
+
+//Idle: entered, then marked again when the load comes
+typedef struct
+{
+    uint64_t us;
+    float remaining_mAh;
+    uint32_t last_ms;
+    uint32_t readings;
+    unsigned oneshots;
+} mark_t;
+
+static mark_t idle_in, idle_out;
+static unsigned cc_en_in_idle;
+static uint64_t load_us, woke_us;
+static logged_t ship_log[LOG_SIZE];
+static unsigned ship_logged;
+static bool ship_sent, ship_done;
+static unsigned load_lines, restored_lines, ship_lines;
+
+static void mark(mark_t *m)
+{
+    m->us = sim_us;
+    m->remaining_mAh = remaining_capacity_mAh;
+    m->last_ms = meter.last_ms;
+    m->readings = meter.readings;
+    m->oneshots = sim_oneshots;
+}
+
+static void on_i2c(void)
+{
+    const sim_i2c_t *t = &sim_i2c_last;
+
+    sim_cc_lsb = CC_OFFSET_LSB + (sim_us >= DISCHARGE_US ? 1 : 0);
+
+    //Idle: one-shots only, CC_EN written off with ADC_EN
+    if (idle_in.us == 0 && power.state == POWER_IDLE) mark(&idle_in);
+    if (idle_in.us != 0 && load_us == 0 && (bq[SYS_CTRL2_REG] & POWER_CTRL2_CC_EN)) cc_en_in_idle++;
+
+    //The wake: ADC and continuous conversions back on. on_i2c runs before
+    //the chip applies a transaction, so it is seen at the next one.
+    if (load_us != 0 && woke_us == 0 && (bq[SYS_CTRL1_REG] & POWER_CTRL1_ADC_EN) &&
+        (bq[SYS_CTRL2_REG] & POWER_CTRL2_CC_EN))
+    {
+        woke_us = sim_us;
+        sim_load = false;
+    }
+
+    //Everything on the bus from the command until the chip is off
+    if (ship_sent && !ship_done)
+    {
+        if (sim_bq_off)
+        {
+            ship_done = true;
+            return;
+        }
+        if (ship_logged < LOG_SIZE)
+        {
+            logged_t *l = &ship_log[ship_logged++];
+
+            l->read = t->read;
+            l->reg = t->reg;
+            l->len = t->len;
+            l->value = (t->data != NULL && t->len > 0) ? t->data[0] : 0;
+        }
+    }
+}
+
+static void wake(void)
+{
+    sim_bq_wake();
+}
+
+static void load_on(void)
+{
+    mark(&idle_out);
+    load_us = sim_us;
+    sim_load = true;
+    sim_at(WAKE_US, wake);
+}
+
+static void input(void)
+{
+    static int step;
+
+    switch (step)
+    {
+    case 0:
+        if (sim_us < DISCHARGE_US) return;
+        //The CC offset is learned with the FETs off until now; discharge
+        //FET on, CHG off so the chip reports LOAD_PRESENT
+        sim_send("write 5 0x42");
+        sim_send("power auto 30");
+        break;
+    case 1:
+        if (sim_us < IDLE_US) return;
+        sim_send("power idle");
+        break;
+    case 2:
+        if (sim_us < SHIP_US) return;
+        ship_sent = true;
+        sim_send("power ship");
+        break;
+    default:
+        return;
+    }
+    step++;
+}
+
+static void host(const char *line)
+{
+    if (getenv("ECHO") != NULL) printf("[%9.3f] %s\n", sim_us / 1e6, line);
+    if (strncmp(line, "Power: active (load) in ", 24) == 0) load_lines++;
+    if (strncmp(line, "BQ76920 restored in ", 20) == 0) restored_lines++;
+    if (strncmp(line, "Entering SHIP mode", 18) == 0) ship_lines++;
+}
+
+int main(void)
+{
+    double mA = bms_cc_raw_to_current_A(1, coulomb_counter_gain_uV, shunt_resistance_ohm) * 1000.0;
+    const logged_t *shut;
+    double counted = 0, truth = 0;
+    uint32_t readings = 0;
+
+    bq_por();
+    sim_model = true;
+    sim_cc_lsb = CC_OFFSET_LSB;
+    sim_host = host;
+    sim_input = input;
+    sim_on_i2c = on_i2c;
+    sim_at(LOAD_US, load_on);
+    sim_end_us = END_US;
+
+    taskBQ76920_init();
+    sim_start();
+
+    //Idle after the quiet time, the discharge still counted: one
+    //one-shot per reading and the charge of the constant current
+    CHECK(mA > CC_DEADBAND_MA && mA < IDLE_CURRENT_MA);
+    CHECK(idle_in.us != 0);
+    CHECK(idle_in.us <= DISCHARGE_US + 30000000u + 2u * MEASURE_IDLE_MS * 1000u);  //the update that sees the command, the one past 30 s
+    CHECK_EQ(cc_en_in_idle, 0);
+    if (idle_in.us != 0)
+    {
+        counted = idle_in.remaining_mAh - idle_out.remaining_mAh;
+        truth = mA * (idle_out.last_ms - idle_in.last_ms) / 3600000.0;
+        readings = idle_out.readings - idle_in.readings;
+
+        CHECK(readings >= (LOAD_US - idle_in.us) / 1000u / MEASURE_IDLE_MS - 1);
+        CHECK_EQ(idle_out.oneshots - idle_in.oneshots, readings);
+        CHECK(fabs(counted - truth) <= 0.01 * truth);
+    }
+
+    //LOAD_PRESENT: Active again within a poll
+    CHECK(woke_us != 0);
+    CHECK(woke_us - load_us <= WAKE_BOUND_US);
+    CHECK_EQ(load_lines, 1);
+
+    //SHIP: FETs off, then the three SYS_CTRL1 writes and nothing between
+    //them; the last one turns the chip off
+    CHECK(ship_done);
+    CHECK_EQ(ship_lines, 1);
+    CHECK(ship_logged >= 4 && ship_logged < LOG_SIZE);
+    if (ship_logged >= 4 && ship_logged < LOG_SIZE)
+    {
+        shut = &ship_log[ship_logged - POWER_SHIP_WRITES];
+        for (unsigned n = 0; n < POWER_SHIP_WRITES; n++)
+        {
+            CHECK(!shut[n].read);
+            CHECK_EQ(shut[n].reg, SYS_CTRL1_REG);
+            CHECK_EQ(shut[n].len, 1);
+        }
+        CHECK_EQ(shut[0].value, 0x08);
+        CHECK_EQ(shut[1].value, 0x09);
+        CHECK_EQ(shut[2].value, 0x0A);
+        CHECK_EQ(bq[SYS_CTRL2_REG] & SYS_CTRL2_FET_MASK, 0);
+    }
+
+    //The boot signal: a power-on reset, the configuration restored and
+    //Active again
+    CHECK_EQ(restored_lines, 1);
+    CHECK_EQ(power.state, POWER_ACTIVE);
+    CHECK_EQ(power.reason, POWER_REASON_RESET);
+    CHECK(bq[SYS_CTRL1_REG] & POWER_CTRL1_ADC_EN);
+    CHECK(bq[SYS_CTRL2_REG] & POWER_CTRL2_CC_EN);
+
+    printf("power state: %u one-shots in Idle counted %.3f of %.3f mAh, load woke Active in %.1f ms\n",
+           readings, counted, truth, (woke_us - load_us) / 1e3);
+    return check_done("power_state_sim");
+}
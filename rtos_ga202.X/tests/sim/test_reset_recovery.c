@@ -0,0 +1,151 @@
+/*
+ * test_reset_recovery.c
+ * Resets the BQ76920 at different points of the firmware's schedule and
+ * measures how long its registers stay at the power-on defaults: from the
+ * reset to the last configuration register rewritten and DEVICE_XREADY
+ * cleared. The protection task polls SYS_STAT every PROTECT_PERIOD_MS,
+ * so recovery should take one poll period plus the restore itself, and
+ * the FETs the reset opened must stay off.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "sim.h"
+#include "taskBQ76920.h"
+
+#define RESETS          8
+#define FIRST_RESET_US  30000000u
+#define RESET_SPACING_US 7013000u   //walks the reset across the 50 ms and 2 s schedules
+#define FETS_ON_US      1000000u    //FETs switched on this long before each reset
+
+//One SYS_STAT poll period, then the restore: DEVICE_XREADY clear, three
+//calibration reads, two configuration writes with their read-back, at
+//100 kHz, plus the longest the protection task can wait for the AFE lock
+#define RECOVERY_BOUND_US   80000u
+
+#define SYS_STAT_DEVICE_XREADY  0x20
+#define SYS_CTRL2_FETS          0x03
+#define CONFIG_REGS             11
+
+//Bits the firmware sets in the configuration registers (SYS_CTRL2
+//without the FETs, which a reset leaves off on purpose)
+static const uint8_t config_mask[CONFIG_REGS] =
+    { 0x1F, 0x1F, 0x1F, 0x18, 0xC0, 0x9F, 0x7F, 0xF0, 0xFF, 0xFF, 0x3F };
+
+static uint8_t before[RESETS][CONFIG_REGS];
+static uint64_t reset_us[RESETS], restored_us[RESETS];
+static unsigned resets;                     //injected so far
+static bool fets_on_seen[RESETS], fets_off_after[RESETS];
+static unsigned restored_lines;
+static unsigned reported_ms_max;
+static unsigned reported_resets;
+
+static bool config_matches(const uint8_t *regs)
+{
+    for (int r = 0; r < CONFIG_REGS; r++)
+    {
+        if ((bq[1 + r] & config_mask[r]) != (regs[r] & config_mask[r])) return false;
+    }
+    return true;
+}
+
+//Recovery of the last reset: the shadow is back in the chip
+static void on_i2c(void)
+{
+    unsigned n = resets;
+
+    if (n > 0 && restored_us[n - 1] == 0 && !(bq[0] & SYS_STAT_DEVICE_XREADY) &&
+        config_matches(before[n - 1]))
+    {
+        restored_us[n - 1] = sim_us;
+        fets_off_after[n - 1] = (bq[5] & SYS_CTRL2_FETS) == 0;
+    }
+}
+
+static void reset_chip(void)
+{
+    unsigned n = resets;
+
+    memcpy(before[n], &bq[1], CONFIG_REGS);
+    fets_on_seen[n] = (bq[5] & SYS_CTRL2_FETS) == SYS_CTRL2_FETS;
+    reset_us[n] = sim_us;
+    bq_por();
+    resets++;
+    if (resets < RESETS) sim_at(FIRST_RESET_US + resets * RESET_SPACING_US, reset_chip);
+}
+
+static void input(void)
+{
+    static unsigned fets_sent;
+    static bool setup_sent;
+    char line[32];
+
+    if (!setup_sent && sim_us >= 5000000u)
+    {
+        //Stay Active, and a protection profile the reset wipes out
+        sim_send("power auto 0");
+        sim_send("write 6 0x9F");
+        sim_send("write 7 0x47");
+        sim_send("write 8 0xD0");
+        sim_send("write 9 0xB4");
+        sim_send("write 10 0x8F");
+        setup_sent = true;
+    }
+    if (fets_sent < RESETS && sim_us >= FIRST_RESET_US + fets_sent * RESET_SPACING_US - FETS_ON_US)
+    {
+        snprintf(line, sizeof(line), "write 5 %u", (unsigned)(bq[5] | SYS_CTRL2_FETS));
+        sim_send(line);
+        fets_sent++;
+    }
+}
+
+static void host(const char *line)
+{
+    unsigned ms, count;
+
+    if (getenv("ECHO") != NULL) printf("[%10.3f] %s\n", sim_us / 1e6, line);
+    if (sscanf(line, "BQ76920 restored in %u ms (%u resets", &ms, &count) == 2)
+    {
+        restored_lines++;
+        if (ms > reported_ms_max) reported_ms_max = ms;
+        reported_resets = count;
+    }
+}
+
+int main(void)
+{
+    uint64_t worst = 0;
+
+    bq_por();
+    sim_model = true;
+    sim_host = host;
+    sim_input = input;
+    sim_on_i2c = on_i2c;
+    sim_at(FIRST_RESET_US, reset_chip);
+    sim_end_us = FIRST_RESET_US + RESETS * RESET_SPACING_US;
+
+    taskBQ76920_init();
+    sim_start();
+
+    CHECK_EQ(resets, RESETS);
+    for (unsigned n = 0; n < resets; n++)
+    {
+        uint64_t took = restored_us[n] - reset_us[n];
+
+        CHECK(fets_on_seen[n]);
+        CHECK(restored_us[n] != 0);
+        if (restored_us[n] == 0) continue;
+        CHECK(took <= RECOVERY_BOUND_US);
+        CHECK(fets_off_after[n]);
+        if (took > worst) worst = took;
+    }
+    CHECK_EQ(restored_lines, RESETS);
+    CHECK_EQ(reported_resets, RESETS);
+    CHECK(reported_ms_max * 1000u <= worst);
+    printf("reset recovery: worst %.1f ms over %u resets\n", worst / 1e3, resets);
+
+    return check_done("reset_recovery");
+}
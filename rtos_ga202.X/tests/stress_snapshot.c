@@ -0,0 +1,256 @@
+/*
+ * stress_snapshot.c
+ * Stress of the meas_snapshot.c reader/writer protocol. Every field of a
+ * published set is derived from its tick, so a reader that copies half
+ * of one set and half of another sees a mismatch.
+ *
+ *   stress_snapshot threads [seconds] [readers]
+ *     one writer thread and several reader threads on different cores;
+ *     needs MEAS_SNAPSHOT_BARRIER as a real fence
+ *   stress_snapshot preempt [seconds]
+ *     the PIC24 case on one thread: a 20 us timer signal preempts the
+ *     main loop like a higher priority task, first publishing while the
+ *     main loop reads (measurement vs console), then reading while the
+ *     main loop publishes (protection vs measurement)
+ *
+ * Add "naive" to read without the generation re-check; the torn count
+ * should then go up, which shows the test can see tearing at all.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "meas_snapshot.h"
+
+#define MAX_READERS     16
+#define TIMER_NS        20000
+
+static meas_snapshot_t snap;
+static volatile sig_atomic_t stop;
+static bool naive;
+
+
+static void fill(measurement_t *m, uint32_t k)
+{
+    memset(m, 0, sizeof(*m));
+    m->tick = k;
+    m->current_A = (float)(k & 0xFFFF);
+    m->soc_percent = (float)((k * 7) & 0xFFFF);
+    m->remaining_mAh = (float)((k * 3) & 0xFFFF);
+    m->learned_mAh = (float)((k * 5) & 0xFFFF);
+    m->cc_raw = (int16_t)k;
+    m->pack_mV = (uint16_t)(k * 11);
+    for (int i = 0; i < MEAS_SNAPSHOT_CELLS; i++) m->cell_mV[i] = (uint16_t)(k + i);
+    m->cell_errors = (uint16_t)~k;
+    m->period_ms = (uint16_t)(k * 13);
+    m->adc_gain_uV = (uint16_t)(k >> 16);
+    m->adc_offset_mV = (int8_t)k;
+    m->cells = (uint8_t)(k >> 8);
+    m->soc_engine = (uint8_t)(k >> 3);
+    m->sample_tier = (uint8_t)(k >> 5);
+    m->sample_reasons = (uint8_t)(k >> 11);
+    m->sample_forced = (k >> 2) & 1;
+    m->power_state = (uint8_t)(k >> 13);
+    m->frame_valid = k & 1;
+    m->fets_off = (k >> 1) & 1;
+}
+
+
+//Field by field: the padding of a copied struct is not compared
+static bool same(const measurement_t *a, const measurement_t *b)
+{
+    return a->tick == b->tick && a->current_A == b->current_A && a->soc_percent == b->soc_percent &&
+           a->remaining_mAh == b->remaining_mAh && a->learned_mAh == b->learned_mAh &&
+           a->cc_raw == b->cc_raw && a->pack_mV == b->pack_mV &&
+           memcmp(a->cell_mV, b->cell_mV, sizeof(a->cell_mV)) == 0 &&
+           a->cell_errors == b->cell_errors && a->period_ms == b->period_ms &&
+           a->adc_gain_uV == b->adc_gain_uV && a->adc_offset_mV == b->adc_offset_mV &&
+           a->cells == b->cells && a->soc_engine == b->soc_engine && a->sample_tier == b->sample_tier &&
+           a->sample_reasons == b->sample_reasons && a->sample_forced == b->sample_forced &&
+           a->power_state == b->power_state && a->frame_valid == b->frame_valid && a->fets_off == b->fets_off;
+}
+
+
+typedef struct
+{
+    unsigned long long reads;
+    unsigned long long torn;
+    unsigned long long stale;       //older than a set already read
+} read_stats_t;
+
+//One read and its check. Ticks never go backwards for one reader.
+static void read_once(read_stats_t *st, uint32_t *last_tick)
+{
+    measurement_t m, want;
+    uint16_t g;
+
+    if (naive)
+    {
+        g = snap.generation;
+        m = snap.buffer[g & 1];
+    }
+    else g = meas_snapshot_read(&snap, &m);
+    if (g == 0) return;
+
+    st->reads++;
+    fill(&want, m.tick);
+    if (!same(&m, &want)) st->torn++;
+    else if (m.tick < *last_tick) st->stale++;
+    else *last_tick = m.tick;
+}
+
+
+static volatile uint32_t next_tick = 1;
+static volatile unsigned long long publishes;
+
+static void publish_once(void)
+{
+    measurement_t m;
+
+    fill(&m, next_tick);
+    next_tick = next_tick + 1;
+    meas_snapshot_publish(&snap, &m);
+    publishes = publishes + 1;
+}
+
+
+static void *writer_thread(void *arg)
+{
+    while (!stop) publish_once();
+    return NULL;
+}
+
+static void *reader_thread(void *arg)
+{
+    read_stats_t *st = arg;
+    uint32_t last_tick = 0;
+
+    while (!stop) read_once(st, &last_tick);
+    return NULL;
+}
+
+static int run_threads(unsigned seconds, int readers)
+{
+    pthread_t writer, reader[MAX_READERS];
+    read_stats_t st[MAX_READERS];
+    read_stats_t total = { 0, 0, 0 };
+    struct timespec wait = { (time_t)seconds, 0 };
+
+    memset(st, 0, sizeof(st));
+    meas_snapshot_init(&snap);
+    stop = 0;
+    pthread_create(&writer, NULL, writer_thread, NULL);
+    for (int i = 0; i < readers; i++) pthread_create(&reader[i], NULL, reader_thread, &st[i]);
+    nanosleep(&wait, NULL);
+    stop = 1;
+    pthread_join(writer, NULL);
+    for (int i = 0; i < readers; i++)
+    {
+        pthread_join(reader[i], NULL);
+        total.reads += st[i].reads;
+        total.torn += st[i].torn;
+        total.stale += st[i].stale;
+    }
+
+    printf("threads: %d readers, %llu publishes, %llu reads, %llu torn, %llu stale\n",
+           readers, publishes, total.reads, total.torn, total.stale);
+    return total.reads == 0 || total.torn != 0 || total.stale != 0;
+}
+
+
+//Single core: the signal handler is the higher priority task
+static bool handler_publishes;
+static read_stats_t preempt_stats;
+static uint32_t preempt_last_tick;
+static volatile unsigned long long preemptions;
+
+static void on_timer(int sig)
+{
+    preemptions = preemptions + 1;
+    if (handler_publishes) publish_once();
+    else read_once(&preempt_stats, &preempt_last_tick);
+}
+
+static int run_preempt_case(unsigned seconds, bool writer_preempts)
+{
+    struct sigevent ev;
+    struct itimerspec its;
+    struct timespec start, now;
+    timer_t timer;
+
+    memset(&ev, 0, sizeof(ev));
+    memset(&its, 0, sizeof(its));
+    memset(&preempt_stats, 0, sizeof(preempt_stats));
+    preempt_last_tick = 0;
+    preemptions = 0;
+    publishes = 0;
+    handler_publishes = writer_preempts;
+    meas_snapshot_init(&snap);
+    publish_once();
+
+    ev.sigev_notify = SIGEV_SIGNAL;
+    ev.sigev_signo = SIGALRM;
+    its.it_value.tv_nsec = TIMER_NS;
+    its.it_interval.tv_nsec = TIMER_NS;
+    signal(SIGALRM, on_timer);
+    if (timer_create(CLOCK_MONOTONIC, &ev, &timer) != 0)
+    {
+        perror("timer_create");
+        return 1;
+    }
+    timer_settime(timer, 0, &its, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            if (writer_preempts) read_once(&preempt_stats, &preempt_last_tick);
+            else publish_once();
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((unsigned)(now.tv_sec - start.tv_sec) < seconds);
+
+    timer_delete(timer);
+    signal(SIGALRM, SIG_DFL);
+
+    printf("preempt, %s: %llu preemptions, %llu publishes, %llu reads, %llu torn, %llu stale\n",
+           writer_preempts ? "writer preempts the reader" : "reader preempts the writer",
+           preemptions, publishes, preempt_stats.reads, preempt_stats.torn, preempt_stats.stale);
+    return preempt_stats.reads == 0 || preempt_stats.torn != 0 || preempt_stats.stale != 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *mode = argc > 1 ? argv[1] : "threads";
+    unsigned seconds = argc > 2 ? (unsigned)atoi(argv[2]) : 2;
+    int readers = argc > 3 ? atoi(argv[3]) : 3;
+    int failed;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "naive") == 0) naive = true;
+    }
+    if (seconds == 0) seconds = 1;
+    if (readers < 1 || readers > MAX_READERS) readers = 3;
+
+    if (strcmp(mode, "threads") == 0) failed = run_threads(seconds, readers);
+    else if (strcmp(mode, "preempt") == 0)
+    {
+        failed = run_preempt_case(seconds, true);
+        failed |= run_preempt_case(seconds, false);
+    }
+    else
+    {
+        fprintf(stderr, "usage: %s threads|preempt [seconds] [readers] [naive]\n", argv[0]);
+        return 2;
+    }
+
+    printf("stress_snapshot %s%s: %s\n", mode, naive ? " naive" : "", failed ? "FAILED" : "ok");
+    return failed;
+}
@@ -0,0 +1,57 @@
+/*
+ * hw.c (host stub)
+ * Storage for the registers declared in stub/xc.h, and fakes for the few
+ * kernel and driver calls the tested sources make. The tests drive
+ * stub_tick and stub_tmr2 to move time.
+ */
+
+#include <stdint.h>
+
+#include "xc.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "hw.h"
+
+#define SFR(name) volatile uint16_t name; volatile sfr_bits_t name##bits
+
+SFR(CLKDIV); SFR(OSCCON); SFR(OSCTUN); SFR(REFOCONL); SFR(REFOCONH); SFR(REFOTRIMH);
+SFR(PMD1); SFR(PMD2); SFR(PMD3); SFR(PMD4); SFR(PMD6); SFR(PMD7); SFR(PMD8);
+SFR(IFS0); SFR(IFS1); SFR(IEC0); SFR(IEC1);
+SFR(TMR1); SFR(PR1); SFR(T1CON); SFR(IPC0);
+SFR(U1MODE); SFR(U1STA); SFR(U1BRG); SFR(U1TXREG); SFR(U1RXREG);
+SFR(U1ADMD); SFR(U1SCCON); SFR(U1SCINT); SFR(U1GTC); SFR(U1WTCL); SFR(U1WTCH);
+SFR(I2C1BRG); SFR(I2C1CONL); SFR(I2C1STAT); SFR(I2C1TRN); SFR(I2C1RCV);
+
+TickType_t stub_tick = 0;
+uint32_t stub_tmr2 = 0;
+unsigned stub_trace_events = 0;
+
+
+TickType_t xTaskGetTickCount(void)
+{
+    return stub_tick;
+}
+
+uint32_t TMR2_Counter32BitGet(void)
+{
+    return stub_tmr2;
+}
+
+void trace_event(uint8_t type, uint8_t arg)
+{
+    (void)type;
+    (void)arg;
+    stub_trace_events++;
+}
+
+void stub_hw_reset(void)
+{
+    //The waits the drivers spin on must end at once: the transmitter is
+    //empty and an oscillator switch completes with the PLL locked
+    U1STAbits.TRMT = 1;
+    U1STAbits.UTXBF = 0;
+    OSCCONbits.OSWEN = 0;
+    OSCCONbits.LOCK = 1;
+    stub_tick = 0;
+    stub_tmr2 = 0;
+}
@@ -0,0 +1,19 @@
+/*
+ * hw.h (host stub)
+ * Time sources and setup for tests that link drivers against stub/xc.h.
+ */
+
+#ifndef HW_STUB_H
+#define HW_STUB_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+extern TickType_t stub_tick;        //xTaskGetTickCount()
+extern uint32_t stub_tmr2;          //TMR2_Counter32BitGet(), Fcy cycles
+extern unsigned stub_trace_events;
+
+//Sets the status bits the drivers wait on so their loops end
+void stub_hw_reset(void);
+
+#endif /* HW_STUB_H */
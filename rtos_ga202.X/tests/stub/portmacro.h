@@ -0,0 +1,41 @@
+/*
+ * portmacro.h (host stub)
+ * Just enough of the PIC24 port for FreeRTOS.h to compile on a PC: the
+ * same types, and critical sections that do nothing (the tests are single
+ * threaded and nothing interrupts them).
+ */
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#include <stdint.h>
+
+#define portCHAR        char
+#define portFLOAT       float
+#define portDOUBLE      double
+#define portLONG        long
+#define portSHORT       short
+#define portSTACK_TYPE  uint16_t
+#define portBASE_TYPE   short
+
+typedef portSTACK_TYPE StackType_t;
+typedef short BaseType_t;
+typedef unsigned short UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY               ( TickType_t ) 0xffffffffUL
+#define portBYTE_ALIGNMENT          2
+#define portSTACK_GROWTH            1
+#define portTICK_PERIOD_MS          ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+
+#define portDISABLE_INTERRUPTS()    ((void)0)
+#define portENABLE_INTERRUPTS()     ((void)0)
+#define portENTER_CRITICAL()        ((void)0)
+#define portEXIT_CRITICAL()         ((void)0)
+#define portYIELD()                 ((void)0)
+#define portNOP()                   ((void)0)
+
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,47 @@
+/*
+ * xc.h (host stub)
+ * Special function registers as plain variables, so MCC drivers and the
+ * modules that program them build on a PC. A test sets the status bits a
+ * driver waits on and reads back what it wrote. Only the registers and
+ * bits the tested sources use are declared; one struct serves every
+ * register.
+ */
+
+#ifndef XC_STUB_H
+#define XC_STUB_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    //UxSTA, UxMODE
+    unsigned URXDA, OERR, UTXBF, UTXEN, TRMT, UARTEN;
+    //IFSx, IECx, IPCx
+    unsigned U1TXIF, U1TXIE, U1RXIF, U1RXIE, MI2C1IF, MI2C1IE, T1IF, T1IE;
+    unsigned U1TXIP, U1RXIP, U1ERIP, MI2C1IP, SI2C1IP, T1IP;
+    //TxCON
+    unsigned TON, TCS, TCKPS0, TCKPS1;
+    //I2CxCONL, I2CxSTAT
+    unsigned I2CEN, DISSLW, SEN, RSEN, PEN, RCEN, ACKEN, ACKDT, ACKSTAT, IWCOL;
+    //OSCCON
+    unsigned OSWEN, LOCK, COSC, NOSC;
+} sfr_bits_t;
+
+#define SFR(name) extern volatile uint16_t name; extern volatile sfr_bits_t name##bits
+
+SFR(CLKDIV); SFR(OSCCON); SFR(OSCTUN); SFR(REFOCONL); SFR(REFOCONH); SFR(REFOTRIMH);
+SFR(PMD1); SFR(PMD2); SFR(PMD3); SFR(PMD4); SFR(PMD6); SFR(PMD7); SFR(PMD8);
+SFR(IFS0); SFR(IFS1); SFR(IEC0); SFR(IEC1);
+SFR(TMR1); SFR(PR1); SFR(T1CON); SFR(IPC0);
+SFR(U1MODE); SFR(U1STA); SFR(U1BRG); SFR(U1TXREG); SFR(U1RXREG);
+SFR(U1ADMD); SFR(U1SCCON); SFR(U1SCINT); SFR(U1GTC); SFR(U1WTCL); SFR(U1WTCH);
+SFR(I2C1BRG); SFR(I2C1CONL); SFR(I2C1STAT); SFR(I2C1TRN); SFR(I2C1RCV);
+
+#undef SFR
+
+#define __builtin_write_OSCCONH(x)  ((void)(x))
+#define __builtin_write_OSCCONL(x)  ((void)(x))
+#define Nop()                       ((void)0)
+#define ClrWdt()                    ((void)0)
+
+#endif /* XC_STUB_H */
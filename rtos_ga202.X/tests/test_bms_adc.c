@@ -0,0 +1,107 @@
+/*
+ * test_bms_adc.c
+ * The divide-free ADC conversions of bms_math.c against the divisions they
+ * replace: every 14-bit VCx code at every ADCGAIN and ADCOFFSET code, and
+ * every BAT_HI/BAT_LO code.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "bms_math.h"
+
+#define ADC_CODES       (1u << 14)
+#define BATCH           16          //bms_cells_raw_to_mV() reports errors in 16 bits
+
+
+//ADCGAIN1/ADCGAIN2 give 5 bits on top of 365 uV
+static uint16_t gain_of_code(unsigned code)
+{
+    return (uint16_t)(365 + code);
+}
+
+
+//The status output's definition, spelled out again
+static uint32_t reference_mV(uint16_t raw, uint16_t gain_uV, int8_t offset_mV)
+{
+    return ((uint32_t)raw * gain_uV) / 1000u + (uint32_t)(int32_t)offset_mV;
+}
+
+
+//Counts mismatches of one gain/offset over raw codes [0, codes)
+static uint32_t sweep(uint16_t gain_uV, int8_t offset_mV, uint32_t codes)
+{
+    bms_adc_scale_t scale;
+    uint16_t raw[BATCH], mV[BATCH];
+    uint32_t bad = 0;
+
+    bms_adc_scale_init(&scale, gain_uV, offset_mV);
+    for (uint32_t base = 0; base < codes; base += BATCH)
+    {
+        uint16_t errors;
+
+        for (unsigned n = 0; n < BATCH; n++) raw[n] = (uint16_t)(base + n);
+        errors = bms_cells_raw_to_mV(&scale, raw, mV, BATCH);
+        for (unsigned n = 0; n < BATCH; n++)
+        {
+            uint32_t want = reference_mV(raw[n], gain_uV, offset_mV);
+
+            if (mV[n] != (uint16_t)want || mV[n] != (uint16_t)bms_cell_raw_to_mV(raw[n], gain_uV, offset_mV))
+                bad++;
+            if (((errors >> n) & 1u) != bms_cell_reading_is_error(raw[n], want)) bad++;
+        }
+    }
+    return bad;
+}
+
+
+static void test_cells_every_code(void)
+{
+    uint32_t bad = 0;
+
+    for (unsigned g = 0; g < 32; g++)
+    {
+        for (int offset = INT8_MIN; offset <= INT8_MAX; offset++)
+            bad += sweep(gain_of_code(g), (int8_t)offset, ADC_CODES);
+    }
+    CHECK_EQ(bad, 0);
+}
+
+
+//The reciprocal is good for any 16-bit code and any gain below 1000 uV;
+//from 1000 up the kernel falls back to the division
+static void test_cells_wide(void)
+{
+    static const uint16_t gains[] = { 1, 250, 365, 396, 500, 999, 1000, 1001, 4000, 65535 };
+    uint32_t bad = 0;
+
+    for (unsigned i = 0; i < sizeof(gains) / sizeof(gains[0]); i++)
+    {
+        bad += sweep(gains[i], 0, 1u << 16);
+        bad += sweep(gains[i], -128, 1u << 16);
+    }
+    CHECK_EQ(bad, 0);
+}
+
+
+static void test_pack_every_code(void)
+{
+    uint32_t bad = 0;
+
+    for (uint32_t raw = 0; raw <= UINT16_MAX; raw++)
+    {
+        uint32_t got = bms_pack_raw_to_mV((uint16_t)raw);
+
+        if (got != raw + raw * 9u / 10u || got != (uint32_t)((uint16_t)raw * 1.9f)) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+
+int main(void)
+{
+    test_cells_every_code();
+    test_cells_wide();
+    test_pack_every_code();
+    return check_done("bms_adc");
+}
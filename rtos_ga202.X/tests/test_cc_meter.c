@@ -0,0 +1,208 @@
+/*
+ * test_cc_meter.c
+ * Charge integrated from Coulomb Counter readings with cc_meter_add(),
+ * across missed readings and long gaps, against the exact charge of a
+ * known current profile.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "check.h"
+#include "cc_meter.h"
+
+
+static void test_first_reading(void)
+{
+    cc_meter_t m;
+    uint32_t dt = 123;
+
+    cc_meter_init(&m);
+    CHECK(cc_meter_add(&m, 2.0f, 1000, &dt) == 0.0f);
+    CHECK_EQ(dt, 0);
+    CHECK_EQ(m.readings, 1);
+    CHECK_EQ(m.gap_max_ms, 0);
+
+    CHECK(cc_meter_add(&m, 4.0f, 3000, &dt) == 3.0f);
+    CHECK_EQ(dt, 2000);
+    CHECK(cc_meter_add(&m, -4.0f, 3250, &dt) == 0.0f);
+    CHECK_EQ(dt, 250);
+    CHECK_EQ(m.readings, 3);
+    CHECK_EQ(m.gap_max_ms, 2000);
+}
+
+
+//The interval across the wrap of the tick count
+static void test_tick_wrap(void)
+{
+    cc_meter_t m;
+    uint32_t dt;
+
+    cc_meter_init(&m);
+    cc_meter_add(&m, 1.0f, 0xFFFFFF00UL, &dt);
+    CHECK(cc_meter_add(&m, 3.0f, 0x100, &dt) == 2.0f);
+    CHECK_EQ(dt, 0x200);
+    CHECK_EQ(m.gap_max_ms, 0x200);
+}
+
+
+//Charge in mAh as the firmware counts it
+static double integrate(const double *amps, const uint32_t *ms, int n, uint32_t *gap_max)
+{
+    cc_meter_t m;
+    double mAh = 0;
+    uint32_t dt;
+
+    cc_meter_init(&m);
+    for (int i = 0; i < n; i++)
+    {
+        float mean = cc_meter_add(&m, (float)amps[i], ms[i], &dt);
+        mAh += mean * (dt / 3600.0);
+    }
+    *gap_max = m.gap_max_ms;
+    return mAh;
+}
+
+
+//A current that moves in straight lines between readings is counted
+//exactly, however far apart and irregular the readings are
+static void test_linear_exact(void)
+{
+    static const uint32_t ms[] = { 0, 2000, 4000, 4250, 34250, 36250, 143254, 145254, 145504 };
+    double amps[9];
+    uint32_t gap;
+    double truth;
+
+    //1.5 A at 0 rising at 10 mA/s: the charge is the mean over the span
+    for (int i = 0; i < 9; i++) amps[i] = 1.5 + 0.01 * (ms[i] / 1000.0);
+    truth = (amps[0] + amps[8]) / 2 * (ms[8] / 3600.0);
+    CHECK(fabs(integrate(amps, ms, 9, &gap) - truth) < 1e-3 * truth);
+    CHECK_EQ(gap, 143254 - 36250);
+}
+
+
+//Ground truth: a discharge triangle between 0.1 and 2 A every 300 s,
+//integrated in 1 ms steps. Each reading is the mean of the 250 ms
+//conversion that ended at it, as on the BQ76920.
+static double profile_A(double t)
+{
+    double phase = fmod(t, 300) / 300;
+
+    return 0.1 + 1.9 * (phase < 0.5 ? 2 * phase : 2 - 2 * phase);
+}
+
+static double truth_mAh(uint32_t from_ms, uint32_t to_ms)
+{
+    double sum = 0;
+
+    for (uint32_t t = from_ms; t < to_ms; t++) sum += profile_A((t + 0.5) / 1000.0);
+    return sum / 3600.0;
+}
+
+static double conversion_A(uint32_t at_ms)
+{
+    return truth_mAh(at_ms - 250, at_ms) * 3600.0 / 250.0;
+}
+
+
+//Readings every period_ms, with one missed from each skip_every (0: none)
+//and none at all between outage_from and outage_to. Returns the error
+//against the truth from the first reading to the last, in mAh.
+static double run_schedule(uint32_t period_ms, int skip_every, uint32_t outage_from, uint32_t outage_to)
+{
+    const uint32_t end_ms = 2400000;
+    cc_meter_t m;
+    double mAh = 0;
+    uint32_t first = 0, last = 0, dt;
+    int k = 0;
+
+    cc_meter_init(&m);
+    for (uint32_t t = 1000; t <= end_ms; t += period_ms, k++)
+    {
+        float mean;
+
+        if (skip_every != 0 && k % skip_every == skip_every - 1) continue;
+        if (t >= outage_from && t < outage_to) continue;
+        mean = cc_meter_add(&m, (float)conversion_A(t), t, &dt);
+        mAh += mean * (dt / 3600.0);
+        if (first == 0) first = t;
+        last = t;
+    }
+    return mAh - truth_mAh(first, last);
+}
+
+
+static void test_ground_truth(void)
+{
+    double truth = truth_mAh(1000, 2400000);
+    double err;
+
+    //Every 2 s measurement reading
+    err = run_schedule(2000, 0, 0, 0);
+    CHECK(fabs(err) < 0.001 * truth);
+
+    //Missed readings and a 30 s bus outage only widen intervals
+    err = run_schedule(2000, 7, 1000000, 1030000);
+    CHECK(fabs(err) < 0.001 * truth);
+
+    //Periodic every 20 s with the outage, and one reading every 97 s. The
+    //only error left is the tips of the triangle, cut by the straight
+    //line across the interval they fall in.
+    err = run_schedule(20000, 0, 1000000, 1030000);
+    CHECK(fabs(err) < 0.005 * truth);
+    err = run_schedule(97000, 0, 0, 0);
+    CHECK(fabs(err) < 0.02 * truth);
+}
+
+
+//A load that switches on inside an interval: holding the new reading
+//over the whole interval counts the time before the step at the new
+//current, always too much; the trapezoid is off by at most half the
+//interval either way, and by nothing on average over the step times
+static void test_step_unbiased(void)
+{
+    const double before_A = 0.1, after_A = 2.0;
+    const uint32_t dt_ms = 20000;
+    const int steps = 400;
+    double sum = 0, held_sum = 0, worst = 0;
+
+    for (int i = 0; i < steps; i++)
+    {
+        double x = (i + 0.5) / steps;               //step at this fraction of the interval
+        double truth = (before_A * x + after_A * (1 - x)) * dt_ms / 3600.0;
+        cc_meter_t m;
+        uint32_t dt;
+        double counted;
+
+        cc_meter_init(&m);
+        cc_meter_add(&m, (float)before_A, 0, &dt);
+        counted = cc_meter_add(&m, (float)after_A, dt_ms, &dt) * (dt / 3600.0);
+        sum += counted - truth;
+        held_sum += after_A * dt_ms / 3600.0 - truth;
+        if (fabs(counted - truth) > worst) worst = fabs(counted - truth);
+    }
+    CHECK(worst <= (after_A - before_A) * dt_ms / 3600.0 / 2 + 1e-6);
+    CHECK(fabs(sum / steps) < 1e-4);
+    CHECK(held_sum / steps > 0.4 * (after_A - before_A) * dt_ms / 3600.0);
+}
+
+
+static void test_mode_names(void)
+{
+    CHECK(cc_meter_mode_name(CC_METER_CONTINUOUS)[0] == 'c');
+    CHECK(cc_meter_mode_name(CC_METER_PERIODIC)[0] == 'p');
+    CHECK(cc_meter_mode_name(CC_METER_ONESHOT)[0] == 'o');
+    CHECK(cc_meter_mode_name(CC_METER_MODES)[0] == '?');
+}
+
+
+int main(void)
+{
+    test_first_reading();
+    test_tick_wrap();
+    test_linear_exact();
+    test_ground_truth();
+    test_step_unbiased();
+    test_mode_names();
+    return check_done("cc_meter");
+}
@@ -0,0 +1,192 @@
+/*
+ * test_cell_stats.c
+ * The O(1) rolling windows of cell_stats.c against a brute-force pass over
+ * the kept samples after every snapshot, and the clamps of
+ * cell_stats_init().
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "check.h"
+#include "cell_stats.h"
+
+#define SNAPSHOTS   20000
+#define CELLS       CELL_STATS_MAX_CELLS
+
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 8;
+}
+
+
+//Cell voltages with long runs of equal values (ties in the min/max
+//queues), slow drifts and the odd extreme reading
+static void snapshot(uint16_t mV[CELLS], uint32_t k)
+{
+    for (int c = 0; c < CELLS; c++)
+    {
+        uint32_t r = rnd();
+
+        switch (c % 4)
+        {
+        case 0: mV[c] = (uint16_t)(3600 + (r % 3)); break;
+        case 1: mV[c] = (uint16_t)(3000 + (k / 7) % 1200); break;
+        case 2: mV[c] = (uint16_t)(r % 4300); break;
+        default: mV[c] = (uint16_t)((r % 97) == 0 ? (r & 1 ? 65535 : 0) : 3300 + r % 50); break;
+        }
+    }
+}
+
+
+//Samples as cell_stats_add() forms them, and the window over the last
+//`window` of them done the slow way
+typedef struct
+{
+    uint16_t sample[SNAPSHOTS][CELLS];
+    uint32_t samples;
+    uint32_t block_sum[CELLS];
+    uint32_t block_count;
+} reference_t;
+
+static reference_t ref;
+
+static bool reference_add(uint8_t decimate, const uint16_t mV[CELLS])
+{
+    for (int c = 0; c < CELLS; c++) ref.block_sum[c] += mV[c];
+    if (++ref.block_count < decimate) return false;
+    for (int c = 0; c < CELLS; c++)
+    {
+        ref.sample[ref.samples][c] = (uint16_t)((ref.block_sum[c] + decimate / 2) / decimate);
+        ref.block_sum[c] = 0;
+    }
+    ref.block_count = 0;
+    ref.samples++;
+    return true;
+}
+
+static void reference_get(uint8_t window, int cell, cell_stat_t *out)
+{
+    uint32_t n = ref.samples < window ? ref.samples : window;
+    double sum = 0, sq = 0;
+
+    out->min_mV = UINT16_MAX;
+    out->max_mV = 0;
+    for (uint32_t i = ref.samples - n; i < ref.samples; i++)
+    {
+        uint16_t x = ref.sample[i][cell];
+
+        if (x < out->min_mV) out->min_mV = x;
+        if (x > out->max_mV) out->max_mV = x;
+        sum += x;
+    }
+    out->mean_mV = (float)(sum / n);
+    for (uint32_t i = ref.samples - n; i < ref.samples; i++)
+    {
+        double d = ref.sample[i][cell] - sum / n;
+        sq += d * d;
+    }
+    out->sd_mV = (float)sqrt(sq / n);
+}
+
+
+//Every statistic after every snapshot; stops at the first mismatch
+static void compare_run(uint8_t window, uint8_t decimate)
+{
+    static cell_stats_t cs;
+    uint16_t mV[CELLS];
+    uint32_t mismatches = 0;
+
+    memset(&ref, 0, sizeof(ref));
+    rnd_state = (uint32_t)window * 31u + decimate;
+    cell_stats_init(&cs, CELLS, window, decimate);
+
+    for (uint32_t k = 0; k < SNAPSHOTS && mismatches == 0; k++)
+    {
+        cell_stat_t got, want;
+        double mean_lo = 1e9, mean_hi = 0;
+        uint8_t weakest = 0xFF, want_weakest = 0;
+
+        snapshot(mV, k);
+        CHECK_EQ(cell_stats_add(&cs, mV), reference_add(decimate, mV));
+        if (ref.samples == 0)
+        {
+            CHECK(!cell_stats_get(&cs, 0, &got));
+            CHECK(cell_stats_imbalance_mV(&cs, &weakest) == 0.0f);
+            continue;
+        }
+
+        for (int c = 0; c < CELLS; c++)
+        {
+            CHECK(cell_stats_get(&cs, (uint8_t)c, &got));
+            reference_get(window, c, &want);
+            if (got.min_mV != want.min_mV || got.max_mV != want.max_mV ||
+                fabsf(got.mean_mV - want.mean_mV) > 1e-3f + 1e-6f * want.mean_mV ||
+                fabsf(got.sd_mV - want.sd_mV) > 1e-3f + 1e-5f * want.sd_mV)
+                mismatches++;
+            if (want.mean_mV < mean_lo)
+            {
+                mean_lo = want.mean_mV;
+                want_weakest = (uint8_t)c;
+            }
+            if (want.mean_mV > mean_hi) mean_hi = want.mean_mV;
+        }
+        if (fabs(cell_stats_imbalance_mV(&cs, &weakest) - (mean_hi - mean_lo)) > 1e-3 + 1e-6 * mean_hi ||
+            weakest != want_weakest)
+            mismatches++;
+        if (mismatches != 0) printf("window %u decimate %u: mismatch at snapshot %u\n", window, decimate, k);
+    }
+    CHECK_EQ(mismatches, 0);
+    if (mismatches == 0) CHECK_EQ(ref.samples, SNAPSHOTS / decimate);
+}
+
+
+static void test_brute_force(void)
+{
+    compare_run(16, 1);
+    compare_run(7, 3);
+    compare_run(1, 1);
+}
+
+
+static void test_init_clamps(void)
+{
+    static cell_stats_t cs;
+    uint16_t mV[CELLS] = { 0 };
+    cell_stat_t st;
+
+    cell_stats_init(&cs, CELLS, 0, 0);
+    CHECK_EQ(cs.window, 1);
+    CHECK_EQ(cs.decimate, 1);
+
+    cell_stats_init(&cs, 255, CELL_STATS_MAX_WINDOW + 1, 255);
+    CHECK_EQ(cs.cells, CELL_STATS_MAX_CELLS);
+    CHECK_EQ(cs.window, CELL_STATS_MAX_WINDOW);
+    CHECK_EQ(cs.decimate, CELL_STATS_MAX_DECIMATE);
+
+    //A window clamped to the maximum keeps the last CELL_STATS_MAX_WINDOW
+    //samples, not more
+    cell_stats_init(&cs, CELLS, 255, 1);
+    for (uint16_t i = 1; i <= 3 * CELL_STATS_MAX_WINDOW; i++)
+    {
+        mV[0] = i;
+        cell_stats_add(&cs, mV);
+    }
+    CHECK(cell_stats_get(&cs, 0, &st));
+    CHECK_EQ(st.min_mV, 2 * CELL_STATS_MAX_WINDOW + 1);
+    CHECK_EQ(st.max_mV, 3 * CELL_STATS_MAX_WINDOW);
+    CHECK(!cell_stats_get(&cs, CELLS, &st));
+}
+
+
+int main(void)
+{
+    test_brute_force();
+    test_init_clamps();
+    return check_done("cell_stats");
+}
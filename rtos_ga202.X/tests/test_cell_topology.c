@@ -0,0 +1,213 @@
+/*
+ * test_cell_topology.c
+ * VC input masks of every topologies[] entry and the mapping of a VC1..TS1
+ * burst to cells.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "check.h"
+#include "bms_math.h"
+#include "cell_topology.h"
+
+#define ADC_GAIN_UV     365
+#define ADC_OFFSET_MV   (-12)
+
+typedef struct
+{
+    bms_afe_t afe;
+    uint8_t cells;
+    uint16_t vc_mask;
+} expected_t;
+
+//GROUP_3 is 0x13 (VCx1, VCx2, VCx5), GROUP_4 0x17, GROUP_5 0x1F, one per
+//five inputs from VC1
+static const expected_t expected[] =
+{
+    { BMS_AFE_BQ76920,  3, 0x0013 },
+    { BMS_AFE_BQ76920,  4, 0x0017 },
+    { BMS_AFE_BQ76920,  5, 0x001F },
+    { BMS_AFE_BQ76930,  6, 0x0273 },
+    { BMS_AFE_BQ76930,  7, 0x0277 },
+    { BMS_AFE_BQ76930,  8, 0x02F7 },
+    { BMS_AFE_BQ76930,  9, 0x02FF },
+    { BMS_AFE_BQ76930, 10, 0x03FF },
+    { BMS_AFE_BQ76940,  9, 0x4E73 },
+    { BMS_AFE_BQ76940, 10, 0x4E77 },
+    { BMS_AFE_BQ76940, 11, 0x4EF7 },
+    { BMS_AFE_BQ76940, 12, 0x5EF7 },
+    { BMS_AFE_BQ76940, 13, 0x5EFF },
+    { BMS_AFE_BQ76940, 14, 0x5FFF },
+    { BMS_AFE_BQ76940, 15, 0x7FFF },
+};
+
+#define EXPECTED_COUNT  (sizeof(expected) / sizeof(expected[0]))
+
+
+static uint8_t bits(uint16_t mask)
+{
+    uint8_t n = 0;
+
+    for (; mask != 0; mask >>= 1) n += mask & 1;
+    return n;
+}
+
+
+static void test_inputs(void)
+{
+    CHECK_EQ(cell_topology_inputs(BMS_AFE_BQ76920), 5);
+    CHECK_EQ(cell_topology_inputs(BMS_AFE_BQ76930), 10);
+    CHECK_EQ(cell_topology_inputs(BMS_AFE_BQ76940), 15);
+    CHECK_EQ(CELL_TOPOLOGY_INPUTS(BMS_AFE_BQ76940), CELL_TOPOLOGY_MAX_CELLS);
+}
+
+
+//Exactly the listed entries exist, with the listed masks
+static void test_masks(void)
+{
+    unsigned found = 0;
+
+    for (unsigned i = 0; i < EXPECTED_COUNT; i++)
+    {
+        const cell_topology_t *t = cell_topology_find(expected[i].afe, expected[i].cells);
+
+        CHECK(t != NULL);
+        if (t == NULL) continue;
+        CHECK_EQ(t->afe, expected[i].afe);
+        CHECK_EQ(t->cells, expected[i].cells);
+        CHECK_EQ(t->vc_mask, expected[i].vc_mask);
+    }
+
+    for (int afe = BMS_AFE_BQ76920; afe <= BMS_AFE_BQ76940; afe++)
+    {
+        for (uint8_t cells = 0; cells <= 16; cells++)
+        {
+            if (cell_topology_find((bms_afe_t)afe, cells) != NULL) found++;
+        }
+    }
+    CHECK_EQ(found, EXPECTED_COUNT);
+    CHECK(cell_topology_find(BMS_AFE_BQ76920, 2) == NULL);
+    CHECK(cell_topology_find(BMS_AFE_BQ76920, 6) == NULL);
+    CHECK(cell_topology_find(BMS_AFE_BQ76930, 5) == NULL);
+    CHECK(cell_topology_find(BMS_AFE_BQ76940, 16) == NULL);
+}
+
+
+//Wiring rules the masks must follow: every group of five has its bottom
+//two and top input connected, and lower groups never have fewer cells
+static void test_groups(void)
+{
+    for (unsigned i = 0; i < EXPECTED_COUNT; i++)
+    {
+        const cell_topology_t *t = cell_topology_find(expected[i].afe, expected[i].cells);
+        uint8_t groups = (uint8_t)(cell_topology_inputs(expected[i].afe) / 5);
+        uint8_t previous = 5;
+
+        if (t == NULL) continue;
+        CHECK_EQ(bits(t->vc_mask), t->cells);
+        CHECK_EQ(t->vc_mask >> cell_topology_inputs(t->afe), 0);
+        for (uint8_t g = 0; g < groups; g++)
+        {
+            uint16_t group = (t->vc_mask >> (5 * g)) & 0x1F;
+
+            CHECK_EQ(group & 0x13, 0x13);
+            CHECK(bits(group) <= previous);
+            previous = bits(group);
+        }
+    }
+}
+
+
+//Each VC input gets its own code, so a cell taken from the wrong input or
+//in the wrong order shows up
+static uint16_t input_raw(uint8_t vc)
+{
+    return (uint16_t)(9000 + 100 * vc);
+}
+
+
+static void fill_frame(uint8_t *frame)
+{
+    for (uint8_t vc = 0; vc < CELL_TOPOLOGY_MAX_CELLS; vc++)
+    {
+        frame[2 * vc] = (uint8_t)(input_raw(vc) >> 8);
+        frame[2 * vc + 1] = (uint8_t)input_raw(vc);
+    }
+    frame[CELL_TOPOLOGY_BAT_OFFSET] = 0x3A;
+    frame[CELL_TOPOLOGY_BAT_OFFSET + 1] = 0x98;
+    frame[CELL_TOPOLOGY_TS1_OFFSET] = 0x0F;
+    frame[CELL_TOPOLOGY_TS1_OFFSET + 1] = 0xA0;
+}
+
+
+static void test_frame_mapping(void)
+{
+    bms_adc_scale_t scale;
+    uint8_t frame[CELL_TOPOLOGY_FRAME_BYTES];
+    cell_frame_t out;
+
+    bms_adc_scale_init(&scale, ADC_GAIN_UV, ADC_OFFSET_MV);
+    for (unsigned i = 0; i < EXPECTED_COUNT; i++)
+    {
+        const cell_topology_t *t = cell_topology_find(expected[i].afe, expected[i].cells);
+        uint8_t cell = 0;
+
+        if (t == NULL) continue;
+        fill_frame(frame);
+        memset(&out, 0, sizeof(out));
+        cell_topology_convert(t, frame, &scale, &out);
+
+        for (uint8_t vc = 0; vc < CELL_TOPOLOGY_MAX_CELLS; vc++)
+        {
+            if (!(t->vc_mask & (1u << vc))) continue;
+            CHECK_EQ(cell_topology_input(t, cell), vc);
+            CHECK_EQ(out.raw[cell], input_raw(vc));
+            CHECK_EQ(out.mV[cell], bms_cell_raw_to_mV(input_raw(vc), ADC_GAIN_UV, ADC_OFFSET_MV));
+            cell++;
+        }
+        CHECK_EQ(cell, t->cells);
+        CHECK_EQ(out.errors, 0);
+        CHECK_EQ(out.bat_raw, 0x3A98);
+        CHECK_EQ(out.bat_mV, bms_pack_raw_to_mV(0x3A98));
+        CHECK_EQ(out.ts1_raw, 0x0FA0);
+
+        //An open wire on the top cell's input is flagged on that cell only
+        uint8_t top = cell_topology_input(t, (uint8_t)(t->cells - 1));
+        frame[2 * top] = 0;
+        frame[2 * top + 1] = 0;
+        cell_topology_convert(t, frame, &scale, &out);
+        CHECK_EQ(out.errors, 1u << (t->cells - 1));
+    }
+}
+
+
+//Inputs left out of the topology never reach the cells, however they read
+static void test_unused_inputs_ignored(void)
+{
+    const cell_topology_t *t = cell_topology_find(BMS_AFE_BQ76920, 3);
+    bms_adc_scale_t scale;
+    uint8_t frame[CELL_TOPOLOGY_FRAME_BYTES];
+    cell_frame_t out;
+
+    bms_adc_scale_init(&scale, ADC_GAIN_UV, ADC_OFFSET_MV);
+    fill_frame(frame);
+    frame[2 * 2] = frame[2 * 2 + 1] = 0;        //VC3 and VC4 shorted to VC2
+    frame[2 * 3] = frame[2 * 3 + 1] = 0;
+    cell_topology_convert(t, frame, &scale, &out);
+    CHECK_EQ(out.errors, 0);
+    CHECK_EQ(out.raw[0], input_raw(0));
+    CHECK_EQ(out.raw[1], input_raw(1));
+    CHECK_EQ(out.raw[2], input_raw(4));
+}
+
+
+int main(void)
+{
+    test_inputs();
+    test_masks();
+    test_groups();
+    test_frame_mapping();
+    test_unused_inputs_ignored();
+    return check_done("cell_topology");
+}
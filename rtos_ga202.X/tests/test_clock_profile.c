@@ -0,0 +1,136 @@
+/*
+ * test_clock_profile.c
+ * Divisors of the two clock profiles (PR1, U1BRG, I2C1BRG) and what
+ * clock_profile_set() programs or refuses.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "hw.h"
+#include "clock.h"
+#include "clock_profile.h"
+#include "i2c1.h"
+#include "uart1.h"
+
+
+//Fcy 2 MHz (4 MHz FRC/2): 1 ms tick is 250 counts at 1:8
+static void test_low_power_divisors(void)
+{
+    clock_profile_divisors_t div;
+
+    clock_profile_divisors(CLOCK_PROFILE_LOW_POWER, 9600, 100000, &div);
+    CHECK_EQ(div.fcy_hz, 2000000);
+    CHECK_EQ(div.tick_pr1, 249);
+    CHECK_EQ(div.uart_brg, 51);                 //9615 baud
+    CHECK_EQ(div.uart_error_permille, 1);
+    CHECK_EQ(div.i2c_brg, 8);                   //Fcy / (2 * (8 + 2)) = 100 kHz
+
+    clock_profile_divisors(CLOCK_PROFILE_LOW_POWER, 57600, 400000, &div);
+    CHECK_EQ(div.uart_brg, 8);                  //55556 baud, out of tolerance
+    CHECK_EQ(div.uart_error_permille, -35);
+    CHECK_EQ(div.i2c_brg, 0);                   //400 kHz needs BRG 0.5
+
+    clock_profile_divisors(CLOCK_PROFILE_LOW_POWER, 115200, 100000, &div);
+    CHECK_EQ(div.uart_brg, 3);
+    CHECK_EQ(div.uart_error_permille, 85);
+}
+
+
+//Fcy 16 MHz (32 MHz FRC x4 PLL)
+static void test_performance_divisors(void)
+{
+    clock_profile_divisors_t div;
+
+    clock_profile_divisors(CLOCK_PROFILE_PERFORMANCE, 9600, 100000, &div);
+    CHECK_EQ(div.fcy_hz, 16000000);
+    CHECK_EQ(div.tick_pr1, 1999);
+    CHECK_EQ(div.uart_brg, 416);                //9592 baud
+    CHECK_EQ(div.uart_error_permille, 0);
+    CHECK_EQ(div.i2c_brg, 78);
+
+    clock_profile_divisors(CLOCK_PROFILE_PERFORMANCE, 115200, 400000, &div);
+    CHECK_EQ(div.uart_brg, 34);                 //114286 baud
+    CHECK_EQ(div.uart_error_permille, -7);
+    CHECK_EQ(div.i2c_brg, 18);                  //16 MHz / 40 = 400 kHz
+}
+
+
+//Rates the clock can't reach are refused, however large: 4 * baud and
+//2 * fscl must not wrap to a zero divisor ("baud 1073741824" on the
+//console)
+static void test_rate_limits(void)
+{
+    static const uint32_t too_fast[] = { 4000001UL, 0x3FFFFFFFUL, 0x40000000UL, 0x80000000UL, 0xFFFFFFFFUL };
+    clock_profile_divisors_t div;
+    int16_t error;
+
+    CHECK_EQ(UART1_BRGCompute(16000000, 4000000, &error), 0);  //Fcy / 4 exactly
+    CHECK_EQ(error, 0);
+    for (unsigned i = 0; i < sizeof(too_fast) / sizeof(too_fast[0]); i++)
+    {
+        error = 0;
+        CHECK_EQ(UART1_BRGCompute(16000000, too_fast[i], &error), 0);
+        CHECK_EQ(error, INT16_MAX);
+    }
+    CHECK_EQ(UART1_BRGCompute(16000000, 0, &error), 0);
+    CHECK_EQ(error, INT16_MAX);
+
+    clock_profile_divisors(CLOCK_PROFILE_PERFORMANCE, 0x40000000UL, 100000, &div);
+    CHECK_EQ(div.uart_error_permille, INT16_MAX);
+    clock_profile_divisors(CLOCK_PROFILE_PERFORMANCE, 9600, 0x80000000UL, &div);
+    CHECK_EQ(div.i2c_brg, 0);
+
+    stub_hw_reset();
+    CLOCK_SystemFrequencyHz = _XTAL_FREQ;
+    UART1_Initialize();
+    CHECK(!UART1_BaudRateSet(0x40000000UL));
+    CHECK_EQ(U1BRG, 51);
+}
+
+
+//Every divisor must follow a switch, and a switch the baud rate can't
+//survive must leave all of them alone
+static void test_profile_switch(void)
+{
+    stub_hw_reset();
+    CLOCK_SystemFrequencyHz = _XTAL_FREQ;
+    UART1_Initialize();
+    I2C1_Initialize();
+    PR1 = 249;
+    CHECK_EQ(U1BRG, 51);
+    CHECK_EQ(I2C1BRG, 8);
+
+    CHECK(clock_profile_set(CLOCK_PROFILE_PERFORMANCE));
+    CHECK_EQ(clock_profile_get(), CLOCK_PROFILE_PERFORMANCE);
+    CHECK_EQ(CLOCK_SystemFrequencyHz, 32000000);
+    CHECK_EQ(PR1, 1999);
+    CHECK_EQ(U1BRG, 416);
+    CHECK_EQ(I2C1BRG, 78);
+    CHECK(I2C1CONLbits.I2CEN);
+
+    CHECK(UART1_BaudRateSet(115200));
+    CHECK_EQ(U1BRG, 34);
+    CHECK(!clock_profile_set(CLOCK_PROFILE_LOW_POWER));
+    CHECK_EQ(clock_profile_get(), CLOCK_PROFILE_PERFORMANCE);
+    CHECK_EQ(CLOCK_SystemFrequencyHz, 32000000);
+    CHECK_EQ(PR1, 1999);
+    CHECK_EQ(U1BRG, 34);
+
+    CHECK(UART1_BaudRateSet(19200));
+    CHECK(clock_profile_set(CLOCK_PROFILE_LOW_POWER));
+    CHECK_EQ(CLOCK_SystemFrequencyHz, 4000000);
+    CHECK_EQ(PR1, 249);
+    CHECK_EQ(U1BRG, 25);
+    CHECK_EQ(I2C1BRG, 8);
+}
+
+
+int main(void)
+{
+    test_low_power_divisors();
+    test_performance_divisors();
+    test_rate_limits();
+    test_profile_switch();
+    return check_done("clock_profile");
+}
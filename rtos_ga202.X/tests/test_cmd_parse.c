@@ -0,0 +1,326 @@
+/*
+ * test_cmd_parse.c
+ * The number parser at the edges of 32 bits, the argument schema (missing
+ * and surplus arguments), the command lines in corpus/cmd_parse and a
+ * random pass checking that a handler only ever sees arguments its schema
+ * allows.
+ *
+ * Run from tests/, where make runs it, so the corpus path resolves.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "check.h"
+#include "cmd_parse.h"
+
+#define CORPUS          "corpus/cmd_parse"
+#define FUZZ_LINES      200000
+#define LINE_MAX        96
+
+
+static cmd_args_t seen;
+static unsigned calls;
+
+static bool record(const cmd_args_t *args)
+{
+    seen = *args;
+    calls++;
+    return true;
+}
+
+//Register writes take a byte, like the firmware's
+static bool write_byte(const cmd_args_t *args)
+{
+    record(args);
+    return args->num[0] <= 0xFF && args->num[1] <= 0xFF;
+}
+
+static const cmd_entry_t table[] =
+{
+    { CMD_KEY("g"),     "g",     "",   record,     "g" },
+    { CMD_KEY("write"), "write", "NN", write_byte, "write <reg> <value>" },
+    { CMD_KEY("read"),  "read",  "Ww", record,     "read <reg|range> [count]" },
+    { CMD_KEY("baud"),  "baud",  "n",  record,     "baud [rate]" },
+    { CMD_KEY("i2c"),   "i2c",   "w",  record,     "i2c [speed|reset]" },
+};
+
+#define TABLE_SIZE      ((uint8_t)(sizeof(table) / sizeof(table[0])))
+
+
+static cmd_status_t run(const char *text)
+{
+    char line[LINE_MAX * 4];
+    const cmd_entry_t *e;
+
+    strncpy(line, text, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    return cmd_dispatch(table, TABLE_SIZE, line, &e);
+}
+
+
+static void test_numbers(void)
+{
+    uint32_t v = 0;
+
+    CHECK(cmd_parse_uint("4294967295", &v));
+    CHECK_EQ(v, 4294967295u);
+    CHECK(!cmd_parse_uint("4294967296", &v));
+    CHECK(!cmd_parse_uint("4294967300", &v));
+    CHECK(!cmd_parse_uint("42949672950", &v));
+    CHECK(cmd_parse_uint("0000000000004294967295", &v));
+    CHECK_EQ(v, 4294967295u);
+
+    CHECK(cmd_parse_uint("0xFFFFFFFF", &v));
+    CHECK_EQ(v, 0xFFFFFFFFu);
+    CHECK(cmd_parse_uint("0Xffffffff", &v));
+    CHECK_EQ(v, 0xFFFFFFFFu);
+    CHECK(!cmd_parse_uint("0x100000000", &v));
+    CHECK(!cmd_parse_uint("0x1FFFFFFFF", &v));
+    CHECK(cmd_parse_uint("0x0000000000FF", &v));
+    CHECK_EQ(v, 0xFF);
+
+    //No digits: the value is left alone
+    v = 7;
+    CHECK(!cmd_parse_uint("", &v));
+    CHECK(!cmd_parse_uint("0x", &v));
+    CHECK(!cmd_parse_uint("0X", &v));
+    CHECK(!cmd_parse_uint("x1", &v));
+    CHECK(!cmd_parse_uint("-1", &v));
+    CHECK(!cmd_parse_uint("+1", &v));
+    CHECK_EQ(v, 7);
+
+    //Something after the digits
+    CHECK(!cmd_parse_uint("1 ", &v));
+    CHECK(!cmd_parse_uint("0x1g", &v));
+    CHECK(!cmd_parse_uint("12ab", &v));
+
+    CHECK(cmd_parse_uint("0", &v));
+    CHECK_EQ(v, 0);
+
+    //cmd_parse_number() stops at the first non-digit
+    CHECK(strcmp(cmd_parse_number("6-10", &v), "-10") == 0);
+    CHECK_EQ(v, 6);
+    CHECK(cmd_parse_number("0x", &v) == NULL);
+}
+
+
+static void test_tokenize(void)
+{
+    char line[1024];
+    const char *words[4];
+    size_t i;
+
+    strcpy(line, "  a bb   ccc ");
+    CHECK_EQ(cmd_tokenize(line, words, 4), 3);
+    CHECK(strcmp(words[0], "a") == 0 && strcmp(words[1], "bb") == 0 && strcmp(words[2], "ccc") == 0);
+    CHECK(words[3] == NULL);
+
+    //More words than room: counted, not stored, and the count saturates
+    for (i = 0; i < 300; i++)
+    {
+        line[2 * i] = 'w';
+        line[2 * i + 1] = ' ';
+    }
+    line[2 * i] = '\0';
+    CHECK_EQ(cmd_tokenize(line, words, 4), 0xFF);
+    CHECK(run("g 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20") == CMD_BAD_ARGS);
+}
+
+
+static void test_schema(void)
+{
+    //Missing required arguments
+    CHECK(run("write") == CMD_BAD_ARGS);
+    CHECK(run("write 5") == CMD_BAD_ARGS);
+    CHECK(run("read") == CMD_BAD_ARGS);
+
+    //Too many
+    CHECK(run("g 1") == CMD_BAD_ARGS);
+    CHECK(run("write 5 3 1") == CMD_BAD_ARGS);
+    CHECK(run("read 1 2 3") == CMD_BAD_ARGS);
+    CHECK(run("baud 9600 8") == CMD_BAD_ARGS);
+
+    //Optional ones may be left out, and read back as NULL and 0
+    calls = 0;
+    CHECK(run("baud") == CMD_OK);
+    CHECK_EQ(seen.argc, 0);
+    CHECK(seen.argv[0] == NULL);
+    CHECK_EQ(seen.num[0], 0);
+    CHECK(run("read 0x04") == CMD_OK);
+    CHECK_EQ(seen.argc, 1);
+    CHECK(strcmp(seen.argv[0], "0x04") == 0 && seen.argv[1] == NULL);
+    CHECK(run("write 4294967295 0xFF") == CMD_REJECTED);
+    CHECK_EQ(seen.num[0], 4294967295u);
+    CHECK_EQ(seen.num[1], 0xFF);
+    CHECK_EQ(calls, 3);
+
+    //The handler never runs for a line the schema refuses
+    calls = 0;
+    CHECK(run("write 4294967296 1") == CMD_BAD_ARGS);
+    CHECK(run("write 0x100000000 1") == CMD_BAD_ARGS);
+    CHECK(run("write 0x 1") == CMD_BAD_ARGS);
+    CHECK(run("baud 0x") == CMD_BAD_ARGS);
+    CHECK_EQ(calls, 0);
+
+    CHECK(run("") == CMD_EMPTY);
+    CHECK(run("    ") == CMD_EMPTY);
+    CHECK(run("wrote 5 3") == CMD_UNKNOWN);     //same key as write
+}
+
+
+static cmd_status_t status_of(const char *word)
+{
+    static const char *const names[] = { "ok", "empty", "unknown", "args", "rejected" };
+
+    for (int s = CMD_OK; s <= CMD_REJECTED; s++)
+    {
+        if (strcmp(word, names[s]) == 0) return (cmd_status_t)s;
+    }
+    return (cmd_status_t)-1;
+}
+
+
+static void test_corpus(void)
+{
+    FILE *f = fopen(CORPUS, "r");
+    char text[LINE_MAX * 4];
+    unsigned number = 0, lines = 0, wrong = 0;
+
+    CHECK(f != NULL);
+    if (f == NULL) return;
+    while (fgets(text, sizeof(text), f) != NULL)
+    {
+        char *line = strchr(text, ' ');
+        char *end;
+        cmd_status_t want, got;
+
+        number++;
+        text[strcspn(text, "\n")] = '\0';
+        if (text[0] == '#' || text[0] == '\0') continue;
+        CHECK(line != NULL);
+        if (line == NULL) continue;
+        *line++ = '\0';
+        if ((end = strrchr(line, '|')) != NULL) *end = '\0';
+
+        want = status_of(text);
+        CHECK(want <= CMD_REJECTED);
+        got = run(line);
+        if (got != want)
+        {
+            printf("%s:%u: \"%s\" gave %d, want %s\n", CORPUS, number, line, got, text);
+            wrong++;
+        }
+        lines++;
+    }
+    fclose(f);
+    CHECK(lines > 0);
+    CHECK_EQ(wrong, 0);
+}
+
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245u + 12345u;
+    return rnd_state >> 8;
+}
+
+//Lines made of the pieces the parser cares about: names (and near
+//misses), numbers around the 32-bit edges, hex prefixes and runs of
+//spaces. Most start with a name, so most reach a handler's schema.
+static void random_line(char *line)
+{
+    static const char *const names[] = { "g", "write", "read", "baud", "i2c" };
+    static const char *const pieces[] =
+    {
+        "g", "write", "read", "baud", "i2c", "wrote", "reed", "i2", "",
+        "0", "5", "255", "256", "4294967295", "4294967296", "99999999999",
+        "0x", "0X", "0xFF", "0xFFFFFFFF", "0x100000000", "0x1g", "-1", "x",
+        " ", "  ", "\t", "reset", "6-10",
+    };
+    size_t len = 0;
+    unsigned n = rnd() % 8;
+
+    line[0] = '\0';
+    if (rnd() % 4)
+    {
+        strcpy(line, names[rnd() % (sizeof(names) / sizeof(names[0]))]);
+        strcat(line, " ");
+        len = strlen(line);
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        const char *p = pieces[rnd() % (sizeof(pieces) / sizeof(pieces[0]))];
+        const char *sep = (rnd() % 4) ? " " : "";
+
+        if (len + strlen(p) + strlen(sep) >= LINE_MAX) break;
+        strcat(line, p);
+        strcat(line, sep);
+        len += strlen(p) + strlen(sep);
+    }
+}
+
+//Whatever the line, a handler sees only what its schema allows
+static void test_random(void)
+{
+    unsigned bad = 0, ran = 0;
+
+    for (unsigned k = 0; k < FUZZ_LINES; k++)
+    {
+        char line[LINE_MAX], copy[LINE_MAX];
+        const cmd_entry_t *e;
+        cmd_status_t s;
+        unsigned before = calls;
+        size_t len;
+
+        random_line(line);
+        strcpy(copy, line);
+        s = cmd_dispatch(table, TABLE_SIZE, line, &e);
+
+        if ((s == CMD_OK || s == CMD_REJECTED) != (calls == before + 1) || calls > before + 1) bad++;
+        if ((s == CMD_EMPTY || s == CMD_UNKNOWN) != (e == NULL)) bad++;
+        if (calls == before) continue;
+        ran++;
+
+        len = strlen(e->schema);
+        if (seen.argc > len || seen.argc > CMD_MAX_ARGS) bad++;
+        for (unsigned i = 0; i < CMD_MAX_ARGS; i++)
+        {
+            char kind = i < len ? e->schema[i] : '\0';
+            uint32_t v;
+
+            if (i >= seen.argc)
+            {
+                if (seen.argv[i] != NULL || seen.num[i] != 0 || kind == 'N' || kind == 'W') bad++;
+                continue;
+            }
+            if (seen.argv[i] == NULL || seen.argv[i][0] == '\0' || strchr(seen.argv[i], ' ') != NULL) bad++;
+            else if (kind == 'N' || kind == 'n')
+            {
+                if (!cmd_parse_uint(seen.argv[i], &v) || v != seen.num[i]) bad++;
+            }
+            else if (seen.num[i] != 0) bad++;
+        }
+        if (bad != 0)
+        {
+            printf("random: \"%s\" broke the schema\n", copy);
+            break;
+        }
+    }
+    CHECK_EQ(bad, 0);
+    if (bad == 0) CHECK(ran > FUZZ_LINES / 10);
+}
+
+
+int main(void)
+{
+    test_numbers();
+    test_tokenize();
+    test_schema();
+    test_corpus();
+    test_random();
+    return check_done("cmd_parse");
+}
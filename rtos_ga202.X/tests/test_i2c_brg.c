@@ -0,0 +1,194 @@
+/*
+ * test_i2c_brg.c
+ * I2C1 baud rate generator values and the start-to-stop transaction timing,
+ * with the master interrupt stepped through whole transactions.
+ */
+
+#include <stdint.h>
+
+#include "check.h"
+#include "hw.h"
+#include "clock.h"
+#include "i2c1.h"
+
+//Defined by the driver without a prototype in i2c1.h
+void _MI2C1Interrupt(void);
+uint8_t I2C1_ErrorCountGet(void);
+
+#define BQ76920_ADDR    0x08
+
+
+//SCL = Fcy / (2 * (BRG + 2))
+static uint32_t scl_hz(uint32_t fcy, uint16_t brg)
+{
+    return fcy / (2UL * (brg + 2UL));
+}
+
+
+static void test_brg_values(void)
+{
+    CHECK_EQ(I2C1_BRGCompute(2000000, 100000), 8);
+    CHECK_EQ(I2C1_BRGCompute(2000000, 400000), 0);      //BRG 0.5, not supported
+    CHECK_EQ(I2C1_BRGCompute(16000000, 100000), 78);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 400000), 18);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 0), 0);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 100), 0);        //BRG above 16 bits
+
+    //Fcy / 8 is the fastest; beyond it 2 * fscl must not wrap to a zero
+    //divisor ("i2c 2147483648" on the console)
+    CHECK_EQ(I2C1_BRGCompute(16000000, 2000000), 2);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 2000001), 0);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 0x7FFFFFFFUL), 0);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 0x80000000UL), 0);
+    CHECK_EQ(I2C1_BRGCompute(16000000, 0xFFFFFFFFUL), 0);
+    CHECK_EQ(I2C1_BRGCompute(2000000, 250000), 2);
+    CHECK_EQ(I2C1_BRGCompute(2000000, 250001), 0);
+}
+
+
+//Over a sweep of clocks and speeds the bus never runs faster than asked,
+//and one step faster would
+static void test_brg_never_fast(void)
+{
+    static const uint32_t fcys[] = { 2000000, 4000000, 8000000, 16000000 };
+
+    for (unsigned i = 0; i < sizeof(fcys) / sizeof(fcys[0]); i++)
+    {
+        for (uint32_t fscl = 10000; fscl <= 1000000; fscl += 2500)
+        {
+            uint16_t brg = I2C1_BRGCompute(fcys[i], fscl);
+            if (brg == 0)
+            {
+                CHECK(fcys[i] / (2 * fscl) < 4);        //too fast for this clock
+                continue;
+            }
+            CHECK(scl_hz(fcys[i], brg) <= fscl);
+            if (brg > 2) CHECK(scl_hz(fcys[i], (uint16_t)(brg - 1)) > fscl);
+        }
+    }
+}
+
+
+static void test_bus_speed(void)
+{
+    stub_hw_reset();
+    CLOCK_SystemFrequencyHz = 4000000UL;    //Fcy 2 MHz
+    I2C1_Initialize();
+    CHECK_EQ(I2C1BRG, 8);
+    CHECK_EQ(I2C1_BusSpeedGet(), I2C1_DEFAULT_BUS_SPEED_HZ);
+
+    CHECK(!I2C1_BusSpeedSet(I2C1_FAST_MODE_HZ));
+    CHECK_EQ(I2C1BRG, 8);
+    CHECK_EQ(I2C1_BusSpeedGet(), I2C1_DEFAULT_BUS_SPEED_HZ);
+
+    CLOCK_SystemFrequencyHz = 32000000UL;   //Fcy 16 MHz
+    I2C1_BRGUpdate();
+    CHECK_EQ(I2C1BRG, 78);
+    CHECK(I2C1_BusSpeedSet(I2C1_FAST_MODE_HZ));
+    CHECK_EQ(I2C1BRG, 18);
+    CHECK_EQ(I2C1CONLbits.DISSLW, 0);       //slew control on in fast mode
+    CHECK(I2C1CONLbits.I2CEN);
+
+    CHECK(I2C1_BusSpeedSet(I2C1_DEFAULT_BUS_SPEED_HZ));
+    CHECK_EQ(I2C1CONLbits.DISSLW, 1);
+
+    CHECK(!I2C1_BusSpeedSet(0x80000000UL));
+    CHECK_EQ(I2C1BRG, 78);
+    CHECK_EQ(I2C1_BusSpeedGet(), I2C1_DEFAULT_BUS_SPEED_HZ);
+}
+
+
+//One interrupt: clears the control bits the last step set, runs the ISR and
+//lets the bus time of what it started pass (1 bit for a start or stop,
+//9 for a byte and its ACK). Returns the cycles that passed.
+static uint32_t bus_step(uint32_t bit_cycles)
+{
+    uint32_t bits = 0;
+
+    I2C1CONLbits.SEN = 0;
+    I2C1CONLbits.RSEN = 0;
+    I2C1CONLbits.PEN = 0;
+    I2C1TRN = 0xFFFF;
+    _MI2C1Interrupt();
+
+    if (I2C1TRN != 0xFFFF) bits = 9;
+    else if (I2C1CONLbits.SEN || I2C1CONLbits.RSEN || I2C1CONLbits.PEN) bits = 1;
+    stub_tmr2 += bits * bit_cycles;
+    return bits * bit_cycles;
+}
+
+
+//A register write (address, register, value) from start to stop. The last
+//interrupt is the stop completing, which records the time.
+static uint32_t register_write(uint32_t bit_cycles, I2C1_MESSAGE_STATUS *status)
+{
+    uint8_t buf[2] = { 0x04, 0x18 };
+    uint32_t cycles = 0;
+
+    I2C1_MasterWrite(buf, sizeof(buf), BQ76920_ADDR, status);
+    CHECK(IFS1bits.MI2C1IF);
+    do
+    {
+        cycles += bus_step(bit_cycles);
+    } while (*status == I2C1_MESSAGE_PENDING);
+    bus_step(bit_cycles);
+    return cycles;
+}
+
+
+static void test_transaction_timing(void)
+{
+    I2C1_MESSAGE_STATUS status;
+    I2C1_TIMING t;
+    uint32_t cycles;
+
+    //100 kHz at Fcy 2 MHz: 20 cycles a bit, 29 bits
+    stub_hw_reset();
+    CLOCK_SystemFrequencyHz = 4000000UL;
+    I2C1_Initialize();
+    I2C1STATbits.ACKSTAT = 0;
+    cycles = register_write(2 * (8 + 2), &status);
+    CHECK_EQ(status, I2C1_MESSAGE_COMPLETE);
+    CHECK_EQ(cycles, 29 * 20);
+    I2C1_TimingGet(&t);
+    CHECK_EQ(t.count, 1);
+    CHECK_EQ(t.last_us, 290);
+
+    //400 kHz at Fcy 16 MHz, across a TMR2 wrap: microseconds follow the clock
+    CLOCK_SystemFrequencyHz = 32000000UL;
+    I2C1_BRGUpdate();
+    CHECK(I2C1_BusSpeedSet(I2C1_FAST_MODE_HZ));
+    stub_tmr2 = 0xFFFFFF00UL;
+    cycles = register_write(2 * (18 + 2), &status);
+    CHECK_EQ(cycles, 29 * 40);
+    I2C1_TimingGet(&t);
+    CHECK_EQ(t.count, 2);
+    CHECK_EQ(t.last_us, 72);                //1160 cycles at 16 per us
+    CHECK_EQ(t.min_us, 72);
+    CHECK_EQ(t.max_us, 290);
+    CHECK_EQ(t.total_us, 362);
+
+    //An address NACK ends at the stop too, and is counted as an error
+    I2C1STATbits.ACKSTAT = 1;
+    register_write(2 * (18 + 2), &status);
+    CHECK_EQ(status, I2C1_DATA_NO_ACK);
+    CHECK_EQ(I2C1_ErrorCountGet(), 1);
+    I2C1_TimingGet(&t);
+    CHECK_EQ(t.count, 3);
+    CHECK_EQ(t.last_us, 27);                //start + address + stop: 11 bits
+
+    I2C1_TimingReset();
+    I2C1_TimingGet(&t);
+    CHECK_EQ(t.count, 0);
+    CHECK_EQ(t.min_us, 0xFFFF);
+}
+
+
+int main(void)
+{
+    test_brg_values();
+    test_brg_never_fast();
+    test_bus_speed();
+    test_transaction_timing();
+    return check_done("i2c_brg");
+}
@@ -0,0 +1,181 @@
+/*
+ * test_power_state.c
+ * The Active/Idle decisions of power_update() over quiet time, current,
+ * the OV/UV margin and the state in effect, and the SYS_CTRL1/SYS_CTRL2
+ * values of power_ctrl1(), power_ctrl2() and power_ship_value() for every
+ * register value.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "check.h"
+#include "power_state.h"
+
+#define CTRL1_KEPT      ((uint8_t)~(POWER_CTRL1_LOAD_PRESENT | POWER_CTRL1_ADC_EN | POWER_CTRL1_SHUT_A))
+#define CTRL2_KEPT      ((uint8_t)~(POWER_CTRL2_CC_EN | POWER_CTRL2_CC_ONESHOT))
+#define SHUT_BITS       (POWER_CTRL1_SHUT_A | POWER_CTRL1_SHUT_B)
+
+static const power_config_t cfg = { 300000, 50, 100 };
+
+
+static void test_quiet_to_idle(void)
+{
+    power_t p;
+
+    power_init(&p);
+    CHECK_EQ(p.state, POWER_ACTIVE);
+    CHECK_EQ(p.reason, POWER_REASON_BOOT);
+    CHECK_EQ(p.quiet_ms, 0);
+
+    //Quiet below idle_mA either way, Idle asked for at idle_after_ms
+    CHECK_EQ(power_update(&p, &cfg, 0.049f, 0xFFFF, 299999), POWER_ACTIVE);
+    CHECK_EQ(p.quiet_ms, 299999);
+    CHECK_EQ(power_update(&p, &cfg, -0.049f, 0xFFFF, 1), POWER_IDLE);
+    CHECK_EQ(p.quiet_ms, 300000);
+    CHECK_EQ(p.state, POWER_ACTIVE);        //only power_entered() changes it
+
+    //Current restarts the quiet time, in either direction
+    CHECK_EQ(power_update(&p, &cfg, 0.050f, 0xFFFF, 1000), POWER_ACTIVE);
+    CHECK_EQ(p.quiet_ms, 0);
+    power_update(&p, &cfg, 0.0f, 0xFFFF, 1000);
+    CHECK_EQ(power_update(&p, &cfg, -0.050f, 0xFFFF, 1000), POWER_ACTIVE);
+    CHECK_EQ(p.quiet_ms, 0);
+
+    //A command does too
+    power_update(&p, &cfg, 0.0f, 0xFFFF, 200000);
+    power_activity(&p);
+    CHECK_EQ(p.quiet_ms, 0);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 0xFFFF, 200000), POWER_ACTIVE);
+
+    //The quiet time saturates instead of wrapping back to Active
+    p.quiet_ms = UINT32_MAX - 5;
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 0xFFFF, 1000), POWER_IDLE);
+    CHECK_EQ(p.quiet_ms, UINT32_MAX);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 0xFFFF, UINT32_MAX), POWER_IDLE);
+    CHECK_EQ(p.quiet_ms, UINT32_MAX);
+}
+
+
+static void test_held_active(void)
+{
+    power_config_t manual = cfg;
+    power_t p;
+
+    //Within limit_margin_mV of OV or UV the ADC stays on, however quiet
+    power_init(&p);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 100, 400000), POWER_ACTIVE);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 0, 400000), POWER_ACTIVE);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 101, 0), POWER_IDLE);
+
+    //idle_after_ms 0: only on command
+    manual.idle_after_ms = 0;
+    power_init(&p);
+    CHECK_EQ(power_update(&p, &manual, 0.0f, 0xFFFF, UINT32_MAX), POWER_ACTIVE);
+}
+
+
+static void test_idle_and_ship(void)
+{
+    power_t p;
+
+    power_init(&p);
+    p.quiet_ms = 1234;
+    power_entered(&p, POWER_IDLE, POWER_REASON_QUIET);
+    CHECK_EQ(p.state, POWER_IDLE);
+    CHECK_EQ(p.reason, POWER_REASON_QUIET);
+    CHECK_EQ(p.quiet_ms, 0);
+
+    //Idle stays Idle without current, whatever the margin; current wakes it
+    CHECK_EQ(power_update(&p, &cfg, 0.049f, 0xFFFF, 1000), POWER_IDLE);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 0, 1000), POWER_IDLE);
+    CHECK_EQ(p.quiet_ms, 0);
+    CHECK_EQ(power_update(&p, &cfg, -0.2f, 0xFFFF, 1000), POWER_ACTIVE);
+
+    //Ship is left only by the chip restarting, never by a measurement
+    power_entered(&p, POWER_SHIP, POWER_REASON_COMMAND);
+    CHECK_EQ(power_update(&p, &cfg, 5.0f, 0xFFFF, 1000), POWER_SHIP);
+    CHECK_EQ(power_update(&p, &cfg, 0.0f, 0xFFFF, 400000), POWER_SHIP);
+    power_entered(&p, POWER_ACTIVE, POWER_REASON_RESET);
+    CHECK_EQ(p.reason, POWER_REASON_RESET);
+}
+
+
+static void test_registers(void)
+{
+    unsigned bad = 0;
+
+    for (unsigned v = 0; v <= 0xFF; v++)
+    {
+        uint8_t r = (uint8_t)v;
+        uint8_t active1 = power_ctrl1(POWER_ACTIVE, r), idle1 = power_ctrl1(POWER_IDLE, r);
+        uint8_t active2 = power_ctrl2(POWER_ACTIVE, r), idle2 = power_ctrl2(POWER_IDLE, r);
+
+        //SYS_CTRL1: ADC_EN by state, never LOAD_PRESENT or SHUT_A, the rest kept
+        if ((active1 & CTRL1_KEPT) != (r & CTRL1_KEPT) || (idle1 & CTRL1_KEPT) != (r & CTRL1_KEPT)) bad++;
+        if (!(active1 & POWER_CTRL1_ADC_EN) || (idle1 & POWER_CTRL1_ADC_EN)) bad++;
+        if ((active1 | idle1) & (POWER_CTRL1_LOAD_PRESENT | POWER_CTRL1_SHUT_A)) bad++;
+        if (power_ctrl1(POWER_SHIP, r) != idle1) bad++;
+
+        //SYS_CTRL2: CC_EN by state, never CC_ONESHOT, the FETs and the rest kept
+        if ((active2 & CTRL2_KEPT) != (r & CTRL2_KEPT) || (idle2 & CTRL2_KEPT) != (r & CTRL2_KEPT)) bad++;
+        if (!(active2 & POWER_CTRL2_CC_EN) || (idle2 & POWER_CTRL2_CC_EN)) bad++;
+        if ((active2 | idle2) & POWER_CTRL2_CC_ONESHOT) bad++;
+        if (power_ctrl2(POWER_SHIP, r) != idle2) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+
+static void test_ship_sequence(void)
+{
+    static const uint8_t shut[POWER_SHIP_WRITES] = { 0, POWER_CTRL1_SHUT_B, POWER_CTRL1_SHUT_A };
+    uint8_t kept = (uint8_t)~(POWER_CTRL1_LOAD_PRESENT | SHUT_BITS);
+    unsigned bad = 0;
+
+    //SYS_CTRL1 as Idle leaves it after the firmware's 0x19
+    CHECK_EQ(power_ship_value(0x09, 0), 0x08);
+    CHECK_EQ(power_ship_value(0x09, 1), 0x09);
+    CHECK_EQ(power_ship_value(0x09, 2), 0x0A);
+    CHECK_EQ(power_ship_value(0x19, 2), 0x1A);
+
+    for (unsigned v = 0; v <= 0xFF; v++)
+    {
+        uint8_t r = (uint8_t)v;
+
+        for (uint8_t n = 0; n < POWER_SHIP_WRITES; n++)
+        {
+            uint8_t w = power_ship_value(r, n);
+
+            if ((w & SHUT_BITS) != shut[n] || (w & kept) != (r & kept) || (w & POWER_CTRL1_LOAD_PRESENT)) bad++;
+        }
+        //Out of range starts the sequence over instead of shipping
+        if (power_ship_value(r, POWER_SHIP_WRITES) != power_ship_value(r, 0)) bad++;
+        if (power_ship_value(r, 0xFF) != power_ship_value(r, 0)) bad++;
+    }
+    CHECK_EQ(bad, 0);
+}
+
+
+static void test_names(void)
+{
+    CHECK(strcmp(power_state_name(POWER_ACTIVE), "active") == 0);
+    CHECK(strcmp(power_state_name(POWER_IDLE), "idle") == 0);
+    CHECK(strcmp(power_state_name(POWER_SHIP), "ship") == 0);
+    CHECK(strcmp(power_state_name(POWER_STATES), "?") == 0);
+    CHECK(strcmp(power_reason_name(POWER_REASON_LOAD), "load") == 0);
+    CHECK(strcmp(power_reason_name(POWER_REASON_RESET), "reset") == 0);
+    CHECK(strcmp(power_reason_name(POWER_REASONS), "?") == 0);
+}
+
+
+int main(void)
+{
+    test_quiet_to_idle();
+    test_held_active();
+    test_idle_and_ship();
+    test_registers();
+    test_ship_sequence();
+    test_names();
+    return check_done("power_state");
+}
@@ -0,0 +1,272 @@
+/*
+ * test_supervisor.c
+ * The liveness decisions that gate the watchdog: when a silent task
+ * trips, which task takes the blame, what the record keeps, and how a
+ * pause for a flash write moves the deadlines.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "check.h"
+#include "supervisor.h"
+
+#define PROTECT_TIMEOUT     3000
+#define MEASURE_TIMEOUT     10000
+#define TELEMETRY_TIMEOUT   10000
+
+
+//The tasks of taskBQ76920.c, registered at start
+static void setup(supervisor_t *s, uint16_t start)
+{
+    supervisor_init(s);
+    CHECK_EQ(supervisor_register(s, "protect", PROTECT_TIMEOUT, start), 0);
+    CHECK_EQ(supervisor_register(s, "measure", MEASURE_TIMEOUT, start), 1);
+    CHECK_EQ(supervisor_register(s, "telemetry", TELEMETRY_TIMEOUT, start), 2);
+}
+
+
+//Last tick at which polling still clears the WDT, polling every tick
+//from start
+static uint16_t last_clear(supervisor_t *s, uint16_t start, uint16_t limit, supervisor_record_t *r)
+{
+    uint16_t now = start;
+
+    while ((uint16_t)(now - start) < limit && supervisor_poll(s, now, r)) now++;
+    return (uint16_t)(now - 1);
+}
+
+
+static void test_register(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+
+    memset(&r, 0, sizeof(r));
+    supervisor_init(&s);
+    for (uint8_t i = 0; i < SUPERVISOR_MAX_TASKS; i++) CHECK_EQ(supervisor_register(&s, "t", 100, 0), i);
+    CHECK_EQ(supervisor_register(&s, "extra", 100, 0), SUPERVISOR_NONE);
+
+    //An unknown id changes nothing
+    supervisor_checkin(&s, SUPERVISOR_NONE, 50, 0x1234);
+    supervisor_activity(&s, SUPERVISOR_NONE, 0x1234);
+    for (uint8_t i = 0; i < SUPERVISOR_MAX_TASKS; i++)
+    {
+        CHECK_EQ(s.task[i].last_checkin, 0);
+        CHECK_EQ(s.task[i].activity, 0);
+    }
+    CHECK(supervisor_poll(&s, 100, &r));
+    CHECK(!supervisor_poll(&s, 101, &r));
+}
+
+
+//Tasks that keep checking in never trip, across the 16-bit tick wrap
+static void test_alive(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+    uint16_t now = 0xF000;
+
+    memset(&r, 0, sizeof(r));
+    setup(&s, now);
+    for (uint32_t t = 0; t < 200000; t++, now++)
+    {
+        if (t % 50 == 0) supervisor_checkin(&s, 0, now, 0x0100);
+        if (t % 2000 == 0) supervisor_checkin(&s, 1, now, 0x0200);
+        if (t % 1000 == 0) supervisor_checkin(&s, 2, now, 0);
+        if (!supervisor_poll(&s, now, &r)) break;
+    }
+    CHECK(!s.tripped);
+    CHECK(!r.pending);
+}
+
+
+//A hung task trips one tick past its timeout; the record names it, its
+//last activity and its silence, and the trip latches
+static void test_hung_task(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+    uint16_t now;
+
+    memset(&r, 0, sizeof(r));
+    setup(&s, 0);
+    supervisor_checkin(&s, 1, 1000, 0x0200);
+    supervisor_activity(&s, 1, 0x0305);             //stuck inside a cell read
+    for (now = 1000; now < 20000; now++)
+    {
+        if (now % 50 == 0) supervisor_checkin(&s, 0, now, 0x0100);
+        if (now % 1000 == 0) supervisor_checkin(&s, 2, now, 0);
+        if (!supervisor_poll(&s, now, &r)) break;
+    }
+
+    CHECK_EQ(now, 1000 + MEASURE_TIMEOUT + 1);
+    CHECK(s.tripped);
+    CHECK(r.pending);
+    CHECK_EQ(r.trips, 1);
+    CHECK(strncmp(r.name, "measure", SUPERVISOR_NAME_BYTES) == 0);
+    CHECK_EQ(r.activity, 0x0305);
+    CHECK_EQ(r.silent, MEASURE_TIMEOUT + 1);
+
+    //Latched: check-ins don't bring the WDT back
+    for (uint8_t i = 0; i < 3; i++) supervisor_checkin(&s, i, 11002, 0);
+    CHECK(!supervisor_poll(&s, 11002, &r));
+    CHECK_EQ(r.trips, 1);
+}
+
+
+//One check-in that comes late is a miss, even if the task carries on
+static void test_missed_checkin(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+    uint16_t now;
+
+    memset(&r, 0, sizeof(r));
+    supervisor_init(&s);
+    supervisor_register(&s, "protect", 100, 0);
+    for (now = 0; now <= 1000; now++)
+    {
+        if (now % 90 == 0 && now != 450) supervisor_checkin(&s, 0, now, 0x0100);
+        if (!supervisor_poll(&s, now, &r)) break;
+    }
+    CHECK_EQ(now, 360 + 100 + 1);
+    CHECK_EQ(r.silent, 101);
+    CHECK_EQ(r.activity, 0x0100);
+}
+
+
+//The spinning high priority task starves the others; with all of them
+//silent since the same tick, the one with the shortest timeout is the
+//most overdue and takes the blame
+static void test_blame_spinning(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+
+    memset(&r, 0, sizeof(r));
+    setup(&s, 0);
+    for (uint8_t i = 0; i < 3; i++) supervisor_checkin(&s, i, 500, (uint16_t)(0x0100 * (i + 1)));
+
+    //Polled late, when every task is past its timeout
+    CHECK(!supervisor_poll(&s, 500 + MEASURE_TIMEOUT + 200, &r));
+    CHECK(strncmp(r.name, "protect", SUPERVISOR_NAME_BYTES) == 0);
+    CHECK_EQ(r.activity, 0x0100);
+    CHECK_EQ(r.silent, MEASURE_TIMEOUT + 200);
+}
+
+
+//A low priority task that stopped long before the others is the one
+//furthest past its timeout, even with a longer timeout
+static void test_blame_most_overdue(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+
+    memset(&r, 0, sizeof(r));
+    setup(&s, 0);
+    supervisor_checkin(&s, 2, 100, 0);
+    supervisor_checkin(&s, 0, 7500, 0x0100);
+    supervisor_checkin(&s, 1, 7500, 0x0200);
+
+    //protect 1 tick over its timeout at 10501, telemetry 301 over
+    CHECK(!supervisor_poll(&s, 7500 + PROTECT_TIMEOUT + 1, &r));
+    CHECK(strncmp(r.name, "telemetr", SUPERVISOR_NAME_BYTES) == 0);    //kept without terminator
+    CHECK_EQ(r.silent, 7500 + PROTECT_TIMEOUT + 1 - 100);
+}
+
+
+static void test_record(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+
+    //Power-up garbage is not a record, and is cleared by the first trip
+    memset(&r, 0xA5, sizeof(r));
+    CHECK(!supervisor_record_valid(&r));
+    setup(&s, 0);
+    CHECK(!supervisor_poll(&s, PROTECT_TIMEOUT + 1, &r));
+    CHECK_EQ(r.trips, 1);
+    CHECK_EQ(r.uptime, 0);
+    CHECK(!supervisor_record_valid(&r));            //sealed by the caller
+    r.uptime = PROTECT_TIMEOUT + 1;
+    supervisor_record_seal(&r);
+    CHECK(supervisor_record_valid(&r));
+
+    //Reported, then a second trip after the reset adds to it
+    r.pending = false;
+    supervisor_record_seal(&r);
+    setup(&s, 0);
+    CHECK(!supervisor_poll(&s, PROTECT_TIMEOUT + 1, &r));
+    CHECK_EQ(r.trips, 2);
+    CHECK(r.pending);
+    supervisor_record_seal(&r);
+    CHECK(supervisor_record_valid(&r));
+
+    //Any changed byte breaks the check
+    r.silent ^= 1;
+    CHECK(!supervisor_record_valid(&r));
+    r.silent ^= 1;
+    r.name[3] ^= 0x20;
+    CHECK(!supervisor_record_valid(&r));
+}
+
+
+//No trip while paused. After the pause a task that didn't check in is
+//exactly as late as before it; one that checked in during the pause
+//counts from that check-in.
+static void test_pause(void)
+{
+    supervisor_t s;
+    supervisor_record_t r;
+    const uint16_t start = 0xFF00;                  //the pause spans the tick wrap
+    const uint16_t paused_at = (uint16_t)(start + 2500);
+    const uint16_t resumed_at = (uint16_t)(paused_at + 8000);
+
+    memset(&r, 0, sizeof(r));
+    setup(&s, start);
+    supervisor_pause(&s, paused_at);
+    for (uint16_t now = paused_at; now != resumed_at; now++) CHECK(supervisor_poll(&s, now, &r));
+    supervisor_checkin(&s, 1, (uint16_t)(paused_at + 7000), 0x0C00);
+    supervisor_resume(&s, resumed_at);
+    CHECK(!s.paused);
+
+    //protect had 500 ticks left, measure 10000 from its check-in
+    CHECK_EQ(s.task[0].last_checkin, (uint16_t)(start + 8000));
+    CHECK_EQ(s.task[1].last_checkin, (uint16_t)(paused_at + 7000));
+    CHECK_EQ(last_clear(&s, resumed_at, 20000, &r), (uint16_t)(resumed_at + 500));
+    CHECK(strncmp(r.name, "protect", SUPERVISOR_NAME_BYTES) == 0);
+    CHECK_EQ(r.silent, PROTECT_TIMEOUT + 1);
+
+    //A task already overdue when the pause starts, but not polled yet,
+    //trips at the first poll after it with the silence it had
+    memset(&r, 0, sizeof(r));
+    setup(&s, 0);
+    supervisor_pause(&s, PROTECT_TIMEOUT + 10);
+    supervisor_resume(&s, PROTECT_TIMEOUT + 2000);
+    CHECK(!supervisor_poll(&s, PROTECT_TIMEOUT + 2000, &r));
+    CHECK(strncmp(r.name, "protect", SUPERVISOR_NAME_BYTES) == 0);
+    CHECK_EQ(r.silent, PROTECT_TIMEOUT + 10);
+
+    //A trip before the pause stays latched through it
+    memset(&r, 0, sizeof(r));
+    setup(&s, 0);
+    CHECK(!supervisor_poll(&s, PROTECT_TIMEOUT + 1, &r));
+    supervisor_pause(&s, PROTECT_TIMEOUT + 2);
+    CHECK(!supervisor_poll(&s, PROTECT_TIMEOUT + 3, &r));
+    CHECK_EQ(r.trips, 1);
+}
+
+
+int main(void)
+{
+    test_register();
+    test_alive();
+    test_hung_task();
+    test_missed_checkin();
+    test_blame_spinning();
+    test_blame_most_overdue();
+    test_record();
+    test_pause();
+    return check_done("supervisor");
+}